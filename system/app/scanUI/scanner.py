@@ -693,6 +693,10 @@ class Scanner():
     if syncedRawImageDir != '':
       for camera in scanDict['cameraParameters']['cameraIDNumbers']:
         pathlib.Path(syncedRawImageDir + '/camera' + str(camera)).mkdir(parents=True, exist_ok=True)
+    localRawImageDir = fileParameters.get('localRawImageDir', '')  # Mirrored to syncedRawImageDir by the scanner
+    if localRawImageDir != '' and syncedRawImageDir != '':
+      for camera in scanDict['cameraParameters']['cameraIDNumbers']:
+        pathlib.Path(localRawImageDir + '/camera' + str(camera)).mkdir(parents=True, exist_ok=True)
     # Create the files.
     csvFileSynced = pathlib.Path(fileParameters['syncedScanDataDir'] + '/' + csvFile)
     csvFileLocal = pathlib.Path(fileParameters['localScanDataDir'] + '/' + csvFile)
@@ -19,5 +19,10 @@ class TiffInterface {
   virtual int ReadScanline(void* buf, uint32_t row) = 0;
   virtual int WriteScanline(void* buf, uint32_t row) = 0;
 
+  // Read/write a whole strip of rows.  size is in bytes (-1 to read the whole strip)
+  // @returns bytes read/written, -1 on error
+  virtual int ReadEncodedStrip(uint32_t strip, void* buf, int size) = 0;
+  virtual int WriteEncodedStrip(uint32_t strip, void* buf, int size) = 0;
+
   virtual int WriteDirectory() = 0;
 };
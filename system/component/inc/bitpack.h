@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Pack and unpack rows of pixels to/from the MSbit-first layout used by
+//   TIFF (and MATLAB) for bit depths other than 16.  See frame.cpp.
+// 8, 10 and 12 bits use kernels that work on whole groups of pixels
+//   (4 pixels -> 5 bytes for 10-bit, 2 pixels -> 3 bytes for 12-bit) with
+//   no carried state, so the compiler can unroll and vectorize them.
+//   Other depths fall back to a bit-serial loop.
+namespace BitPack {
+
+// Bytes needed for a row of n pixels
+inline size_t RowBytes(size_t n, int bits) {
+  return (n * bits + 7) / 8;
+}
+
+// Pack one row
+// @param in n pixels; bits above `bits` are ignored
+// @param out RowBytes(n, bits) bytes.  Unused bits of the last byte are zeroed
+void PackMsb(const uint16_t* in, size_t n, int bits, uint8_t* out);
+
+// Unpack one row
+void UnpackMsb(const uint8_t* in, size_t n, int bits, uint16_t* out);
+
+}  // namespace BitPack
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
+#include <cstdint>
+#include <future>
 #include <mutex>
 #include <thread>
 #include <vector>
@@ -67,6 +70,20 @@ class ExecNode {
   // Check if this ExecNode has any data waiting to be processed
   bool IsExecDone();
 
+  // Barrier on the data this node has received so far
+  // The future becomes ready once all of it has been finished with by this
+  //   node and every node downstream (AtExit has run).  Data arriving after
+  //   the call is not waited for, so this completes while frames stream.
+  // Example:
+  //   std::future<void> done = camera.Drain();
+  //   if (done.wait_for(std::chrono::seconds(5)) != std::future_status::ready) ...
+  std::future<void> Drain();
+
+  // Wait for the data received so far to be finished with
+  // @param timeout_ms how long to wait, or -1 to wait forever
+  // @returns true if it was
+  bool WaitExecDone(int timeout_ms = -1);
+
   // Set the maximum number of threads on this system
   static void SetNumberThreads(size_t threads);
 
@@ -86,6 +103,12 @@ class ExecNode {
   // @param return value from the Exec() of this node
   virtual void AtExit(void* data) {}
 
+  // Whether a was received before b.  Data is retired in the order received,
+  //   whatever order Exec() runs in, so a node combining several pieces of
+  //   data must hand the result on with the earliest of them
+  // @note a and b must both be in Exec()
+  bool ReceivedBefore(void* a, void* b);
+
  private:
   // Run a nodes Exec(), potentially call downstream nodes
   //   Exec or upstream nodes AtExit() depending on producers/
@@ -96,11 +119,18 @@ class ExecNode {
   bool Schedule(void* data, ExecNode* producer);
 
   // Run upstream node cleanup
-  void CleanUp(void* data, ExecNode* consumer);
+  // @param retired filled with the nodes that finished with data, to be
+  //   Retire()d once the leaf is done
+  void CleanUp(void* data, ExecNode* consumer, std::vector<ExecNode*>* retired);
 
   // Run scheduled ExecNodes based on run_list
   void Run(const std::vector<bool>& run_list, void* data);
 
+  // Count data finished with
+  // @param drained filled with the Drain() promises this satisfies, to be
+  //   completed once the caller is done with this node
+  void Retire(std::vector<std::promise<void>>* drained);
+
 
   // Class used by ExecNodes to manage thread execution
   class ThreadManager {
@@ -141,6 +171,9 @@ class ExecNode {
 
   CircularBuffer<void*> up_queue_;
   std::vector<int> up_;
+  // Producer each piece of data in up_queue_ came from.  An unsynced node
+  //   gets different data from each producer, and cleans up only its own
+  CircularBuffer<ExecNode*> up_from_;
 
   std::mutex mutex_;
   std::mutex cleanup_;
@@ -148,4 +181,10 @@ class ExecNode {
   //   to be run.
   std::condition_variable order_;
   bool sync_ = true;
+
+  // Data pushed to / popped from up_queue_, for Drain()
+  std::atomic<uint64_t> admitted_{ 0 };
+  uint64_t retired_ = 0;
+  std::mutex drain_mutex_;
+  std::vector<std::pair<uint64_t, std::promise<void>>> drains_;
 };
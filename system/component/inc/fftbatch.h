@@ -0,0 +1,87 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "fftw3.h"
+
+// Batched 2D real to complex FFTs for threads each holding one frame
+// Threads that call Transform() while the transforms already running use
+//   every runner are stacked into one batch, and transformed together by a
+//   single fftw_plan_many_dft_r2c plan.  With a runner free a frame is
+//   transformed straight away, so batching adds no latency until frames back up.
+// Batches are capped at max_batch frames, and at however many frames can be
+//   transformed within latency_ms, as measured.
+// Memory is (max_running + 1) x max_batch input and output buffers.
+// Example:
+//   FFTBatch batch(width, height);
+//   batch.Transform([&](double* in) { CopyFrame(fr, in); },          // from each ExecNode thread
+//                   [&](const fftw_complex* out) { Power(out, t); });
+class FFTBatch {
+ public:
+  struct Stats {
+    uint64_t frames = 0;
+    uint64_t batches = 0;
+    int largest = 0;           // most frames in one batch
+    double us_per_frame = 0;   // recent average transform time
+  };
+
+  // Plan transforms of 1 to max_batch frames
+  // @param width horizontal pixels
+  // @param height vertical pixels
+  // @param max_batch most frames transformed together
+  // @param latency_ms most time one batched transform should take
+  // @param max_running transforms run at once.  Frames queue up while all
+  //   are running
+  // @param flags FFTW planner flags.  Wisdom is read from and saved to fftw.wis
+  FFTBatch(int width, int height, int max_batch = 4, int latency_ms = 20, int max_running = 2,
+           unsigned flags = FFTW_MEASURE);
+
+  // @note no Transform() may be in progress
+  ~FFTBatch();
+
+  int FftWidth() const { return fft_width_; }
+  int FftHeight() const { return height_; }
+
+  // Transform one frame, along with any others waiting.  Blocks until done
+  // @param fill writes the width x height input, row by row
+  // @param use reads the FftWidth() x FftHeight() output, row by row
+  void Transform(const std::function<void(double* in)>& fill,
+                 const std::function<void(const fftw_complex* out)>& use);
+
+  // Most frames a batch may take now, from max_batch and latency_ms
+  int Limit();
+
+  Stats GetStats();
+
+ private:
+  struct Batch {
+    double* in;
+    fftw_complex* out;
+    bool busy = false;  // open, running, or being read
+    int n = 0;          // frames in the batch
+    int filled = 0;     // inputs written
+    int unread = 0;     // outputs not yet used
+    bool done = false;
+  };
+
+  // @note caller holds mutex_
+  int LimitLocked() const;
+
+  int width_, height_, fft_width_;
+  size_t in_dist_, out_dist_;  // between frames of a batch
+  int max_batch_;
+  int latency_us_;
+  int max_running_;
+  std::vector<fftw_plan> plans_;  // plans_[k - 1] transforms k frames
+  std::vector<Batch> batches_;
+
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  Batch* open_ = NULL;  // batch frames may join
+  int running_ = 0;
+  Stats stats_;
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "fftw3.h"
+
+#include "system/component/inc/frame.h"
+
+// FFT power spectrum of frames on a pool of persistent worker threads
+// The plan and every buffer are made once.  Submit() copies a frame into a free
+//   buffer and wakes a worker, rather than starting a thread for each frame.
+// Each result holds the power spectrum (optionally log scaled) as greyscale
+//   pixels, its maximum, and the ratio of the power under the ROI mask to the
+//   power under the ROU mask.
+// Example:
+//   FFTPool pool(fr->width, fr->height);
+//   pool.SetMask(c_h, c_v, r);
+//   pool.Submit(fr);  // Frame is dropped if every worker is busy
+//   ...
+//   const FFTPool::Result* res = pool.Collect();
+//   if (res) texture.update((uint8_t*)res->px);
+class FFTPool {
+ public:
+  // Weight of each FFT bin in the ROI and ROU sums
+  struct Mask {
+    std::vector<double> roi;
+    std::vector<double> rou;
+  };
+
+  struct Result {
+    uint64_t frame;      // number of frames submitted before this one
+    double max;          // largest (log) power
+    double power;        // ROI / ROU
+    const uint32_t* px;  // FftWidth() x FftHeight() greyscale pixels
+    int64_t us;          // time to compute
+  };
+
+  // Plan the FFT and start the workers
+  // @param h_sz horizontal pixels
+  // @param v_sz vertical pixels
+  // @param n_threads number of workers, and of frames in flight
+  // @param flags FFTW planner flags.  Wisdom is read from and saved to fftw.wis
+  FFTPool(int h_sz, int v_sz, int n_threads = 2, unsigned flags = FFTW_PATIENT);
+
+  // Waits for the workers to finish their frames
+  ~FFTPool();
+
+  int FftWidth() const { return fft_h_sz_; }
+  int FftHeight() const { return fft_v_sz_; }
+
+  // Set circular ROI and ROU (its reflection) masks.  Applies to frames submitted after
+  // @param c_h horizontal centre of the ROU
+  // @param c_v vertical centre of the ROU
+  // @param r radius
+  void SetMask(int c_h, int c_v, int r);
+
+  std::shared_ptr<const Mask> GetMask();
+
+  // Set how power is scaled to pixels.  Applies to frames submitted after
+  // @param compute_log false if linear, true if log scale
+  // @param min_val value mapped to 0 (black)
+  // @param max_val value mapped to 255 (full white).  Values above saturate
+  void SetRange(bool compute_log, double min_val, double max_val);
+
+  // Copy a frame to a free worker
+  // @returns false if every worker is busy and the frame was dropped
+  bool Submit(const Frame* fr);
+
+  // Take the newest finished frame, in the order submitted.  Older finished
+  //   frames are skipped; the previous result goes back to the pool
+  // @returns NULL if no frame has finished since the last call
+  const Result* Collect();
+
+  // Wait for every submitted frame to finish
+  // @param timeout_ms how long to wait, or -1 to wait forever
+  // @returns true if no frames are in flight
+  bool Wait(int timeout_ms = -1);
+
+ private:
+  struct Slot {
+    double* in;
+    fftw_complex* out;
+    std::vector<uint32_t> px;
+    std::shared_ptr<const Mask> mask;  // as of Submit()
+    bool compute_log;
+    double m, b;
+    bool done;
+    Result result;
+  };
+
+  // Worker body
+  void Run();
+
+  // Compute one frame
+  static void Process(fftw_plan plan, int sz, Slot* slot);
+
+  int h_sz_, v_sz_, fft_h_sz_, fft_v_sz_, fft_sz_;
+  fftw_plan plan_;
+  std::vector<Slot> slots_;  // one more than the workers, for the result being shown
+
+  std::mutex mutex_;
+  std::condition_variable work_;      // pending_ has frames, or stopping
+  std::condition_variable finished_;  // a frame is done
+  std::vector<int> free_;
+  std::deque<int> pending_;  // waiting for a worker
+  std::deque<int> order_;    // in flight or done, in submission order
+  int shown_ = -1;           // slot of the last result returned by Collect()
+  uint64_t submitted_ = 0;
+  std::shared_ptr<const Mask> mask_;
+  bool compute_log_ = true;
+  double m_ = 2.5;
+  double b_ = 0;
+  bool stop_ = false;
+  std::vector<std::thread> threads_;
+};
@@ -1,13 +1,16 @@
 #pragma once
 
+#include <array>
 #include <mutex>
 
 #include "fftw3.h"
 
 #include "execnode.h"
+#include "fftbatch.h"
 #include "fftwutil.h"
 #include "frame.h"
 #include "pool.h"
+#include "preview.h"
 #include "zoomable.h"
 
 
@@ -49,6 +52,16 @@ class FFTT : public ExecNode {
   // @param y1 y coordinate of point 1
   void SubWindow2Point(int x0, int y0, int x1, int y1);
 
+  // Transform frames that back up together in batches, see FFTBatch
+  // Call before frames arrive.  Planning may take a while the first time
+  // @param max_batch most frames per transform, 1 to transform each on its own
+  // @param latency_ms most time one batched transform should take
+  // @param max_running batched transforms run at once
+  void SetBatch(int max_batch, int latency_ms = 20, int max_running = 2);
+
+  // Batching statistics, all zero when not batching
+  FFTBatch::Stats GetBatchStats();
+
   // FFT data structure
   // fft: absolute value of the fft
   // fftw_complex: output from fftw
@@ -93,6 +106,7 @@ class FFTT : public ExecNode {
   std::mutex mutex_;
 
   Pool<Tag> data_;
+  FFTBatch* batch_ = NULL;
 
   int x_sz_ = 0;
   int y_sz_ = 0;
@@ -106,6 +120,7 @@ class FFTT : public ExecNode {
 // @note deprecated, use FFTT::Tag
 typedef FFTT::Tag fft_tag;
 
+// Draws the FFT magnitude, at most once per screen refresh
 class FFTTDraw : public ExecNode, public FFTWDraw {
  public:
   // default constructor
@@ -161,7 +176,8 @@ class FFTTDraw : public ExecNode, public FFTWDraw {
   double scale_min_, scale_max_;
   double max_;
   std::mutex wr_lock_;
-  std::vector<uint32_t> px_;
+  Preview::LogScale log_;
+  Preview::RateLimit limit_;
 };
 
 // Class to draw the subwindow selected by the FFTT object
@@ -179,6 +195,9 @@ class FFTTSubWindowDraw : public ExecNode, public Zoomable {
   // @param fr example frame to consume
   void Resize(const Frame* fr);
 
+  // Move the outline to the latest subwindow, then draw it
+  void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+
  private:
   void* Exec(void* data) override;
 
@@ -188,5 +207,7 @@ class FFTTSubWindowDraw : public ExecNode, public Zoomable {
   int subwin_y_ = 0;
   int subwin_x_sz_ = 0;
   int subwin_y_sz_ = 0;
-  sf::VertexArray vertex_;
+  std::mutex wr_lock_;  // between exec threads only
+  mutable TripleBuf<std::array<int, 4>> subwin_;  // x, y, x size, y size
+  mutable sf::VertexArray vertex_;  // only touched by the drawing thread
 };
@@ -7,6 +7,7 @@
 #include <vector>
 
 #include "frame.h"
+#include "triplebuf.h"
 #include "zoomable.h"
 
 #include <vector>
@@ -56,16 +57,26 @@ class FFTWDraw : public Zoomable {
   // @param y position of the point to transform
   int FFTWIndex(int x, int y);
 
+  // Upload the latest pixels, if there are new ones, then draw them
+  void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+
  protected:
   // update drawing objects with pixel data
   void Update(const std::vector<uint32_t>& pixels);
 
+  // Pixels to fill in place of calling Update(), then Publish()
+  // Contents are left over from an earlier update
+  // @note from one thread at a time
+  std::vector<uint32_t>& Pixels();
+  void Publish() { px_.Publish(); }
+
  private:
   int width_ = 0;
   int height_ = 0;
   int fft_x_sz_ = 0;
   int fft_y_sz_ = 0;
-  sf::Texture tx_;
+  mutable TripleBuf<std::vector<uint32_t>> px_;
+  mutable sf::Texture tx_;  // only touched by the drawing thread
   std::array<sf::Sprite, 4> sp_;
 };
 
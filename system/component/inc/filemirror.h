@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Background copier from fast local storage to a synced (cloud or network) folder
+// Acquisition writes locally and hands finished files to Copy(); a single
+//   thread copies them to their destination so the sync client never competes
+//   with the pipeline for the destination disk.
+// - Bandwidth limited, so mirroring does not starve the sync client itself
+// - Each copy goes to <dst>.part, is read back and checksummed against the
+//   source, then renamed into place.  A failed copy is retried.
+// - Queued and finished copies are recorded in a journal.  A mirror created
+//   with the same journal picks up where the last one stopped, continuing a
+//   partial <dst>.part rather than starting over.
+// Example:
+//   FileMirror mirror("D:/scan/mirror.journal", 50.0);
+//   mirror.Copy("D:/scan/image0.tiff", "G:/synced/scan/image0.tiff");
+//   ...
+//   FileMirror::Backlog backlog = mirror.GetBacklog();
+class FileMirror {
+ public:
+  struct Backlog {
+    size_t files_pending = 0;    // queued or being copied
+    uint64_t bytes_pending = 0;
+    uint64_t files_copied = 0;   // verified and in place
+    uint64_t bytes_copied = 0;
+    int failures = 0;            // gave up after retries; left in the journal
+    double mb_per_s = 0.0;       // while copying
+  };
+
+  // Construct a mirror and start its copy thread
+  // @param journal (optional) file recording progress.  Unfinished copies in
+  //   an existing journal are queued again
+  // @param max_mb_per_s (optional) bandwidth limit, 0 for none
+  FileMirror(const std::string& journal = "", double max_mb_per_s = 0.0);
+
+  // Stops after the current chunk.  Unfinished copies stay in the journal
+  ~FileMirror();
+
+  // Queue a file to be copied.  Directories of dst are created as needed
+  // @param src finished file, not written to again
+  // @param dst destination path
+  void Copy(const std::string& src, const std::string& dst);
+
+  // Wait for the queue to empty
+  // @param timeout_ms how long to wait, or -1 to wait forever
+  // @returns true if everything queued has been copied (or failed)
+  bool Wait(int timeout_ms = -1);
+
+  Backlog GetBacklog();
+
+  // Checksum used to verify copies (64-bit FNV-1a)
+  static uint64_t Checksum(const void* data, size_t n, uint64_t hash = 14695981039346656037ull);
+
+ private:
+  struct Job {
+    std::string src;
+    std::string dst;
+    uint64_t bytes;
+  };
+
+  // Copy thread body
+  void Run();
+
+  // Copy, verify and rename one file
+  // @returns 0 on success, 1 if interrupted by the destructor, -1 on failure
+  int CopyFile(const Job& job);
+
+  // Record a copy as queued ('+') or finished ('-')
+  void Journal(char op, const Job& job);
+
+  // Queue the unfinished copies in journal_, then rewrite it with just those
+  void Resume();
+
+  // Sleep as needed to stay under the bandwidth limit
+  void Throttle(uint64_t bytes);
+
+  std::string journal_name_;
+  FILE* journal_ = NULL;
+  double max_bytes_per_ms_;
+
+  std::deque<Job> queue_;  // front is being copied
+  std::atomic<bool> stop_{ false };
+  Backlog backlog_;
+  time_t copy_ms_ = 0;  // time spent copying
+  time_t window_start_ms_ = 0;
+  uint64_t window_bytes_ = 0;
+
+  std::mutex mutex_;
+  std::condition_variable work_;  // queue_ has jobs, or stopping
+  std::condition_variable idle_;  // queue_ is empty
+  std::thread thread_;
+};
@@ -39,6 +39,15 @@ class Frame {
   static const int ERR_PACKET = 1 << 2;     // malformed data packet
   static const int ERR_ORDER = 1 << 3;      // out of order frame
 
+  // Lossless compression used by Write().  Read() decodes any of them.
+  //   Each frame is its own strip, so frames compress and decompress independently.
+  //   8 and 16-bit frames also get the horizontal (difference) predictor.
+  int compression;
+  static const int COMPRESS_NONE = 0;
+  static const int COMPRESS_DEFLATE = 1;  // zip at its fastest level; best choice in tiff_bench
+  static const int COMPRESS_LZW = 2;      // for readers without zip; can expand packed 10/12-bit frames
+  static const int N_COMPRESS = 3;
+
   Frame();
 
   // Create frame object from file
@@ -104,7 +113,8 @@ class Frame {
   void Init();
 
   // Load a frame from disk.
-  void Load();
+  // @returns 0 on success
+  int Load();
 
   std::mutex mutex_;
 
@@ -113,6 +123,9 @@ class Frame {
   // TODO(carsten): investigate changing Frame::data to std::vector
   std::vector<uint16_t> data_;
 
+  // Packed pixels for bit depths other than 16, reused between reads/writes
+  std::vector<uint8_t> strip_;
+
  protected:
   // Create a default TiffInterface for file i/o. (Called lazily.)
   void InitTiff();
@@ -2,6 +2,8 @@
 
 #include "system/component/inc/execnode.h"
 #include "system/component/inc/frame.h"
+#include "system/component/inc/preview.h"
+#include "system/component/inc/triplebuf.h"
 #include "system/component/inc/zoomable.h"
 
 // needed for SFML calls to compile properly
@@ -10,6 +12,8 @@
 #include <SFML/Window.hpp>
 
 // Class for drawing frame objects in SFML
+// Draws at most one frame per screen refresh, box filtered down to the
+//   resolution it is displayed at.
 class FrameDraw : public Zoomable, public ExecNode {
  public:
   // Create default frame drawing object
@@ -37,14 +41,30 @@ class FrameDraw : public Zoomable, public ExecNode {
   // Frame data height and width must match the call to the constructor
   void Update(const Frame* fr);
 
+  // Upload the latest frame, if there is a new one, then draw it
+  void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+
  private:
   void* Exec(void* data);
 
-  std::vector<uint32_t> px_;
+  // A coloured frame, ready to upload
+  struct Image {
+    std::vector<uint32_t> px;
+    int width = 0;
+    int height = 0;
+    int factor = 0;  // downsampling
+  };
+
+  std::vector<uint16_t> small_;  // downsampled frame
   int width_ = 0;
   int height_ = 0;
+  Preview::RateLimit limit_;
+
+  std::mutex wr_lock_;  // between exec threads only
+  mutable TripleBuf<Image> image_;
 
-  std::mutex wr_lock_;
-  sf::Texture tx_;
-  sf::Sprite sp_;
+  // Only touched by the drawing thread
+  mutable int factor_ = 0;  // downsampling of the texture
+  mutable sf::Texture tx_;
+  mutable sf::Sprite sp_;
 };
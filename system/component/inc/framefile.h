@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "system/component/inc/frame.h"
+
+// Append-only container holding many frames of the same geometry in one file,
+//   in place of one TIFF per frame.
+//
+// Layout (all fields little-endian):
+//   Header, padded to kPageBytes
+//   Chunk 0:  chunk_frames payloads, each padded to frame_stride bytes
+//             chunk_frames Records
+//             Trailer
+//             zero padding to a kPageBytes boundary
+//   Chunk 1:  ...
+//   Last chunk: as above, but may hold fewer frames and is not padded, so its
+//             Trailer is the last thing in the file
+//
+// Payloads are either raw uint16 pixels, or packed to `bits` per pixel row by
+//   row with BitPack, exactly as in an uncompressed TIFF strip (10-bit: 4 pixels
+//   in 5 bytes, MSB first).  A packed payload can be written to TIFF as is.
+// Each chunk's index is only written once the chunk is full, so if the writer
+//   dies, everything up to the last complete chunk can still be read.
+// Every full chunk has the same size, so a reader can find each Trailer
+//   without scanning, and the file can be memory mapped and indexed directly.
+namespace FrameFile {
+
+static const int kMaxValues = 8;      // per-frame tag values in each Record
+static const int kValueNameLen = 32;
+static const uint64_t kPageBytes = 4096;
+static const uint64_t kFrameAlign = 64;
+
+struct Header {
+  char magic[8];           // "OWFRAME1"
+  uint32_t version;
+  uint32_t header_bytes;   // offset of the first chunk
+  int32_t width;
+  int32_t height;
+  int32_t bits;
+  uint32_t packed;         // 1 if payloads are packed to `bits` per pixel
+  uint64_t frame_bytes;    // payload bytes per frame
+  uint64_t frame_stride;   // frame_bytes rounded up to kFrameAlign
+  uint32_t chunk_frames;   // frames per full chunk
+  uint32_t n_values;       // how many Record::values are in use
+  char value_names[kMaxValues][kValueNameLen];
+};
+
+// Per-frame index entry
+struct Record {
+  int32_t seq;
+  int32_t camera;          // Frame::serialNumber
+  int64_t timestamp_ms;
+  double temperature;
+  int32_t voxel[3];        // voxel indices this frame belongs to, -1 if unknown
+  int32_t err;             // Frame::err
+  double values[kMaxValues];
+};
+
+struct Trailer {
+  char magic[8];           // "OWFINDEX"
+  uint64_t chunk_offset;   // file offset of this chunk's first payload
+  uint32_t n_frames;
+  uint32_t checksum;       // FNV-1a over this chunk's Records
+};
+
+// Fill a record with the fields carried by a frame
+Record MakeRecord(const Frame& fr);
+
+// Payload bytes of a packed frame: each row packed by BitPack::PackMsb()
+size_t PackedBytes(int width, int height, int bits);
+
+}  // namespace FrameFile
+
+
+// Writes a FrameFile
+// Append() is thread safe.  Frames are stored in the order they are appended.
+class FrameFileWriter {
+ public:
+  FrameFileWriter() {}
+  ~FrameFileWriter();
+
+  // Create a new container, replacing any existing file
+  // @param fname file to create
+  // @param width, height, bits frame geometry.  Every appended frame must match
+  // @param packed store payloads packed to `bits` per pixel
+  // @param chunk_frames how many frames between index writes
+  // @param value_names (optional) names of the per-frame tag values
+  // @returns 0 on success
+  int Open(const char* fname, int width, int height, int bits, bool packed = false,
+           int chunk_frames = 64, const std::vector<std::string>& value_names = {});
+
+  // Append a frame and its index record
+  // @returns 0 on success, -1 if the file is not open or the frame does not match
+  int Append(const Frame& fr, const FrameFile::Record& record);
+
+  // Append a frame with a record made from its own fields
+  int Append(const Frame& fr);
+
+  // Write the index for any partial chunk and close the file
+  // @returns 0 on success
+  int Close();
+
+  // Number of frames appended
+  int Count();
+
+ private:
+  // Write the index of the current chunk
+  // @param pad pad the file to a page boundary for the next chunk
+  int WriteIndex(bool pad);
+
+  std::mutex mutex_;
+  FILE* fp_ = NULL;
+  FrameFile::Header header_;
+  std::vector<FrameFile::Record> records_;  // current chunk
+  std::vector<uint8_t> scratch_;
+  uint64_t chunk_offset_ = 0;
+  int count_ = 0;
+};
+
+
+// Reads a FrameFile through a memory mapping
+// Frames written before a crash are recovered up to the last complete chunk.
+class FrameFileReader {
+ public:
+  FrameFileReader() {}
+  ~FrameFileReader();
+
+  // Map a container and load its index
+  // @returns 0 on success
+  int Open(const char* fname);
+
+  void Close();
+
+  const FrameFile::Header& GetHeader() { return header_; }
+
+  // Number of frames in the file
+  int Count() { return (int)records_.size(); }
+
+  // Index record of the ith frame
+  const FrameFile::Record& GetRecord(int i) { return records_[i]; }
+
+  // Read the ith frame, allocating frame data if needed
+  // Frame objects with data must match the file's geometry
+  // @returns 0 on success
+  int Read(int i, Frame* fr);
+
+  // Pixels of the ith frame, directly from the mapping
+  // @returns NULL for packed files
+  const uint16_t* Raw(int i);
+
+ private:
+  const uint8_t* map_ = NULL;
+  uint64_t size_ = 0;
+  void* file_handle_ = NULL;
+  void* map_handle_ = NULL;
+  FrameFile::Header header_;
+  std::vector<FrameFile::Record> records_;
+  std::vector<uint64_t> offsets_;  // payload offset of each frame
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+
+#include "system/component/inc/execnode.h"
+#include "system/component/inc/frame.h"
+#include "system/component/inc/pool.h"
+
+// Histogram of the pixel values of each frame
+// One pass over the frame gives mean, standard deviation, percentiles and
+//   saturation from the tag, instead of a pass over the frame for each.
+//   StdDev uses the tag when it is exact (frames of 10 bits or less).
+// Pixels are counted into several interleaved histograms that are merged at
+//   the end, so runs of equal pixels do not wait on each other's increments.
+// Example:
+//   FrameHist hist;
+//   hist.AddProducer(&camera);
+//   ...
+//   const FrameHist::Tag* tag = fr->GetTag<FrameHist::Tag>();
+//   if (tag->SaturatedFraction() > 0.001) ...  // reduce exposure
+class FrameHist : public ExecNode {
+ public:
+  FrameHist() {}
+  ~FrameHist() {}
+
+  static const int kBins = 1024;
+
+  struct Tag : Frame::Tag {
+    uint32_t count[kBins];
+    uint64_t n = 0;          // pixels counted
+    int shift = 0;           // bin = pixel >> shift, 0 for frames of 10 bits or less
+    int max_value = 0;       // saturated pixel value, (1 << bits) - 1
+    uint64_t saturated = 0;  // pixels at (or above) max_value
+    uint64_t zero = 0;       // pixels at 0
+
+    // Pixel value at or below which at least a fraction p of the pixels fall
+    // Exact when shift is 0, otherwise the top of the bin it falls in
+    // @param p fraction between 0 and 1
+    int Percentile(double p) const;
+
+    // Mean and standard deviation of the pixels.  Exact when shift is 0,
+    //   otherwise from the centre of each bin
+    double Mean() const;
+    double StdDev() const;
+
+    // Fraction of the pixels that are saturated
+    double SaturatedFraction() const { return n ? (double)saturated / n : 0.0; }
+
+    // Fraction of the pixels clipped at either end of the range
+    double ClippedFraction() const { return n ? (double)(saturated + zero) / n : 0.0; }
+
+   private:
+    double Value(int bin) const;
+  };
+
+  // Build a histogram of a frame
+  static void Compute(const Frame* fr, Tag* tag);
+
+  // resize the number of ExecNodes that can be active at one time
+  void resize(size_t size) override;
+
+ private:
+  void* Exec(void* data) override;
+  void AtExit(void* data) override;
+
+  Pool<Tag> pool_;
+};
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "system/component/inc/frame.h"
+#include "system/component/inc/pool.h"
+
+// Write-behind storage service for frames
+// Frames handed to Save() are copied into a fixed pool of buffers and written
+//   to disk by the store's own I/O threads, so a slow disk never stalls the
+//   ExecNode threads that are processing the rest of the pipeline.
+// The queue is bounded by the pool size: when every buffer is waiting to be
+//   written, Save() blocks until one is free (backpressure on the producer
+//   rather than unbounded memory growth).
+// Example:
+//   FrameStore store;
+//   store.Save(*fr, "image0.tiff");
+//   ...
+//   store.Flush();  // all files written and synced to disk
+// With SetCompression(), frames are compressed by the I/O threads as they are
+//   written, one independent TIFF strip per frame, so encoding scales with the
+//   number of threads.  When the queue backs up (the threads can no longer keep
+//   up with compression) frames are written uncompressed until it drains.
+class FrameStore {
+ public:
+  // Function used to put a frame on disk, called on an I/O thread
+  // @returns 0 on success
+  typedef std::function<int(Frame& fr, const std::string& fname)> Writer;
+
+  // Called on an I/O thread once a file is complete
+  typedef std::function<void(const std::string& fname)> Listener;
+
+  // Per codec results, indexed by Frame::COMPRESS_*
+  struct CodecStats {
+    uint64_t frames = 0;
+    uint64_t raw_bytes = 0;   // frame payload before compression
+    uint64_t file_bytes = 0;  // size of the files on disk
+    double ratio = 0.0;       // raw_bytes / file_bytes
+    double mb_per_s = 0.0;    // payload encoded and written per second, per thread
+  };
+
+  struct Stats {
+    size_t queue_depth = 0;         // frames copied but not yet written
+    size_t max_queue_depth = 0;     // high water mark of queue_depth
+    uint64_t frames_written = 0;
+    uint64_t frames_coalesced = 0;  // queued writes replaced by a newer frame for the same file
+    uint64_t bytes_written = 0;     // frame payload, excluding file headers
+    int errors = 0;
+    double mb_per_s = 0.0;          // payload throughput while writing
+    uint64_t frames_fallback = 0;   // written uncompressed because the queue was backed up
+    CodecStats codec[Frame::N_COMPRESS];
+  };
+
+  // Construct a storage service and start its I/O threads
+  // @param n_threads number of I/O threads
+  // @param depth number of frame buffers, ie. the maximum queue depth
+  // @param writer (optional) how to write a frame.  Defaults to Frame::Write
+  FrameStore(int n_threads = 2, int depth = 32, Writer writer = Writer());
+
+  // Writes out everything still queued, then stops the I/O threads
+  ~FrameStore();
+
+  // Queue a copy of a frame to be written
+  // Blocks while the queue is full.  If a write to the same file is still
+  //   queued, its buffer is overwritten with this frame instead.
+  // @param fr frame to save.  Only the pixel data and header fields are copied
+  // @param fname file to write
+  // @param writer (optional) overrides the store's writer for this frame
+  // @returns 0 on success, -1 if the store is shutting down
+  int Save(const Frame& fr, const std::string& fname, Writer writer = Writer());
+
+  // Compress frames saved from now on
+  // @param compression Frame::COMPRESS_*.  Used by Frame::Write, ie. the default writer
+  // @param fallback write uncompressed while the queue is more than 3/4 full,
+  //   until it drains below 1/4
+  void SetCompression(int compression, bool fallback = true);
+
+  // Be told about each file written by the store's writer, eg. to mirror it
+  //   elsewhere.  Not called for frames saved with their own writer
+  // @note set before the first Save()
+  void SetOnWritten(Listener listener) { on_written_ = listener; }
+
+  // Barrier: block until every frame queued before this call is written
+  // @param sync also flush the files written by the store's writer from the OS
+  //   cache to the device.  Frames saved with their own writer are left to it,
+  //   as the store does not know which file they went to
+  // @returns number of failed writes since the previous Flush()
+  int Flush(bool sync = true);
+
+  // Snapshot of queue and throughput metrics
+  Stats GetStats();
+
+  // Flush files from the OS cache to the device
+  static void SyncFiles(const std::vector<std::string>& fnames);
+
+ private:
+  struct Job {
+    Frame frame;
+    std::string fname;
+    Writer writer;
+    uint64_t id = 0;
+  };
+
+  // I/O thread body
+  void Run();
+
+  // Pull up to max jobs off the queue, waiting for at least one
+  // @returns false if the store is stopping and the queue is empty
+  bool PopBatch(std::vector<Job*>* batch, size_t max);
+
+  Writer writer_;
+  Listener on_written_;
+  Pool<Job> jobs_;
+  std::deque<Job*> queue_;
+  std::set<uint64_t> outstanding_;   // ids queued or being written
+  std::vector<std::string> written_; // files written since the last Flush()
+  std::vector<std::thread> threads_;
+
+  std::mutex mutex_;
+  std::condition_variable work_;     // queue_ has jobs, or stopping
+  std::condition_variable space_;    // a buffer was returned to the pool
+  std::condition_variable done_;     // a job finished
+
+  uint64_t next_id_ = 0;
+  size_t free_ = 0;
+  bool stop_ = false;
+  int compression_ = Frame::COMPRESS_NONE;
+  bool fallback_ = true;
+  bool backed_up_ = false;
+  int flush_errors_ = 0;
+  Stats stats_;
+  time_t first_write_ms_ = 0;
+  time_t last_write_ms_ = 0;
+  time_t codec_ms_[Frame::N_COMPRESS] = {};  // time spent writing, summed over threads
+};
@@ -82,13 +82,13 @@ class FX3 {
   // @param len maximum number of bytes to receive
   // @param data buffer to fill with data
   // @returns number of bytes read, <0 if an error has occurred
-  int DataIn(int len, uint8_t* data);
+  virtual int DataIn(int len, uint8_t* data);
 
   // Transmit data to a bulk in endpoint in synchronous mode
   // @param len number of bytes to transmit
   // @param data data to transmit
   // @returns number of bytes transmitted, <0 if an error has occurred.
-  int DataOut(int len, uint8_t* data);
+  virtual int DataOut(int len, uint8_t* data);
 
   // Bulk in asynchronous control
   // The bulk in endpoint operates in blocking mode by default.
@@ -153,6 +153,7 @@ class FX3 {
 
   // Find the device number that has address.  Device numbers change based on USB
   //   disconnects, addresses do not.
+  // @returns -1 if no device has address, e.g. while it reattaches
   static int DeviceNumber(int address);
 
   // bulk in buffers
@@ -3,10 +3,11 @@
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
-
+#include <string>
 
 // Simple Intel Hex file writer
 // Data must be written in order (ie, low address to high)
+// Writes to a file, or to memory with Open() and Text().
 class IntelHex {
  public:
   IntelHex() {}
@@ -16,6 +17,12 @@ class IntelHex {
   // @param fname file to open
   int Open(const char* fname);
 
+  // Start writing to memory instead of a file
+  int Open();
+
+  // Everything written to memory, complete after Close()
+  const std::string& Text() const { return text_; }
+
   // Finish writing 
   int Close();
 
@@ -49,4 +56,5 @@ class IntelHex {
   int partial_len_;
 
   FILE* fptr_ = NULL;
+  std::string text_;
 };
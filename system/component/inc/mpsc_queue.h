@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+// Lock-free multiple producer, single consumer queue
+// @param T type of data to be stored in this queue
+// Push() may be called from any number of threads without blocking each other.
+//   A single consumer takes everything queued so far with PopAll(), in the
+//   order it was pushed, so it can be handled as one batch.
+// Example:
+//   MpscQueue<Record> queue;
+//   queue.Push(rec);          // any thread
+//   std::vector<Record> batch;
+//   queue.PopAll(&batch);     // consumer thread
+template <typename T>
+class MpscQueue {
+ public:
+  MpscQueue() : head_(nullptr) {}
+
+  ~MpscQueue() {
+    std::vector<T> discard;
+    PopAll(&discard);
+  }
+
+  // Add an element
+  void Push(const T& data) {
+    Node* node = new Node{ data, head_.load(std::memory_order_relaxed) };
+    while (!head_.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {}
+  }
+
+  // Take every element pushed so far
+  // @param out elements are appended, oldest first
+  // @returns number of elements taken
+  size_t PopAll(std::vector<T>* out) {
+    // Taking the whole list at once means no node is ever freed while a
+    // producer might still be reading it (no ABA)
+    Node* node = head_.exchange(nullptr, std::memory_order_acquire);
+    size_t n = 0;
+    Node* prev = nullptr;
+    while (node) {  // Newest first: reverse
+      Node* next = node->next;
+      node->next = prev;
+      prev = node;
+      node = next;
+      ++n;
+    }
+    while (prev) {
+      out->push_back(prev->data);
+      Node* next = prev->next;
+      delete prev;
+      prev = next;
+    }
+    return n;
+  }
+
+  // Check if anything is queued
+  bool empty() const { return head_.load(std::memory_order_acquire) == nullptr; }
+
+ private:
+  struct Node {
+    T data;
+    Node* next;
+  };
+
+  std::atomic<Node*> head_;
+};
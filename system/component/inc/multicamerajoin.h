@@ -0,0 +1,102 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <vector>
+
+#include "system/component/inc/execnode.h"
+#include "system/component/inc/frame.h"
+#include "system/component/inc/pool.h"
+
+// Join frames from several cameras' chains into one bundle per acquisition
+// Frames are grouped by sequence number (or, optionally, by timestamp).  The
+//   group is handed downstream as a Bundle once every camera's frame has
+//   arrived, with the missing cameras' frames left NULL once every missing
+//   camera has sent a later frame (so has dropped this one), or once the first
+//   frame has waited timeout_ms.  A frame that arrives after its group has gone
+//   starts a new group, which closes with the others missing.
+// Exactly one frame of each group carries the Bundle downstream; Exec() returns
+//   NULL for the rest.  Every frame in a Bundle stays valid until downstream
+//   nodes are done with the Bundle.
+// A frame holds its ExecNode thread while it waits, so keep timeout_ms short
+//   compared to how far apart the cameras' frames arrive.
+// Frames from all cameras pass through this node, so resize() it for all of
+//   them after connecting the producers.
+// Example:
+//   MultiCameraJoin join({ serial0, serial1 });
+//   join.AddProducer(&chain0);
+//   join.AddProducer(&chain1);
+//   join.resize(2 * 30);
+//   voxels.AddProducer(&join);
+//   ...
+//   void* Voxels::Exec(void* data) {
+//     MultiCameraJoin::Bundle* bundle = (MultiCameraJoin::Bundle*)data;
+class MultiCameraJoin : public ExecNode {
+ public:
+  struct Bundle {
+    int seq;                     // of the first frame to arrive
+    std::vector<Frame*> frames;  // one per camera, in constructor order.  NULL if missing
+    int missing;                 // number of NULL frames
+  };
+
+  struct Stats {
+    uint64_t complete = 0;  // bundles with every camera
+    uint64_t partial = 0;   // bundles that timed out
+    uint64_t unknown = 0;   // frames from cameras not being joined, dropped
+  };
+
+  // @param cameras serial numbers of the cameras to join
+  // @param timeout_ms how long a group waits for its last frame, when that
+  //   camera sends nothing later
+  MultiCameraJoin(const std::vector<int>& cameras, int timeout_ms = 50);
+  ~MultiCameraJoin() {}
+
+  // Group frames by timestamp instead of sequence number
+  // @param window_ms frames within window_ms of a group's first frame join it
+  void SetTimeWindow(int window_ms);
+
+  Stats GetStats();
+
+  // resize the number of ExecNodes that can be active at one time
+  void resize(size_t size) override;
+
+ private:
+  struct Group {
+    int seq;
+    time_t timestamp_ms;
+    std::chrono::steady_clock::time_point deadline;
+    std::vector<Frame*> frames;
+    std::vector<bool> later;  // by camera, whether it has since sent a later frame
+    size_t present = 0;
+    int waiting = 0;  // frames of this group in Exec()
+    Bundle* bundle = NULL;
+    Frame* carrier = NULL;
+  };
+
+  void* Exec(void* data) override;
+  void AtExit(void* data) override;
+
+  // Open group a frame belongs to, or NULL
+  // @note caller holds mutex_
+  Group* Find(const Frame* fr, int camera);
+
+  // Make the group's Bundle and choose which frame carries it
+  // @note caller holds mutex_
+  void Close(Group* group);
+
+  // Whether every camera missing from a group has since sent a later frame
+  bool Superseded(const Group& group) const;
+
+  std::vector<int> cameras_;
+  int timeout_ms_;
+  int window_ms_ = -1;  // negative to group by sequence number
+
+  std::mutex mutex_;
+  std::condition_variable closed_;
+  std::list<Group> groups_;
+  Stats stats_;
+  Pool<Bundle> pool_;
+};
@@ -1,9 +1,16 @@
 #pragma once
 
 #include <cstdint>
+#include <map>
+#include <vector>
 
 #include "system/component/inc/fx3.h"
 
+// Octopus timing and AOM board
+// A shadow copy of the board's registers is kept on the host, so modifying
+//   bits of a register needs no read back, and writing a register the value
+//   it already holds is skipped.  Register writes can be batched, to be sent
+//   in fewer bulk transfers.
 class Octopus {
  public:
   Octopus() {}
@@ -82,11 +89,36 @@ class Octopus {
     Pin out_select;
   };
 
+  // A timer's registers, as ConfigureTimer writes them
+  struct TimerImage {
+    uint8_t module;     // timer module, the output pin - OUT1_BOTTOM
+    uint16_t regs[17];
+  };
+
+  // Compute the registers for a timer configuration, without touching the board
+  // @param ot timer configuration parameters
+  static TimerImage CompileTimer(const Timer& ot);
+
   // Setup an Octopus Timer
   // @param timer which timer to configure
   // @param ot timer configuration parameters
   void ConfigureTimer(const Timer& ot);
 
+  // Setup an Octopus Timer from precompiled registers.  Registers that
+  //   already hold their values are not written again.
+  // @param image registers from CompileTimer()
+  void ConfigureTimer(const TimerImage& image);
+
+  // Whether the board holds a timer's registers, as far as the shadow knows
+  // @param image registers from CompileTimer()
+  bool TimerLoaded(const TimerImage& image) const;
+
+  // Restart a configured timer: disable then enable it, in one batch.  The
+  //   same timer control writes as ConfigureTimer() and EnableTimer(pin, true)
+  //   make when the timer's registers are unchanged.
+  // @param pin timer output pin
+  void RearmTimer(Pin pin);
+
   // Enable / disable a timer
   // @param pin pin to enable/disable
   // @param enable whether the timer is enabled
@@ -103,6 +135,29 @@ class Octopus {
   // @param oa AOM parameters
   void ConfigureAOM(AOM& oa);
 
+  // Queue register writes until the matching EndBatch(), then send them
+  //   together.  Batches nest, and a register read sends the queue first.
+  void BeginBatch();
+  void EndBatch();
+
+  // Most register writes packed into one bulk transfer.  1, the default,
+  //   sends each write in its own transfer as the firmware has always had them
+  // @param writes 4-byte write records per transfer
+  void SetMaxBatch(int writes);
+
+  // Forget the register shadow, e.g. if the board may have been reset.
+  //   Open() and Close() do this too.
+  void InvalidateShadow();
+
+  struct Stats {
+    int transfers = 0;     // USB bulk transfers, out and in
+    int writes = 0;        // register writes sent
+    int skipped = 0;       // register writes that matched the shadow
+    int reads = 0;         // register reads sent
+    int shadow_reads = 0;  // register reads answered by the shadow
+  };
+  Stats GetStats() const { return stats_; }
+
  private:
   // Raw write register to Octopus
   // @param device device within the octo
@@ -139,9 +194,27 @@ class Octopus {
   // See https://www.analog.com/media/en/technical-documentation/data-sheets/AD9959.pdf
   void UpdateDDS();
 
+  // Register value from the shadow, read from the board if not yet known
+  uint16_t ShadowReg(uint8_t device, uint8_t reg);
+
+  // Send queued register writes
+  void Flush();
+
+  // Registers whose value the board changes, which the shadow must not hold
+  static bool Uncached(uint8_t device, uint8_t reg);
+
+  // Registers whose writes act even when the value is unchanged
+  static bool AlwaysWrite(uint8_t device, uint8_t reg);
+
   FX3 fx3_inst_;
   FX3* fx3_ = &fx3_inst_;
 
+  std::map<uint16_t, uint16_t> shadow_;  // by device << 8 | reg
+  std::vector<uint8_t> queue_;           // write records not yet sent
+  int batch_depth_ = 0;
+  int max_batch_ = 1;
+  Stats stats_;
+
   static const int PID = 0x4F12;
 
   static const int DDS_ADDR = 0x1E;
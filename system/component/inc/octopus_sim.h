@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "system/component/inc/fx3.h"
+
+// Stands in for an Octopus board's FX3, holding its registers in memory
+// Register traffic arrives as the board sees it: bulk transfers of 4-byte
+//   write records, or a 2-byte read request followed by a 2-byte read.  Each
+//   transfer is counted.  The DDS behind the SPI module is emulated far
+//   enough that its registers read back what was written.
+// Example:
+//   OctopusSim sim;
+//   Octopus octo(&sim);
+//   octo.ConfigureTimer(timer);
+//   ASSERT_EQ(18, sim.Transfers());
+class OctopusSim : public FX3 {
+ public:
+  OctopusSim() {}
+
+  int Open(uint16_t pid, int n = 0) override { return 0; }
+  int Flash(int len, uint8_t* data) override { return 0; }
+  int DataOut(int len, uint8_t* data) override;
+  int DataIn(int len, uint8_t* data) override;
+
+  // Register value, 0 if never written
+  uint16_t Reg(uint8_t device, uint8_t reg) const;
+
+  // DDS register value, of the lowest channel for channel registers
+  // @param channel DDS channel (0-3), for registers 3 and up
+  uint32_t DDSReg(uint8_t reg, int channel = 0) const;
+
+  struct Write {
+    uint8_t device;
+    uint8_t reg;
+    uint16_t data;
+  };
+
+  // Register writes received, in order
+  const std::vector<Write>& Writes() const { return writes_; }
+
+  // Bulk transfers received, out and in
+  int Transfers() const { return transfers_; }
+
+  // Forget the writes and transfers counted so far, keeping the registers
+  void ClearLog();
+
+ protected:
+  // Called after each register write is applied, for simulations built on this one
+  virtual void Written(const Write& w) {}
+
+  static const int DDS_ADDR = 0x1E;
+
+ private:
+  // Run the DDS SPI transaction set up in the SPI module's registers
+  void DDSTransaction();
+
+  std::map<uint16_t, uint16_t> regs_;          // by device << 8 | reg
+  std::map<uint16_t, uint32_t> dds_;           // by channel << 8 | reg
+  int read_ = -1;                              // device << 8 | reg requested
+  std::vector<Write> writes_;
+  int transfers_ = 0;
+};
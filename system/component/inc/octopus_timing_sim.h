@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <vector>
+
+#include "system/component/inc/octopus.h"
+#include "system/component/inc/octopus_sim.h"
+
+// Runs the Octopus timers and AOM gates from the registers the board is sent,
+//   one 100 MHz clock cycle at a time, and records every edge on every pin.
+// The timers are modelled as Octopus::Timer describes them and as the scanner
+//   uses them:
+//   - Enabling a timer latches its configuration; its output starts at
+//     start_output_value and it enters state 1 once its gate is open.
+//     Disabling it holds its output.
+//   - A state with use_trigger holds the previous output until the trigger
+//     condition is seen, then outputs its value for its period.  Other states
+//     output their value for their period straight away.
+//   - state_transition_count counts the entry into state 1 and the entry into
+//     the end, where the output goes to end_output_value.  next_state 0 also
+//     ends the timer.  0xFFFFFFFF runs forever.
+//   - While the gate is closed the timer holds, neither counting nor
+//     triggering.
+//   - Timers see pins, including each other's outputs, one cycle late.
+//   - An AOM is on while its amplifier is enabled, its gate pin is high and
+//     its on amplitude, as of the last DDS update, is not 0.
+// Time only passes in Run(); register writes land at the current cycle.
+// Example:
+//   OctopusTimingSim sim;
+//   Octopus octo(&sim);
+//   octo.ConfigureTimer(timer);
+//   octo.EnableTimer(timer.out_select, true);
+//   sim.Run(1e-3);
+//   sim.WriteVCD(file);
+class OctopusTimingSim : public OctopusSim {
+ public:
+  static constexpr double CLOCK_HZ = 100e6;  // OCTO_CLK_FREQ
+
+  OctopusTimingSim();
+
+  // Advance simulated time
+  void Run(double seconds);
+  void RunCycles(uint64_t cycles);
+
+  // Current cycle
+  uint64_t Now() const { return now_; }
+
+  // Drive an input pin (IN1_BOTTOM - IN4_TOP)
+  // @param at_s when, in seconds from the start; the current cycle if earlier
+  void SetInput(Octopus::Pin pin, bool value, double at_s = 0);
+
+  // Drive an input pin with a clock, e.g. a laser's sync output
+  // @param period_s time between rising edges
+  // @param width_s time high
+  // @param count number of pulses
+  // @param start_s first rising edge
+  void ClockInput(Octopus::Pin pin, double period_s, double width_s, int count, double start_s = 0);
+
+  struct Edge {
+    uint64_t cycle;
+    bool value;
+  };
+
+  // Pin value now, and its changes so far
+  bool Value(Octopus::Pin pin) const { return pins_[pin]; }
+  const std::vector<Edge>& Timeline(Octopus::Pin pin) const { return timelines_[pin]; }
+
+  // AOM RF output (channel 1-4) now, and its changes so far
+  bool AOMOn(int channel) const { return aom_on_[channel - 1]; }
+  const std::vector<Edge>& AOMTimeline(int channel) const { return aom_timelines_[channel - 1]; }
+
+  // AOM frequency (Hz) and on amplitude (V), as of the last DDS update
+  double AOMFrequency(int channel) const;
+  double AOMAmplitude(int channel) const;
+
+  struct Pulse {
+    double start;  // seconds
+    double width;  // seconds
+  };
+
+  // High pulses in a timeline; a pulse still high at the end has width -1
+  static std::vector<Pulse> Pulses(const std::vector<Edge>& timeline);
+
+  // Write the pins that changed, and the AOMs, as a value change dump
+  void WriteVCD(std::ostream& out) const;
+
+  // Write every edge as time_s,signal,value
+  void WriteCSV(std::ostream& out) const;
+
+  // Signal name as written, e.g. "OUT1_BOTTOM", "AOM2"
+  static const char* PinName(Octopus::Pin pin);
+
+ protected:
+  void Written(const Write& w) override;
+
+ private:
+  static const int NUM_PINS = 32;
+  static const int NUM_TIMERS = 16;
+  static const int TIMER_CONTROL = 0x1F;
+
+  struct Timer {
+    enum Phase { IDLE, START, WAIT, COUNT } phase = IDLE;
+    Octopus::Timer config;
+    uint32_t counts[7];
+    int state = 0;
+    uint32_t transitions = 0;
+    uint64_t remaining = 0;  // cycles left in the state, as of the last step
+    bool gate_open = false;  // as of the last step
+  };
+
+  // Decode a timer module's registers, as Octopus::CompileTimer packs them
+  void Latch(int module);
+
+  // Simulate one cycle
+  void Step(uint64_t cycle);
+
+  // Move a timer on as far as it goes this cycle
+  // @param pins values seen this cycle
+  // @param previous values seen the cycle before
+  void Advance(Timer& t, const bool* pins, const bool* previous, bool* out);
+  void Enter(Timer& t, int state, bool* out);
+
+  // Next cycle anything happens, or UINT64_MAX
+  uint64_t NextEvent() const;
+
+  void Set(std::vector<Edge>& timeline, bool& value, bool now);
+
+  uint64_t now_ = 0;
+  uint64_t last_step_ = 0;
+  uint64_t wake_ = UINT64_MAX;  // a step requested by a register write
+  bool pins_[NUM_PINS] = {};
+  bool seen_[NUM_PINS] = {};    // pins as of the last step
+  std::vector<Edge> timelines_[NUM_PINS];
+  Timer timers_[NUM_TIMERS];
+  uint16_t enables_ = 0;
+  std::multimap<uint64_t, std::pair<int, bool>> inputs_;  // scheduled input edges
+
+  struct AOM {
+    uint32_t ftw = 0;       // frequency tuning word
+    uint32_t amplitude = 0; // on amplitude scale factor
+  };
+  AOM aoms_[4];             // by DDS channel
+  bool aom_on_[4] = {};     // by AOM channel - 1
+  std::vector<Edge> aom_timelines_[4];
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <vector>
+
+// Kernels for the live display nodes (FrameDraw, FFTTDraw)
+// A preview only needs as many pixels as the screen shows and as many frames
+//   as the screen refreshes, so these reduce frames before colouring them:
+//   box filter down to the displayed resolution, then one table lookup per
+//   pixel.  The loops have no carried state so the compiler can vectorize them.
+namespace Preview {
+
+// Size of one dimension after downsampling; edge boxes may be partial
+inline int Downsized(int n, int factor) {
+  return (n + factor - 1) / factor;
+}
+
+// Box filter: each output pixel is the mean of a factor x factor block
+// @param out Downsized(width, factor) x Downsized(height, factor) pixels
+void Downsample(const uint16_t* in, int width, int height, int factor, uint16_t* out);
+
+// Map pixels through a colormap: out[i] = lut[in[i] >> shift]
+void Colormap(const uint16_t* in, size_t n, const uint32_t* lut, int shift, uint32_t* out);
+
+// Shift that brings pixels of a given bit depth into a COLORMAP_LEN colormap
+int ColormapShift(int bits);
+
+// Log display scale, grey = m * (log(x + 1) - x0), clipped to [0, 255]
+// Evaluated once per quantized magnitude (the top bits of x as a float, ie. a
+//   relative step of 1/128) when set, rather than once per pixel.
+class LogScale {
+ public:
+  LogScale() : table_(kEntries) { Set(1.0, 0.0); }
+
+  void Set(double m, double x0);
+
+  // Opaque grey pixel for a magnitude
+  uint32_t operator()(double x) const { return table_[Index(x)]; }
+
+  // Map magnitudes to opaque grey pixels
+  void Map(const double* in, size_t n, uint32_t* out) const;
+
+ private:
+  static const int kShift = 16;                  // float bits dropped
+  static const int kEntries = 1 << (31 - kShift);  // non-negative floats
+
+  static uint32_t Index(double x);
+
+  std::vector<uint32_t> table_;
+};
+
+// Opaque grey pixel
+inline uint32_t Grey(int level) {
+  return 0xFF000000 | (uint32_t)level * 0x010101;
+}
+
+// Passes at most one frame per interval; the rest are dropped
+class RateLimit {
+ public:
+  // @param interval_ms minimum time between frames.  16 ms is 60 Hz
+  explicit RateLimit(int interval_ms = 16) : interval_ms_(interval_ms) {}
+
+  // @returns true if a frame may be used now, starting a new interval
+  bool Take();
+
+ private:
+  int interval_ms_;
+  std::atomic<time_t> last_ms_{ 0 };
+};
+
+}  // namespace Preview
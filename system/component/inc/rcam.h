@@ -72,9 +72,10 @@ class Rcam : public ExecNode {
   Frame* GetFrame();
 
   // Wait for a new frame to come from the device.  Will clear all
-  // previous frames from the framebuffer
+  // previous frames from the framebuffer.  Sleeps until the frame arrives
   // @param timeout time in seconds to wait for frame
   //   if negative or missing, wait forever
+  // @returns NULL on timeout
   Frame* WaitFrame(double timeout = -1);
 
   // Get configuration frame
@@ -85,6 +86,13 @@ class Rcam : public ExecNode {
   // check number of received frames
   int GetFrameCount();
 
+  // Wait until GetFrameCount() reaches count, e.g. the last frame of an
+  //   acquisition has been received
+  // @param count frame count to wait for
+  // @param timeout_ms how long to wait, or -1 to wait forever
+  // @returns true if the count was reached
+  bool WaitFrameCount(int count, double timeout_ms = -1);
+
   // Set the number of received frames.
   // The next frame received will have its sequence number set to this.
   void SetFrameCount(int frames);
@@ -160,6 +168,10 @@ class Rcam : public ExecNode {
   RcamParam param_ = {{0}};
   Frame fr_cfg_;
   CircularBuffer<Frame> framebuf_;
+  // Signalled by RxThread as each frame is received, for WaitFrame() and
+  //   WaitFrameCount()
+  std::mutex frame_mutex_;
+  std::condition_variable frame_ready_;
 
   int Flash();
 
@@ -5,12 +5,10 @@
 #include "SFML/Graphics.hpp"
 #include "SFML/Window.hpp"
 
+#include "fftpool.h"
 #include "rcam.h"
-#include "circular_buffer.h"
-
-#define HAVE_STRUCT_TIMESPEC
-#include "pthread.h"
 
+// Display the FFT of camera frames, with ROI / ROU masks, computed on an FFTPool
 class RealTimeFFT : public sf::Drawable {
  public:
    // Allocate space and do pre-compuataion for real-time FFT of Rcam frames
@@ -24,7 +22,8 @@ class RealTimeFFT : public sf::Drawable {
    // @param v_px number of pixels to draw vertically
    void SetWindow(int h_px, int v_px);
 
-   // Compute a frame of FFT
+   // Show the newest finished FFT and queue this frame for computing
+   // Frames arriving while every worker is busy are dropped
    void Compute(const Frame* fr);
 
    // Set ROI
@@ -53,35 +52,12 @@ class RealTimeFFT : public sf::Drawable {
 private:
   int h_sz_, v_sz_, fft_h_sz_, fft_v_sz_, fft_sz_;
 
-  double* fft_roi_;
-  double* fft_rou_;
+  FFTPool pool_;
   uint32_t* fft_mask_px_;
   double power_ = 0;
+  double max_ = 0;
 
-  struct FFTThread {
-    pthread_t thread;
-    volatile enum {STOPPED, RUNNING, FINISHED} state;
-    double* fft_in;
-    uint32_t* px;
-    double* roi;
-    double* rou;
-    fftw_complex* fft_out;
-    fftw_plan plan;
-    double max;
-    double scale;
-    double power;
-    int sz;
-  };
-
-  CircularBuffer<FFTThread>* threads_;
-  static void* Exec_(void* param);
-
-  fftw_complex* last_ = NULL;
-  
-  static bool compute_log_;
-  static double m_, b_;
   float sf_h_, sf_v_;
-  uint32_t* px_ = NULL;
   sf::Texture tx_;
   sf::Sprite sp_[4];
   sf::Texture tx_mask_;
@@ -9,6 +9,9 @@
 
 
 // Class for drawing a scan as it happens
+// Voxels are only stored as they arrive.  Colouring happens when the window is
+//   drawn: only the voxels written since the last draw are recoloured and
+//   uploaded, unless the colour scale or the displayed plane has changed.
 class ScanDraw : public ExecNode, public Zoomable {
  public:
   ScanDraw() {}
@@ -30,10 +33,14 @@ class ScanDraw : public ExecNode, public Zoomable {
   //   most current plane.
   void SetViewRelative(int k);
 
+  // Bring the texture up to date, then draw it
+  void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+
  private:
   void* Exec(void* data) override;
 
-  void UpdateDisplay();
+  // Recolour what has changed since the last call and upload it to the texture
+  void Refresh() const;
 
   // voxel data
   std::vector<double> voxel_;
@@ -48,14 +55,18 @@ class ScanDraw : public ExecNode, public Zoomable {
   // maximum value seen so far
   volatile double max_val_ = 1.0;
 
-  // SFML drawable object
-  sf::Texture tx_;
-  sf::Sprite sp_;
-  std::vector<uint32_t> px_;
+  // voxels written since the last Refresh()
+  mutable std::vector<int> dirty_;
 
-  // pixel writer lock
-  std::mutex wr_lock_;
+  // recolour the whole displayed plane on the next Refresh()
+  mutable bool redraw_all_ = true;
+
+  // Display cache, only touched by the drawing thread
+  mutable double scale_max_ = 0.0;  // max_val_ the pixels were coloured with
+  mutable sf::Texture tx_;
+  sf::Sprite sp_;
+  mutable std::vector<uint32_t> px_;
 
   // index/pointer lock
-  std::mutex p_lock_;
+  mutable std::mutex p_lock_;
 };
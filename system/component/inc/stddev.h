@@ -5,6 +5,7 @@
 #include "system/component/inc/pool.h"
 
 // Compute the mean and standard deviation on frames
+// Taken from a FrameHist tag when one is present and exact
 class StdDev : public ExecNode {
  public:
   StdDev() {}
@@ -30,18 +30,26 @@ class SyncNode : public ExecNode {
   void* Get();
 
   // Wait until a new node is received
+  // Sleeps until one arrives, rather than polling
   // @param seconds seconds to wait, if blank or negative wait indefinitely
+  // @returns NULL on timeout
   void* Wait(double seconds = -1);
 
  private:
   void* Exec(void* data) override;
 
+  // Give the data structure held by the user back to the pipeline
+  // @note caller holds mutex_
+  void Release();
+
   // whether a data structure is in use by a user
   //   ie, is the last result of Get() not NULL.
-  volatile bool user_ = false;
+  bool user_ = false;
   // keep track of the number of data structures this node has seen
-  volatile int pushed_ = 0;
-  volatile int popped_ = 0;
+  int pushed_ = 0;
+  int popped_ = 0;
   CircularBuffer<void*> buf_;
   std::mutex mutex_;
+  std::condition_variable received_;  // buf_ has data
+  std::condition_variable released_;  // popped_ changed
 };
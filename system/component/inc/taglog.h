@@ -0,0 +1,228 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "system/component/inc/frame.h"
+
+// Binary log of frame tags
+// Each tag type is registered once as a group of typed columns.  Every frame
+//   logged becomes one record: a bitmask of the groups present on the frame,
+//   then the columns of just those groups, in registration order.  Values that
+//   only need a few significant digits can be stored as FLOAT32.
+// Records are encoded into one of several buffers chosen by the calling thread,
+//   so pipeline threads rarely wait on each other, and a background thread
+//   writes full buffers to disk.  Records from different buffers are not in
+//   frame order; sort on the camera / frame number columns if needed.
+// File layout (little-endian):
+//   FileHeader, n_groups x GroupInfo, n_columns x ColumnInfo, records...
+// Read with TagLogReader, util/taglog (CSV) or util/taglog/taglog.py (numpy).
+// Example:
+//   TagLog log;
+//   log.AddTag<StdDev::Tag>("StdDev", { { "Mean", TagLog::FLOAT32 }, { "Standard Deviation", TagLog::FLOAT32 } },
+//                           [](const StdDev::Tag* tag, TagLog::Fields* f) {
+//                             f->Put((float)tag->mean);
+//                             f->Put((float)tag->stddev);
+//                           });
+//   log.Open("tags.owtag");
+//   log.Log(fr);  // from any thread
+//   log.Close();
+class TagLog {
+ public:
+  enum Type : uint32_t { INT32 = 0, INT64 = 1, FLOAT64 = 2, FLOAT32 = 3 };
+
+  static const int kMaxGroups = 32;  // bits in the record's presence mask
+  static const int kNameLen = 32;
+
+  struct Column {
+    std::string name;
+    Type type;
+  };
+
+  struct FileHeader {
+    char magic[8];          // "OWTAGLOG"
+    uint32_t version;
+    uint32_t header_bytes;  // including the group and column tables
+    uint32_t record_bytes;  // of a record with every group present
+    uint32_t n_groups;
+    uint32_t n_columns;
+    uint32_t reserved;
+  };
+
+  struct GroupInfo {
+    char name[kNameLen];
+    uint32_t first_column;
+    uint32_t n_columns;
+  };
+
+  struct ColumnInfo {
+    char name[kNameLen];
+    uint32_t type;
+    uint32_t offset;  // from the start of the group's columns
+  };
+
+  // Sequential writer for one group's columns, in registration order
+  class Fields {
+   public:
+    explicit Fields(uint8_t* dst) : dst_(dst) {}
+    void Put(int32_t v) { Copy(&v, sizeof(v)); }
+    void Put(int64_t v) { Copy(&v, sizeof(v)); }
+    void Put(double v) { Copy(&v, sizeof(v)); }
+    void Put(float v) { Copy(&v, sizeof(v)); }
+
+   private:
+    void Copy(const void* v, size_t n) {
+      memcpy(dst_, v, n);
+      dst_ += n;
+    }
+    uint8_t* dst_;
+  };
+
+  // Fill a group's columns from a frame
+  // @returns false if the frame does not carry this group's tag
+  typedef std::function<bool(const Frame* fr, Fields* fields)> Filler;
+
+  struct Stats {
+    uint64_t records = 0;
+    uint64_t bytes_written = 0;
+    int errors = 0;
+  };
+
+  TagLog() {}
+
+  // Writes out any buffered records
+  ~TagLog();
+
+  // Register a group of columns.  Must be called before Open()
+  // @returns 0 on success, -1 if the log is open or there are too many groups
+  int AddGroup(const std::string& name, const std::vector<Column>& columns, Filler fill);
+
+  // Register a group filled from a tag of type T
+  // @note T must inherit from Frame::Tag
+  template <typename T>
+  int AddTag(const std::string& name, const std::vector<Column>& columns,
+             std::function<void(const T* tag, Fields* fields)> fill) {
+    return AddGroup(name, columns, [fill](const Frame* fr, Fields* fields) {
+      const T* tag = fr->GetTag<T>();
+      if (tag) fill(tag, fields);
+      return tag != NULL;
+    });
+  }
+
+  // Create a log file and write its header
+  // @param fname file to create.  Fails if it already exists
+  // @returns 0 on success
+  int Open(const std::string& fname);
+
+  bool IsOpen() const { return open_; }
+
+  // Record a frame's tags.  Does nothing if the log is not open
+  void Log(const Frame* fr);
+
+  // Write out buffered records and close the file
+  // @returns number of failed writes
+  int Close();
+
+  // Encode a frame into a record
+  // @param rec RecordBytes() bytes
+  // @returns bytes used, for the groups present on the frame
+  size_t Encode(const Frame* fr, uint8_t* rec) const;
+
+  // Size of a record with every group present
+  size_t RecordBytes() const { return record_bytes_; }
+
+  // Header and column tables describing the current groups
+  std::vector<uint8_t> Header() const;
+
+  Stats GetStats();
+
+ private:
+  struct Group {
+    std::string name;
+    std::vector<Column> columns;
+    Filler fill;
+    size_t bytes;  // of the group's columns
+  };
+
+  // Records encoded by one set of threads
+  struct Shard {
+    std::mutex mutex;
+    std::vector<uint8_t> buf;
+  };
+
+  // Background writer body
+  void Run();
+
+  // Hand a buffer to the writer, replacing it with an empty one
+  // @note caller holds the shard's mutex
+  void Submit(std::vector<uint8_t>* buf);
+
+  // Number of whole records in a buffer
+  size_t CountRecords(const std::vector<uint8_t>& buf) const;
+
+  static const int kShards = 8;
+  static const size_t kBufferBytes = 64 * 1024;
+
+  std::vector<Group> groups_;
+  size_t record_bytes_ = sizeof(uint32_t);  // presence mask
+  FILE* file_ = NULL;
+  std::atomic<bool> open_{ false };
+  Shard shards_[kShards];
+
+  std::thread writer_;
+  std::mutex mutex_;
+  std::condition_variable work_;
+  std::deque<std::vector<uint8_t>> full_;    // waiting to be written
+  std::vector<std::vector<uint8_t>> spare_;  // written, ready for reuse
+  bool stop_ = false;
+  Stats stats_;
+};
+
+// Read a file written by TagLog
+class TagLogReader {
+ public:
+  // @returns 0 on success
+  int Open(const std::string& fname);
+
+  // Use a header from TagLog::Header() to format records that are not in a file
+  // @returns 0 on success
+  int SetHeader(const uint8_t* header, size_t n);
+
+  const TagLog::FileHeader& GetHeader() const { return header_; }
+  const std::vector<TagLog::GroupInfo>& Groups() const { return groups_; }
+  const std::vector<TagLog::ColumnInfo>& Columns() const { return columns_; }
+  size_t Count() const { return records_.size(); }
+  const uint8_t* Record(size_t i) const { return &data_[records_[i]]; }
+
+  // Size of a record
+  // @param rec Record(i), or a record from TagLog::Encode()
+  size_t RecordBytes(const uint8_t* rec) const;
+
+  // Where a column's value is in a record
+  // @returns NULL if the column's group is not on the record
+  const uint8_t* Value(const uint8_t* rec, size_t column) const;
+
+  // Comma separated column names
+  std::string CsvHeader() const;
+
+  // One record as comma separated values.  Columns of absent groups are empty
+  // @param rec Record(i), or a record from TagLog::Encode()
+  std::string Csv(const uint8_t* rec) const;
+
+ private:
+  TagLog::FileHeader header_;
+  std::vector<TagLog::GroupInfo> groups_;
+  std::vector<TagLog::ColumnInfo> columns_;
+  std::vector<size_t> group_bytes_;
+  std::vector<uint8_t> data_;
+  std::vector<size_t> records_;  // offset of each record in data_
+};
@@ -2,33 +2,30 @@
 
 #define _CRT_SECURE_NO_WARNINGS
 
-#include <cstdio>
-#include <mutex>
 #include <string>
 
 #include "system/component/inc/frame.h"
 #include "system/component/inc/execnode.h"
+#include "system/component/inc/taglog.h"
 
-// Save tags on a frame to a single CSV file
+// Save tags on a frame to a single binary tag log, shared by every TagSave node
+//   Frame, FFTT, ROI, StdDev, InvertROI and FilterDev tags are logged.
+//   Convert the log with util/taglog (CSV) or read it with util/taglog/taglog.py.
+// Until SetFileName() is called, tags are printed to stdout as CSV instead.
+// The log is closed when the last TagSave node is destroyed.
 class TagSave : public ExecNode {
  public:
-  TagSave() {}
+  TagSave();
   ~TagSave();
 
-  // Set the csv file name
-  // @param fname file to write (include extension, ie .csv)
-  static void SetFileName(std::string fname);
+  // Set the log file name
+  // @param fname file to create (include extension, ie .owtag)
+  // @returns 0 on success
+  static int SetFileName(std::string fname);
 
- private:
-  static FILE* file_;
-  static bool write_header_;
-  static std::mutex mutex_;
+  // The log shared by all TagSave nodes, with the standard tags registered
+  static TagLog& Log();
 
+ private:
   void* Exec(void* data) override;
-
-  template <typename T>
-  void WriteHeader(const Frame* fr);
-
-  template <typename T>
-  void WriteCSV(const Frame* fr);
 };
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
 #include <thread>
 
 namespace Component {
@@ -12,6 +13,13 @@ inline time_t SteadyClockTimeMs() {
   return ms.count();
 }
 
+// Microsecond version of SteadyClockTimeMs(), for timing short operations
+inline int64_t SteadyClockTimeUs() {
+  std::chrono::microseconds us = std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now().time_since_epoch());
+  return us.count();
+}
+
 // Use this in place of Sleep() on Windows, or the below on Mac/Linux.
 inline void SleepMs(time_t ms) {
   std::this_thread::sleep_for(std::chrono::milliseconds(ms));
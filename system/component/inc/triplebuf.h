@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Wait-free latest-value mailbox between one writer and one reader
+// Three buffers: the writer fills its back buffer and publishes it by swapping
+//   it with the middle one; the reader takes the middle one by swapping it with
+//   its front buffer.  Neither side ever waits for the other, so a stalled
+//   reader (eg. a render loop while the window is dragged) never holds up the
+//   writer, and the reader always gets the latest published value.  Values
+//   the reader never took are simply overwritten.
+// Only one thread may write and one thread may read at a time.
+// Example:
+//   TripleBuf<std::vector<uint32_t>> buf;
+//   // writer
+//   std::vector<uint32_t>& px = buf.Write();
+//   ... fill px ...
+//   buf.Publish();
+//   // reader
+//   if (buf.Fresh()) Draw(buf.Read());
+template <typename T>
+class TripleBuf {
+ public:
+  TripleBuf() {}
+
+  // Buffer to fill.  Holds whatever was in it the last time it was the back buffer
+  T& Write() { return buf_[back_]; }
+
+  // Make the buffer from Write() the latest value
+  void Publish();
+
+  // @returns true if a value was published since the last Read()
+  bool Fresh() const { return (middle_.load(std::memory_order_acquire) & kFresh) != 0; }
+
+  // Take the latest published value
+  // The reference stays valid, and unchanged, until the next Read()
+  const T& Read();
+
+  // Number of the value last returned by Read(), counting from 1.  0 before
+  //   anything has been read.  Gaps are values the reader never saw
+  uint64_t Sequence() const { return seq_[front_]; }
+
+ private:
+  static const uint8_t kIndex = 3;
+  static const uint8_t kFresh = 4;
+
+  T buf_[3];
+  uint64_t seq_[3] = {};
+  uint64_t published_ = 0;  // writer only
+  int back_ = 0;            // writer only
+  int front_ = 1;           // reader only
+  std::atomic<uint8_t> middle_{ 2 };
+};
+
+
+template <typename T>
+void TripleBuf<T>::Publish() {
+  seq_[back_] = ++published_;
+  back_ = middle_.exchange(uint8_t(back_ | kFresh), std::memory_order_acq_rel) & kIndex;
+}
+
+
+template <typename T>
+const T& TripleBuf<T>::Read() {
+  if (Fresh()) front_ = middle_.exchange(uint8_t(front_), std::memory_order_acq_rel) & kIndex;
+  return buf_[front_];
+}
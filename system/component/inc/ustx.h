@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <string>
 #include <vector>
 #include <tuple>
 
@@ -82,11 +85,22 @@ class USTx {
   int LoadJson(const nlohmann::json& j); 
 
   // Add an (x, z) coordinate to the focus list
+  // Delays are computed in bulk, when next needed.
   void AddFocus(double x, double z);
 
   // Compute a focus list, and write it to a hex file
+  // Foci are computed in parallel.  With a cache directory set, a focus list
+  //   already computed for the same parameters and foci is copied instead.
   bool ComputeFoci(const char* hex_fname);
 
+  // Keep computed focus lists in a directory, to reuse across runs
+  // @param dir directory, which must exist; "" turns the cache off
+  void SetCacheDir(const std::string& dir) { cache_dir_ = dir; }
+
+  // Hash of everything a focus list depends on: probe geometry, waveform
+  //   parameters and foci.  Names the cached focus list.
+  uint64_t FociHash() const;
+
   // Download a hex file to the USTx
   // @param hex_fname hex file to download
   // @returns 0 if successful
@@ -136,18 +150,39 @@ class USTx {
   // Length-Address-Data structure
   class LAD;
 
-  // Compute a single element's delay to an (x,y).
-  // @returns delay in seconds, <0 if element should be switched off
-  double ComputeDelay(double x, double z, int element);
+  // Compute element positions relative to the center of the array
+  // @returns false if the probe type is unknown
+  bool ComputeElementPositions(std::vector<double>& x, std::vector<double>& z) const;
+
+  // Compute every element's delay to an (x,z)
+  // @param delays n_elements_ delays in seconds, <0 if an element should be
+  //   switched off
+  // @returns the longest delay, before limiting the elements used
+  double ComputeDelays(double x, double z, const double* element_x, const double* element_z, double* delays) const;
+
+  // Compute delays for foci added since the last call
+  // @returns false if the probe type is unknown
+  bool UpdateDelays();
+
+  // TX7332 chip and lane an element is wired to
+  void ElementChannel(int element, int* chip, int* lane) const;
 
   // Compute foci for pulsed mode
-  bool ComputePulsed(const char* hex_fname);
+  // @param ih hex to write to
+  bool ComputePulsed(IntelHex& ih);
 
   // Compute foci for CW mode
-  bool ComputeCW(const char* hex_fname);
+  bool ComputeCW(IntelHex& ih);
 
   // Write hex file header
-  void WriteHeader(const std::vector<LAD>& init, const std::vector<LAD>& focus, IntelHex& ih);
+  // @param focus_len length of each focus' records in bytes
+  void WriteHeader(const std::vector<LAD>& init, int focus_len, IntelHex& ih);
+
+  // Write the header, then every focus' records, made in parallel
+  // @param make_focus makes a focus' records; returns false if it can't
+  // @returns false if any focus failed, having written nothing
+  bool WriteFoci(const std::vector<LAD>& init, IntelHex& ih,
+                 const std::function<bool(size_t focus, std::vector<LAD>& records)>& make_focus);
 
   // Clear out the recieve buffer
   void ClearRx();
@@ -178,12 +213,14 @@ class USTx {
   const int BAUD_RATE = 921600;  // baud rate of the UART
 
   // focus data
-  std::vector<std::vector<double>> delays_;
+  std::vector<double> delays_;  // n_elements_ per focus
+  size_t delays_computed_ = 0;  // foci delays_ holds
   std::vector<std::pair<double, double>> coordinates_;
-  std::vector<double> x_distances_;
 
   // maximum delay between any focus requested and the trigger
   double max_delay_ = -1;
 
+  std::string cache_dir_;
+
   Serial* serial_;
 };
@@ -1,6 +1,6 @@
 #pragma once
 
-#include <mutex>
+#include <atomic>
 #include <vector>
 
 #define SFML_STATIC
@@ -10,8 +10,10 @@
 // Base class for objects that can be drawn and zoomed
 // Derived objects must at minimum call SetDrawable() to determine
 //   what will be drawn.
-// It is recommended to lock Zoomable::lock_ while updating the underlying
-//   drawable objects, otherwise screen tear may occur.
+// Drawable objects are only touched by the drawing thread.  Derived objects
+//   that are fed from ExecNode threads pass their data through a TripleBuf
+//   and update their drawables from draw(), so a stalled render loop never
+//   blocks the pipeline.
 class Zoomable : public sf::Drawable {
  public:
   Zoomable() {}
@@ -54,6 +56,10 @@ class Zoomable : public sf::Drawable {
   // @returns vector with (x,y) corresponding to the absolute fractional loation
   sf::Vector2f FractionalPosition(sf::Vector2f rel);
 
+  // Image pixels per screen pixel at the last draw(), rounded down, at least 1
+  // Derived objects can downsample this much without visible loss
+  int PixelsPerScreenPixel() const { return px_per_screen_px_; }
+
  protected:
   // Set the total drawing area, and define which objects to draw
   // @param width of the objects to draw in pixels
@@ -65,14 +71,11 @@ class Zoomable : public sf::Drawable {
   // @param objs objects to draw when draw() is called
   void SetDrawable(const std::vector<sf::Drawable*>& objs);
 
-  // Lock to synchronoize between updating the drawable object and
-  //   actually drwaing to the screen.
-  mutable std::mutex lock_;
-
  private:
   int width_ = 0;
   int height_ = 0;
   std::vector<sf::Drawable*> objs_;
   sf::View view_;
   float zoom_ = 1.0;
+  mutable std::atomic<int> px_per_screen_px_{ 1 };
 };
@@ -0,0 +1,90 @@
+#include "system/component/inc/bitpack.h"
+
+namespace BitPack {
+
+static void PackGeneric(const uint16_t* in, size_t n, int bits, uint8_t* out) {
+  uint32_t mask = (1u << bits) - 1;
+  uint64_t acc = 0;
+  int n_bits = 0;
+  for (size_t i = 0; i < n; ++i) {
+    acc = acc << bits | (in[i] & mask);
+    n_bits += bits;
+    while (n_bits >= 8) {
+      *(out++) = uint8_t(acc >> (n_bits - 8));
+      n_bits -= 8;
+    }
+    acc &= (1ull << n_bits) - 1;
+  }
+  if (n_bits > 0) *out = uint8_t(acc << (8 - n_bits));
+}
+
+
+static void UnpackGeneric(const uint8_t* in, size_t n, int bits, uint16_t* out) {
+  uint32_t mask = (1u << bits) - 1;
+  uint64_t acc = 0;
+  int n_bits = 0;
+  for (size_t i = 0; i < n; ++i) {
+    while (n_bits < bits) {
+      acc = acc << 8 | *(in++);
+      n_bits += 8;
+    }
+    out[i] = uint16_t((acc >> (n_bits - bits)) & mask);
+    n_bits -= bits;
+    acc &= (1ull << n_bits) - 1;
+  }
+}
+
+
+void PackMsb(const uint16_t* in, size_t n, int bits, uint8_t* out) {
+  size_t i = 0;
+  if (bits == 8) {
+    for (; i < n; ++i) out[i] = uint8_t(in[i]);
+    return;
+  } else if (bits == 10) {
+    for (; i + 4 <= n; i += 4, out += 5) {
+      uint64_t v = (uint64_t)(in[i] & 0x3ff) << 30 | (uint64_t)(in[i + 1] & 0x3ff) << 20 |
+                   (uint64_t)(in[i + 2] & 0x3ff) << 10 | (uint64_t)(in[i + 3] & 0x3ff);
+      out[0] = uint8_t(v >> 32);
+      out[1] = uint8_t(v >> 24);
+      out[2] = uint8_t(v >> 16);
+      out[3] = uint8_t(v >> 8);
+      out[4] = uint8_t(v);
+    }
+  } else if (bits == 12) {
+    for (; i + 2 <= n; i += 2, out += 3) {
+      uint32_t v = (uint32_t)(in[i] & 0xfff) << 12 | (in[i + 1] & 0xfff);
+      out[0] = uint8_t(v >> 16);
+      out[1] = uint8_t(v >> 8);
+      out[2] = uint8_t(v);
+    }
+  }
+  // Whole groups end on a byte boundary, so the tail starts fresh
+  PackGeneric(in + i, n - i, bits, out);
+}
+
+
+void UnpackMsb(const uint8_t* in, size_t n, int bits, uint16_t* out) {
+  size_t i = 0;
+  if (bits == 8) {
+    for (; i < n; ++i) out[i] = in[i];
+    return;
+  } else if (bits == 10) {
+    for (; i + 4 <= n; i += 4, in += 5) {
+      uint64_t v = (uint64_t)in[0] << 32 | (uint64_t)in[1] << 24 | (uint64_t)in[2] << 16 |
+                   (uint64_t)in[3] << 8 | in[4];
+      out[i] = uint16_t(v >> 30);
+      out[i + 1] = uint16_t((v >> 20) & 0x3ff);
+      out[i + 2] = uint16_t((v >> 10) & 0x3ff);
+      out[i + 3] = uint16_t(v & 0x3ff);
+    }
+  } else if (bits == 12) {
+    for (; i + 2 <= n; i += 2, in += 3) {
+      uint32_t v = (uint32_t)in[0] << 16 | (uint32_t)in[1] << 8 | in[2];
+      out[i] = uint16_t(v >> 12);
+      out[i + 1] = uint16_t(v & 0xfff);
+    }
+  }
+  UnpackGeneric(in, n - i, bits, out + i);
+}
+
+}  // namespace BitPack
@@ -17,7 +17,10 @@ ExecNode::ThreadManager::ThreadManager() {
 }
 
 ExecNode::ThreadManager::~ThreadManager() {
-  stop_ = true;
+  {
+    std::lock_guard<std::mutex> lock(rd_mutex_);
+    stop_ = true;
+  }
   wake_thread_.notify_all();
   for (std::thread& t : threads_) {
     t.join();
@@ -32,6 +35,11 @@ void ExecNode::ThreadManager::Schedule(ExecNode* en, void* data) {
     exit(-1);
   }
   scheduled_nodes_.Push(std::pair<ExecNode*, void*>(en, data));
+  {
+    // Threads wait under rd_mutex_: taking it orders the push before their
+    //   check, so a thread about to sleep cannot miss this wakeup
+    std::lock_guard<std::mutex> rd_lock(rd_mutex_);
+  }
   wake_thread_.notify_one();
 }
 
@@ -50,7 +58,10 @@ void ExecNode::ThreadManager::Thread() {
 }
 
 void ExecNode::ThreadManager::SetNumberThreads(size_t threads) {
-  stop_ = true;
+  {
+    std::lock_guard<std::mutex> lock(rd_mutex_);
+    stop_ = true;
+  }
   wake_thread_.notify_all();
   for (std::thread& t : threads_) {
     t.join();
@@ -69,6 +80,7 @@ static const int BUFLEN = 10;
 ExecNode::ExecNode() {
   down_queue_.resize(BUFLEN);
   up_queue_.resize(BUFLEN);
+  up_from_.resize(BUFLEN);
 }
 
 void ExecNode::Join(ExecNode* producer, ExecNode* consumer) {
@@ -92,6 +104,7 @@ void ExecNode::resize(size_t n) {
   if (down_queue_.size() == n) return;
   down_queue_.resize(n);
   up_queue_.resize(n);
+  up_from_.resize(n);
 
   for (ExecNode* en : consumers_) {
     en->resize(n);
@@ -109,7 +122,9 @@ bool ExecNode::IsRoot() { return producers_.size() == 0; }
 void ExecNode::Produce(void* data) {
   assert(IsRoot());
   mutex_.lock();
+  ++admitted_;
   up_queue_.Push(data);
+  up_from_.Push(NULL);
   std::vector<bool> run_list;
   for (ExecNode* consumer : consumers_) {
     run_list.push_back(consumer->Schedule(data, this));
@@ -126,13 +141,61 @@ void ExecNode::Consume(void* data) {
   assert(IsRoot());
   mutex_.lock();
   down_queue_.Push(data);
+  ++admitted_;
   up_queue_.Push(data);
+  up_from_.Push(NULL);
   mutex_.unlock();
   thread_manager_.Schedule(this, data);
 }
 
 bool ExecNode::IsExecDone() { return !up_queue_.PopAvailable(); }
 
+bool ExecNode::ReceivedBefore(void* a, void* b) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (size_t i = 0; i < down_queue_.PopAvailable(); ++i) {
+    void* d = down_queue_.Peek(i);
+    if (d == a) return true;
+    if (d == b) return false;
+  }
+  return false;
+}
+
+std::future<void> ExecNode::Drain() {
+  std::promise<void> done;
+  std::future<void> future = done.get_future();
+  std::lock_guard<std::mutex> lock(drain_mutex_);
+  uint64_t target = admitted_;
+  if (retired_ >= target) {
+    done.set_value();
+  } else {
+    drains_.emplace_back(target, std::move(done));
+  }
+  return future;
+}
+
+bool ExecNode::WaitExecDone(int timeout_ms) {
+  std::future<void> done = Drain();
+  if (timeout_ms < 0) {
+    done.wait();
+    return true;
+  }
+  return done.wait_for(std::chrono::milliseconds(timeout_ms)) == std::future_status::ready;
+}
+
+void ExecNode::Retire(std::vector<std::promise<void>>* drained) {
+  std::lock_guard<std::mutex> lock(drain_mutex_);
+  ++retired_;
+  for (size_t i = 0; i < drains_.size();) {
+    if (drains_[i].first <= retired_) {
+      drained->push_back(std::move(drains_[i].second));
+      drains_[i] = std::move(drains_.back());
+      drains_.pop_back();
+    } else {
+      ++i;
+    }
+  }
+}
+
 bool ExecNode::Schedule(void* data, ExecNode* producer) {
   std::lock_guard<std::mutex> lock(mutex_);
 
@@ -149,7 +212,9 @@ bool ExecNode::Schedule(void* data, ExecNode* producer) {
   }
   assert(down_queue_.PushAvailable());
   down_queue_.Push(data);
+  ++admitted_;
   up_queue_.Push(data);
+  up_from_.Push(producer);
   return true;
 }
 
@@ -168,13 +233,20 @@ void ExecNode::Execute(void* data) {
   if (IsLeaf()) {
     if (rv) AtExit(rv);
     rv = up_queue_.Pop();
+    ExecNode* from = up_from_.Pop();
+    std::vector<ExecNode*> retired(1, this);
     for (ExecNode* producer : producers_) {
-      producer->CleanUp(rv, this);
+      if (sync_ || producer == from) producer->CleanUp(rv, this, &retired);
     }
     assert(down_queue_.PopAvailable());
     down_queue_.Pop();
-    lck.unlock();
     order_.notify_all();
+    // Last, as a waiter may destroy this node (or any upstream) as soon as
+    //   its Drain() completes
+    std::vector<std::promise<void>> drained;
+    for (ExecNode* en : retired) en->Retire(&drained);
+    lck.unlock();
+    for (std::promise<void>& p : drained) p.set_value();
 
   } else {
     for (ExecNode* consumer : consumers_) {
@@ -191,7 +263,7 @@ void ExecNode::Execute(void* data) {
   
 }
 
-void ExecNode::CleanUp(void* data, ExecNode* consumer) {
+void ExecNode::CleanUp(void* data, ExecNode* consumer, std::vector<ExecNode*>* retired) {
   // Always need to wait until all downstream nodes are done
   //   with the current set of data (otherwise we could free
   //   data still being used by a consumer)
@@ -210,9 +282,11 @@ void ExecNode::CleanUp(void* data, ExecNode* consumer) {
   if (data) AtExit(data);
   assert(up_queue_.PopAvailable());
   void* up_data = up_queue_.Pop();
+  ExecNode* from = up_from_.Pop();
+  retired->push_back(this);
 
   for (ExecNode* producer : producers_) {
-    producer->CleanUp(up_data, this);
+    if (sync_ || producer == from) producer->CleanUp(up_data, this, retired);
   }
 }
 
@@ -0,0 +1,131 @@
+#include "system/component/inc/fftbatch.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "system/component/inc/time.h"
+
+
+FFTBatch::FFTBatch(int width, int height, int max_batch, int latency_ms, int max_running, unsigned flags)
+    : width_(width), height_(height), max_batch_(std::max(1, max_batch)), latency_us_(latency_ms * 1000),
+      max_running_(std::max(1, max_running)) {
+  fft_width_ = width_ / 2 + 1;
+  in_dist_ = (size_t)width_ * height_;
+  out_dist_ = (size_t)fft_width_ * height_;
+
+  int ret = fftw_import_wisdom_from_filename("fftw.wis");
+  if (!ret && (flags & (FFTW_PATIENT | FFTW_EXHAUSTIVE))) {
+    printf("No FFT wisdom found, computing.  This can take several minutes\n");
+  }
+
+  // One batch can be filling while the others run.  The plans are executed
+  //   on every batch's (equally aligned) buffers
+  batches_.resize(max_running_ + 1);
+  for (Batch& b : batches_) {
+    b.in = fftw_alloc_real(in_dist_ * max_batch_);
+    b.out = fftw_alloc_complex(out_dist_ * max_batch_);
+  }
+  int n[2] = { height_, width_ };
+  for (int k = 1; k <= max_batch_; ++k) {
+    plans_.push_back(fftw_plan_many_dft_r2c(2, n, k, batches_[0].in, NULL, 1, (int)in_dist_,
+                                            batches_[0].out, NULL, 1, (int)out_dist_, flags));
+  }
+  fftw_export_wisdom_to_filename("fftw.wis");
+}
+
+
+FFTBatch::~FFTBatch() {
+  for (fftw_plan plan : plans_) fftw_destroy_plan(plan);
+  for (Batch& b : batches_) {
+    fftw_free(b.in);
+    fftw_free(b.out);
+  }
+}
+
+
+int FFTBatch::LimitLocked() const {
+  if (stats_.us_per_frame <= 0) return max_batch_;
+  int n = (int)(latency_us_ / stats_.us_per_frame);
+  return std::min(max_batch_, std::max(1, n));
+}
+
+
+int FFTBatch::Limit() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return LimitLocked();
+}
+
+
+FFTBatch::Stats FFTBatch::GetStats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+
+void FFTBatch::Transform(const std::function<void(double* in)>& fill,
+                         const std::function<void(const fftw_complex* out)>& use) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  Batch* batch = NULL;
+  changed_.wait(lock, [&] {
+    if (open_ && open_->n < LimitLocked()) {
+      batch = open_;
+      return true;
+    }
+    for (Batch& b : batches_) {
+      if (!b.busy) {
+        batch = &b;
+        return true;
+      }
+    }
+    return false;
+  });
+  bool leader = !batch->busy;
+  if (leader) {
+    batch->busy = true;
+    open_ = batch;
+  }
+  int idx = batch->n++;
+
+  lock.unlock();
+  fill(batch->in + idx * in_dist_);  // Frames copy in on their own threads
+  lock.lock();
+  ++batch->filled;
+  changed_.notify_all();
+
+  if (leader) {
+    // While every runner is busy, frames keep joining this batch
+    changed_.wait(lock, [&] { return running_ < max_running_; });
+    if (open_ == batch) open_ = NULL;
+    changed_.wait(lock, [&] { return batch->filled == batch->n; });
+    ++running_;
+    int n = batch->n;
+    lock.unlock();
+
+    int64_t start = Component::SteadyClockTimeUs();
+    fftw_execute_dft_r2c(plans_[n - 1], batch->in, batch->out);
+    double us = (double)(Component::SteadyClockTimeUs() - start) / n;
+
+    lock.lock();
+    --running_;
+    stats_.frames += n;
+    ++stats_.batches;
+    stats_.largest = std::max(stats_.largest, n);
+    stats_.us_per_frame = stats_.us_per_frame > 0 ? 0.9 * stats_.us_per_frame + 0.1 * us : us;
+    batch->unread = n;
+    batch->done = true;
+    changed_.notify_all();
+  } else {
+    changed_.wait(lock, [&] { return batch->done; });
+  }
+
+  lock.unlock();
+  use(batch->out + idx * out_dist_);  // And read out on their own threads
+  lock.lock();
+  if (--batch->unread == 0) {
+    batch->busy = false;
+    batch->n = 0;
+    batch->filled = 0;
+    batch->done = false;
+    changed_.notify_all();
+  }
+}
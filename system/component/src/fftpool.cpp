@@ -0,0 +1,209 @@
+#include "system/component/inc/fftpool.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+#include "system/component/inc/time.h"
+
+static inline double abs2(const fftw_complex c) {
+  return c[0] * c[0] + c[1] * c[1];
+}
+
+
+FFTPool::FFTPool(int h_sz, int v_sz, int n_threads, unsigned flags) {
+  h_sz_ = h_sz;
+  v_sz_ = v_sz;
+  fft_h_sz_ = h_sz_ / 2 + 1;
+  fft_v_sz_ = v_sz_;
+  fft_sz_ = fft_h_sz_ * fft_v_sz_;
+  if (n_threads < 1) n_threads = 1;
+
+  int ret = fftw_import_wisdom_from_filename("fftw.wis");
+  if (!ret && (flags & (FFTW_PATIENT | FFTW_EXHAUSTIVE))) {
+    printf("No FFT wisdom found, computing.  This can take several minutes\n");
+  }
+
+  // One plan, executed on every slot's (equally aligned) buffers
+  slots_.resize(n_threads + 1);
+  for (Slot& slot : slots_) {
+    slot.in = fftw_alloc_real(h_sz_ * v_sz_);
+    slot.out = fftw_alloc_complex(fft_sz_);
+    slot.px.assign(fft_sz_, 0xFF000000);
+    slot.done = false;
+  }
+  plan_ = fftw_plan_dft_r2c_2d(v_sz_, h_sz_, slots_[0].in, slots_[0].out, flags);
+  fftw_export_wisdom_to_filename("fftw.wis");
+
+  std::shared_ptr<Mask> mask = std::make_shared<Mask>();
+  mask->roi.assign(fft_sz_, 0.0);
+  mask->rou.assign(fft_sz_, 0.0);
+  mask_ = mask;
+
+  for (int i = (int)slots_.size() - 1; i >= 0; --i) free_.push_back(i);
+  for (int i = 0; i < n_threads; ++i) threads_.emplace_back(&FFTPool::Run, this);
+}
+
+
+FFTPool::~FFTPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_.notify_all();
+  for (std::thread& thread : threads_) thread.join();
+  fftw_destroy_plan(plan_);
+  for (Slot& slot : slots_) {
+    fftw_free(slot.in);
+    fftw_free(slot.out);
+  }
+}
+
+
+void FFTPool::SetMask(int c_h, int c_v, int r) {
+  int roi_h = c_h;
+  int roi_v = fft_v_sz_ - c_v;
+  int rou_h = c_h;
+  int rou_v = c_v;
+
+  std::shared_ptr<Mask> mask = std::make_shared<Mask>();
+  mask->roi.assign(fft_sz_, 0.0);
+  mask->rou.assign(fft_sz_, 0.0);
+  for (int v = 0; v < fft_v_sz_; ++v) {
+    for (int h = 0; h < fft_h_sz_; ++h) {
+      int idx = v * fft_h_sz_ + h;
+      if ((roi_h - h) * (roi_h - h) + (roi_v - v) * (roi_v - v) < r * r) {
+        mask->roi[idx] = 1.0;
+      } else if ((rou_h - h) * (rou_h - h) + (rou_v - v) * (rou_v - v) < r * r) {
+        mask->rou[idx] = 1.0;
+      }
+    }
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  mask_ = mask;
+}
+
+
+std::shared_ptr<const FFTPool::Mask> FFTPool::GetMask() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return mask_;
+}
+
+
+void FFTPool::SetRange(bool compute_log, double min_val, double max_val) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  compute_log_ = compute_log;
+  b_ = min_val;
+  m_ = 255 / (max_val - min_val);
+}
+
+
+bool FFTPool::Submit(const Frame* fr) {
+  int idx;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_.empty()) return false;
+    idx = free_.back();
+    free_.pop_back();
+  }
+
+  // The slot is ours until it is queued
+  Slot& slot = slots_[idx];
+  int n = h_sz_ * v_sz_;
+  for (int i = 0; i < n; ++i) slot.in[i] = fr->data[i];
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    slot.mask = mask_;
+    slot.compute_log = compute_log_;
+    slot.m = m_;
+    slot.b = b_;
+    slot.done = false;
+    slot.result.frame = submitted_++;
+    pending_.push_back(idx);
+    order_.push_back(idx);
+  }
+  work_.notify_one();
+  return true;
+}
+
+
+const FFTPool::Result* FFTPool::Collect() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  int newest = -1;
+  while (!order_.empty() && slots_[order_.front()].done) {
+    if (newest >= 0) free_.push_back(newest);
+    newest = order_.front();
+    order_.pop_front();
+  }
+  if (newest < 0) return NULL;
+  if (shown_ >= 0) free_.push_back(shown_);
+  shown_ = newest;
+  return &slots_[shown_].result;
+}
+
+
+bool FFTPool::Wait(int timeout_ms) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto idle = [this] {
+    for (int idx : order_) {
+      if (!slots_[idx].done) return false;
+    }
+    return true;
+  };
+  if (timeout_ms < 0) {
+    finished_.wait(lock, idle);
+    return true;
+  }
+  return finished_.wait_for(lock, std::chrono::milliseconds(timeout_ms), idle);
+}
+
+
+void FFTPool::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    work_.wait(lock, [this] { return !pending_.empty() || stop_; });
+    if (pending_.empty()) break;
+    Slot* slot = &slots_[pending_.front()];
+    pending_.pop_front();
+    lock.unlock();
+    Process(plan_, fft_sz_, slot);
+    lock.lock();
+    slot->done = true;
+    finished_.notify_all();
+  }
+}
+
+
+void FFTPool::Process(fftw_plan plan, int sz, Slot* slot) {
+  int64_t start = Component::SteadyClockTimeUs();
+  fftw_execute_dft_r2c(plan, slot->in, slot->out);
+
+  const double* roi_mask = slot->mask->roi.data();
+  const double* rou_mask = slot->mask->rou.data();
+  double max = 0;
+  double roi = 0;
+  double rou = 0;
+  for (int i = 0; i < sz; ++i) {
+    double res = abs2(slot->out[i]);
+    if (slot->compute_log) res = log(res + 1);
+    roi += res * roi_mask[i];
+    rou += res * rou_mask[i];
+    if (res > max) max = res;
+    slot->out[i][0] = res;
+  }
+
+  uint32_t* px = slot->px.data();
+  for (int i = 0; i < sz; ++i) {
+    double res = (slot->out[i][0] - slot->b) * slot->m;
+    if (res < 0) res = 0;
+    if (res > 255) res = 255;
+    uint32_t grey = (uint8_t)res;
+    px[i] = 0xFF000000 | grey << 16 | grey << 8 | grey;
+  }
+
+  slot->result.max = max;
+  slot->result.power = roi / rou;
+  slot->result.px = px;
+  slot->result.us = Component::SteadyClockTimeUs() - start;
+}
@@ -4,6 +4,7 @@
 #include <cassert>
 #include <cmath>
 #include <cstdio>
+#include <cstring>
 
 #ifdef _MSC_VER
 #ifdef _DEBUG
@@ -81,6 +82,7 @@ void FFTT::resize(size_t n) {
 }
 
 FFTT::~FFTT() {
+  delete batch_;
   for (fft_tag& t : data_.Raw()) {
     delete[] t.fft;
     t.fft = NULL;
@@ -97,20 +99,40 @@ void FFTT::SubWindow2Point(int x0, int y0, int x1, int y1) {
   subwin_y_sz_ = abs(y0 - y1);
 }
 
+void FFTT::SetBatch(int max_batch, int latency_ms, int max_running) {
+  delete batch_;
+  batch_ = NULL;
+  if (max_batch > 1) batch_ = new FFTBatch(x_sz_, y_sz_, max_batch, latency_ms, max_running);
+}
+
+FFTBatch::Stats FFTT::GetBatchStats() {
+  return batch_ ? batch_->GetStats() : FFTBatch::Stats();
+}
+
 void* FFTT::Exec(void* data) {
   Frame* fr = (Frame*)data;
   Tag& t = data_.Alloc();
   time_t t1 = Component::SteadyClockTimeMs();
 
-  memset(t.fft, 0, sizeof(double) * x_sz_ * y_sz_);
+  auto fill = [&](double* in) {
+    memset(in, 0, sizeof(double) * x_sz_ * y_sz_);
 
-  for (int j = subwin_y_; j < subwin_y_ + subwin_y_sz_; ++j) {
-    for (int i = subwin_x_; i < subwin_x_ + subwin_x_sz_; ++i) {
-      t.fft[i + j * x_sz_] = fr->data[i + j * x_sz_];
+    for (int j = subwin_y_; j < subwin_y_ + subwin_y_sz_; ++j) {
+      for (int i = subwin_x_; i < subwin_x_ + subwin_x_sz_; ++i) {
+        in[i + j * x_sz_] = fr->data[i + j * x_sz_];
+      }
     }
-  }
+  };
 
-  fftw_execute_dft_r2c(t.plan, t.fft, t.fft_complex);
+  if (batch_) {
+    // Consumers (e.g. InvertROI) use the complex result, so it is copied out
+    batch_->Transform(fill, [&](const fftw_complex* out) {
+      memcpy(t.fft_complex, out, sizeof(fftw_complex) * fft_sz_);
+    });
+  } else {
+    fill(t.fft);
+    fftw_execute_dft_r2c(t.plan, t.fft, t.fft_complex);
+  }
 
   double scale = 1.0 / (fr->width * fr->height);
   for (int i = 0; i < fft_sz_; ++i) {
@@ -160,18 +182,20 @@ void FFTTDraw::Init(int x_sz, int y_sz) {
   x0_ = 0;
   compute_log_ = true;
   max_ = 0;
+  log_.Set(m_, x0_);
 
-  px_.resize(fft_x_sz_ * fft_y_sz_, 0xFF000000);
   FFTWDraw::Resize(x_sz, y_sz);
 }
 
 void FFTTDraw::SetScale(bool compute_log, double min, double max) {
+  std::lock_guard<std::mutex> lock(wr_lock_);
   compute_log_ = compute_log;
   scale_min_ = min;
   scale_max_ = max;
   if (compute_log_) {
     x0_ = log(min);
     m_ = 255.0 / (log(max + 1) - log(min + 1));
+    log_.Set(m_, x0_);
   } else {
     x0_ = min;
     m_ = 255.0 / (max - min);
@@ -190,17 +214,25 @@ void* FFTTDraw::Exec(void* data) {
   double* fft = FFTT::GetTag((Frame*)data)->fft;
   assert(fft);
 
+  // Claim the refresh interval only once the frame is sure to be drawn
   if (!wr_lock_.try_lock()) return data;
-  for (int i = 0; i < fft_sz_; ++i) {
-    double x = fft[i];
-    if (compute_log_) x = log(x + 1);
-    x = m_ * (x - x0_);
-    if (x > 255) x = 255;
-    if (x < 0) x = 0;
-    memset(&px_[i], int(x), 3);
+  if (!limit_.Take()) {
+    wr_lock_.unlock();
+    return data;
+  }
+  std::vector<uint32_t>& px = FFTWDraw::Pixels();
+  if (compute_log_) {
+    log_.Map(fft, fft_sz_, px.data());
+  } else {
+    for (int i = 0; i < fft_sz_; ++i) {
+      double x = m_ * (fft[i] - x0_);
+      if (x > 255) x = 255;
+      if (x < 0) x = 0;
+      px[i] = Preview::Grey(int(x));
+    }
   }
 
-  FFTWDraw::Update(px_);
+  FFTWDraw::Publish();
 
   wr_lock_.unlock();
   return data;
@@ -233,6 +265,7 @@ void* FFTTSubWindowDraw::Exec(void* data) {
   fft_tag* fft = FFTT::GetTag((Frame*)data);
   assert(fft);
 
+  std::lock_guard<std::mutex> lock(wr_lock_);
   if (subwin_x_ == fft->x && subwin_y_ == fft->y && subwin_x_sz_ == fft->x_sz &&
       subwin_y_sz_ == fft->y_sz) {
     return data;
@@ -242,24 +275,25 @@ void* FFTTSubWindowDraw::Exec(void* data) {
   subwin_y_ = fft->y;
   subwin_x_sz_ = fft->x_sz;
   subwin_y_sz_ = fft->y_sz;
-
-  std::lock_guard<std::mutex> lock(Zoomable::lock_);
-  if (subwin_x_ == 0 && subwin_y_ == 0 && subwin_x_sz_ == width_ &&
-      subwin_y_sz_ == height_) {
-    // don't draw when the whole frame is selected
-    vertex_[0].position = sf::Vector2f(0, 0);
-    vertex_[1].position = sf::Vector2f(0, 0);
-    vertex_[2].position = sf::Vector2f(0, 0);
-    vertex_[3].position = sf::Vector2f(0, 0);
-    vertex_[4].position = sf::Vector2f(0, 0);
-  } else {
-    vertex_[0].position = sf::Vector2f(float(subwin_x_), float(subwin_y_));
-    vertex_[1].position = sf::Vector2f(float(subwin_x_ + subwin_x_sz_), float(subwin_y_));
-    vertex_[2].position =
-        sf::Vector2f(float(subwin_x_ + subwin_x_sz_), float(subwin_y_ + subwin_y_sz_));
-    vertex_[3].position = sf::Vector2f(float(subwin_x_), float(subwin_y_ + subwin_y_sz_));
-    vertex_[4].position = sf::Vector2f(float(subwin_x_), float(subwin_y_));
-  }
+  subwin_.Write() = { subwin_x_, subwin_y_, subwin_x_sz_, subwin_y_sz_ };
+  subwin_.Publish();
 
   return data;
 }
+
+void FFTTSubWindowDraw::draw(sf::RenderTarget& target, sf::RenderStates states) const {
+  if (subwin_.Fresh()) {
+    const std::array<int, 4>& w = subwin_.Read();
+    if (w[0] == 0 && w[1] == 0 && w[2] == width_ && w[3] == height_) {
+      // don't draw when the whole frame is selected
+      for (int i = 0; i < 5; ++i) vertex_[i].position = sf::Vector2f(0, 0);
+    } else {
+      vertex_[0].position = sf::Vector2f(float(w[0]), float(w[1]));
+      vertex_[1].position = sf::Vector2f(float(w[0] + w[2]), float(w[1]));
+      vertex_[2].position = sf::Vector2f(float(w[0] + w[2]), float(w[1] + w[3]));
+      vertex_[3].position = sf::Vector2f(float(w[0]), float(w[1] + w[3]));
+      vertex_[4].position = sf::Vector2f(float(w[0]), float(w[1]));
+    }
+  }
+  Zoomable::draw(target, states);
+}
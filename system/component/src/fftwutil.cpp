@@ -69,8 +69,24 @@ int FFTWDraw::FFTWIndex(int x, int y) {
 
 void FFTWDraw::Update(const std::vector<uint32_t>& pixels) {
   assert(pixels.size() == fft_x_sz_ * fft_y_sz_);
-  std::lock_guard<std::mutex> lock(Zoomable::lock_);
-  tx_.update((uint8_t*)pixels.data());
+  Pixels() = pixels;
+  Publish();
+}
+
+
+std::vector<uint32_t>& FFTWDraw::Pixels() {
+  std::vector<uint32_t>& px = px_.Write();
+  px.resize(fft_x_sz_ * fft_y_sz_, 0xFF000000);
+  return px;
+}
+
+
+void FFTWDraw::draw(sf::RenderTarget& target, sf::RenderStates states) const {
+  if (px_.Fresh()) {
+    const std::vector<uint32_t>& px = px_.Read();
+    if (px.size() == fft_x_sz_ * fft_y_sz_) tx_.update((const uint8_t*)px.data());
+  }
+  Zoomable::draw(target, states);
 }
 
 
@@ -0,0 +1,260 @@
+#undef _CRT_SECURE_NO_WARNINGS
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "system/component/inc/filemirror.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <sys/stat.h>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+#include "system/component/inc/time.h"
+
+static const size_t kChunkBytes = 1 << 20;
+static const int kAttempts = 3;
+
+// Size of a file, or -1 if it does not exist
+static int64_t FileSize(const std::string& fname) {
+#ifdef _WIN32
+  struct _stat64 st;
+  if (_stat64(fname.c_str(), &st) != 0) return -1;
+#else
+  struct stat st;
+  if (stat(fname.c_str(), &st) != 0) return -1;
+#endif
+  return (int64_t)st.st_size;
+}
+
+// Create every directory leading up to a file
+static void MakeParentDirs(const std::string& fname) {
+  for (size_t i = 1; i < fname.size(); ++i) {
+    if (fname[i] != '/' && fname[i] != '\\') continue;
+    if (fname[i - 1] == ':') continue;  // Drive letter
+    std::string dir = fname.substr(0, i);
+#ifdef _WIN32
+    _mkdir(dir.c_str());
+#else
+    mkdir(dir.c_str(), 0777);
+#endif
+  }
+}
+
+
+uint64_t FileMirror::Checksum(const void* data, size_t n, uint64_t hash) {
+  const uint8_t* p = (const uint8_t*)data;
+  for (size_t i = 0; i < n; ++i) {
+    hash ^= p[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+
+FileMirror::FileMirror(const std::string& journal, double max_mb_per_s)
+    : journal_name_(journal), max_bytes_per_ms_(max_mb_per_s * 1.0e6 / 1000.0) {
+  if (!journal_name_.empty()) Resume();
+  thread_ = std::thread(&FileMirror::Run, this);
+}
+
+
+FileMirror::~FileMirror() {
+  stop_ = true;
+  work_.notify_all();
+  thread_.join();
+  if (journal_) fclose(journal_);
+}
+
+
+void FileMirror::Copy(const std::string& src, const std::string& dst) {
+  Job job;
+  job.src = src;
+  job.dst = dst;
+  int64_t size = FileSize(src);
+  job.bytes = size > 0 ? size : 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Journal('+', job);
+    queue_.push_back(job);
+    backlog_.bytes_pending += job.bytes;
+  }
+  work_.notify_one();
+}
+
+
+bool FileMirror::Wait(int timeout_ms) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto done = [this] { return queue_.empty(); };
+  if (timeout_ms < 0) {
+    idle_.wait(lock, done);
+    return true;
+  }
+  return idle_.wait_for(lock, std::chrono::milliseconds(timeout_ms), done);
+}
+
+
+FileMirror::Backlog FileMirror::GetBacklog() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Backlog backlog = backlog_;
+  backlog.files_pending = queue_.size();
+  if (copy_ms_ > 0) backlog.mb_per_s = backlog.bytes_copied / 1.0e6 / (copy_ms_ / 1000.0);
+  return backlog;
+}
+
+
+void FileMirror::Journal(char op, const Job& job) {
+  if (!journal_) return;
+  fprintf(journal_, "%c\t%s\t%s\n", op, job.src.c_str(), job.dst.c_str());
+  fflush(journal_);
+}
+
+
+void FileMirror::Resume() {
+  std::vector<Job> order;
+  std::map<std::string, int> pending;  // "src\tdst" -> copies outstanding
+  if (FILE* in = fopen(journal_name_.c_str(), "r")) {
+    char line[4096];
+    while (fgets(line, sizeof(line), in)) {
+      size_t len = strlen(line);
+      if (len < 4 || line[len - 1] != '\n' || line[1] != '\t') continue;  // Torn last line
+      line[len - 1] = '\0';
+      char* tab = strchr(line + 2, '\t');
+      if (!tab) continue;
+      std::string key = line + 2;
+      if (line[0] == '+') {
+        if (pending[key]++ == 0) {
+          Job job;
+          job.src.assign(line + 2, tab);
+          job.dst = tab + 1;
+          order.push_back(job);
+        }
+      } else if (line[0] == '-' && pending[key] > 0) {
+        --pending[key];
+      }
+    }
+    fclose(in);
+  }
+
+  MakeParentDirs(journal_name_);
+  journal_ = fopen(journal_name_.c_str(), "w");
+  if (!journal_) printf("ERROR: FileMirror unable to open %s\n", journal_name_.c_str());
+  for (Job& job : order) {
+    if (pending[job.src + "\t" + job.dst] == 0) continue;
+    int64_t size = FileSize(job.src);
+    job.bytes = size > 0 ? size : 0;
+    Journal('+', job);
+    queue_.push_back(job);
+    backlog_.bytes_pending += job.bytes;
+  }
+  if (!queue_.empty()) printf("INFO: FileMirror resuming %d copies\n", (int)queue_.size());
+}
+
+
+void FileMirror::Throttle(uint64_t bytes) {
+  if (max_bytes_per_ms_ <= 0) return;
+  time_t now = Component::SteadyClockTimeMs();
+  if (now - window_start_ms_ > 1000) {  // Start a new one second window
+    window_start_ms_ = now;
+    window_bytes_ = 0;
+  }
+  window_bytes_ += bytes;
+  time_t allowed_ms = (time_t)(window_bytes_ / max_bytes_per_ms_);
+  time_t elapsed_ms = now - window_start_ms_;
+  if (allowed_ms > elapsed_ms) Component::SleepMs(allowed_ms - elapsed_ms);
+}
+
+
+int FileMirror::CopyFile(const Job& job) {
+  FILE* in = fopen(job.src.c_str(), "rb");
+  if (!in) return -1;
+  std::string part = job.dst + ".part";
+  MakeParentDirs(job.dst);
+
+  // Continue a partial copy.  The source is local, so hash what is already
+  // there from the source rather than reading it back from the destination
+  int64_t done = FileSize(part);
+  if (done < 0 || done > (int64_t)job.bytes) done = 0;
+  std::vector<uint8_t> buf(kChunkBytes);
+  uint64_t hash = Checksum(NULL, 0);
+  for (int64_t left = done; left > 0;) {
+    size_t n = fread(buf.data(), 1, (size_t)std::min<int64_t>(left, buf.size()), in);
+    if (n == 0) break;
+    hash = Checksum(buf.data(), n, hash);
+    left -= n;
+  }
+
+  FILE* out = fopen(part.c_str(), done ? "ab" : "wb");
+  if (!out) {
+    fclose(in);
+    return -1;
+  }
+  int ret = 0;
+  size_t n;
+  while ((n = fread(buf.data(), 1, buf.size(), in)) > 0) {
+    hash = Checksum(buf.data(), n, hash);
+    if (fwrite(buf.data(), 1, n, out) != n) {
+      ret = -1;
+      break;
+    }
+    Throttle(n);
+    if (stop_) {
+      ret = 1;
+      break;
+    }
+  }
+  if (ferror(in)) ret = -1;
+  fclose(in);
+  if (fclose(out) != 0 && ret == 0) ret = -1;
+  if (ret != 0) return ret;
+
+  // Verify what actually landed at the destination
+  FILE* check = fopen(part.c_str(), "rb");
+  if (!check) return -1;
+  uint64_t dst_hash = Checksum(NULL, 0);
+  while ((n = fread(buf.data(), 1, buf.size(), check)) > 0) dst_hash = Checksum(buf.data(), n, dst_hash);
+  fclose(check);
+  if (dst_hash != hash) {
+    printf("WARNING: FileMirror checksum mismatch for %s\n", job.dst.c_str());
+    remove(part.c_str());
+    return -1;
+  }
+
+  remove(job.dst.c_str());  // rename() will not replace a file on Windows
+  return rename(part.c_str(), job.dst.c_str()) == 0 ? 0 : -1;
+}
+
+
+void FileMirror::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    work_.wait(lock, [this] { return !queue_.empty() || stop_; });
+    if (stop_) break;
+    Job job = queue_.front();  // Stays queued, and counted, until finished
+    lock.unlock();
+
+    time_t start_ms = Component::SteadyClockTimeMs();
+    int ret = -1;
+    for (int attempt = 0; attempt < kAttempts && ret < 0 && !stop_; ++attempt) ret = CopyFile(job);
+    time_t end_ms = Component::SteadyClockTimeMs();
+
+    lock.lock();
+    if (ret > 0 || stop_) break;  // Interrupted: still in the journal for next time
+    copy_ms_ += end_ms - start_ms;
+    queue_.pop_front();
+    backlog_.bytes_pending -= job.bytes;
+    if (ret == 0) {
+      ++backlog_.files_copied;
+      backlog_.bytes_copied += job.bytes;
+      Journal('-', job);
+    } else {
+      printf("ERROR: FileMirror unable to copy %s to %s\n", job.src.c_str(), job.dst.c_str());
+      ++backlog_.failures;
+    }
+    if (queue_.empty()) idle_.notify_all();
+  }
+  idle_.notify_all();
+}
@@ -3,6 +3,7 @@
 #include <cstring>
 #include <assert.h>
 
+#include "system/component/inc/bitpack.h"
 #include "system/component/inc/time.h"
 #include "system/third_party/inc/tiffio.h"
 #include "system/third_party/inc/tiff.h"
@@ -11,15 +12,6 @@
 #pragma comment (lib, "tiff.lib")
 #endif
 
-// shift right/left based on sign
-static inline uint8_t sh(uint16_t in, int shift) {
-  if (shift >= 0) {
-    return in >> shift;
-  } else {
-    return in << (-shift);
-  }
-}
-
 class RealTiff: public TiffInterface {
  public:
   RealTiff() {}
@@ -39,6 +31,9 @@ class RealTiff: public TiffInterface {
   int ReadScanline(tdata_t buf, uint32 row) { return TIFFReadScanline(tiff_, buf, row); }
   int WriteScanline(tdata_t buf, uint32 row) { return TIFFWriteScanline(tiff_, buf, row); }
 
+  int ReadEncodedStrip(uint32 strip, tdata_t buf, int size) { return (int)TIFFReadEncodedStrip(tiff_, strip, buf, size); }
+  int WriteEncodedStrip(uint32 strip, tdata_t buf, int size) { return (int)TIFFWriteEncodedStrip(tiff_, strip, buf, size); }
+
   int WriteDirectory() { return TIFFWriteDirectory(tiff_); }
 
  private:
@@ -53,6 +48,7 @@ void Frame::Init() {
   seq = 0;
   serialNumber = -1;
   timestamp_ms_ = 0;
+  compression = COMPRESS_NONE;
 
   err = Frame::OKAY;
   tiff_ = NULL;
@@ -80,37 +76,34 @@ void Frame::Init() {
 // for 8-bit numbers, these are equivalent
 //
 // MATLAB is used widely, so we conform to its specification
-void Frame::Load() {
+//
+// Rows are still padded to a whole byte, so a frame written as one strip is
+// laid out exactly as the same frame written a scanline at a time.
+int Frame::Load() {
   // Assumes InitTiff() has been called.
-  if (bits == 16) {
-    for (int j = 0; j < height; ++j) {
-      tiff_->ReadScanline((*this)[j], j);  // TODO(carsten): Check return.
-    }
-  } else {
-    int line_len = width * bits / 8;
-    if (width * bits % 8 != 0) ++line_len;
-    uint8_t* line_data = new uint8_t[line_len];  // TODO(carsten): Check return.
+  int line_len = (int)BitPack::RowBytes(width, bits);
+  int rows_per_strip = height;
+  tiff_->GetField(TIFFTAG_ROWSPERSTRIP, &rows_per_strip);
+  if (rows_per_strip <= 0 || rows_per_strip > height) rows_per_strip = height;
+
+  // 16-bit strips decode straight into the frame; libtiff maps uncompressed
+  // files, so this is a single copy out of the page cache.
+  uint8_t* buf = (uint8_t*)data;
+  if (bits != 16) {
+    strip_.resize((size_t)line_len * height);
+    buf = strip_.data();
+  }
+  for (int row = 0, strip = 0; row < height; row += rows_per_strip, ++strip) {
+    int rows = rows_per_strip < height - row ? rows_per_strip : height - row;
+    if (tiff_->ReadEncodedStrip(strip, buf + (size_t)row * line_len, rows * line_len) < 0) return -1;
+  }
 
+  if (bits != 16) {
     for (int j = 0; j < height; ++j) {
-      tiff_->ReadScanline(line_data, j);  // TODO(carsten): Check return.
-      uint8_t* line_ptr = line_data;
-      uint64_t buf = 0;
-      int i = 0;
-      int shift = 0;
-
-      while (i < width) {
-        buf = buf << 8 | *(line_ptr++);
-        shift += 8;
-        while (shift - bits >= 0 && i < width) {
-          data[i + j * width] = uint16_t(buf >> (shift - bits));
-          buf = buf & ((1 << (shift - bits)) - 1);
-          shift -= bits;
-          ++i;
-        }
-      }
+      BitPack::UnpackMsb(buf + (size_t)j * line_len, width, bits, (*this)[j]);
     }
-    delete[] line_data;
   }
+  return 0;
 }
 
 Frame::Frame(const char* fname): data(NULL), width(0), height(0) {
@@ -143,6 +136,7 @@ Frame::Frame(const Frame& fr) {
   seq = fr.seq;
   serialNumber = fr.serialNumber;
   timestamp_ms_ = fr.timestamp_ms_;
+  compression = fr.compression;
   tags_ = fr.tags_;
   err = fr.err;
   if (fr.data) {
@@ -162,6 +156,7 @@ const Frame& Frame::operator=(const Frame& fr) {
   seq = fr.seq;
   serialNumber = fr.serialNumber;
   timestamp_ms_ = fr.timestamp_ms_;
+  compression = fr.compression;
   tags_ = fr.tags_;
   err = fr.err;
   if (fr.data) {
@@ -203,7 +198,7 @@ void Frame::InitTiff() {
 
 int Frame::Read(const char* fname) {
   InitTiff();
-  if (!tiff_->Open(fname, "r")) {
+  if (!tiff_->Open(fname, "rM")) {
     return -1;
   }
 
@@ -217,11 +212,13 @@ int Frame::Read(const char* fname) {
     data_.resize(width * height);
     data = data_.data();
   } else if (w != width || h != height || b != bits) {
+    tiff_->Close();
     return -1;
   }
 
-  Load();  // TODO(carsten): Check return. (Needs a return code.)
-  return 0;
+  int ret = Load();
+  tiff_->Close();
+  return ret;
 }
 
 
@@ -241,46 +238,36 @@ int Frame::Write(const char* fname) {
   tiff_->SetField(TIFFTAG_IMAGEWIDTH, width);
   tiff_->SetField(TIFFTAG_IMAGELENGTH, height);
   tiff_->SetField(TIFFTAG_BITSPERSAMPLE, bits);
-  tiff_->SetField(TIFFTAG_COMPRESSION, COMPRESSION_NONE);
+  int codec = COMPRESSION_NONE;
+  if (compression == COMPRESS_DEFLATE) codec = COMPRESSION_ADOBE_DEFLATE;
+  if (compression == COMPRESS_LZW) codec = COMPRESSION_LZW;
+  if (!TIFFIsCODECConfigured(codec)) codec = COMPRESSION_NONE;  // not built into this libtiff
+  tiff_->SetField(TIFFTAG_COMPRESSION, codec);
+  if (codec != COMPRESSION_NONE) {
+    // libtiff only differences whole bytes/hwords, not packed 10 or 12-bit samples
+    if (bits == 8 || bits == 16) tiff_->SetField(TIFFTAG_PREDICTOR, PREDICTOR_HORIZONTAL);
+    if (codec == COMPRESSION_ADOBE_DEFLATE) tiff_->SetField(TIFFTAG_ZIPQUALITY, 1);  // favour speed
+  }
   tiff_->SetField(TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK);
   tiff_->SetField(TIFFTAG_ORIENTATION, static_cast<int>(ORIENTATION_TOPLEFT));
   tiff_->SetField(TIFFTAG_SAMPLESPERPIXEL, 1);
-  tiff_->SetField(TIFFTAG_ROWSPERSTRIP, 1);
+  tiff_->SetField(TIFFTAG_ROWSPERSTRIP, height);  // Whole frame in one strip
   tiff_->SetField(TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
   tiff_->SetField(TIFFTAG_FILLORDER, FILLORDER_MSB2LSB);
   tiff_->SetField(TIFFTAG_MINSAMPLEVALUE, 0);
   tiff_->SetField(TIFFTAG_MAXSAMPLEVALUE, (1 << bits) - 1);
 
-  if (bits == 16) {
-    for (int j = 0; j < height; ++j) {
-      if (tiff_->WriteScanline((*this)[j], j) != 1) return -1;
-    }
-  } else {
-    int line_len = width * bits / 8;
-    if (width * bits % 8 != 0) ++line_len;
-    uint8_t* line_data = new uint8_t[line_len];
+  int line_len = (int)BitPack::RowBytes(width, bits);
+  int strip_len = line_len * height;
+  uint8_t* buf = (uint8_t*)data;
+  if (bits != 16) {
+    strip_.resize(strip_len);
+    buf = strip_.data();
     for (int j = 0; j < height; ++j) {
-      uint8_t* line_ptr = line_data;
-      memset(line_data, 0, line_len);
-      int shift = 0;
-      for (int i = 0; i < width; ++i) {
-        shift += bits;
-        while (true) {
-          *line_ptr |= sh(data[i + width * j], shift - 8);
-          if (shift >= 8) {
-            ++line_ptr;
-            shift -= 8;
-            if (shift == 0) break;
-          }
-          else {
-            break;
-          }
-        }
-      }
-      if (tiff_->WriteScanline(line_data, j) != 1) return -1;
+      BitPack::PackMsb((*this)[j], width, bits, buf + (size_t)j * line_len);
     }
-    delete[] line_data;
   }
+  if (tiff_->WriteEncodedStrip(0, buf, strip_len) != strip_len) return -1;
 
   if (tiff_->WriteDirectory() != 1) return -1;
   return 0;  // stackTiff closes
@@ -1,67 +1,95 @@
-#include "system/component/inc/frame_draw.h"
-
-#include "system/component/inc/colormap.h"
-
-#ifdef _MSC_VER
-#pragma comment (lib, "sfml-graphics-s.lib")
-#pragma comment (lib, "sfml-window-s.lib")
-#pragma comment (lib, "sfml-system-s.lib")
-#pragma comment (lib, "opengl32.lib")
-#pragma comment (lib, "gdi32.lib")
-#pragma comment (lib, "winmm.lib")
-#pragma comment (lib, "freetype.lib")
-#endif
-
-FrameDraw::FrameDraw(const Frame* fr) {
-  Init(fr->width, fr->height);
-}
-
-
-FrameDraw::FrameDraw(int width, int height) {
-  Init(width, height);
-}
-
-
-FrameDraw::~FrameDraw() {
-}
-
-
-void FrameDraw::Init(const Frame* fr) {
-  Init(fr->width, fr->height);
-}
-
-
-void FrameDraw::Init(int width, int height) {
-  width_ = width;
-  height_ = height;
-
-  px_.resize(width * height, 0xFF000000);
-
-  tx_.create(width_, height_);
-  sp_.setTexture(tx_);
-
-  Zoomable::SetDrawable(width, height, std::vector<sf::Drawable*>({&sp_}));
-}
-
-
-void FrameDraw::Update(const Frame* fr) {
-  Exec((void*)fr);
-}
-
-
-void* FrameDraw::Exec(void* data) {
-  Frame* fr = (Frame*)data;
-  assert(fr->height == height_);
-  assert(fr->width == width_);
-
-  // only display frames as fast as we can update the display object
-  if (!wr_lock_.try_lock()) return data;
-  for (int i = 0; i < height_ * width_; ++i) {
-    px_[i] = COLORMAP_GREY[fr->data[i]];
-  }
-  std::lock_guard<std::mutex> rdlock(Zoomable::lock_);
-  tx_.update((uint8_t*)px_.data());
-
-  wr_lock_.unlock();
-  return data;
-}
+#include "system/component/inc/frame_draw.h"
+
+#include "system/component/inc/colormap.h"
+
+#ifdef _MSC_VER
+#pragma comment (lib, "sfml-graphics-s.lib")
+#pragma comment (lib, "sfml-window-s.lib")
+#pragma comment (lib, "sfml-system-s.lib")
+#pragma comment (lib, "opengl32.lib")
+#pragma comment (lib, "gdi32.lib")
+#pragma comment (lib, "winmm.lib")
+#pragma comment (lib, "freetype.lib")
+#endif
+
+FrameDraw::FrameDraw(const Frame* fr) {
+  Init(fr->width, fr->height);
+}
+
+
+FrameDraw::FrameDraw(int width, int height) {
+  Init(width, height);
+}
+
+
+FrameDraw::~FrameDraw() {
+}
+
+
+void FrameDraw::Init(const Frame* fr) {
+  Init(fr->width, fr->height);
+}
+
+
+void FrameDraw::Init(int width, int height) {
+  width_ = width;
+  height_ = height;
+  factor_ = 0;  // Texture is created for the first frame
+
+  Zoomable::SetDrawable(width, height, std::vector<sf::Drawable*>({&sp_}));
+}
+
+
+void FrameDraw::Update(const Frame* fr) {
+  Exec((void*)fr);
+}
+
+
+void* FrameDraw::Exec(void* data) {
+  Frame* fr = (Frame*)data;
+  assert(fr->height == height_);
+  assert(fr->width == width_);
+
+  // only display frames as fast as the screen, and we, can update
+  // The refresh interval is only claimed once the frame is sure to be drawn
+  if (!wr_lock_.try_lock()) return data;
+  if (!limit_.Take()) {
+    wr_lock_.unlock();
+    return data;
+  }
+
+  int factor = Zoomable::PixelsPerScreenPixel();
+  int w = Preview::Downsized(width_, factor);
+  int h = Preview::Downsized(height_, factor);
+  const uint16_t* pixels = fr->data;
+  if (factor > 1) {
+    small_.resize(w * h);
+    Preview::Downsample(fr->data, width_, height_, factor, small_.data());
+    pixels = small_.data();
+  }
+  Image& image = image_.Write();
+  image.px.resize(w * h);
+  image.width = w;
+  image.height = h;
+  image.factor = factor;
+  Preview::Colormap(pixels, w * h, COLORMAP_GREY, Preview::ColormapShift(fr->bits), image.px.data());
+  image_.Publish();
+
+  wr_lock_.unlock();
+  return data;
+}
+
+
+void FrameDraw::draw(sf::RenderTarget& target, sf::RenderStates states) const {
+  if (image_.Fresh()) {
+    const Image& image = image_.Read();
+    if (image.factor != factor_) {
+      factor_ = image.factor;
+      tx_.create(image.width, image.height);
+      sp_.setTexture(tx_, true);
+      sp_.setScale(float(factor_), float(factor_));
+    }
+    tx_.update((const uint8_t*)image.px.data());
+  }
+  Zoomable::draw(target, states);
+}
@@ -0,0 +1,326 @@
+#include "system/component/inc/framefile.h"
+
+#include <cstring>
+
+#include "system/component/inc/bitpack.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(FrameFile::Header) <= FrameFile::kPageBytes, "FrameFile header must fit in one page");
+static_assert(sizeof(FrameFile::Record) == 104, "FrameFile record layout changed");
+static_assert(sizeof(FrameFile::Trailer) == 24, "FrameFile trailer layout changed");
+
+static const char kFileMagic[8] = { 'O', 'W', 'F', 'R', 'A', 'M', 'E', '1' };
+static const char kIndexMagic[8] = { 'O', 'W', 'F', 'I', 'N', 'D', 'E', 'X' };
+static const uint32_t kVersion = 2;  // 2: packed payloads are MSB-first TIFF rows
+
+static uint64_t AlignUp(uint64_t n, uint64_t align) {
+  return (n + align - 1) / align * align;
+}
+
+// FNV-1a
+static uint32_t Checksum(const void* data, size_t len) {
+  const uint8_t* p = (const uint8_t*)data;
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < len; ++i) {
+    h = (h ^ p[i]) * 16777619u;
+  }
+  return h;
+}
+
+namespace FrameFile {
+
+Record MakeRecord(const Frame& fr) {
+  Record r;
+  memset(&r, 0, sizeof(r));
+  r.seq = fr.seq;
+  r.camera = fr.serialNumber;
+  r.timestamp_ms = fr.timestamp_ms_;
+  r.temperature = fr.temperature;
+  r.voxel[0] = r.voxel[1] = r.voxel[2] = -1;
+  r.err = fr.err;
+  return r;
+}
+
+
+size_t PackedBytes(int width, int height, int bits) {
+  return (size_t)height * BitPack::RowBytes(width, bits);
+}
+
+}  // namespace FrameFile
+
+using namespace FrameFile;
+
+
+FrameFileWriter::~FrameFileWriter() {
+  Close();
+}
+
+
+int FrameFileWriter::Open(const char* fname, int width, int height, int bits, bool packed,
+                          int chunk_frames, const std::vector<std::string>& value_names) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (fp_) return -1;
+  if (width <= 0 || height <= 0 || bits <= 0 || bits > 16 || chunk_frames <= 0) return -1;
+  if (value_names.size() > kMaxValues) return -1;
+
+  memset(&header_, 0, sizeof(header_));
+  memcpy(header_.magic, kFileMagic, sizeof(kFileMagic));
+  header_.version = kVersion;
+  header_.header_bytes = kPageBytes;
+  header_.width = width;
+  header_.height = height;
+  header_.bits = bits;
+  header_.packed = packed && bits < 16;
+  size_t pixels = (size_t)width * height;
+  header_.frame_bytes = header_.packed ? PackedBytes(width, height, bits) : pixels * sizeof(uint16_t);
+  header_.frame_stride = AlignUp(header_.frame_bytes, kFrameAlign);
+  header_.chunk_frames = chunk_frames;
+  header_.n_values = (uint32_t)value_names.size();
+  for (size_t i = 0; i < value_names.size(); ++i) {
+    strncpy(header_.value_names[i], value_names[i].c_str(), kValueNameLen - 1);
+  }
+
+  fp_ = fopen(fname, "wb");
+  if (!fp_) {
+    printf("ERROR: FrameFileWriter unable to create %s\n", fname);
+    return -1;
+  }
+  std::vector<uint8_t> page(kPageBytes, 0);
+  memcpy(page.data(), &header_, sizeof(header_));
+  if (fwrite(page.data(), 1, page.size(), fp_) != page.size()) {
+    fclose(fp_);
+    fp_ = NULL;
+    return -1;
+  }
+  fflush(fp_);
+
+  records_.clear();
+  records_.reserve(chunk_frames);
+  scratch_.assign(header_.frame_stride, 0);
+  chunk_offset_ = kPageBytes;
+  count_ = 0;
+  return 0;
+}
+
+
+int FrameFileWriter::Append(const Frame& fr) {
+  return Append(fr, MakeRecord(fr));
+}
+
+
+int FrameFileWriter::Append(const Frame& fr, const Record& record) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!fp_ || !fr.data) return -1;
+  if (fr.width != header_.width || fr.height != header_.height || fr.bits != header_.bits) return -1;
+
+  // Payload, padded out to the frame stride
+  if (header_.packed) {
+    size_t row_bytes = BitPack::RowBytes(fr.width, fr.bits);
+    for (int j = 0; j < fr.height; ++j) {
+      BitPack::PackMsb(fr.data + (size_t)j * fr.width, fr.width, fr.bits, scratch_.data() + j * row_bytes);
+    }
+  } else {
+    memcpy(scratch_.data(), fr.data, header_.frame_bytes);
+  }
+  if (fwrite(scratch_.data(), 1, header_.frame_stride, fp_) != header_.frame_stride) return -1;
+
+  records_.push_back(record);
+  ++count_;
+  if (records_.size() == header_.chunk_frames) {
+    return WriteIndex(true);
+  }
+  return 0;
+}
+
+
+int FrameFileWriter::WriteIndex(bool pad) {
+  Trailer trailer;
+  memcpy(trailer.magic, kIndexMagic, sizeof(kIndexMagic));
+  trailer.chunk_offset = chunk_offset_;
+  trailer.n_frames = (uint32_t)records_.size();
+  trailer.checksum = Checksum(records_.data(), records_.size() * sizeof(Record));
+
+  if (fwrite(records_.data(), sizeof(Record), records_.size(), fp_) != records_.size()) return -1;
+  if (fwrite(&trailer, sizeof(trailer), 1, fp_) != 1) return -1;
+
+  uint64_t end = chunk_offset_ + records_.size() * (header_.frame_stride + sizeof(Record)) + sizeof(Trailer);
+  if (pad) {
+    uint64_t next = AlignUp(end, kPageBytes);
+    std::vector<uint8_t> zeros(next - end, 0);
+    if (fwrite(zeros.data(), 1, zeros.size(), fp_) != zeros.size()) return -1;
+    end = next;
+  }
+  fflush(fp_);
+
+  records_.clear();
+  chunk_offset_ = end;
+  return 0;
+}
+
+
+int FrameFileWriter::Close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!fp_) return 0;
+  int ret = 0;
+  if (!records_.empty()) ret = WriteIndex(false);
+  if (fclose(fp_) != 0) ret = -1;
+  fp_ = NULL;
+  return ret;
+}
+
+
+int FrameFileWriter::Count() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return count_;
+}
+
+
+FrameFileReader::~FrameFileReader() {
+  Close();
+}
+
+
+int FrameFileReader::Open(const char* fname) {
+  Close();
+#ifdef _WIN32
+  HANDLE file = CreateFileA(fname, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) return -1;
+  LARGE_INTEGER size;
+  GetFileSizeEx(file, &size);
+  size_ = size.QuadPart;
+  HANDLE mapping = size_ ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+  if (!mapping) {
+    CloseHandle(file);
+    return -1;
+  }
+  map_ = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  file_handle_ = file;
+  map_handle_ = mapping;
+  if (!map_) {
+    Close();
+    return -1;
+  }
+#else
+  int fd = open(fname, O_RDONLY);
+  if (fd < 0) return -1;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return -1;
+  }
+  size_ = st.st_size;
+  void* map = mmap(NULL, size_, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) return -1;
+  map_ = (const uint8_t*)map;
+#endif
+
+  if (size_ < sizeof(Header)) {
+    Close();
+    return -1;
+  }
+  memcpy(&header_, map_, sizeof(header_));
+  if (memcmp(header_.magic, kFileMagic, sizeof(kFileMagic)) != 0 || header_.version != kVersion ||
+      header_.chunk_frames == 0 || header_.frame_stride < header_.frame_bytes) {
+    printf("ERROR: %s is not a frame file\n", fname);
+    Close();
+    return -1;
+  }
+
+  // Walk the chunks.  Full chunks have a known size; the last chunk may be
+  // partial, in which case its trailer is at the very end of the file.
+  uint64_t full_index = header_.chunk_frames * header_.frame_stride;
+  uint64_t full_trailer = full_index + header_.chunk_frames * sizeof(Record);
+  uint64_t full_chunk = AlignUp(full_trailer + sizeof(Trailer), kPageBytes);
+  uint64_t offset = header_.header_bytes;
+  while (offset < size_) {
+    const Trailer* trailer = NULL;
+    uint64_t n = 0;
+    if (offset + full_trailer + sizeof(Trailer) <= size_) {
+      trailer = (const Trailer*)(map_ + offset + full_trailer);
+      n = header_.chunk_frames;
+    }
+    if (!trailer || memcmp(trailer->magic, kIndexMagic, sizeof(kIndexMagic)) != 0 ||
+        trailer->chunk_offset != offset || trailer->n_frames != n) {
+      trailer = (const Trailer*)(map_ + size_ - sizeof(Trailer));
+      n = trailer->n_frames;
+      if (memcmp(trailer->magic, kIndexMagic, sizeof(kIndexMagic)) != 0 || trailer->chunk_offset != offset ||
+          n > header_.chunk_frames ||
+          offset + n * (header_.frame_stride + sizeof(Record)) + sizeof(Trailer) != size_) {
+        break;  // Incomplete chunk, the writer did not finish it
+      }
+    }
+
+    const Record* records = (const Record*)(map_ + offset + n * header_.frame_stride);
+    if (trailer->checksum != Checksum(records, n * sizeof(Record))) break;
+    for (uint64_t i = 0; i < n; ++i) {
+      Record r;
+      memcpy(&r, records + i, sizeof(r));
+      records_.push_back(r);
+      offsets_.push_back(offset + i * header_.frame_stride);
+    }
+    offset += full_chunk;
+  }
+  return 0;
+}
+
+
+void FrameFileReader::Close() {
+#ifdef _WIN32
+  if (map_) UnmapViewOfFile(map_);
+  if (map_handle_) CloseHandle((HANDLE)map_handle_);
+  if (file_handle_) CloseHandle((HANDLE)file_handle_);
+#else
+  if (map_) munmap((void*)map_, size_);
+#endif
+  map_ = NULL;
+  map_handle_ = NULL;
+  file_handle_ = NULL;
+  size_ = 0;
+  records_.clear();
+  offsets_.clear();
+}
+
+
+const uint16_t* FrameFileReader::Raw(int i) {
+  if (header_.packed || i < 0 || i >= Count()) return NULL;
+  return (const uint16_t*)(map_ + offsets_[i]);
+}
+
+
+int FrameFileReader::Read(int i, Frame* fr) {
+  if (i < 0 || i >= Count()) return -1;
+  if (!fr->data) {
+    *fr = Frame(header_.width, header_.height);
+  } else if (fr->width != header_.width || fr->height != header_.height) {
+    return -1;
+  }
+  fr->bits = header_.bits;
+
+  if (header_.packed) {
+    size_t row_bytes = BitPack::RowBytes(header_.width, header_.bits);
+    for (int j = 0; j < header_.height; ++j) {
+      BitPack::UnpackMsb(map_ + offsets_[i] + j * row_bytes, header_.width, header_.bits,
+                         fr->data + (size_t)j * header_.width);
+    }
+  } else {
+    memcpy(fr->data, map_ + offsets_[i], header_.frame_bytes);
+  }
+
+  const Record& r = records_[i];
+  fr->seq = r.seq;
+  fr->serialNumber = r.camera;
+  fr->timestamp_ms_ = r.timestamp_ms;
+  fr->temperature = r.temperature;
+  fr->err = r.err;
+  return 0;
+}
@@ -0,0 +1,124 @@
+#include "system/component/inc/framehist.h"
+
+#include <cmath>
+#include <cstring>
+
+static const int kSubHists = 4;
+
+// Count pixels into interleaved sub-histograms
+// @param exact also count saturated and zero pixels, for when bins are wider
+//   than one value and the end bins cannot tell
+template <bool exact>
+static void Count(const uint16_t* px, size_t n, int shift, int max_value, uint32_t (*sub)[FrameHist::kBins],
+                  uint64_t* saturated, uint64_t* zero) {
+  const uint32_t top = FrameHist::kBins - 1;
+  auto bin = [shift, top](uint16_t v) {
+    uint32_t b = (uint32_t)v >> shift;
+    return b < top ? b : top;  // Clamp stray high bits rather than write past the end
+  };
+  uint64_t sat = 0;
+  uint64_t zer = 0;
+  size_t i = 0;
+  for (; i + kSubHists <= n; i += kSubHists) {
+    for (int k = 0; k < kSubHists; ++k) {
+      ++sub[k][bin(px[i + k])];
+      if (exact) {
+        sat += px[i + k] >= max_value;
+        zer += px[i + k] == 0;
+      }
+    }
+  }
+  for (; i < n; ++i) {
+    ++sub[0][bin(px[i])];
+    if (exact) {
+      sat += px[i] >= max_value;
+      zer += px[i] == 0;
+    }
+  }
+  *saturated = sat;
+  *zero = zer;
+}
+
+
+void FrameHist::Compute(const Frame* fr, Tag* tag) {
+  int shift = 0;
+  while ((1 << (fr->bits - shift)) > kBins) ++shift;
+  tag->shift = shift;
+  tag->max_value = (1 << fr->bits) - 1;
+  tag->n = (uint64_t)fr->width * fr->height;
+
+  uint32_t sub[kSubHists][kBins];
+  memset(sub, 0, sizeof(sub));
+  if (shift == 0) {
+    Count<false>(fr->data, tag->n, 0, tag->max_value, sub, &tag->saturated, &tag->zero);
+  } else {
+    Count<true>(fr->data, tag->n, shift, tag->max_value, sub, &tag->saturated, &tag->zero);
+  }
+  for (int b = 0; b < kBins; ++b) {
+    uint32_t c = 0;
+    for (int k = 0; k < kSubHists; ++k) c += sub[k][b];
+    tag->count[b] = c;
+  }
+  if (shift == 0) {
+    tag->zero = tag->count[0];
+    tag->saturated = 0;
+    for (int b = tag->max_value; b < kBins; ++b) tag->saturated += tag->count[b];
+  }
+}
+
+
+double FrameHist::Tag::Value(int bin) const {
+  return shift ? (bin << shift) + ((1 << shift) - 1) / 2.0 : bin;
+}
+
+
+int FrameHist::Tag::Percentile(double p) const {
+  uint64_t target = (uint64_t)ceil(p * n);
+  if (target == 0) target = 1;
+  uint64_t sum = 0;
+  for (int b = 0; b < kBins; ++b) {
+    sum += count[b];
+    if (sum >= target) return ((b + 1) << shift) - 1;
+  }
+  return max_value;
+}
+
+
+double FrameHist::Tag::Mean() const {
+  if (n == 0) return 0.0;
+  double sum = 0;
+  for (int b = 0; b < kBins; ++b) sum += count[b] * Value(b);
+  return sum / n;
+}
+
+
+double FrameHist::Tag::StdDev() const {
+  if (n == 0) return 0.0;
+  double mean = Mean();
+  double sum = 0;
+  for (int b = 0; b < kBins; ++b) {
+    double d = Value(b) - mean;
+    sum += count[b] * d * d;
+  }
+  return sqrt(sum / n);
+}
+
+
+void* FrameHist::Exec(void* data) {
+  Frame* fr = (Frame*)data;
+  Tag* tag = &pool_.Alloc();
+  Compute(fr, tag);
+  fr->AddTag(tag);
+  return data;
+}
+
+
+void FrameHist::AtExit(void* data) {
+  pool_.Free(((Frame*)data)->GetTag<Tag>());
+}
+
+
+void FrameHist::resize(size_t size) {
+  pool_.resize(size);
+  ExecNode::resize(size);
+}
@@ -0,0 +1,248 @@
+#include "system/component/inc/framestore.h"
+
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "system/component/inc/time.h"
+
+// Maximum number of frames an I/O thread takes off the queue at once
+static const size_t kMaxBatch = 8;
+
+// Copy pixel data and header fields, reusing dst's buffer when it is big enough
+static void CopyFrame(const Frame& src, Frame* dst) {
+  if (!dst->data || dst->width != src.width || dst->height != src.height) {
+    *dst = Frame(src.width, src.height);
+  }
+  memcpy(dst->data, src.data, sizeof(uint16_t) * src.width * src.height);
+  dst->bits = src.bits;
+  dst->seq = src.seq;
+  dst->serialNumber = src.serialNumber;
+  dst->temperature = src.temperature;
+  dst->timestamp_ms_ = src.timestamp_ms_;
+  dst->err = src.err;
+}
+
+
+// Size of a file on disk, or 0 if it cannot be found
+static uint64_t FileBytes(const std::string& fname) {
+  struct stat st;
+  if (stat(fname.c_str(), &st) != 0) return 0;
+  return (uint64_t)st.st_size;
+}
+
+
+FrameStore::FrameStore(int n_threads, int depth, Writer writer) : writer_(writer) {
+  if (!writer_) {
+    writer_ = [](Frame& fr, const std::string& fname) { return fr.Write(fname.c_str()); };
+  }
+  if (depth < 1) depth = 1;
+  if (n_threads < 1) n_threads = 1;
+  jobs_.resize(depth);
+  free_ = depth;
+  for (int i = 0; i < n_threads; ++i) {
+    threads_.push_back(std::thread(&FrameStore::Run, this));
+  }
+}
+
+
+FrameStore::~FrameStore() {
+  Flush(false);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_.notify_all();
+  space_.notify_all();
+  for (std::thread& t : threads_) t.join();
+}
+
+
+int FrameStore::Save(const Frame& fr, const std::string& fname, Writer writer) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (stop_) return -1;
+
+  // Coalesce with a write to the same file that has not started yet
+  for (Job* queued : queue_) {
+    if (queued->fname == fname) {
+      CopyFrame(fr, &queued->frame);
+      queued->writer = writer;
+      ++stats_.frames_coalesced;
+      return 0;
+    }
+  }
+
+  space_.wait(lock, [this] { return free_ > 0 || stop_; });
+  if (stop_) return -1;
+  Job* job = jobs_.TryAlloc();
+  --free_;
+  job->id = next_id_++;
+  outstanding_.insert(job->id);
+  size_t depth = jobs_.size() - free_;
+  if (depth > stats_.max_queue_depth) stats_.max_queue_depth = depth;
+  // Hysteresis, so a queue sitting at the threshold does not flip every frame
+  if (depth * 4 > jobs_.size() * 3) backed_up_ = true;
+  if (depth * 4 < jobs_.size()) backed_up_ = false;
+  int compression = compression_;
+  if (fallback_ && backed_up_ && compression != Frame::COMPRESS_NONE) {
+    compression = Frame::COMPRESS_NONE;
+    ++stats_.frames_fallback;
+  }
+  lock.unlock();
+
+  // Nobody else can see this job until it is queued, so copy without the lock
+  job->fname = fname;
+  job->writer = writer;
+  CopyFrame(fr, &job->frame);
+  job->frame.compression = compression;
+
+  lock.lock();
+  queue_.push_back(job);
+  lock.unlock();
+  work_.notify_one();
+  return 0;
+}
+
+
+void FrameStore::SetCompression(int compression, bool fallback) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  compression_ = compression;
+  fallback_ = fallback;
+}
+
+
+int FrameStore::Flush(bool sync) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  uint64_t barrier = next_id_;
+  done_.wait(lock, [this, barrier] {
+    return outstanding_.empty() || *outstanding_.begin() >= barrier;
+  });
+  std::vector<std::string> fnames;
+  fnames.swap(written_);
+  int errors = flush_errors_;
+  flush_errors_ = 0;
+  lock.unlock();
+
+  if (sync) SyncFiles(fnames);
+  return errors;
+}
+
+
+FrameStore::Stats FrameStore::GetStats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats stats = stats_;
+  stats.queue_depth = jobs_.size() - free_;
+  time_t elapsed_ms = last_write_ms_ - first_write_ms_;
+  if (elapsed_ms > 0) {
+    stats.mb_per_s = stats.bytes_written / 1.0e6 / (elapsed_ms / 1000.0);
+  }
+  for (int i = 0; i < Frame::N_COMPRESS; ++i) {
+    CodecStats& c = stats.codec[i];
+    if (c.file_bytes > 0) c.ratio = (double)c.raw_bytes / c.file_bytes;
+    if (codec_ms_[i] > 0) c.mb_per_s = c.raw_bytes / 1.0e6 / (codec_ms_[i] / 1000.0);
+  }
+  return stats;
+}
+
+
+bool FrameStore::PopBatch(std::vector<Job*>* batch, size_t max) {
+  batch->clear();
+  std::unique_lock<std::mutex> lock(mutex_);
+  work_.wait(lock, [this] { return !queue_.empty() || stop_; });
+  while (!queue_.empty() && batch->size() < max) {
+    batch->push_back(queue_.front());
+    queue_.pop_front();
+  }
+  return !batch->empty();
+}
+
+
+void FrameStore::Run() {
+  std::vector<Job*> batch;
+  std::vector<std::string> written;
+  while (PopBatch(&batch, kMaxBatch)) {
+    time_t start_ms = Component::SteadyClockTimeMs();
+    uint64_t bytes = 0;
+    int errors = 0;
+    int frames = 0;
+    CodecStats codec[Frame::N_COMPRESS];
+    time_t codec_ms[Frame::N_COMPRESS] = {};
+    written.clear();
+    for (Job* job : batch) {
+      Writer& writer = job->writer ? job->writer : writer_;
+      time_t job_start_ms = Component::SteadyClockTimeMs();
+      if (writer(job->frame, job->fname) == 0) {
+        uint64_t raw = (uint64_t)job->frame.width * job->frame.height * job->frame.bits / 8;
+        bytes += raw;
+        ++frames;
+        if (!job->writer) {  // Only Frame::Write leaves one file per frame to measure and sync
+          written.push_back(job->fname);
+          int c = job->frame.compression;
+          ++codec[c].frames;
+          codec[c].raw_bytes += raw;
+          codec[c].file_bytes += FileBytes(job->fname);
+          codec_ms[c] += Component::SteadyClockTimeMs() - job_start_ms;
+          if (on_written_) on_written_(job->fname);
+        }
+      } else {
+        printf("ERROR: FrameStore unable to write %s\n", job->fname.c_str());
+        ++errors;
+      }
+    }
+    time_t end_ms = Component::SteadyClockTimeMs();
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (stats_.frames_written == 0 && stats_.errors == 0) first_write_ms_ = start_ms;
+      last_write_ms_ = end_ms;
+      stats_.frames_written += frames;
+      stats_.bytes_written += bytes;
+      stats_.errors += errors;
+      flush_errors_ += errors;
+      for (int i = 0; i < Frame::N_COMPRESS; ++i) {
+        stats_.codec[i].frames += codec[i].frames;
+        stats_.codec[i].raw_bytes += codec[i].raw_bytes;
+        stats_.codec[i].file_bytes += codec[i].file_bytes;
+        codec_ms_[i] += codec_ms[i];
+      }
+      written_.insert(written_.end(), written.begin(), written.end());
+      for (Job* job : batch) {
+        outstanding_.erase(job->id);
+        job->writer = Writer();
+        jobs_.Free(job);
+        ++free_;
+      }
+    }
+    space_.notify_all();
+    done_.notify_all();
+  }
+}
+
+
+void FrameStore::SyncFiles(const std::vector<std::string>& fnames) {
+  for (const std::string& fname : fnames) {
+#ifdef _WIN32
+    int fd = _open(fname.c_str(), _O_RDWR | _O_BINARY);
+    if (fd < 0) continue;
+    _commit(fd);
+    _close(fd);
+#else
+    int fd = open(fname.c_str(), O_RDONLY);
+    if (fd < 0) continue;
+    fsync(fd);
+#ifdef __linux__
+    // Raw frames are write-once; keep them from crowding the page cache
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+    close(fd);
+#endif
+  }
+}
@@ -37,15 +37,14 @@ void FX3::Init() {
 
 int FX3::DeviceNumber(int address) {
   CCyUSBDevice usb(NULL);
-  int n = 0;
-  while (true) {
+  int count = usb.DeviceCount();
+  for (int n = 0; n < count; ++n) {
     if (!usb.Open(n)) continue;
-    if (usb.USBAddress == address) break;
-    ++n;
-    if (n >= addresses_.size()) n = 0;
+    bool found = usb.USBAddress == address;
+    usb.Close();
+    if (found) return n;
   }
-  usb.Close();
-  return n;
+  return -1;
 }
 
 int FX3::NumDevices(uint16_t pid) {
@@ -98,7 +97,13 @@ int FX3::Reset() {
 
   // make sure the bootlaoder is running after reset
   CCyFX3Device bootloader;
-  while (!bootloader.Open(DeviceNumber(address_))) {
+  int64_t t0 = GetTickCount64();
+  int n;
+  while ((n = DeviceNumber(address_)) < 0 || !bootloader.Open(n)) {
+    if (GetTickCount64() - t0 > REATTACH_TIMEOUT * 1000) {
+      printf("Bootloader did not come up after reset\n");
+      return -1;
+    }
     Sleep(100);
   };
   bool boot = bootloader.IsBootLoaderRunning();
@@ -147,7 +152,8 @@ int FX3::Flash(int len, uint8_t* data) {
   // bulk_in_ is a quick check
   if (bulk_in_) return 0;
   CCyFX3Device boot;
-  if (!boot.Open(DeviceNumber(address_))) return -1;
+  int n = DeviceNumber(address_);
+  if (n < 0 || !boot.Open(n)) return -1;
   if (!boot.IsBootLoaderRunning()) {
     boot.Close();
     return 0;
@@ -312,15 +318,21 @@ void FX3::Reattach() {
       printf("Fatal USB Disconnect timeout\n");
       assert(0);
     }
+    Sleep(10);
   }
 
-   do {
-      usb_device_.Open(DeviceNumber(address_));
-
-      ctrl_ = usb_device_.ControlEndPt;
-      bulk_in_ = usb_device_.BulkInEndPt;
-      bulk_out_ = usb_device_.BulkOutEndPt;
-    } while (usb_device_.USBAddress != address_);
+  // The device may not be listed again yet
+  int n;
+  while ((n = DeviceNumber(address_)) < 0 || !usb_device_.Open(n) || usb_device_.USBAddress != address_) {
+    if (GetTickCount64() - t0 > REATTACH_TIMEOUT * 1000) {
+      printf("Fatal USB Disconnect timeout\n");
+      assert(0);
+    }
+    Sleep(10);
+  }
+  ctrl_ = usb_device_.ControlEndPt;
+  bulk_in_ = usb_device_.BulkInEndPt;
+  bulk_out_ = usb_device_.BulkOutEndPt;
 
   assert(ctrl_);
 
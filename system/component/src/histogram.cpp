@@ -28,6 +28,7 @@ void Histogram::Clear() {
 }
 
 void Histogram::Add(int p) {
+  if (p < min_ || p > max_) return;
   ++data_[(p - min_) / bucket_size_];
 }
 
@@ -23,6 +23,14 @@ int IntelHex::Open(const char* fname) {
   return 0;
 }
 
+int IntelHex::Open() {
+  fptr_ = NULL;
+  text_.clear();
+  address_ = 0;
+  partial_len_ = 0;
+  return 0;
+}
+
 
 int IntelHex::SetAddress(uint32_t addr) {
   // write any remaining bytes buffered but not written to file
@@ -86,32 +94,37 @@ int IntelHex::Close() {
 
   CHECK(WriteRecord(0, 0, IH_EOF, NULL));
 
-  CHECK(fclose(fptr_));
-  fptr_ = NULL;
+  if (fptr_) {
+    CHECK(fclose(fptr_));
+    fptr_ = NULL;
+  }
   return 0;
 }
 
 
 int IntelHex::WriteRecord(uint8_t len, uint16_t addr, uint8_t op,
                           const uint8_t* data) {
+  static const char HEX[] = "0123456789ABCDEF";
   char linebuf[80];
-  char bytebuf[4];
-  sprintf(linebuf, ":%02X%04X%02X", len, addr, op);
-
+  char* p = linebuf;
   uint8_t checksum = 0;
-  checksum -= len;
-  checksum -= addr >> 8;
-  checksum -= addr & 0xFF;
-  checksum -= op;
-
-  for (int i = 0; i < len; ++i) {
-    sprintf(bytebuf, "%02X", data[i]);
-    strcat(linebuf, bytebuf);
-    checksum -= data[i];
-  }
-
-  sprintf(bytebuf, "%02X\n", checksum);
-  strcat(linebuf, bytebuf);
-
-  return fprintf(fptr_, "%s", linebuf);
+  auto put = [&](uint8_t b) {
+    *p++ = HEX[b >> 4];
+    *p++ = HEX[b & 0xF];
+    checksum -= b;
+  };
+
+  *p++ = ':';
+  put(len);
+  put(addr >> 8);
+  put(addr & 0xFF);
+  put(op);
+  for (int i = 0; i < len; ++i) put(data[i]);
+  put(checksum);
+  *p++ = '\n';
+
+  int n = (int)(p - linebuf);
+  if (fptr_) return (int)fwrite(linebuf, 1, n, fptr_) == n ? n : -1;
+  text_.append(linebuf, n);
+  return n;
 }
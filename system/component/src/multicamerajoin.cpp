@@ -0,0 +1,131 @@
+#include "system/component/inc/multicamerajoin.h"
+
+#include <cstdlib>
+
+
+MultiCameraJoin::MultiCameraJoin(const std::vector<int>& cameras, int timeout_ms)
+    : cameras_(cameras), timeout_ms_(timeout_ms) {
+  SetSync(false);  // Frames from each producer are different frames
+  resize(10);
+}
+
+
+void MultiCameraJoin::SetTimeWindow(int window_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  window_ms_ = window_ms;
+}
+
+
+MultiCameraJoin::Stats MultiCameraJoin::GetStats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+
+void MultiCameraJoin::resize(size_t size) {
+  pool_.resize(size);
+  ExecNode::resize(size);
+}
+
+
+MultiCameraJoin::Group* MultiCameraJoin::Find(const Frame* fr, int camera) {
+  for (Group& group : groups_) {
+    if (group.bundle || group.frames[camera]) continue;
+    if (window_ms_ < 0 ? group.seq == fr->seq : std::abs(fr->timestamp_ms_ - group.timestamp_ms) <= window_ms_) {
+      return &group;
+    }
+  }
+  return NULL;
+}
+
+
+void MultiCameraJoin::Close(Group* group) {
+  // The earliest frame received is retired first, so it carries the bundle:
+  //   the others are not released until it is
+  for (Frame* fr : group->frames) {
+    if (fr && (!group->carrier || ReceivedBefore(fr, group->carrier))) group->carrier = fr;
+  }
+  Bundle* bundle = &pool_.Alloc();
+  bundle->seq = group->seq;
+  bundle->frames = group->frames;
+  bundle->missing = (int)(group->frames.size() - group->present);
+  group->bundle = bundle;
+  if (bundle->missing) {
+    ++stats_.partial;
+  } else {
+    ++stats_.complete;
+  }
+  closed_.notify_all();
+}
+
+
+bool MultiCameraJoin::Superseded(const Group& group) const {
+  for (size_t i = 0; i < cameras_.size(); ++i) {
+    if (!group.frames[i] && !group.later[i]) return false;
+  }
+  return true;
+}
+
+
+void* MultiCameraJoin::Exec(void* data) {
+  Frame* fr = (Frame*)data;
+  int camera = -1;
+  for (size_t i = 0; i < cameras_.size(); ++i) {
+    if (cameras_[i] == fr->serialNumber) camera = (int)i;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (camera < 0) {
+    ++stats_.unknown;
+    return NULL;
+  }
+
+  Group* group = Find(fr, camera);
+  if (!group) {
+    groups_.emplace_back();
+    group = &groups_.back();
+    group->seq = fr->seq;
+    group->timestamp_ms = fr->timestamp_ms_;
+    group->deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms_);
+    group->frames.assign(cameras_.size(), NULL);
+    group->later.assign(cameras_.size(), false);
+  }
+  group->frames[camera] = fr;
+  ++group->present;
+  ++group->waiting;
+
+  // A frame dropped by one camera must not hold up the others' later groups
+  //   until the timeout: ExecNode retires frames in the order they arrived.
+  //   Only frames sent since a group opened count, as sequence numbers may be
+  //   set back between slices.
+  for (Group& other : groups_) {
+    if (&other == group || other.bundle || other.frames[camera]) continue;
+    if (window_ms_ < 0 ? fr->seq > other.seq : fr->timestamp_ms_ > other.timestamp_ms + window_ms_) {
+      other.later[camera] = true;
+      if (Superseded(other)) Close(&other);
+    }
+  }
+
+  // Every frame waits, as any of them may turn out to be the carrier
+  if (group->present == cameras_.size()) {
+    Close(group);
+  } else if (!closed_.wait_until(lock, group->deadline, [group] { return group->bundle != NULL; })) {
+    Close(group);
+  }
+
+  void* rv = group->carrier == fr ? group->bundle : NULL;
+  if (--group->waiting == 0) {
+    for (auto it = groups_.begin(); it != groups_.end(); ++it) {
+      if (&*it == group) {
+        groups_.erase(it);
+        break;
+      }
+    }
+  }
+  return rv;
+}
+
+
+void MultiCameraJoin::AtExit(void* data) {
+  pool_.Free((Bundle*)data);
+}
@@ -1,5 +1,6 @@
 #include "system/component/inc/octopus.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 
@@ -33,6 +34,7 @@ static const int CH_MAP[5] = {-1, 2, 3, 0, 1};
   }
 
 int Octopus::Open(int n) {
+  InvalidateShadow();
   CHECK_RET(fx3_->Open(PID, n));
 
   CHECK_RET(fx3_->Flash(__octo_fw_len, __octo_fw));
@@ -44,15 +46,62 @@ int Octopus::Open(int n) {
 
 int Octopus::SerialNumber() { return fx3_->SerialNumber(); }
 
-void Octopus::Close() { fx3_->Close(); }
+void Octopus::Close() {
+  Flush();
+  InvalidateShadow();
+  fx3_->Close();
+}
+
+void Octopus::BeginBatch() { ++batch_depth_; }
+
+void Octopus::EndBatch() {
+  assert(batch_depth_ > 0);
+  if (--batch_depth_ == 0) Flush();
+}
+
+void Octopus::SetMaxBatch(int writes) { max_batch_ = std::max(1, writes); }
+
+void Octopus::InvalidateShadow() { shadow_.clear(); }
+
+bool Octopus::Uncached(uint8_t device, uint8_t reg) {
+  // DDS read back data, and the DDS transaction strobe
+  return device == DDS_ADDR && (reg == 3 || reg == 4 || reg == 7);
+}
+
+bool Octopus::AlwaysWrite(uint8_t device, uint8_t reg) {
+  // Timer enables restart their timers
+  return Uncached(device, reg) || (device == TIMER_CONTROL && reg == 0);
+}
+
+void Octopus::Flush() {
+  size_t max_len = 4 * max_batch_;
+  for (size_t sent = 0; sent < queue_.size(); ) {
+    int len = (int)std::min(max_len, queue_.size() - sent);
+    int xfer = fx3_->DataOut(len, queue_.data() + sent);
+    assert(xfer == len);
+    ++stats_.transfers;
+    sent += len;
+  }
+  queue_.clear();
+}
 
 void Octopus::WriteReg(uint8_t device, uint8_t reg, uint16_t data) {
+  if (!Uncached(device, reg)) {
+    auto known = shadow_.find(device << 8 | reg);
+    if (known != shadow_.end() && known->second == data && !AlwaysWrite(device, reg)) {
+      ++stats_.skipped;
+      return;
+    }
+    shadow_[device << 8 | reg] = data;
+  }
+
   uint8_t bytes[4];
   bytes[0] = reg;
   bytes[1] = device | 0x80;
   memcpy(bytes + 2, &data, 2);
-  int xfer = fx3_->DataOut(4, bytes);
-  assert(xfer == 4);
+  queue_.insert(queue_.end(), bytes, bytes + 4);
+  ++stats_.writes;
+  if (batch_depth_ == 0) Flush();
 
 #ifdef __PRETTYPRINT
   prettyPrintOctopusReg(NULL, bytes[0] | (bytes[1] << 8), data);
@@ -60,18 +109,33 @@ void Octopus::WriteReg(uint8_t device, uint8_t reg, uint16_t data) {
 }
 
 uint16_t Octopus::ReadReg(uint8_t device, uint8_t reg) {
+  Flush();  // Reads see every write before them
   uint16_t ret;
   ret = device << 8 | reg;
   int xfer = fx3_->DataOut(2, (uint8_t*)&ret);
   assert(xfer == 2);
   xfer = fx3_->DataIn(2, (uint8_t*)&ret);
   assert(xfer == 2);
+  stats_.transfers += 2;
+  ++stats_.reads;
+  if (!Uncached(device, reg)) shadow_[device << 8 | reg] = ret;
   return ret;
 }
 
+uint16_t Octopus::ShadowReg(uint8_t device, uint8_t reg) {
+  if (!Uncached(device, reg)) {
+    auto known = shadow_.find(device << 8 | reg);
+    if (known != shadow_.end()) {
+      ++stats_.shadow_reads;
+      return known->second;
+    }
+  }
+  return ReadReg(device, reg);
+}
+
 void Octopus::ModReg(uint8_t device, uint8_t reg, uint16_t val,
                      uint8_t bit_addr, uint8_t bit_len) {
-  uint16_t r = ReadReg(device, reg);
+  uint16_t r = ShadowReg(device, reg);
   r &= ~(((1 << bit_len) - 1) << bit_addr);
   r |= val << bit_addr;
   WriteReg(device, reg, r);
@@ -112,6 +176,7 @@ uint32_t Octopus::ReadDDS(uint8_t reg, int len) {
 }
 
 void Octopus::WriteDDS(uint8_t reg, uint32_t data, int len) {
+  BeginBatch();
   WriteReg(DDS_ADDR, 0, (len << 8) | reg);
   switch (len) {
     case 1: {
@@ -134,12 +199,14 @@ void Octopus::WriteDDS(uint8_t reg, uint32_t data, int len) {
   }
 
   WriteReg(DDS_ADDR, 7, 1);
+  EndBatch();
 }
 
 void Octopus::UpdateDDS() { WriteReg(DDS_ADDR, 7, 2); }
 
-void Octopus::ConfigureTimer(const Timer& ot) {
-  uint16_t regmap[17] = {0};
+Octopus::TimerImage Octopus::CompileTimer(const Timer& ot) {
+  TimerImage image = {};
+  uint16_t* regmap = image.regs;
   uint32_t count;
 
   for (int i = 1; i < 7; ++i) {
@@ -148,9 +215,6 @@ void Octopus::ConfigureTimer(const Timer& ot) {
     assert(ot.state[i].next_state <= 6);
   }
 
-  // disable timer to allow config
-  ModReg(TIMER_CONTROL, 0, 0, ot.out_select - 8, 1);
-
   // register map from timer_top.v
   regmap[0] = (ot.trigger.select << 0) | (ot.trigger.sense << 5) |
               (ot.gate.select << 7) | (ot.gate.sense << 12) |
@@ -193,11 +257,38 @@ void Octopus::ConfigureTimer(const Timer& ot) {
   regmap[15] = ot.state_transition_count & 0xFFFF;
   regmap[16] = ot.state_transition_count >> 16;
 
+  image.module = ot.out_select - 8;
+  return image;
+}
+
+void Octopus::ConfigureTimer(const Timer& ot) { ConfigureTimer(CompileTimer(ot)); }
+
+void Octopus::ConfigureTimer(const TimerImage& image) {
+  // disable timer to allow config
+  BeginBatch();
+  ModReg(TIMER_CONTROL, 0, 0, image.module, 1);
+
   // write to the timer device
-  uint8_t module_address = (ot.out_select - 8);
   for (int i = 0; i < 17; ++i) {
-    WriteReg(module_address, i, regmap[i]);
+    WriteReg(image.module, i, image.regs[i]);
   }
+  EndBatch();
+}
+
+bool Octopus::TimerLoaded(const TimerImage& image) const {
+  for (int i = 0; i < 17; ++i) {
+    auto known = shadow_.find(image.module << 8 | i);
+    if (known == shadow_.end() || known->second != image.regs[i]) return false;
+  }
+  return true;
+}
+
+void Octopus::RearmTimer(Pin pin) {
+  if (pin < OUT1_BOTTOM || pin > OUT8_TOP) return;
+  BeginBatch();
+  ModReg(TIMER_CONTROL, 0, 0, pin - 8, 1);
+  ModReg(TIMER_CONTROL, 0, 1, pin - 8, 1);
+  EndBatch();
 }
 
 void Octopus::EnableTimer(Pin pin, bool enable) {
@@ -215,6 +306,7 @@ void Octopus::ConfigureAOM(AOM& oa) {
   assert(oa.amplitude <= 7.25);
 
   // select the channel
+  BeginBatch();
   int ch = CH_MAP[oa.channel];
   WriteDDS(0, (1 << ch) << 4, 1);
 
@@ -251,4 +343,5 @@ void Octopus::ConfigureAOM(AOM& oa) {
 
   // set the update bit to make the above changes take effect
   WriteReg(DDS_ADDR, 7, 2);
+  EndBatch();
 }
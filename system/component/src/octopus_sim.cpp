@@ -0,0 +1,93 @@
+#include "system/component/inc/octopus_sim.h"
+
+#include <cstring>
+
+int OctopusSim::DataOut(int len, uint8_t* data) {
+  ++transfers_;
+  if (len == 2 && !(data[1] & 0x80)) {
+    read_ = data[1] << 8 | data[0];
+    return len;
+  }
+  if (len % 4 != 0) return -1;
+
+  for (int i = 0; i < len; i += 4) {
+    Write w;
+    w.reg = data[i];
+    w.device = data[i + 1] & 0x7F;
+    memcpy(&w.data, data + i + 2, 2);
+    writes_.push_back(w);
+    regs_[w.device << 8 | w.reg] = w.data;
+    if (w.device == DDS_ADDR && w.reg == 7 && w.data == 1) DDSTransaction();
+    Written(w);
+  }
+  return len;
+}
+
+int OctopusSim::DataIn(int len, uint8_t* data) {
+  ++transfers_;
+  if (len != 2 || read_ < 0) return -1;
+  uint16_t value = Reg(read_ >> 8, read_ & 0xFF);
+  memcpy(data, &value, 2);
+  read_ = -1;
+  return len;
+}
+
+uint16_t OctopusSim::Reg(uint8_t device, uint8_t reg) const {
+  auto r = regs_.find(device << 8 | reg);
+  return r == regs_.end() ? 0 : r->second;
+}
+
+uint32_t OctopusSim::DDSReg(uint8_t reg, int channel) const {
+  auto r = dds_.find((reg < 3 ? 0 : channel) << 8 | reg);
+  return r == dds_.end() ? 0 : r->second;
+}
+
+void OctopusSim::ClearLog() {
+  writes_.clear();
+  transfers_ = 0;
+}
+
+void OctopusSim::DDSTransaction() {
+  // SPI module registers, as Octopus::WriteDDS and ReadDDS pack them
+  uint16_t command = Reg(DDS_ADDR, 0);
+  uint8_t reg = command & 0x7F;
+  bool read = (command & 0x80) != 0;
+  int len = command >> 8;
+  uint16_t b43 = Reg(DDS_ADDR, 1), b21 = Reg(DDS_ADDR, 2);
+
+  // Channel registers go to the channels enabled in the channel select register
+  std::vector<int> channels;
+  for (int ch = 0; ch < 4; ++ch) {
+    if (reg < 3) {
+      channels.push_back(0);
+      break;
+    }
+    if (DDSReg(0) & (0x10 << ch)) channels.push_back(ch);
+  }
+
+  if (!read) {
+    uint32_t value = 0;
+    switch (len) {
+      case 1: value = b21 >> 8; break;
+      case 2: value = b21; break;
+      case 3: value = (uint32_t)b21 << 8 | b43 >> 8; break;
+      case 4: value = (uint32_t)b21 << 16 | b43; break;
+    }
+    for (int ch : channels) dds_[ch << 8 | reg] = value;
+    return;
+  }
+
+  uint32_t value = channels.empty() ? 0 : DDSReg(reg, channels[0]);
+  switch (len) {
+    case 1: regs_[DDS_ADDR << 8 | 4] = (uint16_t)(value << 8); break;
+    case 2: regs_[DDS_ADDR << 8 | 4] = (uint16_t)value; break;
+    case 3:
+      regs_[DDS_ADDR << 8 | 4] = (uint16_t)(value >> 8);
+      regs_[DDS_ADDR << 8 | 3] = (uint16_t)(value << 8);
+      break;
+    case 4:
+      regs_[DDS_ADDR << 8 | 4] = (uint16_t)(value >> 16);
+      regs_[DDS_ADDR << 8 | 3] = (uint16_t)value;
+      break;
+  }
+}
@@ -0,0 +1,303 @@
+#include "system/component/inc/octopus_timing_sim.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <tuple>
+
+// As octopus.cpp
+static const double AOM_FULLSCALE = 8.00;
+static const double AOM_CLK_FREQ = 400e6;
+static const int CH_MAP[5] = {-1, 2, 3, 0, 1};
+
+static const uint32_t FOREVER = 0xFFFFFFFF;
+
+static const char* const PIN_NAMES[] = {
+  "IN1_BOTTOM", "IN2_BOTTOM", "IN3_BOTTOM", "IN4_BOTTOM", "IN1_TOP", "IN2_TOP", "IN3_TOP", "IN4_TOP",
+  "OUT1_BOTTOM", "OUT2_BOTTOM", "OUT3_BOTTOM", "OUT4_BOTTOM", "OUT5_BOTTOM", "OUT6_BOTTOM", "OUT7_BOTTOM", "OUT8_BOTTOM",
+  "OUT1_TOP", "OUT2_TOP", "OUT3_TOP", "OUT4_TOP", "OUT5_TOP", "OUT6_TOP", "OUT7_TOP", "OUT8_TOP",
+};
+
+OctopusTimingSim::OctopusTimingSim() {
+  pins_[Octopus::Pin::HIGH] = true;
+  seen_[Octopus::Pin::HIGH] = true;
+}
+
+const char* OctopusTimingSim::PinName(Octopus::Pin pin) {
+  if (pin >= Octopus::Pin::IN1_BOTTOM && pin <= Octopus::Pin::OUT8_TOP) return PIN_NAMES[pin];
+  if (pin == Octopus::Pin::LOW) return "LOW";
+  if (pin == Octopus::Pin::HIGH) return "HIGH";
+  return "?";
+}
+
+void OctopusTimingSim::Run(double seconds) { RunCycles((uint64_t)std::llround(seconds * CLOCK_HZ)); }
+
+void OctopusTimingSim::RunCycles(uint64_t cycles) {
+  uint64_t end = now_ + cycles;
+  for (uint64_t next = NextEvent(); next <= end; next = NextEvent()) {
+    Step(next);
+  }
+  now_ = end;
+}
+
+void OctopusTimingSim::SetInput(Octopus::Pin pin, bool value, double at_s) {
+  if (pin < Octopus::Pin::IN1_BOTTOM || pin > Octopus::Pin::IN4_TOP) return;
+  uint64_t cycle = (uint64_t)std::llround(std::max(at_s, 0.0) * CLOCK_HZ);
+  if (cycle > now_) {
+    inputs_.insert(std::make_pair(cycle, std::make_pair((int)pin, value)));
+    return;
+  }
+  if (last_step_ != now_) Step(now_);
+  Set(timelines_[pin], pins_[pin], value);
+}
+
+void OctopusTimingSim::ClockInput(Octopus::Pin pin, double period_s, double width_s, int count, double start_s) {
+  for (int i = 0; i < count; ++i) {
+    SetInput(pin, true, start_s + i * period_s);
+    SetInput(pin, false, start_s + i * period_s + width_s);
+  }
+}
+
+double OctopusTimingSim::AOMFrequency(int channel) const {
+  return aoms_[CH_MAP[channel]].ftw * AOM_CLK_FREQ / ((int64_t)1 << 32);
+}
+
+double OctopusTimingSim::AOMAmplitude(int channel) const {
+  return aoms_[CH_MAP[channel]].amplitude * AOM_FULLSCALE / 0x3FF;
+}
+
+void OctopusTimingSim::Written(const Write& w) {
+  if (w.device == TIMER_CONTROL && w.reg == 0) {
+    if (last_step_ != now_) Step(now_);  // so the timers see the write as a change
+    uint16_t changed = w.data ^ enables_;
+    enables_ = w.data;
+    for (int i = 0; i < NUM_TIMERS; ++i) {
+      if (!(changed & (1 << i))) continue;
+      Timer& t = timers_[i];
+      if (w.data & (1 << i)) {
+        Latch(i);
+        t.phase = Timer::START;
+        t.transitions = 0;
+        t.gate_open = false;
+        Set(timelines_[Octopus::Pin::OUT1_BOTTOM + i], pins_[Octopus::Pin::OUT1_BOTTOM + i],
+            t.config.start_output_value);
+      } else {
+        t.phase = Timer::IDLE;
+      }
+    }
+    wake_ = std::min(wake_, now_ + 1);
+  } else if (w.device == DDS_ADDR && (w.reg == 5 || w.reg == 6 || (w.reg == 7 && w.data == 2))) {
+    if (w.reg == 7) {
+      // The update takes the DDS channel registers as they have been written
+      for (int ch = 0; ch < 4; ++ch) {
+        aoms_[ch].ftw = DDSReg(4, ch);
+        aoms_[ch].amplitude = DDSReg(0x0A, ch) >> 22;
+      }
+    }
+    if (last_step_ != now_) Step(now_);
+    wake_ = std::min(wake_, now_ + 1);
+  }
+}
+
+void OctopusTimingSim::Latch(int module) {
+  Octopus::Timer& ot = timers_[module].config;
+  uint16_t r = Reg(module, 0);
+  ot.trigger.select = (Octopus::Pin)(r & 0x1F);
+  ot.trigger.sense = (decltype(ot.trigger.sense))((r >> 5) & 0b11);
+  ot.gate.select = (Octopus::Pin)((r >> 7) & 0x1F);
+  ot.gate.sense = (decltype(ot.gate.sense))((r >> 12) & 1);
+  ot.start_output_value = (r >> 13) & 1;
+  ot.end_output_value = (r >> 14) & 1;
+
+  // States 1-3 packed in register 1, 4-6 in register 8, and their counts after each
+  static const int COUNT_REGS[7] = {0, 2, 4, 6, 9, 11, 13};
+  for (int i = 1; i < 7; ++i) {
+    uint16_t states = Reg(module, i < 4 ? 1 : 8);
+    int shift = (i - 1) % 3 * 5;
+    ot.state[i].output_value = (states >> shift) & 1;
+    ot.state[i].use_trigger = (states >> (shift + 1)) & 1;
+    ot.state[i].next_state = (states >> (shift + 2)) & 0b111;
+    timers_[module].counts[i] = Reg(module, COUNT_REGS[i]) | (uint32_t)Reg(module, COUNT_REGS[i] + 1) << 16;
+    ot.state[i].period = timers_[module].counts[i] / CLOCK_HZ;
+  }
+  ot.state_transition_count = Reg(module, 15) | (uint32_t)Reg(module, 16) << 16;
+  ot.out_select = (Octopus::Pin)(Octopus::Pin::OUT1_BOTTOM + module);
+}
+
+void OctopusTimingSim::Step(uint64_t cycle) {
+  uint64_t elapsed = cycle - last_step_;
+  bool pins[NUM_PINS], previous[NUM_PINS], out[NUM_TIMERS];
+  memcpy(pins, pins_, sizeof(pins));
+  memcpy(previous, elapsed == 1 ? seen_ : pins_, sizeof(previous));
+  memcpy(out, pins_ + Octopus::Pin::OUT1_BOTTOM, sizeof(out));
+  now_ = std::max(now_, cycle);
+
+  for (int i = 0; i < NUM_TIMERS; ++i) {
+    Timer& t = timers_[i];
+    if (t.phase == Timer::IDLE) continue;
+    if (t.phase == Timer::COUNT && t.gate_open) t.remaining -= std::min(t.remaining, elapsed);
+    t.gate_open = pins[t.config.gate.select] == (t.config.gate.sense == Octopus::Timer::Gate::HIGH);
+    if (t.gate_open) Advance(t, pins, previous, &out[i]);
+  }
+
+  for (auto in = inputs_.begin(); in != inputs_.end() && in->first <= cycle; in = inputs_.erase(in)) {
+    Set(timelines_[in->second.first], pins_[in->second.first], in->second.second);
+  }
+  for (int i = 0; i < NUM_TIMERS; ++i) {
+    Set(timelines_[Octopus::Pin::OUT1_BOTTOM + i], pins_[Octopus::Pin::OUT1_BOTTOM + i], out[i]);
+  }
+
+  // AOM outputs follow their gates straight away
+  for (int channel = 1; channel <= 4; ++channel) {
+    int ch = CH_MAP[channel];
+    uint16_t gates = Reg(DDS_ADDR, ch == 0 ? 6 : 5);
+    int gate = ch == 0 ? gates & 0x1F : gates >> ((3 - ch) * 5) & 0x1F;
+    bool amplifier = (Reg(DDS_ADDR, 6) >> (channel + 11)) & 1;
+    Set(aom_timelines_[channel - 1], aom_on_[channel - 1], amplifier && pins_[gate] && aoms_[ch].amplitude);
+  }
+
+  memcpy(seen_, pins, sizeof(seen_));
+  last_step_ = cycle;
+  if (wake_ <= cycle) wake_ = UINT64_MAX;
+}
+
+void OctopusTimingSim::Advance(Timer& t, const bool* pins, const bool* previous, bool* out) {
+  // At most a few state changes in one cycle: every state lasts a cycle or more
+  for (int guard = 0; guard < 8; ++guard) {
+    switch (t.phase) {
+      case Timer::START: {
+        Enter(t, 1, out);
+      } break;
+      case Timer::COUNT: {
+        if (t.remaining > 0) return;
+        int next = t.config.state[t.state].next_state;
+        if (next == 0 || (t.config.state_transition_count != FOREVER &&
+                          t.transitions + 1 >= t.config.state_transition_count)) {
+          ++t.transitions;
+          t.phase = Timer::IDLE;
+          *out = t.config.end_output_value;
+          return;
+        }
+        Enter(t, next, out);
+      } break;
+      case Timer::WAIT: {
+        Octopus::Pin p = t.config.trigger.select;
+        bool fired = false;
+        switch (t.config.trigger.sense) {
+          case Octopus::Timer::Trigger::LOW: fired = !pins[p]; break;
+          case Octopus::Timer::Trigger::RISING: fired = pins[p] && !previous[p]; break;
+          case Octopus::Timer::Trigger::FALLING: fired = !pins[p] && previous[p]; break;
+          case Octopus::Timer::Trigger::HIGH: fired = pins[p]; break;
+        }
+        if (!fired) return;
+        t.phase = Timer::COUNT;
+        t.remaining = std::max<uint64_t>(t.counts[t.state], 1);
+        *out = t.config.state[t.state].output_value;
+        return;
+      }
+      default:
+        return;
+    }
+  }
+}
+
+void OctopusTimingSim::Enter(Timer& t, int state, bool* out) {
+  ++t.transitions;
+  t.state = state;
+  if (t.config.state[state].use_trigger) {
+    t.phase = Timer::WAIT;
+    return;
+  }
+  t.phase = Timer::COUNT;
+  t.remaining = std::max<uint64_t>(t.counts[state], 1);
+  *out = t.config.state[state].output_value;
+}
+
+uint64_t OctopusTimingSim::NextEvent() const {
+  uint64_t next = wake_;
+  if (memcmp(pins_, seen_, sizeof(pins_)) != 0) next = std::min(next, last_step_ + 1);
+  for (const Timer& t : timers_) {
+    if (t.phase == Timer::COUNT && t.gate_open) next = std::min(next, last_step_ + t.remaining);
+  }
+  if (!inputs_.empty()) next = std::min(next, inputs_.begin()->first);
+  return next;
+}
+
+void OctopusTimingSim::Set(std::vector<Edge>& timeline, bool& value, bool now) {
+  if (value == now) return;
+  value = now;
+  timeline.push_back({ now_, now });
+}
+
+std::vector<OctopusTimingSim::Pulse> OctopusTimingSim::Pulses(const std::vector<Edge>& timeline) {
+  std::vector<Pulse> pulses;
+  for (const Edge& e : timeline) {
+    if (e.value) {
+      pulses.push_back({ e.cycle / CLOCK_HZ, -1 });
+    } else if (!pulses.empty() && pulses.back().width < 0) {
+      pulses.back().width = e.cycle / CLOCK_HZ - pulses.back().start;
+    }
+  }
+  return pulses;
+}
+
+void OctopusTimingSim::WriteVCD(std::ostream& out) const {
+  // Every input and output pin, then the AOMs; identifiers from '!'
+  std::vector<std::pair<std::string, const std::vector<Edge>*>> signals;
+  for (int pin = Octopus::Pin::IN1_BOTTOM; pin <= Octopus::Pin::OUT8_TOP; ++pin) {
+    signals.push_back({ PIN_NAMES[pin], &timelines_[pin] });
+  }
+  for (int channel = 1; channel <= 4; ++channel) {
+    signals.push_back({ "AOM" + std::to_string(channel), &aom_timelines_[channel - 1] });
+  }
+
+  out << "$timescale 10ns $end\n$scope module octopus $end\n";
+  for (size_t i = 0; i < signals.size(); ++i) {
+    out << "$var wire 1 " << (char)('!' + i) << " " << signals[i].first << " $end\n";
+  }
+  out << "$upscope $end\n$enddefinitions $end\n#0\n$dumpvars\n";
+  for (size_t i = 0; i < signals.size(); ++i) out << "0" << (char)('!' + i) << "\n";
+  out << "$end\n";
+
+  std::vector<std::tuple<uint64_t, size_t, bool>> changes;
+  for (size_t i = 0; i < signals.size(); ++i) {
+    for (const Edge& e : *signals[i].second) changes.push_back(std::make_tuple(e.cycle, i, e.value));
+  }
+  std::stable_sort(changes.begin(), changes.end(),
+                   [](const std::tuple<uint64_t, size_t, bool>& a, const std::tuple<uint64_t, size_t, bool>& b) {
+                     return std::get<0>(a) < std::get<0>(b);
+                   });
+  uint64_t time = 0;
+  for (const auto& c : changes) {
+    if (std::get<0>(c) != time) {
+      time = std::get<0>(c);
+      out << "#" << time << "\n";
+    }
+    out << std::get<2>(c) << (char)('!' + std::get<1>(c)) << "\n";
+  }
+  out << "#" << std::max(time, now_) << "\n";
+}
+
+void OctopusTimingSim::WriteCSV(std::ostream& out) const {
+  std::vector<std::tuple<uint64_t, std::string, bool>> changes;
+  for (int pin = Octopus::Pin::IN1_BOTTOM; pin <= Octopus::Pin::OUT8_TOP; ++pin) {
+    for (const Edge& e : timelines_[pin]) changes.push_back(std::make_tuple(e.cycle, PIN_NAMES[pin], e.value));
+  }
+  for (int channel = 1; channel <= 4; ++channel) {
+    for (const Edge& e : aom_timelines_[channel - 1]) {
+      changes.push_back(std::make_tuple(e.cycle, "AOM" + std::to_string(channel), e.value));
+    }
+  }
+  std::stable_sort(changes.begin(), changes.end(),
+                   [](const std::tuple<uint64_t, std::string, bool>& a,
+                      const std::tuple<uint64_t, std::string, bool>& b) { return std::get<0>(a) < std::get<0>(b); });
+
+  out << "time_s,signal,value\n";
+  char time[32];
+  for (const auto& c : changes) {
+    snprintf(time, sizeof(time), "%.8f", std::get<0>(c) / CLOCK_HZ);
+    out << time << "," << std::get<1>(c) << "," << std::get<2>(c) << "\n";
+  }
+}
@@ -0,0 +1,86 @@
+#include "system/component/inc/preview.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "system/component/inc/colormap.h"
+#include "system/component/inc/time.h"
+
+namespace Preview {
+
+void Downsample(const uint16_t* in, int width, int height, int factor, uint16_t* out) {
+  int out_w = Downsized(width, factor);
+  std::vector<uint32_t> sum(out_w);
+  for (int y0 = 0; y0 < height; y0 += factor) {
+    int rows = height - y0 < factor ? height - y0 : factor;
+    std::fill(sum.begin(), sum.end(), 0);
+    for (int j = y0; j < y0 + rows; ++j) {
+      const uint16_t* row = in + (size_t)j * width;
+      int x = 0;
+      for (int o = 0; o < out_w; ++o) {
+        uint32_t s = 0;
+        int end = x + factor < width ? x + factor : width;
+        for (; x < end; ++x) s += row[x];
+        sum[o] += s;
+      }
+    }
+    int last_cols = width - (out_w - 1) * factor;
+    for (int o = 0; o < out_w; ++o) {
+      int cols = o == out_w - 1 ? last_cols : factor;
+      out[o] = (uint16_t)(sum[o] / (uint32_t)(rows * cols));
+    }
+    out += out_w;
+  }
+}
+
+
+void Colormap(const uint16_t* in, size_t n, const uint32_t* lut, int shift, uint32_t* out) {
+  for (size_t i = 0; i < n; ++i) out[i] = lut[in[i] >> shift];
+}
+
+
+int ColormapShift(int bits) {
+  int shift = 0;
+  while ((1 << (bits - shift)) > COLORMAP_LEN) ++shift;
+  return shift;
+}
+
+
+void LogScale::Set(double m, double x0) {
+  for (int i = 0; i < kEntries; ++i) {
+    // Middle of the range of magnitudes that quantize to this entry
+    uint32_t bits = ((uint32_t)i << kShift) | (1u << (kShift - 1));
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    double x = m * (log((double)f + 1) - x0);
+    if (!(x > 0)) x = 0;  // Also catches NaN
+    if (x > 255) x = 255;
+    table_[i] = Grey(int(x));
+  }
+}
+
+
+uint32_t LogScale::Index(double x) {
+  float f = (float)x;
+  uint32_t bits;
+  memcpy(&bits, &f, sizeof(bits));
+  bits >>= kShift;
+  return bits < (uint32_t)kEntries ? bits : 0;  // Negative magnitudes are black
+}
+
+
+void LogScale::Map(const double* in, size_t n, uint32_t* out) const {
+  const uint32_t* table = table_.data();
+  for (size_t i = 0; i < n; ++i) out[i] = table[Index(in[i])];
+}
+
+
+bool RateLimit::Take() {
+  time_t now = Component::SteadyClockTimeMs();
+  time_t last = last_ms_;
+  if (now - last < interval_ms_) return false;
+  // Only one of several exec threads wins the interval
+  return last_ms_.compare_exchange_strong(last, now);
+}
+
+}  // namespace Preview
@@ -183,14 +183,15 @@ Frame* Rcam::WaitFrame(double timeout) {
   while (GetFrame() != NULL) {
   }
 
-  // subtracting int from int deals with possible timer overflow
-  uint64_t t_start = Component::SteadyClockTimeMs();
-  uint64_t ms = (uint64_t)(timeout * 1000);
-  Frame* fr;
-  while ((fr = GetFrame()) == NULL) {
-    if (timeout > 0 && Component::SteadyClockTimeMs() - t_start > ms) return NULL;
+  std::unique_lock<std::mutex> lock(frame_mutex_);
+  auto ready = [this] { return framebuf_.PopAvailable() > 0; };
+  if (timeout > 0) {
+    if (!frame_ready_.wait_for(lock, std::chrono::duration<double>(timeout), ready)) return NULL;
+  } else {
+    frame_ready_.wait(lock, ready);
   }
-  return fr;
+  lock.unlock();
+  return GetFrame();
 }
 
 void Rcam::SetStream(bool stream) {
@@ -248,9 +249,23 @@ int Rcam::SerialNumber() { return fx3_->SerialNumber(); }
 
 int Rcam::GetFrameCount() { return frames_; }
 
+bool Rcam::WaitFrameCount(int count, double timeout_ms) {
+  std::unique_lock<std::mutex> lock(frame_mutex_);
+  auto reached = [this, count] { return frames_ >= count; };
+  if (timeout_ms < 0) {
+    frame_ready_.wait(lock, reached);
+    return true;
+  }
+  return frame_ready_.wait_for(lock, std::chrono::duration<double, std::milli>(timeout_ms), reached);
+}
+
 
 void Rcam::SetFrameCount(int frames) { 
-  frames_ = frames;
+  {
+    std::lock_guard<std::mutex> lock(frame_mutex_);
+    frames_ = frames;
+  }
+  frame_ready_.notify_all();
   int ret = fx3_->CmdWrite(RQ_SET_FRAME_COUNT, 0, 0, 4, (uint8_t*)&frames);
   assert(ret == 4);
 }
@@ -462,7 +477,12 @@ void Rcam::RxThread() {
           if (!IsLeaf()) Produce(fr);
           fr = NULL;
         }
-        ++frames_;
+        {
+          // Orders the push and count before a waiter's check, so the notify is not missed
+          std::lock_guard<std::mutex> lock(frame_mutex_);
+          ++frames_;
+        }
+        frame_ready_.notify_all();
       }
 
       if (!fr && framebuf_.PushAvailable()) {
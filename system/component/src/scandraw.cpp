@@ -1,9 +1,18 @@
 #include "system/component/inc/scandraw.h"
 
+#include <algorithm>
+
 #include "system/component/inc/colormap.h"
 #include "system/component/inc/frame.h"
 #include "system/component/inc/roi.h"
 
+static inline uint32_t Colour(double v, double scale) {
+  int idx = (int)(v * scale);
+  if (idx >= COLORMAP_LEN) idx = COLORMAP_LEN - 1;
+  if (idx < 0) idx = 0;
+  return COLORMAP_JET[idx];
+}
+
 void ScanDraw::SetSize(int i, int j, int k) {
   dim_[0] = i;
   dim_[1] = j;
@@ -15,6 +24,10 @@ void ScanDraw::SetSize(int i, int j, int k) {
   max_val_ = 1.0;
 
   voxel_.resize(i * j * k, 0);
+  dirty_.clear();
+  dirty_.reserve(i * j);
+  redraw_all_ = true;
+  scale_max_ = 0.0;
 
   px_.resize(i * j, COLORMAP_JET[0]);
 
@@ -31,54 +44,79 @@ void ScanDraw::SetIndex(int i, int j, int k) {
 void ScanDraw::SetViewRelative(int k) {
   if (max_plane_ < 0) return;
 
-  p_lock_.lock();
+  std::lock_guard<std::mutex> lock(p_lock_);
 
   display_plane_ += k;
   if (display_plane_ >= max_plane_) display_plane_ = max_plane_;
   if (display_plane_ < 0) display_plane_ = 0;
-
-  p_lock_.unlock();
-
-  std::lock_guard<std::mutex> lock2(wr_lock_);
-  UpdateDisplay();
+  redraw_all_ = true;
+  dirty_.clear();
 }
 
 void* ScanDraw::Exec(void* data) {
-  p_lock_.lock();
+  std::lock_guard<std::mutex> lock(p_lock_);
 
   roi_tag* roi = ROI::GetTag((Frame*)data);
   assert(roi);
-  assert(write_idx_ < dim_[0] * dim_[1] * dim_[2]);
-  voxel_[write_idx_] = roi->roi;
-  if (voxel_[write_idx_] > max_val_) max_val_ = voxel_[write_idx_];
-
-  if (write_idx_ % (dim_[0] * dim_[1]) == 0) {
-    if (display_plane_ == max_plane_) ++display_plane_;
+  int idx = write_idx_;
+  assert(idx < dim_[0] * dim_[1] * dim_[2]);
+  voxel_[idx] = roi->roi;
+  if (voxel_[idx] > max_val_) max_val_ = voxel_[idx];
+
+  if (idx % (dim_[0] * dim_[1]) == 0) {
+    if (display_plane_ == max_plane_) {
+      ++display_plane_;
+      redraw_all_ = true;
+      dirty_.clear();
+    }
     ++max_plane_;
   }
-  ++write_idx_;
-
-  p_lock_.unlock();
-
-  if (display_plane_ == max_plane_ && wr_lock_.try_lock()) {
-    UpdateDisplay();
-    wr_lock_.unlock();
-  }
+  // dirty_ only ever holds voxels of the displayed plane
+  if (idx / (dim_[0] * dim_[1]) == display_plane_ && !redraw_all_) dirty_.push_back(idx);
+  write_idx_ = idx + 1;
 
   return data;
 }
 
-void ScanDraw::UpdateDisplay() {
+void ScanDraw::draw(sf::RenderTarget& target, sf::RenderStates states) const {
+  Refresh();
+  Zoomable::draw(target, states);
+}
+
+void ScanDraw::Refresh() const {
   int plane_size = dim_[0] * dim_[1];
-  double scale = (double)(COLORMAP_LEN - 1) / max_val_;
-  double* plane = &voxel_[display_plane_ * plane_size];
-  for (int i = 0; i < plane_size; ++i) {
-    int idx = (int)(plane[i] * scale);
-    if (idx >= COLORMAP_LEN) idx = COLORMAP_LEN - 1;
-    assert(idx >= 0);
-    assert(idx < COLORMAP_LEN);
-    px_[i] = COLORMAP_JET[idx];
+  int first_row = 0;
+  int n_rows = 0;
+  {
+    std::lock_guard<std::mutex> lock(p_lock_);
+    if (display_plane_ < 0) return;
+    // Rescale at most once per draw, however often the maximum moves
+    if (max_val_ != scale_max_) {
+      scale_max_ = max_val_;
+      redraw_all_ = true;
+    }
+    double scale = (double)(COLORMAP_LEN - 1) / scale_max_;
+    const double* plane = &voxel_[display_plane_ * plane_size];
+    if (redraw_all_) {
+      for (int i = 0; i < plane_size; ++i) px_[i] = Colour(plane[i], scale);
+      n_rows = dim_[1];
+    } else if (!dirty_.empty()) {
+      int lo = plane_size;
+      int hi = -1;
+      for (int idx : dirty_) {
+        int i = idx - display_plane_ * plane_size;
+        px_[i] = Colour(plane[i], scale);
+        lo = std::min(lo, i);
+        hi = std::max(hi, i);
+      }
+      first_row = lo / dim_[0];
+      n_rows = hi / dim_[0] - first_row + 1;
+    }
+    dirty_.clear();
+    redraw_all_ = false;
   }
-  std::lock_guard<std::mutex> lock(Zoomable::lock_);
-  tx_.update((uint8_t*)px_.data());
+  if (n_rows == 0) return;
+
+  // Voxels arrive in raster order, so the changed texels are a band of rows
+  tx_.update((const uint8_t*)&px_[first_row * dim_[0]], dim_[0], n_rows, 0, first_row);
 }
@@ -2,11 +2,22 @@
 
 #include <cmath>
 
+#include "system/component/inc/framehist.h"
+
 
 void* StdDev::Exec(void* data) {
   Frame* fr = (Frame*)data;
   Tag* tag = &pool_.Alloc();
 
+  // A histogram upstream already has exact statistics, without another two passes
+  const FrameHist::Tag* hist = fr->GetTag<FrameHist::Tag>();
+  if (hist && hist->shift == 0) {
+    tag->mean = hist->Mean();
+    tag->stddev = hist->StdDev();
+    fr->AddTag(tag);
+    return data;
+  }
+
   // use int64_t to not lose precision on large sums
   // int32_t will overflow for 5MP @ 10bit images
   int size = fr->width * fr->height;
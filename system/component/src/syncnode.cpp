@@ -12,13 +12,19 @@ void SyncNode::resize(size_t n) {
 }
 
 
-void* SyncNode::Get() {
+void SyncNode::Release() {
   if (user_) {
     buf_.Pop();
     ++popped_;
     user_ = false;
+    released_.notify_all();
   }
+}
+
 
+void* SyncNode::Get() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Release();
   if (buf_.PopAvailable()) {
     user_ = true;
     return buf_.Peek();
@@ -28,28 +34,26 @@ void* SyncNode::Get() {
 
 
 void* SyncNode::Wait(double seconds) {
-  using std::chrono::steady_clock;
-
-  steady_clock::time_point end =
-      steady_clock::now() + std::chrono::milliseconds((int)(seconds * 1000));
-  void* d;
-  while ((d = Get()) == NULL) {
-    if (seconds > 0 && steady_clock::now() > end) {
-      return NULL;
-    }
+  std::unique_lock<std::mutex> lock(mutex_);
+  Release();
+  auto ready = [this] { return buf_.PopAvailable() > 0; };
+  if (seconds > 0) {
+    if (!received_.wait_for(lock, std::chrono::duration<double>(seconds), ready)) return NULL;
+  } else {
+    received_.wait(lock, ready);
   }
-  return d;
+  user_ = true;
+  return buf_.Peek();
 }
 
 
 void* SyncNode::Exec(void* data) {
-  mutex_.lock();
+  std::unique_lock<std::mutex> lock(mutex_);
   int wait = ++pushed_;
   buf_.Push(data);
-  mutex_.unlock();
+  received_.notify_all();
 
-  while (wait - popped_ > 0) {
-    std::this_thread::yield();
-  }
+  // Hold the data until the user has moved past it
+  released_.wait(lock, [&] { return wait - popped_ <= 0; });
   return data;
 }
@@ -0,0 +1,344 @@
+#undef _CRT_SECURE_NO_WARNINGS
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "system/component/inc/taglog.h"
+
+#include <algorithm>
+#include <cinttypes>
+
+static const char kMagic[8] = { 'O', 'W', 'T', 'A', 'G', 'L', 'O', 'G' };
+static const uint32_t kVersion = 2;  // 2: only the groups present are stored
+
+static size_t TypeBytes(uint32_t type) {
+  return type == TagLog::INT32 || type == TagLog::FLOAT32 ? 4 : 8;
+}
+
+// Copy a name into a fixed size, NUL terminated field
+static void SetName(char* dst, const std::string& name) {
+  memset(dst, 0, TagLog::kNameLen);
+  strncpy(dst, name.c_str(), TagLog::kNameLen - 1);
+}
+
+
+TagLog::~TagLog() {
+  Close();
+}
+
+
+int TagLog::AddGroup(const std::string& name, const std::vector<Column>& columns, Filler fill) {
+  if (open_ || groups_.size() >= kMaxGroups) return -1;
+  Group group;
+  group.name = name;
+  group.columns = columns;
+  group.fill = fill;
+  group.bytes = 0;
+  for (const Column& column : columns) group.bytes += TypeBytes(column.type);
+  record_bytes_ += group.bytes;
+  groups_.push_back(group);
+  return 0;
+}
+
+
+std::vector<uint8_t> TagLog::Header() const {
+  size_t n_columns = 0;
+  for (const Group& group : groups_) n_columns += group.columns.size();
+
+  FileHeader header;
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.header_bytes = (uint32_t)(sizeof(FileHeader) + groups_.size() * sizeof(GroupInfo) +
+                                   n_columns * sizeof(ColumnInfo));
+  header.record_bytes = (uint32_t)record_bytes_;
+  header.n_groups = (uint32_t)groups_.size();
+  header.n_columns = (uint32_t)n_columns;
+  header.reserved = 0;
+
+  std::vector<uint8_t> out(header.header_bytes);
+  uint8_t* p = out.data();
+  memcpy(p, &header, sizeof(header));
+  p += sizeof(header);
+
+  uint32_t column = 0;
+  for (const Group& group : groups_) {
+    GroupInfo info;
+    SetName(info.name, group.name);
+    info.first_column = column;
+    info.n_columns = (uint32_t)group.columns.size();
+    memcpy(p, &info, sizeof(info));
+    p += sizeof(info);
+    column += info.n_columns;
+  }
+  for (const Group& group : groups_) {
+    size_t offset = 0;
+    for (const Column& c : group.columns) {
+      ColumnInfo info;
+      SetName(info.name, c.name);
+      info.type = c.type;
+      info.offset = (uint32_t)offset;
+      memcpy(p, &info, sizeof(info));
+      p += sizeof(info);
+      offset += TypeBytes(c.type);
+    }
+  }
+  return out;
+}
+
+
+int TagLog::Open(const std::string& fname) {
+  Close();
+  file_ = fopen(fname.c_str(), "wbx");
+  if (file_ == NULL) {
+    printf("Could not open tag log for writing: %s\n", fname.c_str());
+    return -1;
+  }
+  std::vector<uint8_t> header = Header();
+  if (fwrite(header.data(), 1, header.size(), file_) != header.size()) {
+    printf("Could not write tag log header: %s\n", fname.c_str());
+    fclose(file_);
+    file_ = NULL;
+    return -1;
+  }
+  stats_ = Stats();
+  stop_ = false;
+  writer_ = std::thread(&TagLog::Run, this);
+  open_ = true;
+  return 0;
+}
+
+
+size_t TagLog::Encode(const Frame* fr, uint8_t* rec) const {
+  uint32_t present = 0;
+  size_t pos = sizeof(present);
+  for (size_t g = 0; g < groups_.size(); ++g) {
+    // An absent group's space is reused by the next group, even if its filler wrote part of it
+    Fields fields(rec + pos);
+    if (groups_[g].fill(fr, &fields)) {
+      present |= 1u << g;
+      pos += groups_[g].bytes;
+    }
+  }
+  memcpy(rec, &present, sizeof(present));
+  return pos;
+}
+
+
+void TagLog::Log(const Frame* fr) {
+  size_t shard_idx = std::hash<std::thread::id>()(std::this_thread::get_id()) % kShards;
+  Shard& shard = shards_[shard_idx];
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  if (!open_) return;  // Checked under the shard lock so Close() cannot miss this record
+  size_t pos = shard.buf.size();
+  shard.buf.resize(pos + record_bytes_);
+  shard.buf.resize(pos + Encode(fr, &shard.buf[pos]));
+  if (shard.buf.size() + record_bytes_ > kBufferBytes) Submit(&shard.buf);
+}
+
+
+void TagLog::Submit(std::vector<uint8_t>* buf) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    full_.push_back(std::move(*buf));
+    if (!spare_.empty()) {
+      *buf = std::move(spare_.back());
+      spare_.pop_back();
+    } else {
+      *buf = std::vector<uint8_t>();
+      buf->reserve(kBufferBytes);
+    }
+  }
+  buf->clear();
+  work_.notify_one();
+}
+
+
+void TagLog::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    work_.wait(lock, [this] { return !full_.empty() || stop_; });
+    if (full_.empty()) break;  // Stopping, and everything is written
+    std::vector<uint8_t> buf = std::move(full_.front());
+    full_.pop_front();
+    lock.unlock();
+    size_t n = fwrite(buf.data(), 1, buf.size(), file_);
+    lock.lock();
+    if (n != buf.size()) {
+      printf("Error writing frame tags\n");
+      ++stats_.errors;
+    } else {
+      stats_.bytes_written += n;
+      stats_.records += CountRecords(buf);
+    }
+    buf.clear();
+    spare_.push_back(std::move(buf));
+  }
+}
+
+
+size_t TagLog::CountRecords(const std::vector<uint8_t>& buf) const {
+  size_t n = 0;
+  size_t pos = 0;
+  uint32_t present;
+  while (pos + sizeof(present) <= buf.size()) {
+    memcpy(&present, &buf[pos], sizeof(present));
+    pos += sizeof(present);
+    for (size_t g = 0; g < groups_.size(); ++g) {
+      if (present & (1u << g)) pos += groups_[g].bytes;
+    }
+    ++n;
+  }
+  return n;
+}
+
+
+int TagLog::Close() {
+  if (!open_) return 0;
+  open_ = false;
+  for (Shard& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (!shard.buf.empty()) Submit(&shard.buf);
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_.notify_all();
+  writer_.join();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (fclose(file_) != 0) ++stats_.errors;
+  file_ = NULL;
+  return stats_.errors;
+}
+
+
+TagLog::Stats TagLog::GetStats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+
+int TagLogReader::SetHeader(const uint8_t* header, size_t n) {
+  if (n < sizeof(header_)) return -1;
+  memcpy(&header_, header, sizeof(header_));
+  if (memcmp(header_.magic, kMagic, sizeof(kMagic)) != 0 || header_.version != kVersion) return -1;
+  size_t expected = sizeof(header_) + header_.n_groups * sizeof(TagLog::GroupInfo) +
+                    header_.n_columns * sizeof(TagLog::ColumnInfo);
+  if (header_.header_bytes != expected || n < expected || header_.record_bytes == 0) return -1;
+
+  const uint8_t* p = header + sizeof(header_);
+  groups_.resize(header_.n_groups);
+  memcpy(groups_.data(), p, groups_.size() * sizeof(TagLog::GroupInfo));
+  p += groups_.size() * sizeof(TagLog::GroupInfo);
+  columns_.resize(header_.n_columns);
+  memcpy(columns_.data(), p, columns_.size() * sizeof(TagLog::ColumnInfo));
+  group_bytes_.assign(groups_.size(), 0);
+  size_t record_bytes = sizeof(uint32_t);
+  for (size_t g = 0; g < groups_.size(); ++g) {
+    if (groups_[g].first_column + groups_[g].n_columns > columns_.size()) return -1;
+    for (uint32_t i = 0; i < groups_[g].n_columns; ++i) {
+      const TagLog::ColumnInfo& c = columns_[groups_[g].first_column + i];
+      group_bytes_[g] = std::max(group_bytes_[g], (size_t)c.offset + TypeBytes(c.type));
+    }
+    record_bytes += group_bytes_[g];
+  }
+  if (record_bytes != header_.record_bytes) return -1;
+  return 0;
+}
+
+
+size_t TagLogReader::RecordBytes(const uint8_t* rec) const {
+  uint32_t present;
+  memcpy(&present, rec, sizeof(present));
+  size_t n = sizeof(present);
+  for (size_t g = 0; g < groups_.size(); ++g) {
+    if (present & (1u << g)) n += group_bytes_[g];
+  }
+  return n;
+}
+
+
+const uint8_t* TagLogReader::Value(const uint8_t* rec, size_t column) const {
+  uint32_t present;
+  memcpy(&present, rec, sizeof(present));
+  const uint8_t* p = rec + sizeof(present);
+  for (size_t g = 0; g < groups_.size(); ++g) {
+    if (!(present & (1u << g))) continue;
+    if (column < groups_[g].first_column + groups_[g].n_columns) {
+      return column >= groups_[g].first_column ? p + columns_[column].offset : NULL;
+    }
+    p += group_bytes_[g];
+  }
+  return NULL;
+}
+
+
+int TagLogReader::Open(const std::string& fname) {
+  FILE* file = fopen(fname.c_str(), "rb");
+  if (!file) return -1;
+  std::vector<uint8_t> bytes;
+  uint8_t buf[64 * 1024];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), file)) > 0) bytes.insert(bytes.end(), buf, buf + n);
+  fclose(file);
+
+  if (SetHeader(bytes.data(), bytes.size()) != 0) return -1;
+  data_.assign(bytes.begin() + header_.header_bytes, bytes.end());
+  records_.clear();
+  size_t pos = 0;
+  while (pos + sizeof(uint32_t) <= data_.size()) {
+    size_t n = RecordBytes(&data_[pos]);
+    if (pos + n > data_.size()) break;  // Drop a partial last record
+    records_.push_back(pos);
+    pos += n;
+  }
+  return 0;
+}
+
+
+std::string TagLogReader::CsvHeader() const {
+  std::string out;
+  for (size_t i = 0; i < columns_.size(); ++i) {
+    if (i) out += ", ";
+    out += columns_[i].name;
+  }
+  return out;
+}
+
+
+std::string TagLogReader::Csv(const uint8_t* rec) const {
+  uint32_t present;
+  memcpy(&present, rec, sizeof(present));
+  std::string out;
+  char buf[32];
+  bool first = true;
+  const uint8_t* p = rec + sizeof(present);
+  for (size_t g = 0; g < groups_.size(); ++g) {
+    for (uint32_t i = 0; i < groups_[g].n_columns; ++i) {
+      const TagLog::ColumnInfo& c = columns_[groups_[g].first_column + i];
+      if (!first) out += ", ";
+      first = false;
+      if (!(present & (1u << g))) continue;
+      const uint8_t* v = p + c.offset;
+      if (c.type == TagLog::INT32) {
+        int32_t x;
+        memcpy(&x, v, sizeof(x));
+        snprintf(buf, sizeof(buf), "%d", x);
+      } else if (c.type == TagLog::INT64) {
+        int64_t x;
+        memcpy(&x, v, sizeof(x));
+        snprintf(buf, sizeof(buf), "%" PRId64, x);
+      } else if (c.type == TagLog::FLOAT32) {
+        float x;
+        memcpy(&x, v, sizeof(x));
+        snprintf(buf, sizeof(buf), "%.7g", x);
+      } else {
+        double x;
+        memcpy(&x, v, sizeof(x));
+        snprintf(buf, sizeof(buf), "%.10g", x);
+      }
+      out += buf;
+    }
+    if (present & (1u << g)) p += group_bytes_[g];
+  }
+  return out;
+}
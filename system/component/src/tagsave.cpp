@@ -1,130 +1,112 @@
 #include "system/component/inc/tagsave.h"
 
+#include <cstdio>
+#include <mutex>
+
 #include "system/component/inc/filterdev.h"
 #include "system/component/inc/fftt.h"
 #include "system/component/inc/invertroi.h"
 #include "system/component/inc/roi.h"
 #include "system/component/inc/stddev.h"
 
-FILE* TagSave::file_ = stdout;
-bool TagSave::write_header_ = true;
-std::mutex TagSave::mutex_;
-
-
-template <typename T>
-static const char* header = "";
-template <typename T>
-static void WriteCSV(const T* tag, FILE* file) {}
-
-// Frame
-template <>
-static const char* header<Frame> =
-    "Camera Number, Frame Number, Timestamp (ms), Temperature (C)";
-template <>
-static void WriteCSV<Frame>(const Frame* fr, FILE* file) {
-  fprintf(file, "%d, %d, %ld, %.1lf", fr->serialNumber, fr->seq, fr->timestamp_ms_, fr->temperature);
+// Tag values are stored to float precision; the CSV this replaced kept 4 significant digits
+static void AddStandardTags(TagLog* log) {
+  log->AddGroup("Frame",
+                { { "Camera Number", TagLog::INT32 }, { "Frame Number", TagLog::INT32 },
+                  { "Timestamp (ms)", TagLog::INT64 }, { "Temperature (C)", TagLog::FLOAT32 } },
+                [](const Frame* fr, TagLog::Fields* f) {
+                  f->Put((int32_t)fr->serialNumber);
+                  f->Put((int32_t)fr->seq);
+                  f->Put((int64_t)fr->timestamp_ms_);
+                  f->Put((float)fr->temperature);
+                  return true;
+                });
+  log->AddTag<FFTT::Tag>("FFTT", { { "FFT Time(ms)", TagLog::INT32 }, { "FFTT Zero", TagLog::FLOAT32 } },
+                         [](const FFTT::Tag* tag, TagLog::Fields* f) {
+                           f->Put((int32_t)tag->ms);
+                           f->Put((float)tag->fft_zero);
+                         });
+  log->AddTag<ROI::Tag>("ROI", { { "ROI", TagLog::FLOAT32 }, { "ROU", TagLog::FLOAT32 } },
+                        [](const ROI::Tag* tag, TagLog::Fields* f) {
+                          f->Put((float)tag->roi);
+                          f->Put((float)tag->rou);
+                        });
+  log->AddTag<StdDev::Tag>("StdDev", { { "Mean", TagLog::FLOAT32 }, { "Standard Deviation", TagLog::FLOAT32 } },
+                           [](const StdDev::Tag* tag, TagLog::Fields* f) {
+                             f->Put((float)tag->mean);
+                             f->Put((float)tag->stddev);
+                           });
+  log->AddTag<InvertROI::Tag>("InvertROI",
+                              { { "ROI Mean", TagLog::FLOAT32 }, { "ROI Standard Deviation", TagLog::FLOAT32 } },
+                              [](const InvertROI::Tag* tag, TagLog::Fields* f) {
+                                f->Put((float)tag->mean);
+                                f->Put((float)tag->stddev);
+                              });
+  log->AddTag<FilterDev::Tag>("FilterDev",
+                              { { "Filtered Mean", TagLog::FLOAT32 },
+                                { "Filtered Standard Deviation", TagLog::FLOAT32 },
+                                { "Saturated Pixels", TagLog::INT32 } },
+                              [](const FilterDev::Tag* tag, TagLog::Fields* f) {
+                                f->Put((float)tag->mean);
+                                f->Put((float)tag->stddev);
+                                f->Put((int32_t)tag->saturated);
+                              });
 }
 
-// FFTT
-template <>
-static const char* header<FFTT::Tag> = ", FFT Time(ms), FFTT Zero";
-template <>
-static void WriteCSV<FFTT::Tag>(const FFTT::Tag* tag, FILE* file) {
-  fprintf(file, ", %d, %.3le", tag->ms, tag->fft_zero);
-}
 
-// ROI
-template <>
-static const char* header<ROI::Tag> = ", ROI, ROU";
-template <>
-static void WriteCSV<ROI::Tag>(const ROI::Tag* tag, FILE* file) {
-  fprintf(file, ", %.3le, %.3le", tag->roi, tag->rou);
+TagLog& TagSave::Log() {
+  static TagLog log;
+  static std::once_flag once;
+  std::call_once(once, [] { AddStandardTags(&log); });
+  return log;
 }
 
-// StdDev
-template <>
-static const char* header<StdDev::Tag> = ", Mean, Standard Deviation";
-template <>
-static void WriteCSV<StdDev::Tag>(const StdDev::Tag* tag, FILE* file) {
-  fprintf(file, ", %.3le, %.3le", tag->mean, tag->stddev);
-}
 
-// invert ROI
-template <>
-static const char* header<InvertROI::Tag> = ", ROI Mean, ROI Standard Deviation";
-template <>
-static void WriteCSV<InvertROI::Tag>(const InvertROI::Tag* tag, FILE* file) {
-  fprintf(file, ", %.3le, %.3le", tag->mean, tag->stddev);
+int TagSave::SetFileName(std::string fname) {
+  return Log().Open(fname);
 }
 
-// FilterDev
-template <>
-static const char* header<FilterDev::Tag> =
-    ", Filtered Mean, Filtered Standard Deviation";
-template <>
-static void WriteCSV<FilterDev::Tag>(const FilterDev::Tag* tag, FILE* file) {
-  fprintf(file, ", %.3le, %.3le", tag->mean, tag->stddev);
-}
 
-template <typename T>
-void TagSave::WriteHeader(const Frame* fr) {
-  if (fr->GetTag<T>()) {
-    fprintf(file_, header<T>);
+// Console output when there is no log file: one CSV line per frame
+static void PrintCSV(const Frame* fr) {
+  static std::mutex mutex;
+  static TagLogReader format;
+  static std::vector<uint8_t> rec;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (rec.empty()) {
+    std::vector<uint8_t> header = TagSave::Log().Header();
+    format.SetHeader(header.data(), header.size());
+    rec.resize(TagSave::Log().RecordBytes());
+    printf("%s\n", format.CsvHeader().c_str());
   }
+  TagSave::Log().Encode(fr, rec.data());
+  printf("%s\n", format.Csv(rec.data()).c_str());
 }
 
-template <typename T>
-void TagSave::WriteCSV(const Frame* fr) {
-  if (T* tag = fr->GetTag<T>()) {
-    ::WriteCSV<T>(tag, file_);
-  }
-}
-
-
-void TagSave::SetFileName(std::string fname) {
-  file_ = fopen(fname.c_str(), "wx");
-  if (file_ == NULL) {
-    printf("Could not open csv for writing: %s\n", fname.c_str());
-    exit(1);
-  }
-}
 
 void* TagSave::Exec(void* data) {
   Frame* fr = (Frame*)data;
-  std::lock_guard<std::mutex> lock(mutex_);
-
-  if (write_header_) {
-    fprintf(file_, header<Frame>);
-    WriteHeader<FFTT::Tag>(fr);
-    WriteHeader<ROI::Tag>(fr);
-    WriteHeader<StdDev::Tag>(fr);
-    WriteHeader<InvertROI::Tag>(fr);
-    WriteHeader<FilterDev::Tag>(fr);
-    fputc('\n', file_);
-    write_header_ = false;
+  if (Log().IsOpen()) {
+    Log().Log(fr);
+  } else {
+    PrintCSV(fr);
   }
+  return data;
+}
 
-  // always write frame stats
-  ::WriteCSV<Frame>(fr, file_);
-  WriteCSV<FFTT::Tag>(fr);
-  WriteCSV<ROI::Tag>(fr);
-  WriteCSV<StdDev::Tag>(fr);
-  WriteCSV<InvertROI::Tag>(fr);
-  WriteCSV<FilterDev::Tag>(fr);
-  fputc('\n', file_);
-
-  if (ferror(file_)) {
-    printf("Error writing frame tags\n");
-    exit(1);
-  }
+// Live TagSave nodes sharing the log
+static std::mutex nodes_mutex;
+static int nodes = 0;
 
-  return data;
+TagSave::TagSave() {
+  std::lock_guard<std::mutex> lock(nodes_mutex);
+  ++nodes;
 }
 
 TagSave::~TagSave() {
-  std::lock_guard<std::mutex> lock(mutex_);
-  if (file_) {
-    fclose(file_);
-    file_ = NULL;
+  std::lock_guard<std::mutex> lock(nodes_mutex);
+  if (--nodes > 0) return;
+  if (Log().Close() != 0) {
+    printf("Error writing frame tags\n");
   }
 }
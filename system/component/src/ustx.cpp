@@ -5,44 +5,131 @@
 #include <cmath>
 #include <cstdint>
 #include <cstdio>
+#include <fstream>
+#include <functional>
 #include <string>
 #include <thread>
 
 using json = nlohmann::json;
 
-double USTx::ComputeDelay(double x, double z, int element) {
-  double x_d;
-  double z_d;
-  if (probe_.at(0) == 'L' || probe_.at(0) == 'B') {
-    // Standard linear array (typically 128 elements)
-    x_d = x - (element - (double)(n_elements_ - 1) / 2) * pitch_;
-    z_d = z;
+// Bump when the hex written for the same parameters changes
+static const uint32_t FOCUS_LIST_VERSION = 1;
 
-    // Limit number of elements based on f# or max angle
-    if (std::abs((x_d * 2) / z_d) > 1.0 / f_number_) return -1;
-
-  } else if (probe_.at(0) == 'P') {
-    // 64 element P4-2 array or 96 element P4-1 array
-    // typically use all elements, but can use maxElements field to further limit side lobes
-    x_d = x - (element - (double)(n_elements_ - 1) / 2) * pitch_;
-    z_d = z;
-    x_distances_[element] = abs(x_d);
+// Run fn(begin, end) over [0, n) in chunks, one per hardware thread
+static void ParallelFor(size_t n, const std::function<void(size_t, size_t)>& fn) {
+  size_t threads = std::max(1u, std::thread::hardware_concurrency());
+  threads = std::min(threads, (n + 63) / 64);  // not worth a thread for less
+  if (threads <= 1) {
+    fn(0, n);
+    return;
+  }
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < threads; ++t) {
+    workers.emplace_back(fn, n * t / threads, n * (t + 1) / threads);
+  }
+  for (std::thread& w : workers) w.join();
+}
 
+bool USTx::ComputeElementPositions(std::vector<double>& x, std::vector<double>& z) const {
+  x.assign(n_elements_, 0);
+  z.assign(n_elements_, 0);
+  if (probe_.at(0) == 'L' || probe_.at(0) == 'B' || probe_.at(0) == 'P') {
+    // Standard linear array (typically 128 elements),
+    //   64 element P4-2 array or 96 element P4-1 array
+    for (int element = 0; element < n_elements_; ++element) {
+      x[element] = (element - (double)(n_elements_ - 1) / 2) * pitch_;
+    }
   } else if (probe_.at(0) == 'C') {
-    // 128 element curvilinear C5-2 array; limit number of elements based on maxElements field
+    // 128 element curvilinear C5-2 array
     double scanAngle_rad = pitch_ * (double)(n_elements_ - 1) / (radius_);  // Angle subtended by curvilinear array
     double deltaAngle = scanAngle_rad / (double)(n_elements_ - 1);  // Angle subtended by individual element
-    double elementAngle = (-1.0 * scanAngle_rad / 2.0) + deltaAngle * (double)element;  // Angluar location from edge of array with center = 0
-    double elementXpos = radius_ * sin(elementAngle);
-    double elementZpos = radius_ * cos(elementAngle) - radius_;
-    x_d = x - elementXpos;
-    z_d = z - elementZpos;
-    x_distances_[element] = abs(x_d);
-
+    for (int element = 0; element < n_elements_; ++element) {
+      double elementAngle = (-1.0 * scanAngle_rad / 2.0) + deltaAngle * (double)element;  // Angluar location from edge of array with center = 0
+      x[element] = radius_ * sin(elementAngle);
+      z[element] = radius_ * cos(elementAngle) - radius_;
+    }
   } else {
     printf("Probe type not found: %s\n", probe_.c_str());
+    return false;
+  }
+  return true;
+}
+
+double USTx::ComputeDelays(double x, double z, const double* element_x, const double* element_z,
+                           double* delays) const {
+  // Linear arrays limit the number of elements based on f#.  Phased arrays
+  //   typically use all elements, and phased and curvilinear arrays are
+  //   limited to max_elements_ below.
+  double max_ratio = (probe_.at(0) == 'L' || probe_.at(0) == 'B') ? 1.0 / f_number_ : INFINITY;
+
+  // No branches, so this vectorises
+  for (int i = 0; i < n_elements_; ++i) {
+    double x_d = x - element_x[i];
+    double z_d = z - element_z[i];
+    double delay = sqrt(x_d * x_d + z_d * z_d) / speed_sound_;
+    delays[i] = std::abs((x_d * 2) / z_d) > max_ratio ? -1 : delay;
+  }
+  double max_delay = -1;
+  for (int i = 0; i < n_elements_; ++i) {
+    max_delay = std::max(max_delay, delays[i]);
+  }
+
+  // Limit number of elements used to create focus for curvilinear and phased arrays
+  if (probe_.at(0) == 'C') {
+    int min_element_index = 0;
+    for (int i = 1; i < n_elements_; ++i) {
+      if (std::abs(x - element_x[i]) < std::abs(x - element_x[min_element_index])) min_element_index = i;
+    }
+    int element_start = min_element_index - max_elements_ / 2;
+    int element_end = min_element_index + max_elements_ / 2;
+    if (element_start < 0) {
+      element_start = 0;
+      element_end = max_elements_ - 1;
+    }
+    if (element_end > n_elements_) {
+      element_end = n_elements_;
+      element_start = n_elements_ - max_elements_ - 1;
+    }
+
+    for (int i = 0; i < n_elements_; ++i) {
+      if (i < element_start || i > element_end) {
+        delays[i] = -1; // turns off that element
+      }
+    }
+  } else if (probe_.at(0) == 'B') {
+    for (int i = 0; i < n_elements_; ++i) {
+      if ((i == 0) || (i == 60) || (i == 67) || (i == 127)) {
+       // do nothing
+      } else {
+        delays[i] = -1;  // turns off all but those 4 elements
+      }
+    }
   }
-  return sqrt(x_d * x_d + z_d * z_d) / speed_sound_;
+  return max_delay;
+}
+
+bool USTx::UpdateDelays() {
+  size_t n_foci = coordinates_.size();
+  if (delays_computed_ == n_foci) return true;
+
+  std::vector<double> element_x, element_z;
+  if (!ComputeElementPositions(element_x, element_z)) return false;
+
+  size_t first = delays_computed_;
+  delays_.resize(n_foci * n_elements_);
+  std::vector<double> max_delays(n_foci - first);
+  ParallelFor(n_foci - first, [&](size_t begin, size_t end) {
+    for (size_t f = begin; f < end; ++f) {
+      const std::pair<double, double>& focus = coordinates_[first + f];
+      max_delays[f] = ComputeDelays(focus.first, focus.second, element_x.data(), element_z.data(),
+                                    &delays_[(first + f) * n_elements_]);
+    }
+  });
+  for (double delay : max_delays) {
+    if (delay > max_delay_) max_delay_ = delay;
+  }
+  delays_computed_ = n_foci;
+  return true;
 }
 
 template <typename T>
@@ -64,6 +151,11 @@ int USTx::LoadJson(const json& j) {
   LoadIfPresent<double>(j, "radius", radius_);
   LoadIfPresent<int>(j, "max_elements", max_elements_);
 
+  // Recompute delays for any foci already added with the new parameters
+  delays_.clear();
+  delays_computed_ = 0;
+  max_delay_ = -1;
+
   if (j.contains("foci")) {
     for (const json& focus : j["foci"]) {
       AddFocus(focus[0].get<double>(), focus[1].get<double>());
@@ -115,6 +207,15 @@ class USTx::LAD {
     ih.Write16(address_);
     ih.Write((uint8_t*)data_.data(), data_.size() * 4);
   }
+
+  // Copy out the bytes Write() would write
+  // @returns the end of the copy
+  uint8_t* Copy(uint8_t* out) const {
+    memcpy(out, &length_, 2);
+    memcpy(out + 2, &address_, 2);
+    memcpy(out + 4, data_.data(), data_.size() * 4);
+    return out + size();
+  }
 };
 
 // P4-1 element -> Verasonics pinmap
@@ -151,24 +252,106 @@ static const int PDN_MAP[32] = {16, 24, 17, 25, 18, 26, 19, 27, 20, 28, 21,
                                 29, 22, 30, 23, 31, 0,  8,  1,  9,  2,  10,
                                 3,  11, 4,  12, 5,  13, 6,  14, 7,  15};
 
-bool USTx::ComputeFoci(const char* hex_fname) {
-  if (cw_mode_) {
-    return ComputeCW(hex_fname);
+void USTx::ElementChannel(int element, int* chip, int* lane) const {
+  if (probe_ == "P4-2" && element > 31) {
+    // P4-2 probe has 64 adjacent elements, but they use Verasonics pins 1-32 and 97-128
+    *chip = verasonics_pinmap[element + 64] / 32;
+    *lane = verasonics_pinmap[element + 64] % 32;
+  } else if (probe_ == "P4-1") {
+    // P4-1 probe has 96 adjacent elements but they use the Verasonics pins in an order defined by p4_1_elementmap
+    *chip = verasonics_pinmap[p4_1_elementmap[element]] / 32;
+    *lane = verasonics_pinmap[p4_1_elementmap[element]] % 32;
   } else {
-    return ComputePulsed(hex_fname);
+    *chip = verasonics_pinmap[element] / 32;
+    *lane = verasonics_pinmap[element] % 32;
+  }
+}
+
+static bool WriteText(const std::string& fname, const std::string& text) {
+  FILE* fp = fopen(fname.c_str(), "w");
+  if (fp == NULL) return false;
+  bool ok = fwrite(text.data(), 1, text.size(), fp) == text.size();
+  return fclose(fp) == 0 && ok;
+}
+
+static bool CopyFile(const std::string& from, const std::string& to) {
+  std::ifstream in(from, std::ios::binary);
+  if (!in) return false;
+  std::ofstream out(to, std::ios::binary);
+  out << in.rdbuf();
+  return (bool)out;
+}
+
+uint64_t USTx::FociHash() const {
+  // FNV-1a
+  uint64_t hash = 14695981039346656037ull;
+  auto add = [&hash](const void* data, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+      hash ^= ((const uint8_t*)data)[i];
+      hash *= 1099511628211ull;
+    }
+  };
+  add(&FOCUS_LIST_VERSION, sizeof(FOCUS_LIST_VERSION));
+  size_t probe_len = probe_.size();
+  add(&probe_len, sizeof(probe_len));
+  add(probe_.data(), probe_len);
+  add(&n_elements_, sizeof(n_elements_));
+  add(&pitch_, sizeof(pitch_));
+  add(&radius_, sizeof(radius_));
+  add(&max_elements_, sizeof(max_elements_));
+  add(&f_number_, sizeof(f_number_));
+  add(&speed_sound_, sizeof(speed_sound_));
+  add(&frequency_, sizeof(frequency_));
+  add(&waveforms_, sizeof(waveforms_));
+  add(&repeat_count_, sizeof(repeat_count_));
+  add(&repeat_time_, sizeof(repeat_time_));
+  add(&cw_mode_, sizeof(cw_mode_));
+  add(coordinates_.data(), coordinates_.size() * sizeof(coordinates_[0]));
+  return hash;
+}
+
+bool USTx::ComputeFoci(const char* hex_fname) {
+  // GetDelay() needs the delays, even if the focus list is cached
+  if (!UpdateDelays()) return false;
+
+  std::string cached;
+  if (!cache_dir_.empty()) {
+    char name[32];
+    snprintf(name, sizeof(name), "/ustx_%016llx.hex", (unsigned long long)FociHash());
+    cached = cache_dir_ + name;
+    if (CopyFile(cached, hex_fname)) {
+      printf("Using cached focus list %s\n", cached.c_str());
+      return true;
+    }
+  }
+
+  // Build the hex in memory, and write it out in one go
+  IntelHex ih;
+  ih.Open();
+  bool ok = cw_mode_ ? ComputeCW(ih) : ComputePulsed(ih);
+  if (!ok) return false;
+  ih.Close();
+
+  if (!WriteText(hex_fname, ih.Text())) {
+    printf("Could not write: %s\n", hex_fname);
+    return false;
+  }
+  // Write then rename, so a half written file is never used
+  if (!cached.empty()) {
+    std::string tmp = cached + ".tmp";
+    if (!WriteText(tmp, ih.Text()) || std::rename(tmp.c_str(), cached.c_str()) != 0) {
+      printf("Could not cache focus list %s\n", cached.c_str());
+      std::remove(tmp.c_str());
+    }
   }
+  return true;
 }
 
-void USTx::WriteHeader(const std::vector<LAD>& init,
-                       const std::vector<LAD>& focus, IntelHex& ih) {
+void USTx::WriteHeader(const std::vector<LAD>& init, int focus_len, IntelHex& ih) {
   int init_len = 0;
   for (const LAD& record : init) {
     init_len += record.size();
   }
-  int focus_len = 0;
-  for (const LAD& record : focus) {
-    focus_len += record.size();
-  }
 
   // This must be kept in sync with how the USTx reads the intel hex file.
   ih.Write32(0x12345678);      // magic number
@@ -176,7 +359,7 @@ void USTx::WriteHeader(const std::vector<LAD>& init,
   ih.Write32(init_len);        // length of the initialization registers
   ih.Write32(256 + init_len);  // first focus address
   ih.Write32(focus_len);       // length of a focus
-  ih.Write32(delays_.size());  // number of focii
+  ih.Write32(coordinates_.size());  // number of focii
   ih.Write32(cw_mode_);        // cw mode
   ih.SetAddress(256);
 
@@ -185,7 +368,39 @@ void USTx::WriteHeader(const std::vector<LAD>& init,
   }
 }
 
-bool USTx::ComputeCW(const char* hex_fname) {
+bool USTx::WriteFoci(const std::vector<LAD>& init, IntelHex& ih,
+                     const std::function<bool(size_t, std::vector<LAD>&)>& make_focus) {
+  size_t n_foci = coordinates_.size();
+  if (n_foci == 0) return true;
+
+  // Every focus has the same records, so the same length
+  std::vector<LAD> focus;
+  if (!make_focus(0, focus)) return false;
+  int focus_len = 0;
+  for (const LAD& record : focus) focus_len += record.size();
+
+  std::vector<uint8_t> records(n_foci * focus_len);
+  std::vector<char> failed(n_foci, 0);
+  ParallelFor(n_foci, [&](size_t begin, size_t end) {
+    std::vector<LAD> focus;
+    for (size_t f = begin; f < end; ++f) {
+      focus.clear();
+      if (!make_focus(f, focus)) {
+        failed[f] = 1;
+        return;
+      }
+      uint8_t* out = &records[f * focus_len];
+      for (const LAD& record : focus) out = record.Copy(out);
+    }
+  });
+  if (std::find(failed.begin(), failed.end(), 1) != failed.end()) return false;
+
+  WriteHeader(init, focus_len, ih);
+  ih.Write(records.data(), records.size());
+  return true;
+}
+
+bool USTx::ComputeCW(IntelHex& ih) {
   int clk_div = round(log2(CLK_FREQ / frequency_ / 16));
   if (clk_div < 0 || clk_div > 7) {
     printf("Unsupported clock frequency: %.1lf\n", frequency_);
@@ -204,32 +419,16 @@ bool USTx::ComputeCW(const char* hex_fname) {
   // TR switches off
   init.push_back(LAD(0x1A, {0xFFFFFFFF}, 4));
 
-  IntelHex ih;
-  if (ih.Open(hex_fname) != 0) {
-    printf("Could not open: %s\n", hex_fname);
-    return false;
-  }
+  return WriteFoci(init, ih, [&](size_t f, std::vector<LAD>& focus) {
+    const double* delay_profile = &delays_[f * n_elements_];
 
-  bool write_header = true;
-  for (std::vector<double>& delay_profile : delays_) {
     // compute per-channel delays
     std::vector<uint32_t> profile(4 * 16, 0);
     std::vector<uint32_t> aperture(4, (uint32_t)0xFFFFFFFF);
     for (int i = 0; i < n_elements_; ++i) {
       int chip;
       int lane;
-      if (probe_ == "P4-2" && i > 31) {
-        // P4-2 probe has 64 adjacent elements, but they use Verasonics pins 1-32 and 97-128
-        chip = verasonics_pinmap[i + 64] / 32;
-        lane = verasonics_pinmap[i + 64] % 32;
-      } else if (probe_ == "P4-1") {
-        // P4-1 probe has 96 adjacent elements but they use the Verasonics pins in an order defined by p4_1_elementmap
-        chip = verasonics_pinmap[p4_1_elementmap[i]] / 32;
-        lane = verasonics_pinmap[p4_1_elementmap[i]] % 32;
-      } else {
-        chip = verasonics_pinmap[i] / 32;
-        lane = verasonics_pinmap[i] % 32;
-      }
+      ElementChannel(i, &chip, &lane);
 
       if (delay_profile[i] >= 0) {
         aperture[chip] &= ~(1 << PDN_MAP[lane]);
@@ -239,31 +438,15 @@ bool USTx::ComputeCW(const char* hex_fname) {
     }
 
     // make a focus with above registers
-    std::vector<LAD> focus;
     focus.push_back(LAD(0x1B, aperture));
     focus.push_back(LAD(0x20, profile));
-
-    if (write_header) {
-      write_header = false;
-      WriteHeader(init, focus, ih);
-    }
-
-    for (const LAD& record : focus) {
-      record.Write(ih);
-    }
-  }
-
-  if (ih.Close() != 0) {
-    printf("Could not finish writing file %s\n", hex_fname);
-    return false;
-  }
-
-  return true;
+    return true;
+  });
 }
 
 // This function translates between physical parameters (frequency, time)
 //   and TX7332 registers.
-bool USTx::ComputePulsed(const char* hex_fname) {
+bool USTx::ComputePulsed(IntelHex& ih) {
   // compute the pattern
   // a 3rd order harmonic elimination square wave has 6 parts
   // HHGLLG (H = high, G = ground, L = low)
@@ -357,14 +540,13 @@ bool USTx::ComputePulsed(const char* hex_fname) {
   }
   init.push_back(LAD(0x120, pattern, 4));
 
-  IntelHex ih;
-  if (ih.Open(hex_fname) != 0) {
-    printf("Could not open: %s\n", hex_fname);
-    return false;
-  }
+  // element whose delay is too long, by focus
+  std::vector<int> too_long(coordinates_.size(), -1);
+  bool ok = WriteFoci(init, ih, [&](size_t f, std::vector<LAD>& focus) {
+    // delays from the trigger, rather than to the focus
+    std::vector<double> delay_profile(delays_.begin() + f * n_elements_,
+                                      delays_.begin() + (f + 1) * n_elements_);
 
-  bool write_header = true;
-  for (std::vector<double>& delay_profile : delays_) {
     // determine the minimum delay for this focus
     double min_delay = 1e9;
     for (double& delay : delay_profile) {
@@ -384,26 +566,13 @@ bool USTx::ComputePulsed(const char* hex_fname) {
     for (int i = 0; i < n_elements_; ++i) {
       int chip;
       int lane;
-      if (probe_ == "P4-2" && i > 31) {
-        // P4-2 probe has 64 adjacent elements, but they use Verasonics pins 1-32 and 97-128
-        chip = verasonics_pinmap[i + 64] / 32;
-        lane = verasonics_pinmap[i + 64] % 32;
-      } else if (probe_ == "P4-1") {
-        // P4-1 probe has 96 adjacent elements but they use the Verasonics pins in an order defined by p4_1_elementmap
-        chip = verasonics_pinmap[p4_1_elementmap[i]] / 32;
-        lane = verasonics_pinmap[p4_1_elementmap[i]] % 32;
-      } else {
-        chip = verasonics_pinmap[i] / 32;
-        lane = verasonics_pinmap[i] % 32;
-      }
+      ElementChannel(i, &chip, &lane);
 
       if (delay_profile[i] >= 0) {
         aperture[chip] &= ~(1 << PDN_MAP[lane]);
         uint32_t reg = round((delay_profile[i] - common_delay) * CLK_FREQ);
         if (reg > 0x1FFF) {
-          printf("Requsted delay too long: %d %e\n", i, delay_profile[i]);
-          max_delay_ = -1;
-          ih.Close();
+          too_long[f] = i;
           return false;
         }
         profile[chip * 16 + PROF_MAP[lane][0]] |= reg << PROF_MAP[lane][1];
@@ -411,25 +580,20 @@ bool USTx::ComputePulsed(const char* hex_fname) {
     }
 
     // make a focus with above registers
-    std::vector<LAD> focus;
     focus.push_back(LAD(0x18, {(glbl_delay << 18) | (clk_div << 3) | 0x3}, 4));
     focus.push_back(LAD(0x1B, aperture));
     focus.push_back(LAD(0x20, profile));
-
-    // write out the initalization data if we haven't already
-    // this is done here in case the focus length changes
-    if (write_header) {
-      write_header = false;
-      WriteHeader(init, focus, ih);
-    }
-
-    for (const LAD& record : focus) {
-      record.Write(ih);
+    return true;
+  });
+
+  if (!ok) {
+    for (size_t f = 0; f < too_long.size(); ++f) {
+      if (too_long[f] < 0) continue;
+      int i = too_long[f];
+      printf("Requsted delay too long: %d %e\n", i, TR_DEL + max_delay_ - delays_[f * n_elements_ + i]);
+      break;
     }
-  }
-
-  if (ih.Close() != 0) {
-    printf("Could not finish writing file %s\n", hex_fname);
+    max_delay_ = -1;
     return false;
   }
 
@@ -438,47 +602,10 @@ bool USTx::ComputePulsed(const char* hex_fname) {
 
 void USTx::AddFocus(double x, double z) {
   coordinates_.push_back(std::pair<double, double>(x, z));
-  x_distances_.resize(n_elements_);
-
-  std::vector<double> pattern(n_elements_);
-  for (int i = 0; i < n_elements_; ++i) {
-    pattern[i] = ComputeDelay(x, z, i);
-    if (pattern[i] > max_delay_) max_delay_ = pattern[i];
-  }
-
-  // Limit number of elements used to create focus for curvilinear and phased arrays
-  if (probe_.at(0) == 'C') { 
-    int min_element_index = std::min_element(x_distances_.begin(), x_distances_.end()) - x_distances_.begin();
-    int element_start = min_element_index - max_elements_ / 2;
-    int element_end = min_element_index + max_elements_ / 2;
-    if (element_start < 0) {
-      element_start = 0;
-      element_end = max_elements_ - 1;
-    }
-    if (element_end > n_elements_) {
-      element_end = n_elements_;
-      element_start = n_elements_ - max_elements_ - 1;
-    }
-
-    for (int i = 0; i < n_elements_; ++i) {
-      if (i < element_start || i > element_end) {
-        pattern[i] = -1; // turns off that element
-      }
-    }
-  }
-  else if (probe_.at(0) == 'B') {
-    for (int i = 0; i < n_elements_; ++i) {
-      if ((i == 0) || (i == 60) || (i == 67) || (i == 127)) {
-       // do nothing 
-      } else {
-        pattern[i] = -1;  // turns off all but those 4 elements
-      }
-    }
-  } 
-  delays_.push_back(pattern);
 }
 
 double USTx::GetDelay() {
+  UpdateDelays();
   // From datasheet Figure 54.
   return max_delay_ + 123.0 / CLK_FREQ + T_PROP + TR_DEL;
 }
@@ -1,5 +1,7 @@
 #include "system/component/inc/zoomable.h"
 
+#include <algorithm>
+
 
 void Zoomable::setViewport(const sf::FloatRect& viewport) {
   view_.setViewport(viewport);
@@ -50,7 +52,11 @@ sf::Vector2f Zoomable::FractionalPosition(sf::Vector2f rel) {
 
 
 void Zoomable::draw(sf::RenderTarget& target, sf::RenderStates states) const {
-  std::lock_guard<std::mutex> lock(lock_);
+  sf::Vector2u size = target.getSize();
+  const sf::FloatRect& viewport = view_.getViewport();
+  float x = view_.getSize().x / (viewport.width * size.x);
+  float y = view_.getSize().y / (viewport.height * size.y);
+  px_per_screen_px_ = std::max(1, (int)std::min(x, y));
   target.setView(view_);
   for (sf::Drawable* dr : objs_) {
     target.draw(*dr, states);
@@ -0,0 +1,72 @@
+#include <cstring>
+#include <vector>
+
+#include "googletest/googletest/include/gtest/gtest.h"
+#include "system/component/inc/bitpack.h"
+
+// Per-pixel packer that Frame::Write used before the grouped kernels.
+// Kept as the reference for the MATLAB bit order.
+static void LegacyPack(const uint16_t* in, int width, int bits, uint8_t* line_data) {
+  int line_len = (int)BitPack::RowBytes(width, bits);
+  uint8_t* line_ptr = line_data;
+  memset(line_data, 0, line_len);
+  int shift = 0;
+  for (int i = 0; i < width; ++i) {
+    shift += bits;
+    while (true) {
+      int s = shift - 8;
+      *line_ptr |= s >= 0 ? uint8_t(in[i] >> s) : uint8_t(in[i] << (-s));
+      if (shift >= 8) {
+        ++line_ptr;
+        shift -= 8;
+        if (shift == 0) break;
+      } else {
+        break;
+      }
+    }
+  }
+}
+
+static std::vector<uint16_t> Pixels(int n, int bits) {
+  std::vector<uint16_t> px(n);
+  uint32_t x = 12345;
+  for (int i = 0; i < n; ++i) {
+    x = x * 1103515245 + 12345;
+    px[i] = (x >> 8) & ((1 << bits) - 1);
+  }
+  return px;
+}
+
+TEST(TestBitPack, MatchesLegacyPacking) {
+  for (int bits = 1; bits < 16; ++bits) {
+    for (int width : { 1, 2, 3, 4, 5, 7, 8, 13, 64, 2712 }) {
+      std::vector<uint16_t> px = Pixels(width, bits);
+      size_t len = BitPack::RowBytes(width, bits);
+      std::vector<uint8_t> expected(len), packed(len);
+      LegacyPack(px.data(), width, bits, expected.data());
+      BitPack::PackMsb(px.data(), width, bits, packed.data());
+      ASSERT_EQ(expected, packed) << bits << " bits, width " << width;
+    }
+  }
+}
+
+TEST(TestBitPack, UnpackInvertsPack) {
+  for (int bits = 1; bits <= 16; ++bits) {
+    for (int width : { 1, 3, 4, 9, 2712 }) {
+      std::vector<uint16_t> px = Pixels(width, bits), out(width);
+      std::vector<uint8_t> packed(BitPack::RowBytes(width, bits));
+      BitPack::PackMsb(px.data(), width, bits, packed.data());
+      BitPack::UnpackMsb(packed.data(), width, bits, out.data());
+      ASSERT_EQ(px, out) << bits << " bits, width " << width;
+    }
+  }
+}
+
+TEST(TestBitPack, PackIgnoresHighBits) {
+  uint16_t px[4] = { 0xffff, 0, 0, 0 };
+  uint8_t packed[5];
+  BitPack::PackMsb(px, 4, 10, packed);
+  ASSERT_EQ(0xff, packed[0]);
+  ASSERT_EQ(0xc0, packed[1]);
+  ASSERT_EQ(0, packed[2]);
+}
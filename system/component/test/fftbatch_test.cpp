@@ -0,0 +1,81 @@
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "googletest/googletest/include/gtest/gtest.h"
+#include "system/component/inc/fftbatch.h"
+#include "system/component/inc/time.h"
+
+static void Fill(double* in, int n, int seed) {
+  for (int i = 0; i < n; ++i) in[i] = (i * 7 + seed * 13) % 17;
+}
+
+TEST(TestFFTBatch, MatchesSingleTransforms) {
+  const int w = 8, h = 6, n_frames = 12;
+  FFTBatch batch(w, h, 4, 1000, 1, FFTW_ESTIMATE);
+  int fft_sz = batch.FftWidth() * batch.FftHeight();
+
+  std::vector<std::vector<double>> power(n_frames, std::vector<double>(fft_sz));
+  std::vector<std::thread> threads;
+  for (int f = 0; f < n_frames; ++f) {
+    threads.emplace_back([&, f] {
+      batch.Transform([&](double* in) { Fill(in, w * h, f); },
+                      [&](const fftw_complex* out) {
+                        for (int i = 0; i < fft_sz; ++i) power[f][i] = out[i][0] * out[i][0] + out[i][1] * out[i][1];
+                      });
+    });
+  }
+  for (std::thread& t : threads) t.join();
+
+  double* in = fftw_alloc_real(w * h);
+  fftw_complex* out = fftw_alloc_complex(fft_sz);
+  fftw_plan plan = fftw_plan_dft_r2c_2d(h, w, in, out, FFTW_ESTIMATE);
+  for (int f = 0; f < n_frames; ++f) {
+    Fill(in, w * h, f);
+    fftw_execute_dft_r2c(plan, in, out);
+    for (int i = 0; i < fft_sz; ++i) {
+      ASSERT_NEAR(out[i][0] * out[i][0] + out[i][1] * out[i][1], power[f][i], 1e-6) << f << " " << i;
+    }
+  }
+  fftw_destroy_plan(plan);
+  fftw_free(in);
+  fftw_free(out);
+  ASSERT_EQ(n_frames, batch.GetStats().frames);
+}
+
+TEST(TestFFTBatch, BatchesFramesArrivingTogether) {
+  const int w = 16, h = 8, n_frames = 7;
+  FFTBatch batch(w, h, 8, 10000, 1, FFTW_ESTIMATE);
+  std::atomic<bool> hold(true);
+  std::atomic<int> done(0);
+  auto transform = [&](bool first) {
+    batch.Transform([&](double* in) {
+                      Fill(in, w * h, 0);
+                      while (first && hold) Component::SleepMs(1);
+                    },
+                    [&](const fftw_complex*) { ++done; });
+  };
+
+  // The first frame's batch stays open while it copies in, and the rest join it
+  std::vector<std::thread> threads;
+  threads.emplace_back(transform, true);
+  Component::SleepMs(20);
+  for (int f = 1; f < n_frames; ++f) threads.emplace_back(transform, false);
+  Component::SleepMs(50);
+  hold = false;
+  for (std::thread& t : threads) t.join();
+
+  FFTBatch::Stats stats = batch.GetStats();
+  ASSERT_EQ(n_frames, done);
+  ASSERT_EQ(n_frames, stats.frames);
+  ASSERT_LT(stats.batches, n_frames);
+  ASSERT_GT(stats.largest, 1);
+}
+
+TEST(TestFFTBatch, LimitFollowsLatency) {
+  FFTBatch batch(16, 8, 4, 0, 1, FFTW_ESTIMATE);
+  ASSERT_EQ(4, batch.Limit());  // Nothing measured yet
+  batch.Transform([](double* in) { Fill(in, 16 * 8, 0); }, [](const fftw_complex*) {});
+  ASSERT_EQ(1, batch.Limit());
+}
@@ -0,0 +1,142 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "googletest/googletest/include/gtest/gtest.h"
+#include "system/component/inc/fftpool.h"
+#include "system/component/inc/time.h"
+
+// The per-frame computation as RealTimeFFT did it before FFTPool: a thread
+// started for each frame
+struct Legacy {
+  Legacy(int h_sz, int v_sz) : h_sz(h_sz), v_sz(v_sz), sz((h_sz / 2 + 1) * v_sz) {
+    in = fftw_alloc_real(h_sz * v_sz);
+    out = fftw_alloc_complex(sz);
+    px.assign(sz, 0xFF000000);
+    plan = fftw_plan_dft_r2c_2d(v_sz, h_sz, in, out, FFTW_ESTIMATE);
+  }
+  ~Legacy() {
+    fftw_destroy_plan(plan);
+    fftw_free(in);
+    fftw_free(out);
+  }
+
+  void Compute(const Frame* fr, const FFTPool::Mask& mask, double m, double b) {
+    for (int i = 0; i < h_sz * v_sz; ++i) in[i] = fr->data[i];
+    std::thread thread([&] {
+      fftw_execute_dft_r2c(plan, in, out);
+      max = 0;
+      double roi = 0;
+      double rou = 0;
+      for (int i = 0; i < sz; ++i) {
+        double res = out[i][0] * out[i][0] + out[i][1] * out[i][1];
+        res = log(res + 1);
+        roi += res * mask.roi[i];
+        rou += res * mask.rou[i];
+        if (res > max) max = res;
+        out[i][0] = res;
+      }
+      power = roi / rou;
+      for (int i = 0; i < sz; ++i) {
+        double res = (out[i][0] - b) * m;
+        if (res < 0) res = 0;
+        if (res > 255) res = 255;
+        memset(&px[i], (uint8_t)res, 3);
+      }
+    });
+    thread.join();
+  }
+
+  int h_sz, v_sz, sz;
+  double* in;
+  fftw_complex* out;
+  fftw_plan plan;
+  std::vector<uint32_t> px;
+  double max = 0;
+  double power = 0;
+};
+
+static void Fill(Frame* fr, int seed) {
+  for (int i = 0; i < fr->width * fr->height; ++i) {
+    fr->data[i] = (uint16_t)((i * 7 + seed * 13 + (i / fr->width) * seed) % 1024);
+  }
+}
+
+TEST(TestFFTPool, MatchesPerFrameThreads) {
+  const int W = 24;
+  const int H = 16;
+  FFTPool pool(W, H, 2, FFTW_ESTIMATE);
+  pool.SetMask(4, 4, 3);
+  pool.SetRange(true, 1.0, 20.0);
+  Legacy legacy(W, H);
+  std::shared_ptr<const FFTPool::Mask> mask = pool.GetMask();
+
+  Frame fr(W, H);
+  for (int seed = 0; seed < 4; ++seed) {
+    Fill(&fr, seed);
+    ASSERT_TRUE(pool.Submit(&fr));
+    ASSERT_TRUE(pool.Wait());
+    const FFTPool::Result* res = pool.Collect();
+    ASSERT_NE(nullptr, res);
+    ASSERT_EQ((uint64_t)seed, res->frame);
+
+    legacy.Compute(&fr, *mask, 255 / (20.0 - 1.0), 1.0);
+    ASSERT_EQ(legacy.max, res->max);
+    ASSERT_EQ(legacy.power, res->power);
+    ASSERT_EQ(0, memcmp(legacy.px.data(), res->px, legacy.px.size() * sizeof(uint32_t)));
+  }
+  ASSERT_EQ(nullptr, pool.Collect());
+}
+
+TEST(TestFFTPool, DropsFramesWhenBusyAndReturnsNewest) {
+  FFTPool pool(16, 8, 1, FFTW_ESTIMATE);
+  Frame fr(16, 8);
+  Fill(&fr, 1);
+  // One worker, one buffer in flight, one waiting on it: the third has nowhere to go
+  ASSERT_TRUE(pool.Submit(&fr));
+  ASSERT_TRUE(pool.Submit(&fr));
+  ASSERT_FALSE(pool.Submit(&fr));
+  ASSERT_TRUE(pool.Wait());
+  const FFTPool::Result* res = pool.Collect();
+  ASSERT_NE(nullptr, res);
+  ASSERT_EQ(1u, res->frame);
+  ASSERT_TRUE(pool.Submit(&fr));  // The older result went back to the pool
+  ASSERT_FALSE(pool.Submit(&fr));  // The shown one did not
+}
+
+// Frames per second through FFTPool against a thread per frame.  Small frames,
+// where starting a thread is a large part of the work
+TEST(TestFFTPool, Throughput) {
+  const int W = 32;
+  const int H = 32;
+  const int N = 200;
+  FFTPool pool(W, H, 2, FFTW_ESTIMATE);
+  std::shared_ptr<const FFTPool::Mask> mask = pool.GetMask();
+  Legacy legacy(W, H);
+  Frame fr(W, H);
+  Fill(&fr, 3);
+
+  int64_t start = Component::SteadyClockTimeUs();
+  for (int i = 0; i < N; ++i) legacy.Compute(&fr, *mask, 2.5, 0);
+  int64_t legacy_us = Component::SteadyClockTimeUs() - start;
+
+  start = Component::SteadyClockTimeUs();
+  int64_t compute_us = 0;
+  for (int submitted = 0; submitted < N;) {
+    if (pool.Submit(&fr)) {
+      ++submitted;
+    } else {
+      pool.Wait();
+    }
+    const FFTPool::Result* res = pool.Collect();
+    if (res) compute_us += res->us;
+  }
+  pool.Wait();
+  int64_t pool_us = Component::SteadyClockTimeUs() - start;
+
+  printf("thread per frame: %.0f frames/s\n", N * 1e6 / legacy_us);
+  printf("FFTPool:          %.0f frames/s\n", N * 1e6 / pool_us);
+  ASSERT_GT(compute_us, 0);
+}
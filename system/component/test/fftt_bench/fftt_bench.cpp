@@ -0,0 +1,86 @@
+// Measure FFT throughput against batch size K for our frame sizes
+// For each K: one fftw_plan_many_dft_r2c plan over K stacked frames, then
+//   FFTBatch (as FFTT uses it) fed by as many threads as ExecNode runs
+// Usage: fftt_bench [max K] [frames] [width height]
+//   without a size, runs 2712x2080, 2080x2712 and 1356x1040.  Wisdom is
+//   read from and saved to fftw.wis in the working directory
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "fftw3.h"
+
+#include "system/component/inc/fftbatch.h"
+#include "system/component/inc/time.h"
+
+static const int THREADS = 16;  // ExecNode::ThreadManager
+
+static void Fill(double* in, size_t n) {
+  for (size_t i = 0; i < n; ++i) in[i] = (double)((i * 7) & 1023);
+}
+
+// Frames/s transforming k stacked frames at a time on one thread
+static double PlanMany(int width, int height, int k, int frames) {
+  size_t in_dist = (size_t)width * height;
+  size_t out_dist = (size_t)(width / 2 + 1) * height;
+  double* in = fftw_alloc_real(in_dist * k);
+  fftw_complex* out = fftw_alloc_complex(out_dist * k);
+  int n[2] = { height, width };
+  fftw_plan plan = fftw_plan_many_dft_r2c(2, n, k, in, NULL, 1, (int)in_dist, out, NULL, 1, (int)out_dist,
+                                          FFTW_MEASURE);
+  Fill(in, in_dist * k);
+  fftw_execute(plan);  // Warm up
+
+  int reps = std::max(1, frames / k);
+  int64_t start = Component::SteadyClockTimeUs();
+  for (int i = 0; i < reps; ++i) fftw_execute(plan);
+  int64_t us = std::max<int64_t>(1, Component::SteadyClockTimeUs() - start);
+
+  fftw_destroy_plan(plan);
+  fftw_free(in);
+  fftw_free(out);
+  return reps * k * 1e6 / us;
+}
+
+// Frames/s through FFTBatch with up to k frames per batch, fed by THREADS threads
+static double Batched(int width, int height, int k, int frames, int* largest) {
+  FFTBatch batch(width, height, k, 1000);
+  size_t n = (size_t)width * height;
+  std::atomic<int> next(0);
+  int64_t start = Component::SteadyClockTimeUs();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < THREADS; ++t) {
+    threads.emplace_back([&] {
+      while (next++ < frames) batch.Transform([n](double* in) { Fill(in, n); }, [](const fftw_complex*) {});
+    });
+  }
+  for (std::thread& t : threads) t.join();
+  int64_t us = std::max<int64_t>(1, Component::SteadyClockTimeUs() - start);
+  *largest = batch.GetStats().largest;
+  return frames * 1e6 / us;
+}
+
+int main(int argc, char** argv) {
+  int max_k = argc > 1 ? atoi(argv[1]) : 4;
+  int frames = argc > 2 ? atoi(argv[2]) : 32;
+  std::vector<std::pair<int, int>> sizes = { { 2712, 2080 }, { 2080, 2712 }, { 1356, 1040 } };
+  if (argc > 4) sizes = { { atoi(argv[3]), atoi(argv[4]) } };
+
+  fftw_import_wisdom_from_filename("fftw.wis");
+  for (const std::pair<int, int>& size : sizes) {
+    for (int k = 1; k <= max_k; ++k) {
+      double many = PlanMany(size.first, size.second, k, frames);
+      int largest = 0;
+      double batched = Batched(size.first, size.second, k, frames, &largest);
+      printf("%4dx%-4d K=%d: plan_many %7.1f frames/s  FFTBatch %7.1f frames/s (largest batch %d)\n", size.first,
+             size.second, k, many, batched, largest);
+    }
+  }
+  fftw_export_wisdom_to_filename("fftw.wis");
+  return 0;
+}
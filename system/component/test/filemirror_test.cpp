@@ -0,0 +1,126 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "googletest/googletest/include/gtest/gtest.h"
+#include "system/component/inc/filemirror.h"
+
+static std::string TempName(const std::string& name) {
+  return "filemirror_test_" + name;
+}
+
+static std::vector<uint8_t> Bytes(size_t n, uint32_t seed) {
+  std::vector<uint8_t> v(n);
+  for (size_t i = 0; i < n; ++i) {
+    seed = seed * 1103515245 + 12345;
+    v[i] = (uint8_t)(seed >> 16);
+  }
+  return v;
+}
+
+static void WriteFile(const std::string& fname, const std::vector<uint8_t>& v) {
+  FILE* f = fopen(fname.c_str(), "wb");
+  fwrite(v.data(), 1, v.size(), f);
+  fclose(f);
+}
+
+static std::vector<uint8_t> ReadFile(const std::string& fname) {
+  std::vector<uint8_t> v;
+  FILE* f = fopen(fname.c_str(), "rb");
+  if (!f) return v;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) v.insert(v.end(), buf, buf + n);
+  fclose(f);
+  return v;
+}
+
+TEST(TestFileMirror, CopiesIntoNewDirectories) {
+  std::vector<uint8_t> a = Bytes(3 << 20, 1), b = Bytes(100, 2);
+  WriteFile(TempName("a"), a);
+  WriteFile(TempName("b"), b);
+  std::string dst = TempName("dst/sub/");
+  {
+    FileMirror mirror;
+    mirror.Copy(TempName("a"), dst + "a");
+    mirror.Copy(TempName("b"), dst + "b");
+    ASSERT_TRUE(mirror.Wait(10000));
+    FileMirror::Backlog backlog = mirror.GetBacklog();
+    ASSERT_EQ(0u, backlog.files_pending);
+    ASSERT_EQ(0u, backlog.bytes_pending);
+    ASSERT_EQ(2u, backlog.files_copied);
+    ASSERT_EQ(a.size() + b.size(), backlog.bytes_copied);
+    ASSERT_EQ(0, backlog.failures);
+  }
+  ASSERT_EQ(a, ReadFile(dst + "a"));
+  ASSERT_EQ(b, ReadFile(dst + "b"));
+  ASSERT_TRUE(ReadFile(dst + "a.part").empty());
+  for (const char* f : { "a", "b", "dst/sub/a", "dst/sub/b" }) remove(TempName(f).c_str());
+  remove(TempName("dst/sub").c_str());
+  remove(TempName("dst").c_str());
+}
+
+TEST(TestFileMirror, ResumesFromJournal) {
+  std::vector<uint8_t> a = Bytes(5 << 20, 3), b = Bytes(1000, 4);
+  WriteFile(TempName("ra"), a);
+  WriteFile(TempName("rb"), b);
+  // A previous run queued both, finished b, and was stopped part way into a
+  FILE* journal = fopen(TempName("journal").c_str(), "w");
+  fprintf(journal, "+\t%s\t%s\n", TempName("ra").c_str(), TempName("ra.copy").c_str());
+  fprintf(journal, "+\t%s\t%s\n", TempName("rb").c_str(), TempName("rb.copy").c_str());
+  fprintf(journal, "-\t%s\t%s\n", TempName("rb").c_str(), TempName("rb.copy").c_str());
+  fprintf(journal, "+\t%s", TempName("torn").c_str());
+  fclose(journal);
+  WriteFile(TempName("ra.copy.part"), std::vector<uint8_t>(a.begin(), a.begin() + (2 << 20)));
+  {
+    FileMirror mirror(TempName("journal"));
+    ASSERT_TRUE(mirror.Wait(10000));
+    FileMirror::Backlog backlog = mirror.GetBacklog();
+    ASSERT_EQ(1u, backlog.files_copied);
+    ASSERT_EQ(0, backlog.failures);
+  }
+  ASSERT_EQ(a, ReadFile(TempName("ra.copy")));
+  ASSERT_TRUE(ReadFile(TempName("rb.copy")).empty());  // already done, not copied again
+
+  // Nothing is left to do
+  {
+    FileMirror mirror(TempName("journal"));
+    ASSERT_TRUE(mirror.Wait(10000));
+    ASSERT_EQ(0u, mirror.GetBacklog().files_copied);
+  }
+  for (const char* f : { "ra", "rb", "ra.copy", "journal" }) remove(TempName(f).c_str());
+}
+
+TEST(TestFileMirror, RestartsCorruptPartialCopy) {
+  std::vector<uint8_t> a = Bytes(1 << 20, 5);
+  WriteFile(TempName("ca"), a);
+  WriteFile(TempName("ca.copy.part"), Bytes(1000, 6));  // not a prefix of a
+  {
+    FileMirror mirror(TempName("cjournal"));
+    mirror.Copy(TempName("ca"), TempName("ca.copy"));
+    ASSERT_TRUE(mirror.Wait(10000));
+    ASSERT_EQ(1u, mirror.GetBacklog().files_copied);
+  }
+  ASSERT_EQ(a, ReadFile(TempName("ca.copy")));
+  for (const char* f : { "ca", "ca.copy", "cjournal" }) remove(TempName(f).c_str());
+}
+
+TEST(TestFileMirror, CountsFailures) {
+  FileMirror mirror;
+  mirror.Copy(TempName("missing"), TempName("missing.copy"));
+  ASSERT_TRUE(mirror.Wait(10000));
+  FileMirror::Backlog backlog = mirror.GetBacklog();
+  ASSERT_EQ(1, backlog.failures);
+  ASSERT_EQ(0u, backlog.files_copied);
+}
+
+TEST(TestFileMirror, LimitsBandwidth) {
+  std::vector<uint8_t> a = Bytes(3 << 20, 7);
+  WriteFile(TempName("la"), a);
+  FileMirror mirror("", 10.0);
+  mirror.Copy(TempName("la"), TempName("la.copy"));
+  ASSERT_FALSE(mirror.Wait(100));  // 3 MB at 10 MB/s takes ~300 ms
+  ASSERT_TRUE(mirror.Wait(10000));
+  ASSERT_LT(mirror.GetBacklog().mb_per_s, 15.0);
+  for (const char* f : { "la", "la.copy" }) remove(TempName(f).c_str());
+}
@@ -1,3 +1,7 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+
 #include "googletest/googlemock/include/gmock/gmock.h"
 #include "googletest/googletest/include/gtest/gtest.h"
 #include "system/component/inc/frame.h"
@@ -17,6 +21,8 @@ class MockTiff : public TiffInterface {
   MOCK_METHOD2(SetField, int(ttag_t tag, int value));
   MOCK_METHOD2(ReadScanline, int(tdata_t buf, uint32 row));
   MOCK_METHOD2(WriteScanline, int(tdata_t buf, uint32 row));
+  MOCK_METHOD3(ReadEncodedStrip, int(uint32 strip, tdata_t buf, int size));
+  MOCK_METHOD3(WriteEncodedStrip, int(uint32 strip, tdata_t buf, int size));
   MOCK_METHOD0(WriteDirectory, int());
 };
 
@@ -88,21 +94,33 @@ TEST(TestFrame, WriteFailsWhenSetFieldFails) {
 }
 #endif
 
-TEST(TestFrame, WriteFailsWhenWriteScanlineFails) {
+TEST(TestFrame, WriteFailsWhenWriteStripFails) {
   testing::NiceMock<MockTiff> mockTiff;
   FrameTest test(&mockTiff);
   EXPECT_CALL(mockTiff, Open(_, _)).Times(1).WillOnce(Return(true));
   EXPECT_CALL(mockTiff, SetField(_, _)).Times(12).WillRepeatedly(Return(1));
-  EXPECT_CALL(mockTiff, WriteScanline(_, 0)).Times(1).WillOnce(Return(-1));
+  EXPECT_CALL(mockTiff, WriteEncodedStrip(0, _, _)).Times(1).WillOnce(Return(-1));
   ASSERT_EQ(-1, test.Write("foo"));
 }
 
+TEST(TestFrame, WriteIsOneStrip) {
+  testing::NiceMock<MockTiff> mockTiff;
+  FrameTest test(&mockTiff);
+  EXPECT_CALL(mockTiff, Open(_, _)).Times(1).WillOnce(Return(true));
+  EXPECT_CALL(mockTiff, SetField(_, _)).WillRepeatedly(Return(1));
+  EXPECT_CALL(mockTiff, SetField(TIFFTAG_ROWSPERSTRIP, 10)).Times(1).WillOnce(Return(1));
+  EXPECT_CALL(mockTiff, WriteScanline(_, _)).Times(0);
+  EXPECT_CALL(mockTiff, WriteEncodedStrip(0, _, 20 * 10 * 2)).Times(1).WillOnce(Return(20 * 10 * 2));
+  EXPECT_CALL(mockTiff, WriteDirectory()).Times(1).WillOnce(Return(1));
+  ASSERT_EQ(0, test.Write("foo"));
+}
+
 TEST(TestFrame, WriteFailsWhenWriteDirectoryFails) {
   testing::NiceMock<MockTiff> mockTiff;
   FrameTest test(&mockTiff);
   EXPECT_CALL(mockTiff, Open(_, _)).Times(1).WillOnce(Return(true));
   EXPECT_CALL(mockTiff, SetField(_, _)).Times(12).WillRepeatedly(Return(1));
-  EXPECT_CALL(mockTiff, WriteScanline(_, _)).Times(10).WillRepeatedly(Return(1));
+  EXPECT_CALL(mockTiff, WriteEncodedStrip(0, _, _)).Times(1).WillOnce(Return(20 * 10 * 2));
   EXPECT_CALL(mockTiff, WriteDirectory()).Times(1).WillOnce(Return(-1));
   ASSERT_EQ(-1, test.Write("foo"));
 }
@@ -149,3 +167,85 @@ TEST(TestFrame, ClearTagRemovesTags) {
   fr.ClearTags();
   EXPECT_EQ(fr.GetTag<TestTag>(), nullptr);
 }
+
+static std::string TempName(const char* name) {
+  const char* dir = getenv("TEST_TMPDIR");  // Set by bazel
+  return std::string(dir ? dir : ".") + "/" + name;
+}
+
+static void FillFrame(Frame* fr, int bits) {
+  fr->bits = bits;
+  for (int i = 0; i < fr->width * fr->height; ++i) {
+    fr->data[i] = (i * 2654435761u >> 7) & ((1 << bits) - 1);
+  }
+}
+
+TEST(TestFrame, WriteReadRoundTrip) {
+  std::string fname = TempName("frame_roundtrip.tiff");
+  for (int bits : { 8, 10, 12, 14, 16 }) {
+    Frame out(37, 11);  // Odd width: rows end part way through a byte
+    FillFrame(&out, bits);
+    ASSERT_EQ(0, out.Write(fname.c_str()));
+    Frame in;
+    ASSERT_EQ(0, in.Read(fname.c_str()));
+    ASSERT_EQ(bits, in.bits);
+    ASSERT_EQ(0, memcmp(out.data, in.data, 37 * 11 * sizeof(uint16_t))) << bits << " bits";
+  }
+  remove(fname.c_str());
+}
+
+TEST(TestFrame, CompressedRoundTrip) {
+  std::string fname = TempName("frame_compressed.tiff");
+  for (int codec : { Frame::COMPRESS_DEFLATE, Frame::COMPRESS_LZW }) {
+    for (int bits : { 8, 10, 12, 16 }) {
+      Frame out(64, 48);
+      out.bits = bits;
+      for (int i = 0; i < 64 * 48; ++i) out.data[i] = (i % 64 + i / 64) & ((1 << bits) - 1);  // smooth ramp
+      out.compression = codec;
+      ASSERT_EQ(0, out.Write(fname.c_str()));
+      Frame in;
+      ASSERT_EQ(0, in.Read(fname.c_str()));
+      ASSERT_EQ(0, memcmp(out.data, in.data, 64 * 48 * sizeof(uint16_t))) << codec << ", " << bits << " bits";
+
+      FILE* f = fopen(fname.c_str(), "rb");
+      ASSERT_TRUE(f != NULL);
+      fseek(f, 0, SEEK_END);
+      long size = ftell(f);
+      fclose(f);
+      ASSERT_LT(size, 64 * 48 * bits / 8) << codec << ", " << bits << " bits";
+    }
+  }
+  remove(fname.c_str());
+}
+
+// Files from before whole-frame strips have one row per strip
+TEST(TestFrame, ReadsScanlineFiles) {
+  std::string fname = TempName("frame_scanline.tiff");
+  Frame expected(37, 11);
+  FillFrame(&expected, 16);
+  TIFF* tiff = TIFFOpen(fname.c_str(), "w");
+  ASSERT_TRUE(tiff != NULL);
+  TIFFSetField(tiff, TIFFTAG_IMAGEWIDTH, 37);
+  TIFFSetField(tiff, TIFFTAG_IMAGELENGTH, 11);
+  TIFFSetField(tiff, TIFFTAG_BITSPERSAMPLE, 16);
+  TIFFSetField(tiff, TIFFTAG_SAMPLESPERPIXEL, 1);
+  TIFFSetField(tiff, TIFFTAG_ROWSPERSTRIP, 1);
+  TIFFSetField(tiff, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK);
+  for (int j = 0; j < 11; ++j) TIFFWriteScanline(tiff, expected[j], j);
+  TIFFClose(tiff);
+
+  Frame in;
+  ASSERT_EQ(0, in.Read(fname.c_str()));
+  ASSERT_EQ(0, memcmp(expected.data, in.data, 37 * 11 * sizeof(uint16_t)));
+  remove(fname.c_str());
+}
+
+TEST(TestFrame, ReadFailsOnMismatchedFrame) {
+  std::string fname = TempName("frame_mismatch.tiff");
+  Frame out(37, 11);
+  FillFrame(&out, 16);
+  ASSERT_EQ(0, out.Write(fname.c_str()));
+  Frame in(11, 37);
+  ASSERT_EQ(-1, in.Read(fname.c_str()));
+  remove(fname.c_str());
+}
@@ -0,0 +1,145 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "googletest/googletest/include/gtest/gtest.h"
+#include "system/component/inc/bitpack.h"
+#include "system/component/inc/framefile.h"
+
+static std::string TempName(const char* name) {
+  const char* dir = getenv("TEST_TMPDIR");  // Set by bazel
+  return std::string(dir ? dir : ".") + "/" + name;
+}
+
+static void FillFrame(Frame* fr, int bits, int seq) {
+  for (int i = 0; i < fr->width * fr->height; ++i) {
+    fr->data[i] = (i * 37 + seq * 101) & ((1 << bits) - 1);
+  }
+  fr->bits = bits;
+  fr->seq = seq;
+  fr->serialNumber = 3;
+  fr->timestamp_ms_ = 1000 + seq;
+  fr->temperature = 25.5;
+}
+
+static void WriteFrames(const std::string& fname, int n, int bits, bool packed, int chunk_frames) {
+  FrameFileWriter writer;
+  ASSERT_EQ(0, writer.Open(fname.c_str(), 13, 7, bits, packed, chunk_frames, { "mean", "stddev" }));
+  Frame fr(13, 7);
+  for (int i = 0; i < n; ++i) {
+    FillFrame(&fr, bits, i);
+    FrameFile::Record r = FrameFile::MakeRecord(fr);
+    r.voxel[0] = i % 3;
+    r.values[0] = i * 0.5;
+    ASSERT_EQ(0, writer.Append(fr, r));
+  }
+  ASSERT_EQ(n, writer.Count());
+  ASSERT_EQ(0, writer.Close());
+}
+
+static void ExpectFrames(const std::string& fname, int n, int bits) {
+  FrameFileReader reader;
+  ASSERT_EQ(0, reader.Open(fname.c_str()));
+  ASSERT_EQ(n, reader.Count());
+  ASSERT_STREQ("stddev", reader.GetHeader().value_names[1]);
+  Frame expected(13, 7);
+  Frame fr;
+  for (int i = 0; i < n; ++i) {
+    FillFrame(&expected, bits, i);
+    ASSERT_EQ(0, reader.Read(i, &fr));
+    ASSERT_EQ(bits, fr.bits);
+    ASSERT_EQ(i, fr.seq);
+    ASSERT_EQ(3, fr.serialNumber);
+    ASSERT_EQ(1000 + i, fr.timestamp_ms_);
+    for (int p = 0; p < 13 * 7; ++p) ASSERT_EQ(expected.data[p], fr.data[p]);
+    ASSERT_EQ(i % 3, reader.GetRecord(i).voxel[0]);
+    ASSERT_EQ(-1, reader.GetRecord(i).voxel[1]);
+    ASSERT_EQ(i * 0.5, reader.GetRecord(i).values[0]);
+  }
+}
+
+TEST(TestFrameFile, PackedPayloadIsTiffRows) {
+  std::string fname = TempName("framefile_tiffrows.owf");
+  Frame fr(7, 3);
+  FillFrame(&fr, 10, 0);
+  FrameFileWriter writer;
+  ASSERT_EQ(0, writer.Open(fname.c_str(), 7, 3, 10, true));
+  ASSERT_EQ(0, writer.Append(fr));
+  ASSERT_EQ(0, writer.Close());
+
+  // Each row packed on its own, as Frame::Write() does for a TIFF strip
+  size_t row_bytes = BitPack::RowBytes(7, 10);
+  std::vector<uint8_t> expected(3 * row_bytes);
+  for (int j = 0; j < 3; ++j) BitPack::PackMsb(fr[j], 7, 10, expected.data() + j * row_bytes);
+
+  FrameFileReader reader;
+  ASSERT_EQ(0, reader.Open(fname.c_str()));
+  ASSERT_EQ(expected.size(), reader.GetHeader().frame_bytes);
+  uint32_t offset = reader.GetHeader().header_bytes;
+  reader.Close();
+  std::vector<uint8_t> payload(expected.size());
+  FILE* fp = fopen(fname.c_str(), "rb");
+  ASSERT_TRUE(fp != NULL);
+  ASSERT_EQ(0, fseek(fp, offset, SEEK_SET));
+  ASSERT_EQ(payload.size(), fread(payload.data(), 1, payload.size(), fp));
+  fclose(fp);
+  ASSERT_EQ(expected, payload);
+  remove(fname.c_str());
+}
+
+TEST(TestFrameFile, RoundTrip) {
+  std::string fname = TempName("framefile_roundtrip.owf");
+  WriteFrames(fname, 10, 16, false, 4);  // Two full chunks and a partial one
+  ExpectFrames(fname, 10, 16);
+  remove(fname.c_str());
+}
+
+TEST(TestFrameFile, PackedRoundTrip) {
+  std::string fname = TempName("framefile_packed.owf");
+  WriteFrames(fname, 8, 10, true, 4);  // Ends on a full chunk
+  ExpectFrames(fname, 8, 10);
+  remove(fname.c_str());
+}
+
+TEST(TestFrameFile, RawPointsIntoFile) {
+  std::string fname = TempName("framefile_raw.owf");
+  WriteFrames(fname, 3, 12, false, 2);
+  FrameFileReader reader;
+  ASSERT_EQ(0, reader.Open(fname.c_str()));
+  Frame expected(13, 7);
+  FillFrame(&expected, 12, 2);
+  const uint16_t* raw = reader.Raw(2);
+  ASSERT_TRUE(raw != NULL);
+  ASSERT_EQ(0, ((uintptr_t)raw) % FrameFile::kFrameAlign);
+  for (int p = 0; p < 13 * 7; ++p) ASSERT_EQ(expected.data[p], raw[p]);
+  reader.Close();
+  remove(fname.c_str());
+}
+
+TEST(TestFrameFile, RecoversCompleteChunksAfterCrash) {
+  std::string fname = TempName("framefile_crash.owf");
+  WriteFrames(fname, 10, 16, false, 4);
+
+  // Chop off the final (partial) chunk's index, as if the writer had died
+  std::ifstream in(fname, std::ios::binary);
+  std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  in.close();
+  bytes.resize(bytes.size() - 10);
+  std::ofstream out(fname, std::ios::binary | std::ios::trunc);
+  out.write(bytes.data(), bytes.size());
+  out.close();
+
+  ExpectFrames(fname, 8, 16);
+  remove(fname.c_str());
+}
+
+TEST(TestFrameFile, RejectsMismatchedFrames) {
+  std::string fname = TempName("framefile_mismatch.owf");
+  FrameFileWriter writer;
+  ASSERT_EQ(0, writer.Open(fname.c_str(), 13, 7, 16));
+  Frame fr(7, 13);
+  ASSERT_EQ(-1, writer.Append(fr));
+  writer.Close();
+  remove(fname.c_str());
+}
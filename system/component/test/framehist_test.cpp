@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "googletest/googletest/include/gtest/gtest.h"
+#include "system/component/inc/framehist.h"
+
+static void Fill(Frame* fr, int bits, uint32_t seed) {
+  fr->bits = bits;
+  for (int i = 0; i < fr->width * fr->height; ++i) {
+    seed = seed * 1103515245 + 12345;
+    fr->data[i] = (seed >> 8) & ((1 << bits) - 1);
+  }
+}
+
+TEST(TestFrameHist, MatchesDirectStatistics) {
+  Frame fr(37, 29);  // Odd pixel count exercises the tail loop
+  Fill(&fr, 10, 1);
+  fr.data[0] = 1023;
+  fr.data[1] = 1023;
+  fr.data[2] = 0;
+  FrameHist::Tag tag;
+  FrameHist::Compute(&fr, &tag);
+
+  int n = fr.width * fr.height;
+  ASSERT_EQ((uint64_t)n, tag.n);
+  ASSERT_EQ(0, tag.shift);
+  std::vector<uint16_t> px(fr.data, fr.data + n);
+  double sum = 0;
+  for (uint16_t v : px) sum += v;
+  double mean = sum / n;
+  double var = 0;
+  for (uint16_t v : px) var += (v - mean) * (v - mean);
+  ASSERT_NEAR(mean, tag.Mean(), 1e-9);
+  ASSERT_NEAR(sqrt(var / n), tag.StdDev(), 1e-9);
+
+  std::sort(px.begin(), px.end());
+  ASSERT_EQ(px[n / 2 - 1 + (n & 1)], tag.Percentile(0.5));
+  ASSERT_EQ(px[0], tag.Percentile(0.0));
+  ASSERT_EQ(px[n - 1], tag.Percentile(1.0));
+  ASSERT_EQ((uint64_t)std::count(px.begin(), px.end(), 1023), tag.saturated);
+  ASSERT_EQ((uint64_t)std::count(px.begin(), px.end(), 0), tag.zero);
+  ASSERT_DOUBLE_EQ((double)(tag.saturated + tag.zero) / n, tag.ClippedFraction());
+}
+
+TEST(TestFrameHist, CountsSaturationExactlyForDeepFrames) {
+  Frame fr(16, 16);
+  Fill(&fr, 12, 2);
+  for (int i = 0; i < 256; ++i) {
+    if (fr.data[i] >= 4092) fr.data[i] = 4091;  // Nothing in the top bin but what we add
+  }
+  fr.data[10] = 4095;
+  fr.data[11] = 4094;
+  FrameHist::Tag tag;
+  FrameHist::Compute(&fr, &tag);
+  ASSERT_EQ(2, tag.shift);
+  ASSERT_EQ(2u, tag.count[FrameHist::kBins - 1]);
+  ASSERT_EQ(1u, tag.saturated);
+  ASSERT_EQ(4095, tag.Percentile(1.0));
+}
+
+TEST(TestFrameHist, ClampsOutOfRangePixels) {
+  Frame fr(4, 1);
+  fr.bits = 10;
+  fr.data[0] = 0xffff;  // Garbage above the bit depth
+  fr.data[1] = 5;
+  fr.data[2] = 5;
+  fr.data[3] = 5;
+  FrameHist::Tag tag;
+  FrameHist::Compute(&fr, &tag);
+  ASSERT_EQ(1u, tag.count[FrameHist::kBins - 1]);
+  ASSERT_EQ(1u, tag.saturated);
+  ASSERT_EQ(5, tag.Percentile(0.75));
+}
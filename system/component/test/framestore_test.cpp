@@ -0,0 +1,237 @@
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include "googletest/googletest/include/gtest/gtest.h"
+#include "system/component/inc/framestore.h"
+#include "system/component/inc/time.h"
+
+// Writer that records what it was asked to write, and can be held closed to
+// simulate a stalled disk
+class FakeDisk {
+ public:
+  FrameStore::Writer writer() {
+    return [this](Frame& fr, const std::string& fname) { return Write(fr, fname); };
+  }
+
+  int Write(Frame& fr, const std::string& fname) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    open_.wait(lock, [this] { return !stalled_; });
+    files_[fname] = fr.data[0];
+    compression_[fname] = fr.compression;
+    ++writes_;
+    return fail_ ? -1 : 0;
+  }
+
+  void Stall(bool stalled) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stalled_ = stalled;
+    }
+    open_.notify_all();
+  }
+
+  void Fail(bool fail) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fail_ = fail;
+  }
+
+  std::map<std::string, uint16_t> files() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return files_;
+  }
+
+  std::map<std::string, int> compression() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return compression_;
+  }
+
+  int writes() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return writes_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable open_;
+  bool stalled_ = false;
+  bool fail_ = false;
+  int writes_ = 0;
+  std::map<std::string, uint16_t> files_;
+  std::map<std::string, int> compression_;
+};
+
+static std::string TempName(const std::string& name) {
+  const char* dir = getenv("TEST_TMPDIR");  // Set by bazel
+  return std::string(dir ? dir : ".") + "/" + name;
+}
+
+TEST(TestFrameStore, WritesEveryFrame) {
+  FakeDisk disk;
+  FrameStore store(2, 4, disk.writer());
+  Frame fr(8, 4);
+  for (int i = 0; i < 20; ++i) {
+    fr.data[0] = i;
+    ASSERT_EQ(0, store.Save(fr, "frame" + std::to_string(i)));
+  }
+  ASSERT_EQ(0, store.Flush(false));
+
+  std::map<std::string, uint16_t> files = disk.files();
+  ASSERT_EQ(20, files.size());
+  for (int i = 0; i < 20; ++i) {
+    ASSERT_EQ(i, files["frame" + std::to_string(i)]);
+  }
+  FrameStore::Stats stats = store.GetStats();
+  ASSERT_EQ(20, stats.frames_written);
+  ASSERT_EQ(20 * 8 * 4 * 2, stats.bytes_written);
+  ASSERT_EQ(0, stats.queue_depth);
+}
+
+TEST(TestFrameStore, ReportsWrittenFiles) {
+  FakeDisk disk;
+  FrameStore store(2, 4, disk.writer());
+  std::mutex mutex;
+  std::set<std::string> written;
+  store.SetOnWritten([&](const std::string& fname) {
+    std::lock_guard<std::mutex> lock(mutex);
+    written.insert(fname);
+  });
+  Frame fr(8, 4);
+  ASSERT_EQ(0, store.Save(fr, "frame0"));
+  ASSERT_EQ(0, store.Save(fr, "frame1"));
+  ASSERT_EQ(0, store.Save(fr, "own", [](Frame&, const std::string&) { return 0; }));
+  ASSERT_EQ(0, store.Flush(false));
+  std::lock_guard<std::mutex> lock(mutex);
+  ASSERT_EQ(std::set<std::string>({ "frame0", "frame1" }), written);
+}
+
+TEST(TestFrameStore, SaveCopiesFrameData) {
+  FakeDisk disk;
+  disk.Stall(true);
+  FrameStore store(1, 4, disk.writer());
+  Frame fr(8, 4);
+  fr.data[0] = 7;
+  store.Save(fr, "frame");
+  fr.data[0] = 9;  // Caller is free to reuse its frame as soon as Save returns
+  disk.Stall(false);
+  store.Flush(false);
+  ASSERT_EQ(7, disk.files()["frame"]);
+}
+
+TEST(TestFrameStore, SaveBlocksWhenQueueIsFull) {
+  FakeDisk disk;
+  disk.Stall(true);
+  FrameStore store(1, 2, disk.writer());
+  Frame fr(8, 4);
+  store.Save(fr, "a");
+  store.Save(fr, "b");
+
+  std::atomic<bool> saved(false);
+  std::thread producer([&] {
+    store.Save(fr, "c");
+    saved = true;
+  });
+  Component::SleepMs(50);
+  ASSERT_FALSE(saved);
+  ASSERT_EQ(2, store.GetStats().queue_depth);
+
+  disk.Stall(false);
+  producer.join();
+  store.Flush(false);
+  ASSERT_TRUE(saved);
+  ASSERT_EQ(3, disk.files().size());
+  ASSERT_EQ(2, store.GetStats().max_queue_depth);
+}
+
+TEST(TestFrameStore, CoalescesQueuedWritesToSameFile) {
+  FakeDisk disk;
+  disk.Stall(true);
+  FrameStore store(1, 4, disk.writer());
+  Frame fr(8, 4);
+  fr.data[0] = 1;
+  store.Save(fr, "busy");  // Taken by the I/O thread, then stalls
+  Component::SleepMs(20);
+  fr.data[0] = 2;
+  store.Save(fr, "same");
+  fr.data[0] = 3;
+  store.Save(fr, "same");
+  disk.Stall(false);
+  store.Flush(false);
+
+  ASSERT_EQ(2, disk.writes());
+  ASSERT_EQ(3, disk.files()["same"]);
+  ASSERT_EQ(1, store.GetStats().frames_coalesced);
+}
+
+TEST(TestFrameStore, FlushReportsErrors) {
+  FakeDisk disk;
+  disk.Fail(true);
+  FrameStore store(2, 4, disk.writer());
+  Frame fr(8, 4);
+  store.Save(fr, "a");
+  store.Save(fr, "b");
+  ASSERT_EQ(2, store.Flush(false));
+  ASSERT_EQ(0, store.Flush(false));  // Errors are reported once
+  ASSERT_EQ(2, store.GetStats().errors);
+}
+
+TEST(TestFrameStore, DestructorWritesQueuedFrames) {
+  FakeDisk disk;
+  {
+    FrameStore store(1, 4, disk.writer());
+    Frame fr(8, 4);
+    for (int i = 0; i < 4; ++i) store.Save(fr, std::to_string(i));
+  }
+  ASSERT_EQ(4, disk.writes());
+}
+
+TEST(TestFrameStore, FallsBackToUncompressedWhenBackedUp) {
+  FakeDisk disk;
+  disk.Stall(true);
+  FrameStore store(1, 8, disk.writer());
+  store.SetCompression(Frame::COMPRESS_DEFLATE);
+  Frame fr(8, 4);
+  for (int i = 0; i < 8; ++i) store.Save(fr, std::to_string(i));  // 7th and 8th are over 3/4 full
+  disk.Stall(false);
+  store.Flush(false);
+  store.Save(fr, "8");  // Drained
+  store.Flush(false);
+
+  std::map<std::string, int> compression = disk.compression();
+  for (int i = 0; i < 9; ++i) {
+    int expected = i == 6 || i == 7 ? Frame::COMPRESS_NONE : Frame::COMPRESS_DEFLATE;
+    ASSERT_EQ(expected, compression[std::to_string(i)]) << i;
+  }
+  ASSERT_EQ(2, store.GetStats().frames_fallback);
+}
+
+TEST(TestFrameStore, ReportsCompressionRatio) {
+  FrameStore store(2, 16);  // Deep enough not to fall back
+  store.SetCompression(Frame::COMPRESS_DEFLATE);
+  Frame fr(64, 48);
+  for (int i = 0; i < 64 * 48; ++i) fr.data[i] = i % 64;
+  std::vector<std::string> fnames;
+  for (int i = 0; i < 4; ++i) {
+    fnames.push_back(TempName("framestore_deflate" + std::to_string(i) + ".tiff"));
+    store.Save(fr, fnames.back());
+  }
+  ASSERT_EQ(0, store.Flush(false));
+
+  FrameStore::CodecStats deflate = store.GetStats().codec[Frame::COMPRESS_DEFLATE];
+  ASSERT_EQ(4, deflate.frames);
+  ASSERT_EQ(4 * 64 * 48 * 2, deflate.raw_bytes);
+  ASSERT_GT(deflate.ratio, 2.0);
+  ASSERT_EQ(0, store.GetStats().codec[Frame::COMPRESS_NONE].frames);
+  for (const std::string& fname : fnames) {
+    Frame in;
+    ASSERT_EQ(0, in.Read(fname.c_str()));
+    ASSERT_EQ(0, memcmp(fr.data, in.data, 64 * 48 * sizeof(uint16_t)));
+    remove(fname.c_str());
+  }
+}
@@ -0,0 +1,41 @@
+#include <thread>
+#include <vector>
+
+#include "googletest/googletest/include/gtest/gtest.h"
+#include "system/component/inc/mpsc_queue.h"
+
+TEST(TestMpscQueue, PopAllIsFifo) {
+  MpscQueue<int> queue;
+  ASSERT_TRUE(queue.empty());
+  for (int i = 0; i < 5; ++i) queue.Push(i);
+  ASSERT_FALSE(queue.empty());
+  std::vector<int> out;
+  ASSERT_EQ(5, queue.PopAll(&out));
+  ASSERT_EQ(std::vector<int>({ 0, 1, 2, 3, 4 }), out);
+  ASSERT_TRUE(queue.empty());
+  ASSERT_EQ(0, queue.PopAll(&out));
+}
+
+TEST(TestMpscQueue, ConcurrentProducersKeepTheirOrder) {
+  static const int N_THREADS = 4;
+  static const int N = 20000;
+  MpscQueue<std::pair<int, int>> queue;
+  std::vector<std::thread> producers;
+  for (int t = 0; t < N_THREADS; ++t) {
+    producers.push_back(std::thread([&queue, t] {
+      for (int i = 0; i < N; ++i) queue.Push(std::make_pair(t, i));
+    }));
+  }
+
+  std::vector<std::pair<int, int>> out;
+  std::vector<int> next(N_THREADS, 0);
+  while (out.size() < N_THREADS * N) {
+    size_t start = out.size();
+    queue.PopAll(&out);
+    for (size_t i = start; i < out.size(); ++i) {
+      ASSERT_EQ(next[out[i].first]++, out[i].second);  // Each producer's elements arrive in order
+    }
+  }
+  for (std::thread& t : producers) t.join();
+  ASSERT_TRUE(queue.empty());
+}
@@ -0,0 +1,181 @@
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include "googletest/googletest/include/gtest/gtest.h"
+#include "system/component/inc/multicamerajoin.h"
+#include "system/component/inc/time.h"
+
+// Camera stand-in: records frames as they are released
+class Source : public ExecNode {
+ public:
+  bool Released(Frame* fr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return released_.count(fr) > 0;
+  }
+
+ private:
+  void AtExit(void* data) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    released_.insert((Frame*)data);
+  }
+
+  std::mutex mutex_;
+  std::set<Frame*> released_;
+};
+
+// Records bundles, checking their frames are still held while in use
+class Collector : public ExecNode {
+ public:
+  Collector(std::vector<Source*> sources) : sources_(sources) {}
+
+  struct Seen {
+    int seq;
+    std::vector<Frame*> frames;
+    int missing;
+  };
+
+  std::vector<Seen> Bundles() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return seen_;
+  }
+
+  int early = 0;  // frames released before their bundle was done
+
+ private:
+  void* Exec(void* data) override {
+    MultiCameraJoin::Bundle* bundle = (MultiCameraJoin::Bundle*)data;
+    Component::SleepMs(10);
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < bundle->frames.size(); ++i) {
+      if (bundle->frames[i] && sources_[i]->Released(bundle->frames[i])) ++early;
+    }
+    seen_.push_back({ bundle->seq, bundle->frames, bundle->missing });
+    return data;
+  }
+
+  std::vector<Source*> sources_;
+  std::mutex mutex_;
+  std::vector<Seen> seen_;
+};
+
+static void Init(Frame* fr, int camera, int seq, time_t timestamp_ms = 0) {
+  fr->serialNumber = camera;
+  fr->seq = seq;
+  fr->timestamp_ms_ = timestamp_ms;
+}
+
+TEST(TestMultiCameraJoin, JoinsBySequence) {
+  Source a, b;
+  MultiCameraJoin join({ 100, 200 });
+  Collector out({ &a, &b });
+  join.AddProducer(&a);
+  join.AddProducer(&b);
+  out.AddProducer(&join);
+
+  Frame fa[3], fb[3];
+  for (int i = 0; i < 3; ++i) {
+    Init(&fa[i], 100, i);
+    Init(&fb[i], 200, i);
+  }
+  a.Consume(&fa[0]);
+  b.Consume(&fb[0]);
+  b.Consume(&fb[1]);  // Cameras need not arrive in the same order
+  a.Consume(&fa[1]);
+  a.Consume(&fa[2]);
+  b.Consume(&fb[2]);
+  ASSERT_TRUE(a.WaitExecDone(5000));
+  ASSERT_TRUE(b.WaitExecDone(5000));
+
+  std::vector<Collector::Seen> bundles = out.Bundles();
+  ASSERT_EQ(3u, bundles.size());
+  std::set<int> seqs;
+  for (const Collector::Seen& s : bundles) {
+    seqs.insert(s.seq);
+    ASSERT_EQ(0, s.missing);
+    ASSERT_EQ(&fa[s.seq], s.frames[0]);
+    ASSERT_EQ(&fb[s.seq], s.frames[1]);
+  }
+  ASSERT_EQ(std::set<int>({ 0, 1, 2 }), seqs);
+  ASSERT_EQ(0, out.early);
+  ASSERT_EQ(3u, join.GetStats().complete);
+}
+
+TEST(TestMultiCameraJoin, TimesOutWithMissingFrames) {
+  Source a, b;
+  MultiCameraJoin join({ 100, 200 }, 50);
+  Collector out({ &a, &b });
+  join.AddProducer(&a);
+  join.AddProducer(&b);
+  out.AddProducer(&join);
+
+  Frame fa;
+  Init(&fa, 100, 7);
+  time_t start = Component::SteadyClockTimeMs();
+  a.Consume(&fa);
+  ASSERT_TRUE(a.WaitExecDone(5000));
+  ASSERT_GE(Component::SteadyClockTimeMs() - start, 45);
+
+  std::vector<Collector::Seen> bundles = out.Bundles();
+  ASSERT_EQ(1u, bundles.size());
+  ASSERT_EQ(7, bundles[0].seq);
+  ASSERT_EQ(1, bundles[0].missing);
+  ASSERT_EQ(&fa, bundles[0].frames[0]);
+  ASSERT_EQ(nullptr, bundles[0].frames[1]);
+  ASSERT_EQ(1u, join.GetStats().partial);
+}
+
+TEST(TestMultiCameraJoin, JoinsByTimestamp) {
+  Source a, b;
+  MultiCameraJoin join({ 100, 200 }, 200);
+  join.SetTimeWindow(5);
+  Collector out({ &a, &b });
+  join.AddProducer(&a);
+  join.AddProducer(&b);
+  out.AddProducer(&join);
+
+  Frame fa, fb;
+  Init(&fa, 100, 3, 1000);
+  Init(&fb, 200, 9, 1004);  // Counters disagree; the clock does not
+  a.Consume(&fa);
+  b.Consume(&fb);
+  ASSERT_TRUE(a.WaitExecDone(5000));
+  ASSERT_TRUE(b.WaitExecDone(5000));
+
+  std::vector<Collector::Seen> bundles = out.Bundles();
+  ASSERT_EQ(1u, bundles.size());
+  ASSERT_EQ(0, bundles[0].missing);
+  ASSERT_EQ(&fb, bundles[0].frames[1]);
+}
+
+TEST(TestMultiCameraJoin, DroppedFrameClosesOnLaterFrame) {
+  Source a, b;
+  MultiCameraJoin join({ 100, 200 }, 5000);
+  Collector out({ &a, &b });
+  join.AddProducer(&a);
+  join.AddProducer(&b);
+  out.AddProducer(&join);
+
+  Frame fa[4], fb[4];
+  for (int i = 0; i < 4; ++i) {
+    Init(&fa[i], 100, i);
+    Init(&fb[i], 200, i);
+  }
+  time_t start = Component::SteadyClockTimeMs();
+  a.Consume(&fa[0]);  // b drops seq 0
+  for (int i = 1; i < 4; ++i) {
+    a.Consume(&fa[i]);
+    b.Consume(&fb[i]);
+  }
+  ASSERT_TRUE(a.WaitExecDone(5000));
+  ASSERT_TRUE(b.WaitExecDone(5000));
+  ASSERT_LT(Component::SteadyClockTimeMs() - start, 1000);
+
+  std::vector<Collector::Seen> bundles = out.Bundles();
+  ASSERT_EQ(4u, bundles.size());
+  for (const Collector::Seen& s : bundles) {
+    ASSERT_EQ(s.seq == 0 ? 1 : 0, s.missing);
+  }
+  ASSERT_EQ(3u, join.GetStats().complete);
+  ASSERT_EQ(1u, join.GetStats().partial);
+}
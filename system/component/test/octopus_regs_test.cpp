@@ -0,0 +1,104 @@
+#include <vector>
+
+#include "googletest/googletest/include/gtest/gtest.h"
+#include "system/component/inc/octopus.h"
+#include "system/component/inc/octopus_sim.h"
+
+static const int TIMER_CONTROL = 0x1F;
+
+static Octopus::Timer Pulses(Octopus::Pin out, double period) {
+  Octopus::Timer ot = {};
+  ot.trigger.select = Octopus::Pin::HIGH;
+  ot.trigger.sense = Octopus::Timer::Trigger::HIGH;
+  ot.gate.select = Octopus::Pin::HIGH;
+  ot.gate.sense = Octopus::Timer::Gate::HIGH;
+  ot.state[1].output_value = true;
+  ot.state[1].next_state = 2;
+  ot.state[1].period = period;
+  ot.state[2].next_state = 1;
+  ot.state[2].period = period;
+  ot.state_transition_count = 10;
+  ot.out_select = out;
+  return ot;
+}
+
+static Octopus::AOM Aom(int channel, double frequency) {
+  Octopus::AOM oa;
+  oa.channel = channel;
+  oa.frequency = frequency;
+  oa.amplitude = 1;
+  oa.gate = Octopus::Pin::HIGH;
+  return oa;
+}
+
+TEST(TestOctopusRegs, ModRegUsesShadow) {
+  OctopusSim sim;
+  Octopus octo(&sim);
+  octo.EnableTimer(Octopus::Pin::OUT1_BOTTOM, true);
+  octo.EnableTimer(Octopus::Pin::OUT2_BOTTOM, true);
+  ASSERT_EQ(0b11, sim.Reg(TIMER_CONTROL, 0));
+  ASSERT_EQ(1, octo.GetStats().reads);
+  ASSERT_EQ(1, octo.GetStats().shadow_reads);
+  ASSERT_EQ(2 + 2, sim.Transfers());  // One read, two writes
+}
+
+TEST(TestOctopusRegs, UnchangedTimerRegistersSkipped) {
+  OctopusSim sim;
+  Octopus octo(&sim);
+  octo.ConfigureTimer(Pulses(Octopus::Pin::OUT3_BOTTOM, 10e-6));
+  ASSERT_EQ(1000, sim.Reg(2, 2));  // State 1 count
+  ASSERT_EQ(2 + 1 + 17, sim.Transfers());
+
+  sim.ClearLog();
+  octo.ConfigureTimer(Pulses(Octopus::Pin::OUT3_BOTTOM, 10e-6));
+  ASSERT_EQ(1, sim.Transfers());  // Only the timer disable
+  ASSERT_EQ(17, octo.GetStats().skipped);
+
+  sim.ClearLog();
+  octo.ConfigureTimer(Pulses(Octopus::Pin::OUT3_BOTTOM, 20e-6));
+  ASSERT_EQ(1 + 2, sim.Transfers());  // Both state counts
+  ASSERT_EQ(2000, sim.Reg(2, 4));
+}
+
+TEST(TestOctopusRegs, BatchesMatchSingleWrites) {
+  OctopusSim single_sim, batch_sim;
+  Octopus single(&single_sim), batch(&batch_sim);
+  batch.SetMaxBatch(64);
+  for (Octopus* octo : { &single, &batch }) {
+    octo->ConfigureTimer(Pulses(Octopus::Pin::OUT1_TOP, 1e-6));
+    octo->ConfigureTimer(Pulses(Octopus::Pin::OUT2_TOP, 2e-6));
+    Octopus::AOM oa = Aom(1, 95e6);
+    octo->ConfigureAOM(oa);
+    octo->EnableTimer(Octopus::Pin::OUT1_TOP, true);
+  }
+
+  const std::vector<OctopusSim::Write>& a = single_sim.Writes();
+  const std::vector<OctopusSim::Write>& b = batch_sim.Writes();
+  ASSERT_EQ(a.size(), b.size());
+  for (size_t i = 0; i < a.size(); ++i) {
+    ASSERT_EQ(a[i].device, b[i].device) << i;
+    ASSERT_EQ(a[i].reg, b[i].reg) << i;
+    ASSERT_EQ(a[i].data, b[i].data) << i;
+  }
+  ASSERT_LT(batch_sim.Transfers() * 4, single_sim.Transfers());
+  ASSERT_EQ(single.GetStats().writes, batch.GetStats().writes);
+}
+
+TEST(TestOctopusRegs, AOMProgramsDDS) {
+  OctopusSim sim;
+  Octopus octo(&sim);
+  ASSERT_EQ(0, octo.Open());
+  ASSERT_EQ(0xC00000u, sim.DDSReg(1));  // PLL
+
+  Octopus::AOM oa = Aom(3, 100e6);  // DDS channel 0
+  octo.ConfigureAOM(oa);
+  ASSERT_EQ(0x40000000u, sim.DDSReg(4, 0));
+  ASSERT_EQ(0u, sim.DDSReg(4, 1));
+
+  // Again, without the SPI registers that already hold the right values
+  int writes = octo.GetStats().writes;
+  octo.ConfigureAOM(oa);
+  ASSERT_GT(octo.GetStats().skipped, 0);
+  ASSERT_LT(octo.GetStats().writes - writes, writes);
+  ASSERT_EQ(0x40000000u, sim.DDSReg(4, 0));
+}
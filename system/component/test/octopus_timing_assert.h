@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+#include "googletest/googletest/include/gtest/gtest.h"
+#include "system/component/inc/octopus_timing_sim.h"
+
+// gtest assertions on OctopusTimingSim timelines, e.g.
+//   EXPECT_TRUE(PulsesAre(sim.Timeline(Octopus::Pin::OUT8_TOP), {{0, 100e-6}}));
+//   EXPECT_TRUE(DelayIs(sim, Octopus::Pin::OUT7_TOP, Octopus::Pin::OUT2_BOTTOM, 587.89e-6));
+// Times are in seconds, and match to within tolerance_s, one clock cycle by default.
+
+static const double ONE_CYCLE = 1 / OctopusTimingSim::CLOCK_HZ;
+
+// A timeline has exactly these high pulses.  A start < 0 matches any start,
+//   for checking widths alone.
+inline ::testing::AssertionResult PulsesAre(const std::vector<OctopusTimingSim::Edge>& timeline,
+                                            const std::vector<OctopusTimingSim::Pulse>& expected,
+                                            double tolerance_s = ONE_CYCLE) {
+  std::vector<OctopusTimingSim::Pulse> pulses = OctopusTimingSim::Pulses(timeline);
+  if (pulses.size() != expected.size()) {
+    return ::testing::AssertionFailure() << pulses.size() << " pulses, expected " << expected.size();
+  }
+  for (size_t i = 0; i < pulses.size(); ++i) {
+    if ((expected[i].start >= 0 && std::fabs(pulses[i].start - expected[i].start) > tolerance_s) ||
+        std::fabs(pulses[i].width - expected[i].width) > tolerance_s) {
+      return ::testing::AssertionFailure() << "pulse " << i << " at " << pulses[i].start << " s, " << pulses[i].width
+                                           << " s wide, expected " << expected[i].start << " s, "
+                                           << expected[i].width << " s wide";
+    }
+  }
+  return ::testing::AssertionSuccess();
+}
+
+// Every rising edge on one pin is followed by a rising edge on another, after delay_s
+inline ::testing::AssertionResult DelayIs(const OctopusTimingSim& sim, Octopus::Pin from, Octopus::Pin to,
+                                          double delay_s, double tolerance_s = ONE_CYCLE) {
+  std::vector<OctopusTimingSim::Pulse> causes = OctopusTimingSim::Pulses(sim.Timeline(from));
+  std::vector<OctopusTimingSim::Pulse> effects = OctopusTimingSim::Pulses(sim.Timeline(to));
+  if (causes.empty()) return ::testing::AssertionFailure() << OctopusTimingSim::PinName(from) << " never rose";
+
+  size_t e = 0;
+  for (size_t c = 0; c < causes.size(); ++c) {
+    while (e < effects.size() && effects[e].start < causes[c].start) ++e;
+    if (e == effects.size()) {
+      return ::testing::AssertionFailure() << OctopusTimingSim::PinName(to) << " did not follow "
+                                           << OctopusTimingSim::PinName(from) << " at " << causes[c].start << " s";
+    }
+    double delay = effects[e].start - causes[c].start;
+    if (std::fabs(delay - delay_s) > tolerance_s) {
+      return ::testing::AssertionFailure() << OctopusTimingSim::PinName(to) << " rose " << delay << " s after "
+                                           << OctopusTimingSim::PinName(from) << " at " << causes[c].start
+                                           << " s, expected " << delay_s << " s";
+    }
+  }
+  return ::testing::AssertionSuccess();
+}
@@ -0,0 +1,134 @@
+#include <sstream>
+#include <string>
+
+#include "googletest/googletest/include/gtest/gtest.h"
+#include "system/component/inc/octopus.h"
+#include "system/component/inc/octopus_timing_sim.h"
+#include "system/component/test/octopus_timing_assert.h"
+
+// Pulses of a width, the same time apart
+static Octopus::Timer Pulses(Octopus::Pin out, double width, int transitions) {
+  Octopus::Timer ot = {};
+  ot.trigger.select = Octopus::Pin::HIGH;
+  ot.trigger.sense = Octopus::Timer::Trigger::HIGH;
+  ot.gate.select = Octopus::Pin::HIGH;
+  ot.gate.sense = Octopus::Timer::Gate::HIGH;
+  ot.state[1].output_value = true;
+  ot.state[1].next_state = 2;
+  ot.state[1].period = width;
+  ot.state[2].next_state = 1;
+  ot.state[2].period = width;
+  ot.state_transition_count = transitions;
+  ot.out_select = out;
+  return ot;
+}
+
+// A pulse, delay after each trigger
+static Octopus::Timer Delayed(Octopus::Pin out, Octopus::Pin trigger, double delay, double width) {
+  Octopus::Timer ot = {};
+  ot.trigger.select = trigger;
+  ot.trigger.sense = Octopus::Timer::Trigger::RISING;
+  ot.gate.select = Octopus::Pin::HIGH;
+  ot.gate.sense = Octopus::Timer::Gate::HIGH;
+  ot.state[1].use_trigger = true;
+  ot.state[1].next_state = 2;
+  ot.state[1].period = delay;
+  ot.state[2].output_value = true;
+  ot.state[2].next_state = 3;
+  ot.state[2].period = width;
+  ot.state[3].next_state = 1;
+  ot.state[3].period = 1e-6;
+  ot.state_transition_count = -1;
+  ot.out_select = out;
+  return ot;
+}
+
+TEST(TestOctopusTiming, PulseTrainToTheCycle) {
+  OctopusTimingSim sim;
+  Octopus octo(&sim);
+  octo.ConfigureTimer(Pulses(Octopus::Pin::OUT3_BOTTOM, 10e-6, 10));
+  octo.EnableTimer(Octopus::Pin::OUT3_BOTTOM, true);
+  sim.Run(1e-3);
+
+  // Starts the cycle after the enable; 9 states, then the end
+  std::vector<OctopusTimingSim::Pulse> expected;
+  for (int i = 0; i < 5; ++i) expected.push_back({ ONE_CYCLE + i * 20e-6, 10e-6 });
+  EXPECT_TRUE(PulsesAre(sim.Timeline(Octopus::Pin::OUT3_BOTTOM), expected, ONE_CYCLE / 2));
+  EXPECT_FALSE(sim.Value(Octopus::Pin::OUT3_BOTTOM));
+}
+
+TEST(TestOctopusTiming, TriggersChainAndRearm) {
+  OctopusTimingSim sim;
+  Octopus octo(&sim);
+  octo.ConfigureTimer(Delayed(Octopus::Pin::OUT2_BOTTOM, Octopus::Pin::OUT1_TOP, 50e-6, 10e-6));
+  octo.EnableTimer(Octopus::Pin::OUT2_BOTTOM, true);
+  octo.ConfigureTimer(Pulses(Octopus::Pin::OUT1_TOP, 100e-6, 2));
+  octo.EnableTimer(Octopus::Pin::OUT1_TOP, true);
+  sim.Run(1e-3);
+  octo.RearmTimer(Octopus::Pin::OUT1_TOP);
+  sim.Run(1e-3);
+
+  EXPECT_TRUE(PulsesAre(sim.Timeline(Octopus::Pin::OUT1_TOP), { { -1, 100e-6 }, { 1e-3 + ONE_CYCLE, 100e-6 } }));
+  EXPECT_TRUE(PulsesAre(sim.Timeline(Octopus::Pin::OUT2_BOTTOM), { { -1, 10e-6 }, { -1, 10e-6 } }));
+  // One cycle to see the trigger
+  EXPECT_TRUE(DelayIs(sim, Octopus::Pin::OUT1_TOP, Octopus::Pin::OUT2_BOTTOM, 50e-6 + ONE_CYCLE, ONE_CYCLE / 2));
+}
+
+TEST(TestOctopusTiming, GateHoldsTimer) {
+  OctopusTimingSim sim;
+  Octopus octo(&sim);
+  Octopus::Timer ot = Delayed(Octopus::Pin::OUT4_TOP, Octopus::Pin::IN2_BOTTOM, 5e-6, 2e-6);
+  ot.gate.select = Octopus::Pin::IN1_TOP;
+  octo.ConfigureTimer(ot);
+  octo.EnableTimer(Octopus::Pin::OUT4_TOP, true);
+
+  sim.ClockInput(Octopus::Pin::IN2_BOTTOM, 100e-6, 1e-6, 10);  // a laser sync
+  sim.SetInput(Octopus::Pin::IN1_TOP, true, 450e-6);
+  sim.Run(1e-3);
+
+  // Triggers from 500 us on, once the gate has been seen open
+  ASSERT_EQ(5u, OctopusTimingSim::Pulses(sim.Timeline(Octopus::Pin::OUT4_TOP)).size());
+  EXPECT_TRUE(PulsesAre(sim.Timeline(Octopus::Pin::OUT4_TOP), { { 505e-6, 2e-6 }, { 605e-6, 2e-6 }, { 705e-6, 2e-6 },
+                                                                { 805e-6, 2e-6 }, { 905e-6, 2e-6 } }, 2 * ONE_CYCLE));
+  EXPECT_FALSE(DelayIs(sim, Octopus::Pin::IN2_BOTTOM, Octopus::Pin::OUT4_TOP, 5e-6 + ONE_CYCLE));
+}
+
+TEST(TestOctopusTiming, AOMFollowsGate) {
+  OctopusTimingSim sim;
+  Octopus octo(&sim);
+  ASSERT_EQ(0, octo.Open());
+  Octopus::AOM oa;
+  oa.channel = 2;
+  oa.frequency = 95e6;
+  oa.amplitude = 4;
+  oa.gate = Octopus::Pin::OUT6_TOP;
+  octo.ConfigureAOM(oa);
+  octo.ConfigureTimer(Pulses(Octopus::Pin::OUT6_TOP, 20e-6, 4));
+  octo.EnableTimer(Octopus::Pin::OUT6_TOP, true);
+  sim.Run(1e-4);
+
+  EXPECT_NEAR(95e6, sim.AOMFrequency(2), 1);
+  EXPECT_NEAR(4, sim.AOMAmplitude(2), 0.01);
+  EXPECT_TRUE(PulsesAre(sim.AOMTimeline(2), OctopusTimingSim::Pulses(sim.Timeline(Octopus::Pin::OUT6_TOP)), 0));
+  EXPECT_EQ(2u, sim.AOMTimeline(2).size() / 2);
+  EXPECT_TRUE(sim.AOMTimeline(1).empty());
+}
+
+TEST(TestOctopusTiming, WritesVCDAndCSV) {
+  OctopusTimingSim sim;
+  Octopus octo(&sim);
+  octo.ConfigureTimer(Pulses(Octopus::Pin::OUT1_BOTTOM, 1e-6, 5));
+  octo.EnableTimer(Octopus::Pin::OUT1_BOTTOM, true);
+  sim.Run(10e-6);
+
+  std::ostringstream vcd, csv;
+  sim.WriteVCD(vcd);
+  sim.WriteCSV(csv);
+  EXPECT_NE(std::string::npos, vcd.str().find("$var wire 1 ) OUT1_BOTTOM $end"));
+  EXPECT_NE(std::string::npos, vcd.str().find("#1\n1)\n#101\n0)\n#201\n1)\n#301\n0)\n#1000\n"));
+  EXPECT_EQ("time_s,signal,value\n"
+            "0.00000001,OUT1_BOTTOM,1\n"
+            "0.00000101,OUT1_BOTTOM,0\n"
+            "0.00000201,OUT1_BOTTOM,1\n"
+            "0.00000301,OUT1_BOTTOM,0\n", csv.str());
+}
@@ -0,0 +1,68 @@
+#include <cmath>
+#include <vector>
+
+#include "googletest/googletest/include/gtest/gtest.h"
+#include "system/component/inc/colormap.h"
+#include "system/component/inc/preview.h"
+
+TEST(TestPreview, DownsampleAveragesBoxes) {
+  // 5 x 3 image, factor 2: full, full and partial boxes
+  uint16_t in[15] = { 0, 2, 4, 6, 8,
+                      2, 4, 6, 8, 10,
+                      100, 100, 7, 9, 1 };
+  std::vector<uint16_t> out(Preview::Downsized(5, 2) * Preview::Downsized(3, 2));
+  ASSERT_EQ(6u, out.size());
+  Preview::Downsample(in, 5, 3, 2, out.data());
+  ASSERT_EQ(2, out[0]);    // (0 + 2 + 2 + 4) / 4
+  ASSERT_EQ(6, out[1]);    // (4 + 6 + 6 + 8) / 4
+  ASSERT_EQ(9, out[2]);    // (8 + 10) / 2
+  ASSERT_EQ(100, out[3]);  // (100 + 100) / 2
+  ASSERT_EQ(8, out[4]);    // (7 + 9) / 2
+  ASSERT_EQ(1, out[5]);
+}
+
+TEST(TestPreview, DownsampleByOneCopies) {
+  std::vector<uint16_t> in(7 * 3), out(7 * 3);
+  for (size_t i = 0; i < in.size(); ++i) in[i] = (uint16_t)(i * 97);
+  Preview::Downsample(in.data(), 7, 3, 1, out.data());
+  ASSERT_EQ(in, out);
+}
+
+TEST(TestPreview, ColormapScalesBitDepth) {
+  ASSERT_EQ(0, Preview::ColormapShift(10));
+  ASSERT_EQ(2, Preview::ColormapShift(12));
+  ASSERT_EQ(6, Preview::ColormapShift(16));
+  uint16_t in[2] = { 0, 4095 };
+  uint32_t out[2];
+  Preview::Colormap(in, 2, COLORMAP_GREY, Preview::ColormapShift(12), out);
+  ASSERT_EQ(COLORMAP_GREY[0], out[0]);
+  ASSERT_EQ(COLORMAP_GREY[COLORMAP_LEN - 1], out[1]);
+}
+
+TEST(TestPreview, LogScaleMatchesLog) {
+  double m = 255.0 / (log(1e6 + 1) - log(10 + 1));
+  double x0 = log(10);
+  Preview::LogScale scale;
+  scale.Set(m, x0);
+  std::vector<double> in;
+  for (double x = 0; x < 2e6; x = x * 1.01 + 0.1) in.push_back(x);
+  std::vector<uint32_t> out(in.size());
+  scale.Map(in.data(), in.size(), out.data());
+  for (size_t i = 0; i < in.size(); ++i) {
+    double g = m * (log(in[i] + 1) - x0);
+    g = g < 0 ? 0 : g > 255 ? 255 : g;
+    int level = out[i] & 0xFF;
+    ASSERT_LE(abs(int(g) - level), 1) << in[i];
+    ASSERT_EQ(Preview::Grey(level), out[i]);
+  }
+  ASSERT_EQ(Preview::Grey(0), scale(-5.0));
+}
+
+TEST(TestPreview, RateLimitPassesOneFramePerInterval) {
+  Preview::RateLimit limit(1000);
+  ASSERT_TRUE(limit.Take());
+  ASSERT_FALSE(limit.Take());
+  Preview::RateLimit none(0);
+  ASSERT_TRUE(none.Take());
+  ASSERT_TRUE(none.Take());
+}
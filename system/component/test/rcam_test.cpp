@@ -1,6 +1,7 @@
 #include "googletest/googlemock/include/gmock/gmock.h"
 #include "googletest/googletest/include/gtest/gtest.h"
 #include "system/component/inc/rcam.h"
+#include "system/component/inc/time.h"
 
 using testing::Return;
 using testing::_;
@@ -66,4 +67,19 @@ TEST(TestFrame, OpenFailsIfParamReadFails) {
   ASSERT_EQ(-1, test.Open(0));
 }
 
+TEST(TestFrame, WaitFrameCountReturnsOnceReached) {
+  testing::NiceMock<MockFX3> mockFX3;
+  RcamTest test(&mockFX3);
+  ASSERT_TRUE(test.WaitFrameCount(0, 0));
+  ASSERT_TRUE(test.WaitFrameCount(0));
+}
+
+TEST(TestFrame, WaitFrameCountTimesOut) {
+  testing::NiceMock<MockFX3> mockFX3;
+  RcamTest test(&mockFX3);
+  time_t start = Component::SteadyClockTimeMs();
+  ASSERT_FALSE(test.WaitFrameCount(1, 20));
+  ASSERT_GE(Component::SteadyClockTimeMs() - start, 19);
+}
+
 // TODO: more ...
@@ -0,0 +1,72 @@
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+#include "googletest/googletest/include/gtest/gtest.h"
+#include "system/component/inc/syncnode.h"
+#include "system/component/inc/time.h"
+
+// Node that holds data in Exec() until opened, and counts AtExit() calls
+class Gate : public ExecNode {
+ public:
+  void Open() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      open_ = true;
+    }
+    cv_.notify_all();
+  }
+
+  std::atomic<int> exited{ 0 };
+
+ private:
+  void* Exec(void* data) override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return open_; });
+    return data;
+  }
+
+  void AtExit(void* data) override { ++exited; }
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool open_ = false;
+};
+
+TEST(TestSyncNode, WaitTimesOut) {
+  SyncNode sn;
+  time_t start = Component::SteadyClockTimeMs();
+  ASSERT_EQ(nullptr, sn.Wait(0.05));
+  ASSERT_GE(Component::SteadyClockTimeMs() - start, 45);
+}
+
+TEST(TestSyncNode, WaitReturnsDataInOrder) {
+  ExecNode source;
+  SyncNode sn;
+  sn.AddProducer(&source);
+  int a = 1;
+  int b = 2;
+  source.Consume(&a);
+  source.Consume(&b);
+  ASSERT_EQ(&a, sn.Wait(1.0));
+  ASSERT_EQ(&b, sn.Wait(1.0));  // Releases a
+  ASSERT_EQ(nullptr, sn.Get());  // Releases b
+  ASSERT_TRUE(source.WaitExecDone(1000));
+}
+
+TEST(TestExecNode, DrainWaitsForDataInFlight) {
+  Gate gate;
+  ExecNode leaf;
+  leaf.AddProducer(&gate);
+  ASSERT_EQ(std::future_status::ready, gate.Drain().wait_for(std::chrono::seconds(0)));
+
+  int data[3];
+  for (int& d : data) gate.Consume(&d);
+  std::future<void> done = gate.Drain();
+  ASSERT_EQ(std::future_status::timeout, done.wait_for(std::chrono::milliseconds(50)));
+  ASSERT_FALSE(gate.WaitExecDone(0));
+
+  gate.Open();
+  ASSERT_EQ(std::future_status::ready, done.wait_for(std::chrono::seconds(5)));
+  ASSERT_EQ(3, gate.exited);
+}
@@ -0,0 +1,150 @@
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "googletest/googletest/include/gtest/gtest.h"
+#include "system/component/inc/taglog.h"
+
+static std::string TempName(const char* name) {
+  const char* dir = getenv("TEST_TMPDIR");  // Set by bazel
+  std::string fname = std::string(dir ? dir : ".") + "/" + name;
+  remove(fname.c_str());  // TagLog will not overwrite
+  return fname;
+}
+
+struct CountTag : Frame::Tag {
+  double value = 0.0;
+};
+
+static void AddGroups(TagLog* log) {
+  log->AddGroup("Frame", { { "Camera", TagLog::INT32 }, { "Seq", TagLog::INT32 }, { "Time", TagLog::INT64 } },
+                [](const Frame* fr, TagLog::Fields* f) {
+                  f->Put((int32_t)fr->serialNumber);
+                  f->Put((int32_t)fr->seq);
+                  f->Put((int64_t)fr->timestamp_ms_);
+                  return true;
+                });
+  log->AddTag<CountTag>("Count", { { "Value", TagLog::FLOAT64 } },
+                        [](const CountTag* tag, TagLog::Fields* f) { f->Put(tag->value); });
+}
+
+TEST(TestTagLog, RecordsFromManyThreads) {
+  std::string fname = TempName("taglog_threads.owtag");
+  TagLog log;
+  AddGroups(&log);
+  ASSERT_EQ(4 + 4 + 4 + 8 + 8, log.RecordBytes());
+  ASSERT_EQ(0, log.Open(fname));
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.push_back(std::thread([&log, t] {
+      Frame fr;
+      fr.serialNumber = t;
+      for (int i = 0; i < 5000; ++i) {
+        fr.seq = i;
+        fr.timestamp_ms_ = 1000 + i;
+        log.Log(&fr);
+      }
+    }));
+  }
+  for (std::thread& t : threads) t.join();
+  ASSERT_EQ(0, log.Close());
+  ASSERT_EQ(20000, log.GetStats().records);
+
+  TagLogReader reader;
+  ASSERT_EQ(0, reader.Open(fname));
+  ASSERT_EQ(20000, reader.Count());
+  ASSERT_EQ(2, reader.Groups().size());
+  ASSERT_EQ(4, reader.Columns().size());
+  std::set<std::pair<int, int>> seen;
+  for (size_t i = 0; i < reader.Count(); ++i) {
+    const uint8_t* rec = reader.Record(i);
+    int32_t camera, seq;
+    int64_t time;
+    ASSERT_EQ(4 + 4 + 4 + 8, reader.RecordBytes(rec));  // No Count tag
+    ASSERT_TRUE(reader.Value(rec, 3) == NULL);
+    memcpy(&camera, reader.Value(rec, 0), sizeof(camera));
+    memcpy(&seq, reader.Value(rec, 1), sizeof(seq));
+    memcpy(&time, reader.Value(rec, 2), sizeof(time));
+    ASSERT_EQ(1000 + seq, time);
+    seen.insert(std::make_pair(camera, seq));
+  }
+  ASSERT_EQ(20000, seen.size());  // Every frame exactly once
+  remove(fname.c_str());
+}
+
+TEST(TestTagLog, CsvLeavesAbsentGroupsEmpty) {
+  std::string fname = TempName("taglog_csv.owtag");
+  TagLog log;
+  AddGroups(&log);
+  ASSERT_EQ(0, log.Open(fname));
+  Frame fr;
+  fr.serialNumber = 3;
+  fr.seq = 7;
+  fr.timestamp_ms_ = 12;
+  log.Log(&fr);
+  CountTag* tag = new CountTag();
+  tag->value = 2.5;
+  fr.AddTag(tag);
+  log.Log(&fr);
+  ASSERT_EQ(0, log.Close());
+
+  TagLogReader reader;
+  ASSERT_EQ(0, reader.Open(fname));
+  ASSERT_EQ("Camera, Seq, Time, Value", reader.CsvHeader());
+  ASSERT_EQ("3, 7, 12, ", reader.Csv(reader.Record(0)));
+  ASSERT_EQ("3, 7, 12, 2.5", reader.Csv(reader.Record(1)));
+  ASSERT_EQ(4 + 16, reader.RecordBytes(reader.Record(0)));  // Absent groups take no space
+  ASSERT_EQ(4 + 16 + 8, reader.RecordBytes(reader.Record(1)));
+  fr.ClearTags();
+  delete tag;
+  remove(fname.c_str());
+}
+
+TEST(TestTagLog, Float32Columns) {
+  std::string fname = TempName("taglog_float32.owtag");
+  TagLog log;
+  log.AddGroup("Float", { { "x", TagLog::FLOAT32 }, { "n", TagLog::INT32 } },
+               [](const Frame* fr, TagLog::Fields* f) {
+                 f->Put(0.125f * fr->seq);
+                 f->Put((int32_t)fr->seq);
+                 return true;
+               });
+  ASSERT_EQ(4 + 4 + 4, log.RecordBytes());
+  ASSERT_EQ(0, log.Open(fname));
+  Frame fr;
+  fr.seq = 3;
+  log.Log(&fr);
+  ASSERT_EQ(0, log.Close());
+
+  TagLogReader reader;
+  ASSERT_EQ(0, reader.Open(fname));
+  ASSERT_EQ(1, reader.Count());
+  ASSERT_EQ("0.375, 3", reader.Csv(reader.Record(0)));
+  remove(fname.c_str());
+}
+
+TEST(TestTagLog, SchemaIsFixedOnceOpen) {
+  std::string fname = TempName("taglog_schema.owtag");
+  TagLog log;
+  AddGroups(&log);
+  ASSERT_EQ(0, log.Open(fname));
+  ASSERT_EQ(-1, log.AddGroup("Late", { { "x", TagLog::INT32 } }, TagLog::Filler()));
+  ASSERT_EQ(0, log.Close());
+
+  TagLog again;
+  ASSERT_EQ(-1, again.Open(fname));  // Never overwrites a log
+  remove(fname.c_str());
+}
+
+TEST(TestTagLog, LogBeforeOpenIsIgnored) {
+  TagLog log;
+  AddGroups(&log);
+  Frame fr;
+  log.Log(&fr);
+  ASSERT_EQ(0, log.Close());
+  ASSERT_EQ(0, log.GetStats().records);
+}
@@ -0,0 +1,107 @@
+// Measure Frame::Write/Read throughput, against the old one-scanline-per-row layout,
+//   and the ratio and speed of each compression codec
+// Usage: tiff_bench [directory] [frames]
+//   directory defaults to /dev/shm (tmpfs) so the disk is not what is measured
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+#include "system/component/inc/bitpack.h"
+#include "system/component/inc/frame.h"
+#include "system/component/inc/time.h"
+#include "system/third_party/inc/tiffio.h"
+
+static const int IMG_X = 2712;
+static const int IMG_Y = 2080;
+
+// How Frame::Write used to lay out a file: one strip per row
+static int LegacyWrite(Frame* fr, const char* fname) {
+  TIFF* tiff = TIFFOpen(fname, "w");
+  if (!tiff) return -1;
+  TIFFSetField(tiff, TIFFTAG_IMAGEWIDTH, fr->width);
+  TIFFSetField(tiff, TIFFTAG_IMAGELENGTH, fr->height);
+  TIFFSetField(tiff, TIFFTAG_BITSPERSAMPLE, fr->bits);
+  TIFFSetField(tiff, TIFFTAG_COMPRESSION, COMPRESSION_NONE);
+  TIFFSetField(tiff, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK);
+  TIFFSetField(tiff, TIFFTAG_SAMPLESPERPIXEL, 1);
+  TIFFSetField(tiff, TIFFTAG_ROWSPERSTRIP, 1);
+  std::vector<uint8_t> line(BitPack::RowBytes(fr->width, fr->bits));
+  for (int j = 0; j < fr->height; ++j) {
+    void* row = (*fr)[j];
+    if (fr->bits != 16) {
+      BitPack::PackMsb((*fr)[j], fr->width, fr->bits, line.data());
+      row = line.data();
+    }
+    TIFFWriteScanline(tiff, row, j);
+  }
+  TIFFClose(tiff);
+  return 0;
+}
+
+static void Report(const char* what, int bits, int n, time_t ms) {
+  double s = ms / 1000.0;
+  double mb = (double)n * IMG_X * IMG_Y * bits / 8 / 1e6;
+  printf("%-16s %2d bits: %7.1f frames/s  %7.1f MB/s\n", what, bits, n / s, mb / s);
+}
+
+int main(int argc, char** argv) {
+  std::string dir = argc > 1 ? argv[1] : "/dev/shm";
+  int n = argc > 2 ? atoi(argv[2]) : 50;
+
+  Frame fr(IMG_X, IMG_Y);
+  for (int bits : { 10, 12, 16 }) {
+    fr.bits = bits;
+    for (int i = 0; i < IMG_X * IMG_Y; ++i) fr.data[i] = (i * 7) & ((1 << bits) - 1);
+    std::vector<std::string> names;
+    for (int i = 0; i < n; ++i) names.push_back(dir + "/tiff_bench" + std::to_string(i) + ".tiff");
+
+    time_t start = Component::SteadyClockTimeMs();
+    for (int i = 0; i < n; ++i) LegacyWrite(&fr, names[i].c_str());
+    Report("scanline write", bits, n, Component::SteadyClockTimeMs() - start);
+
+    Frame in(IMG_X, IMG_Y);
+    in.bits = bits;
+    start = Component::SteadyClockTimeMs();
+    for (int i = 0; i < n; ++i) in.Read(names[i].c_str());
+    Report("scanline read", bits, n, Component::SteadyClockTimeMs() - start);
+
+    start = Component::SteadyClockTimeMs();
+    for (int i = 0; i < n; ++i) {
+      if (fr.Write(names[i].c_str()) != 0) {
+        printf("ERROR: unable to write %s\n", names[i].c_str());
+        return -1;
+      }
+    }
+    Report("strip write", bits, n, Component::SteadyClockTimeMs() - start);
+
+    start = Component::SteadyClockTimeMs();
+    for (int i = 0; i < n; ++i) in.Read(names[i].c_str());
+    Report("strip read", bits, n, Component::SteadyClockTimeMs() - start);
+
+    static const char* codecs[Frame::N_COMPRESS] = { "none", "deflate", "lzw" };
+    for (int c = Frame::COMPRESS_DEFLATE; c < Frame::N_COMPRESS; ++c) {
+      fr.compression = c;
+      start = Component::SteadyClockTimeMs();
+      for (int i = 0; i < n; ++i) fr.Write(names[i].c_str());
+      Report((std::string(codecs[c]) + " write").c_str(), bits, n, Component::SteadyClockTimeMs() - start);
+      start = Component::SteadyClockTimeMs();
+      for (int i = 0; i < n; ++i) in.Read(names[i].c_str());
+      Report((std::string(codecs[c]) + " read").c_str(), bits, n, Component::SteadyClockTimeMs() - start);
+      struct stat st;
+      stat(names[0].c_str(), &st);
+      printf("%-16s %2d bits: ratio %.2f\n", codecs[c], bits, (double)IMG_X * IMG_Y * bits / 8 / st.st_size);
+    }
+    fr.compression = Frame::COMPRESS_NONE;
+
+    if (memcmp(fr.data, in.data, sizeof(uint16_t) * IMG_X * IMG_Y) != 0) {
+      printf("ERROR: %d-bit frame did not survive the round trip\n", bits);
+      return -1;
+    }
+    for (const std::string& name : names) remove(name.c_str());
+  }
+  return 0;
+}
@@ -0,0 +1,51 @@
+#include <thread>
+#include <vector>
+
+#include "googletest/googletest/include/gtest/gtest.h"
+#include "system/component/inc/triplebuf.h"
+
+TEST(TestTripleBuf, ReadsLatestValue) {
+  TripleBuf<int> buf;
+  ASSERT_FALSE(buf.Fresh());
+  ASSERT_EQ(0u, buf.Sequence());
+  for (int i = 1; i <= 3; ++i) {
+    buf.Write() = i * 10;
+    buf.Publish();
+  }
+  ASSERT_TRUE(buf.Fresh());
+  ASSERT_EQ(30, buf.Read());
+  ASSERT_EQ(3u, buf.Sequence());
+  ASSERT_FALSE(buf.Fresh());
+  ASSERT_EQ(30, buf.Read());  // No new value: same one again
+  ASSERT_EQ(3u, buf.Sequence());
+
+  buf.Write() = 40;
+  ASSERT_FALSE(buf.Fresh());  // Not until published
+  buf.Publish();
+  ASSERT_EQ(40, buf.Read());
+  ASSERT_EQ(4u, buf.Sequence());
+}
+
+TEST(TestTripleBuf, ReaderSeesWholeValues) {
+  // The writer fills every element of a value with its sequence number; the
+  // reader must never see a mix, or go backwards
+  static const uint64_t kValues = 20000;
+  TripleBuf<std::vector<uint64_t>> buf;
+  std::thread writer([&buf] {
+    for (uint64_t i = 1; i <= kValues; ++i) {
+      std::vector<uint64_t>& v = buf.Write();
+      v.assign(64, i);
+      buf.Publish();
+    }
+  });
+  uint64_t last = 0;
+  while (last < kValues) {
+    if (!buf.Fresh()) continue;
+    const std::vector<uint64_t>& v = buf.Read();
+    ASSERT_EQ(64u, v.size());
+    for (uint64_t x : v) ASSERT_EQ(buf.Sequence(), x);
+    ASSERT_GT(buf.Sequence(), last);
+    last = buf.Sequence();
+  }
+  writer.join();
+}
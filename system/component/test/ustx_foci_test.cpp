@@ -0,0 +1,125 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "googletest/googletest/include/gtest/gtest.h"
+#include "system/component/inc/ustx.h"
+
+using json = nlohmann::json;
+
+static std::string TempName(const std::string& name) {
+  return "ustx_foci_test_" + name;
+}
+
+static std::string ReadFile(const std::string& fname) {
+  std::ifstream f(fname);
+  std::stringstream ss;
+  ss << f.rdbuf();
+  return ss.str();
+}
+
+static uint64_t Fnv1a(const std::string& s) {
+  uint64_t hash = 14695981039346656037ull;
+  for (unsigned char c : s) {
+    hash ^= c;
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+// A 7 x 5 grid, 6 x 4 mm
+static void AddGrid(USTx& ustx) {
+  for (int xi = 0; xi < 7; ++xi) {
+    for (int zi = 0; zi < 5; ++zi) ustx.AddFocus(-0.006 + 0.002 * xi, 0.02 + 0.004 * zi);
+  }
+}
+
+// Hex files as computed one focus and one element at a time
+TEST(TestUSTxFoci, MatchReference) {
+  struct {
+    const char* params;
+    double delay;
+    uint64_t hash;
+    size_t size;
+  } cases[] = {
+    { R"({"probe":"L11-5v","frequency":5e6,"repeat_count":5})",
+      2.94379251828159e-05, 0x29b89daccdd7d683ull, 29284 },
+    { R"({"probe":"C5-2","n_elements":128,"pitch":4.8e-4,"radius":0.0495,"max_elements":30,"frequency":3e6,
+          "waveforms":2,"repeat_count":10})",
+      4.0506988095947587e-05, 0x8f576e79fefe6fbfull, 29328 },
+    { R"({"probe":"P4-2","n_elements":64,"pitch":3e-4,"max_elements":64,"frequency":2.5e6,"repeat_time":0.0001})",
+      2.8736852796613915e-05, 0x56ce49d5f1f3c28cull, 29388 },
+    { R"({"probe":"L11-5v","frequency":5e6,"cw_mode":true})",
+      2.94379251828159e-05, 0x6d0ba466379b7e3bull, 27268 },
+  };
+  for (const auto& c : cases) {
+    SCOPED_TRACE(c.params);
+    Serial serial;
+    USTx ustx(&serial);
+    ustx.LoadJson(json::parse(c.params));
+    AddGrid(ustx);
+    ASSERT_TRUE(ustx.ComputeFoci(TempName("foci.hex").c_str()));
+    EXPECT_DOUBLE_EQ(c.delay, ustx.GetDelay());
+    std::string hex = ReadFile(TempName("foci.hex"));
+    EXPECT_EQ(c.size, hex.size());
+    EXPECT_EQ(c.hash, Fnv1a(hex));
+  }
+  remove(TempName("foci.hex").c_str());
+}
+
+TEST(TestUSTxFoci, DelayTooLong) {
+  Serial serial;
+  USTx ustx(&serial);
+  // Slow enough that the elements' delays are too far apart
+  ustx.LoadJson(json::parse(R"({"probe":"P4-2","n_elements":64,"speed_sound":100,"foci":[[0,0.01],[0.009,0.005]]})"));
+  EXPECT_FALSE(ustx.ComputeFoci(TempName("foci.hex").c_str()));
+  EXPECT_LT(ustx.GetDelay(), 0);
+  remove(TempName("foci.hex").c_str());
+}
+
+TEST(TestUSTxFoci, UnknownProbe) {
+  Serial serial;
+  USTx ustx(&serial);
+  ustx.LoadJson(json::parse(R"({"probe":"X1-1","foci":[[0,0.01]]})"));
+  EXPECT_FALSE(ustx.ComputeFoci(TempName("foci.hex").c_str()));
+}
+
+TEST(TestUSTxFoci, CachesFocusList) {
+  json params = json::parse(R"({"probe":"L11-5v","frequency":5e6,"repeat_count":5})");
+  Serial serial;
+  USTx ustx(&serial);
+  ustx.LoadJson(params);
+  AddGrid(ustx);
+  ustx.SetCacheDir(".");
+  char cached[32];
+  snprintf(cached, sizeof(cached), "./ustx_%016llx.hex", (unsigned long long)ustx.FociHash());
+  remove(cached);
+
+  ASSERT_TRUE(ustx.ComputeFoci(TempName("a.hex").c_str()));
+  std::string hex = ReadFile(TempName("a.hex"));
+  EXPECT_EQ(hex, ReadFile(cached));
+
+  // The same foci again, from the cache
+  std::ofstream(cached) << "cached";
+  USTx again(&serial);
+  again.LoadJson(params);
+  AddGrid(again);
+  again.SetCacheDir(".");
+  ASSERT_TRUE(again.ComputeFoci(TempName("b.hex").c_str()));
+  EXPECT_EQ("cached", ReadFile(TempName("b.hex")));
+  EXPECT_DOUBLE_EQ(ustx.GetDelay(), again.GetDelay());
+
+  // Anything else is computed
+  uint64_t hash = again.FociHash();
+  again.AddFocus(0, 0.03);
+  EXPECT_NE(hash, again.FociHash());
+  USTx other(&serial);
+  other.LoadJson(json::parse(R"({"probe":"L11-5v","frequency":6e6,"repeat_count":5})"));
+  AddGrid(other);
+  EXPECT_NE(ustx.FociHash(), other.FociHash());
+
+  remove(cached);
+  remove(TempName("a.hex").c_str());
+  remove(TempName("b.hex").c_str());
+}
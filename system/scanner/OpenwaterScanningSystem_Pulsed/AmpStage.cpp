@@ -23,6 +23,8 @@ AmpStage::AmpStage() {
 }
 
 AmpStage::~AmpStage() {
+  delete pipeline_;
+  pipeline_ = NULL;
   delete rs232_;
   rs232_ = NULL;
 }
@@ -34,6 +36,11 @@ bool AmpStage::sendCommand(const char *cmd) {
   int cmdLen = (int)strlen(cmd);
   strncpy(buf + 2, cmd, cmdLen);
   buf[2 + cmdLen] = '\r';
+  if (pipeline_) {
+    // The drive acknowledges each command with "%" or "*", or "?" on an error
+    std::string ack = pipeline_->Request(std::string(buf, 2 + cmdLen + 1), "", 100).get();
+    return !ack.empty() && ack.find('?') == std::string::npos;
+  }
   return RS232_SendBuf(rs232_->Port(), (unsigned char*)buf, 2 + cmdLen + 1);
 }
 
@@ -41,7 +48,9 @@ bool AmpStage::init(int port) {
   if (!rs232_) {  // in case it's mocked
     rs232_ = new RS232();
   }
-  return rs232_->Open(port - 1, 9600, "8N1") == 0;
+  if (rs232_->Open(port - 1, 9600, "8N1") != 0) return false;
+  if (!pipeline_) pipeline_ = new SerialPipeline(rs232_, "\r");
+  return true;
 }
 
 int AmpStage::stageMoving() {
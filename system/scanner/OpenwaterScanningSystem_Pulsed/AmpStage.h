@@ -1,5 +1,6 @@
 #pragma once
 
+#include "SerialPipeline.h"
 #include "stages.h"
 
 class AmpStage: public Stage {
@@ -22,4 +23,6 @@ class AmpStage: public Stage {
 
  protected:
   bool sendCommand(const char *cmd);
+
+  SerialPipeline* pipeline_ = NULL;
 };
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include <thread>
 
@@ -41,6 +42,32 @@ bool AsyncScanner::initializeStage(Stage* stage, int comPort) {
   return true;
 }
 
+std::future<double> AsyncScanner::moveAsync(Stage* stage, double location_mm) {
+  return std::async(std::launch::async, [stage, location_mm] {
+    time_t start = Component::SteadyClockTimeMs();
+    stage->moveAbsolute(location_mm);  // Blocks until the stage stops
+    return double(Component::SteadyClockTimeMs() - start);
+  });
+}
+
+void AsyncScanner::startMove(const Position* from, const Position& to, std::vector<std::future<double>>* moves) {
+  // Each stage has its own COM port, so they can all be driven at once
+  if (xStage_ && (!from || from->x != to.x)) moves->push_back(moveAsync(xStage_, to.x));
+  if (yStage_ && (!from || from->y != to.y)) moves->push_back(moveAsync(yStage_, to.y));
+  if (zStage_ && (!from || from->z != to.z)) moves->push_back(moveAsync(zStage_, to.z));
+}
+
+void AsyncScanner::finishMove(std::vector<std::future<double>>* moves, SliceTiming* timing) {
+  time_t start = Component::SteadyClockTimeMs();
+  double move_ms = 0;
+  for (std::future<double>& move : *moves) move_ms = std::max(move_ms, move.get());  // Axes move together
+  moves->clear();
+  if (!timing) return;
+  timing->move_ms = move_ms;
+  timing->wait_ms = double(Component::SteadyClockTimeMs() - start);
+  timing->saved_ms = std::max(0.0, move_ms - timing->wait_ms);
+}
+
 bool AsyncScanner::scan() {
   const auto& scanParameters = systemParameters_["scanParameters"];
   double xROICenter_mm = scanParameters["xROICenter_mm"].get<double>();
@@ -66,72 +93,108 @@ bool AsyncScanner::scan() {
     return false;
   }
 
+  ScanPlan plan = planScan({ { "z", &zSteps }, { "y", &ySteps }, { "x", &xSteps } });
+  std::vector<Position> slices;
+  for (const ScanPlan::Pose& pose : plan.poses()) {
+    slices.push_back({ pose.location[2], pose.location[1], pose.location[0] });
+  }
+
+  timeline_.clear();
+  std::vector<std::future<double>> moves;
   bool cancel = CheckForCancel();
-  int sliceIdx = 0;
-  for (int zi = 0; zi < zSteps.values.size() && !cancel; zi++) {
-    double z = zSteps[zi];
-    if (zStage_) zStage_->moveAbsolute(z);
-
-    for (int yi = 0; yi < ySteps.values.size() && !cancel; yi++) {
-      double y = ySteps[yi];
-      if (yStage_) yStage_->moveAbsolute(y);
-
-      for (int xi = 0; xi < xSteps.values.size() && !cancel; xi++) {
-        double x = xSteps[xi];
-        if (xStage_) xStage_->moveAbsolute(x);
-        
-        if (ustx_) ustx_->SetFocus(0, true);  // Use incrementing
-
-        for (int azi = 0; azi < azimuthSteps.values.size() && !cancel; azi++) {
-
-          if (ustx_ && !cancel) {
-            int focusIdx = ustx_->GetFocus();
-            if (focusIdx != azi * numAxialSteps) {
-              LOG(WARNING) << "Unexpected ustx focus index: " << focusIdx;
-            }
-          }
+  if (!cancel && !slices.empty()) startMove(NULL, slices[0], &moves);
 
-          int maxErrors = 4;
-          int numErrors = 0;
-          while (cameras_ && !cancel) {
-            if (cameras_->captureAndWriteImagesAsync(numFociPerSlice_, sliceIdx, numAxialSteps, azi+1, frameGatePeriod_ms) == 1) break;
-            LOG(WARNING) << "Repeating axial column capture.";
-            if (ustx_) ustx_->SetFocus(azi * numAxialSteps, true);  // Use incrementing
-            cancel = CheckForCancel();
-            numErrors++;
-            if (numErrors > maxErrors) {
-              cameras_->resetAllCamerasMidscan(sliceIdx * numFociPerSlice_ + azi * numAxialSteps);
-              LOG(WARNING) << "Resetting all cameras due to excessive errors";
-            }
-          }
+  for (int sliceIdx = 0; sliceIdx < slices.size() && !cancel; sliceIdx++) {
+    SliceTiming timing;
+    finishMove(&moves, &timing);
+    time_t acquireStart = Component::SteadyClockTimeMs();
+    time_t checksStart = acquireStart;
+    bool nextMoveStarted = false;
 
-          // Check for thermal shutdown after each axial column
-          if (ustx_ && ustx_->ThermalShutdown()) {
-            ustx_->Reset();
-            LOG(WARNING) << "USTX reset after thermal shutdown";
-          }
+    // Frames, and so images, are numbered by raster index rather than scan
+    //   order, so they map to the same voxels whatever order the plan takes
+    int raster = plan.poses()[sliceIdx].raster;
+    if (cameras_) cameras_->setFrameCount(raster * numFociPerSlice_);
+
+    if (ustx_) ustx_->SetFocus(0, true);  // Use incrementing
+
+    for (int azi = 0; azi < azimuthSteps.values.size() && !cancel; azi++) {
+
+      if (ustx_ && !cancel) {
+        int focusIdx = ustx_->GetFocus();
+        if (focusIdx != azi * numAxialSteps) {
+          LOG(WARNING) << "Unexpected ustx focus index: " << focusIdx;
         }
+      }
 
-        // Check that full axial/azimuth slice completed and focus list reindexed to zero
-        if (ustx_) {
-          int focusIdx = ustx_->GetFocus();
-          if (focusIdx != 0) {
-            LOG(WARNING) << "Unexpected ustx focus index after slice: " << focusIdx;
+      int maxErrors = 4;
+      int numErrors = 0;
+      while (cameras_ && !cancel) {
+        if (cameras_->captureAndWriteImagesAsync(numFociPerSlice_, raster, numAxialSteps, azi+1, frameGatePeriod_ms) == 1) break;
+        LOG(WARNING) << "Repeating axial column capture.";
+        if (ustx_) ustx_->SetFocus(azi * numAxialSteps, true);  // Use incrementing
+        cancel = CheckForCancel();
+        numErrors++;
+        if (numErrors > maxErrors) {
+          LOG(WARNING) << "Resetting all cameras due to excessive errors";
+          if (!cameras_->resetAllCamerasMidscan(raster * numFociPerSlice_ + azi * numAxialSteps)) {
+            LOG(ERROR) << "Camera reset failed, cancelling scan";
+            cancel = true;
           }
         }
-        
-        sliceIdx++;
+      }
 
-        // Periodically check for cancel.
-        cancel = CheckForCancel();
+      // The last exposure is done, so the stages can head for the next slice
+      //   while the checks below run and the pipeline processes this one
+      if (azi == azimuthSteps.values.size() - 1 && !cancel) {
+        checksStart = Component::SteadyClockTimeMs();
+        if (sliceIdx + 1 < slices.size()) startMove(&slices[sliceIdx], slices[sliceIdx + 1], &moves);
+        nextMoveStarted = true;
+      }
+
+      // Check for thermal shutdown after each axial column
+      if (ustx_ && ustx_->ThermalShutdown()) {
+        ustx_->Reset();
+        LOG(WARNING) << "USTX reset after thermal shutdown";
+      }
+    }
+    if (!nextMoveStarted) checksStart = Component::SteadyClockTimeMs();
+
+    // Check that full axial/azimuth slice completed and focus list reindexed to zero
+    if (ustx_) {
+      int focusIdx = ustx_->GetFocus();
+      if (focusIdx != 0) {
+        LOG(WARNING) << "Unexpected ustx focus index after slice: " << focusIdx;
       }
     }
+
+    // Periodically check for cancel.
+    cancel = CheckForCancel();
+    if (!nextMoveStarted && !cancel && sliceIdx + 1 < slices.size()) {
+      startMove(&slices[sliceIdx], slices[sliceIdx + 1], &moves);
+    }
+
+    time_t now = Component::SteadyClockTimeMs();
+    timing.acquire_ms = double(checksStart - acquireStart);
+    timing.checks_ms = double(now - checksStart);
+    timeline_.push_back(timing);
+    LOG(INFO) << "Slice " << sliceIdx << ": move " << timing.move_ms << " ms, waited " << timing.wait_ms
+              << " ms, acquire " << timing.acquire_ms << " ms, checks " << timing.checks_ms
+              << " ms, saved " << timing.saved_ms << " ms";
+  }
+  finishMove(&moves, NULL);  // Cancelled with the next slice's move under way
+
+  double saved_ms = 0, waited_ms = 0;
+  for (const SliceTiming& timing : timeline_) {
+    saved_ms += timing.saved_ms;
+    waited_ms += timing.wait_ms;
   }
+  LOG(INFO) << "Overlapped stage motion saved " << saved_ms / 1000 << " s over " << timeline_.size()
+            << " slices, " << waited_ms / 1000 << " s still spent waiting on stages";
 
   // Move Stages back to centered and closest
-  if (xStage_) xStage_->moveAbsolute(xROICenter_mm);
-  if (yStage_) yStage_->moveAbsolute(yROICenter_mm);
-  if (zStage_) zStage_->moveAbsolute(zClosest_mm);
+  startMove(NULL, { xROICenter_mm, yROICenter_mm, zClosest_mm }, &moves);
+  finishMove(&moves, NULL);
 
   if (xStage_) xStage_->disableController();
   if (yStage_) yStage_->disableController();
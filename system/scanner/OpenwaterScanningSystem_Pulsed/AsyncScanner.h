@@ -1,3 +1,6 @@
+#include <future>
+#include <vector>
+
 #include "scanner.h"
 
 class ConexStage;
@@ -16,8 +19,38 @@ public:
   bool init() override;
   bool scan() override;
 
+  // Where one slice spent its time.  Stages move into slice i+1 while slice
+  //   i's post-capture checks run, rather than after them.
+  struct SliceTiming {
+    double move_ms = 0;     // stage motion into the slice, ie. the longest axis move
+    double wait_ms = 0;     // stalled on that motion before the first exposure
+    double acquire_ms = 0;  // first exposure to last
+    double checks_ms = 0;   // thermal, focus and cancel checks after the last exposure
+    double saved_ms = 0;    // idle time removed versus moving serially after the checks
+  };
+
+  // One entry per slice of the last scan()
+  const std::vector<SliceTiming>& timeline() const { return timeline_; }
+
 protected:
+  struct Position {
+    double x, y, z;
+  };
+
   bool initializeStage(Stage* stage, int comPort);
 
+  // Move a stage on its own thread
+  // @returns future holding how long the move took in ms
+  static std::future<double> moveAsync(Stage* stage, double location_mm);
+
+  // Start moving every stage whose location changes.  Axes move concurrently
+  // @param from locations, or NULL if unknown and every stage moves
+  void startMove(const Position* from, const Position& to, std::vector<std::future<double>>* moves);
+
+  // Wait for moves from startMove()
+  // @param timing (optional) gets the summed move time and time waited
+  void finishMove(std::vector<std::future<double>>* moves, SliceTiming* timing);
+
   ConexStage* xStage_, * yStage_, * zStage_;
+  std::vector<SliceTiming> timeline_;
 };
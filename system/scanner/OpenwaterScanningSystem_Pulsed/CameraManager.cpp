@@ -1,12 +1,20 @@
+#include <algorithm>
+#include <cmath>
+#include <future>
 #include <iostream>
+#include <thread>
 #include <time.h>
 
 #include "CameraManager.h"
 #include "FrameSave.h"
 #include "VoxelSave.h"
+#include "VoxelSink.h"
 
 #include "system/component/inc/fftt.h"
+#include "system/component/inc/filemirror.h"
+#include "system/component/inc/framestore.h"
 #include "system/component/inc/fx3.h"
+#include "system/component/inc/multicamerajoin.h"
 #include "system/component/inc/rcam.h"
 #include "system/component/inc/roi.h"
 #include "system/component/inc/stddev.h"
@@ -24,8 +32,17 @@ CameraManager::~CameraManager() {
     delete info.roi;
     delete info.stdDev;
     delete info.frameSave;
-    delete info.voxelSave;
   }
+  delete cameraJoin_;
+  delete voxelSave_;
+  delete frameStore_;  // Before the mirror: the store reports files to it as they are written
+  delete voxelSink_;
+  if (fileMirror_ && !fileMirror_->Wait(0)) {
+    // Finish mirroring before exiting; if interrupted, the journal has what is left
+    std::cout << "INFO: Waiting for " << fileMirror_->GetBacklog().files_pending << " raw images to mirror" << std::endl;
+    fileMirror_->Wait();
+  }
+  delete fileMirror_;
 }
 
 bool CameraManager::init(const json& systemParameters, Trigger* trigger) {
@@ -53,6 +70,30 @@ bool CameraManager::init(const json& systemParameters, Trigger* trigger) {
   int pulsedSystem = systemParameters["laserParameters"]["pulsed"].get<int>();
   std::string usAmplifier = systemParameters["ultrasoundParameters"]["ultrasoundAmp"].get<std::string>();
   syncedRawImageDir_ = systemParameters["fileParameters"]["syncedRawImageDir"].get<std::string>();
+  // Optional: one FrameFile container per camera instead of one TIFF per frame
+  rawImageContainer_ = systemParameters["fileParameters"].value("rawImageContainer", 0) != 0;
+  // Optional: write raw images to fast local storage, and copy them to syncedRawImageDir
+  // in the background at up to mirrorMaxMBps (0 for no limit)
+  localRawImageDir_ = systemParameters["fileParameters"].value("localRawImageDir", std::string(""));
+  double mirrorMaxMBps = systemParameters["fileParameters"].value("mirrorMaxMBps", 0.0);
+  // Optional: how often voxel results are copied to the synced imageInfo file
+  int imageInfoMirrorPeriod_ms = systemParameters["fileParameters"].value("imageInfoMirrorPeriod_ms", 2000);
+  // Optional: how long to wait for a camera's frame of a voxel, when it sends nothing later, before writing without it
+  int cameraJoinTimeout_ms = camParams.value("cameraJoinTimeout_ms", 50);
+  // Optional: transform up to fftMaxBatch frames at once when they back up (1 for each on its own)
+  int fftMaxBatch = camParams.value("fftMaxBatch", 1);
+  int fftBatchLatency_ms = camParams.value("fftBatchLatency_ms", 20);
+  // Optional: lossless compression of raw TIFFs, "none", "deflate" or "lzw"
+  std::string rawImageCompression = systemParameters["fileParameters"].value("rawImageCompression", std::string("none"));
+  int compression = Frame::COMPRESS_NONE;
+  if (rawImageCompression == "deflate") {
+    compression = Frame::COMPRESS_DEFLATE;
+  } else if (rawImageCompression == "lzw") {
+    compression = Frame::COMPRESS_LZW;
+  } else if (rawImageCompression != "none") {
+    std::cout << "Error: unknown rawImageCompression " << rawImageCompression << std::endl;
+    return false;
+  }
 
   // How many cameras are in the system?
   int numCameras = Rcam::NumCameras();
@@ -63,7 +104,28 @@ bool CameraManager::init(const json& systemParameters, Trigger* trigger) {
     return false;
   }
 
+  // Raw images are written by the frame store's own threads so disk latency
+  // never holds up the processing chain.  Compression runs on the same threads,
+  // so give it more of them.
+  int storeThreads = 2;
+  if (compression != Frame::COMPRESS_NONE) storeThreads = std::max(2, (int)std::thread::hardware_concurrency() / 2);
+  frameStore_ = new FrameStore(storeThreads, 8 * numCameras);
+  frameStore_->SetCompression(compression);
+
+  // The sync client then only ever competes with the mirror for the synced disk,
+  // never with acquisition.  The journal lets an interrupted mirror resume.
+  std::string rawImageDir = syncedRawImageDir_;
+  if (localRawImageDir_ != "" && syncedRawImageDir_ != "") {
+    rawImageDir = localRawImageDir_;
+    fileMirror_ = new FileMirror(localRawImageDir_ + "/mirror.journal", mirrorMaxMBps);
+    frameStore_->SetOnWritten([this](const std::string& fname) { fileMirror_->Copy(fname, syncedPath(fname)); });
+  }
+
+  voxelSink_ = new VoxelSink(100, imageInfoMirrorPeriod_ms);
+  voxelSink_->SetStreams(imageInfoLocal_, imageInfoSynced_);
+
   // Set up cameras and image processing pipeline
+  std::vector<int> cameraIDs;
   for (int i = 0; i < numCameras; i++) {
     Rcam* camera = new Rcam();
     if (camera->Open(i) != 0) return false;  // error msgs will come from Open()
@@ -76,10 +138,13 @@ bool CameraManager::init(const json& systemParameters, Trigger* trigger) {
     cameraInfo.camera = camera;
     cameraInfo.portNumber = i;
     cameraInfo.fftt = new FFTT(resolutionX, resolutionY);
+    cameraInfo.fftt->SetBatch(fftMaxBatch, fftBatchLatency_ms);
     cameraInfo.roi = new ROI(resolutionX, resolutionY);
     cameraInfo.stdDev = new StdDev();
     cameraInfo.frameSave = new FrameSave();
-    cameraInfo.voxelSave = new VoxelSave(this);
+    cameraInfo.frameSave->setFrameStore(frameStore_);
+    cameraInfo.frameSave->setContainer(rawImageContainer_);
+    cameraIDs.push_back(cameraID);
 
     cameraInfo.camera->SetExposure(exposureTime_s_);
     cameraInfo.camera->SubWindow2Point(0, 0, resolutionX, resolutionY);
@@ -94,33 +159,53 @@ bool CameraManager::init(const json& systemParameters, Trigger* trigger) {
     cameraInfo.roi->Set(ROI_xCenter, ROI_yCenter, ROI_radius);
     cameraInfo.stdDev->AddProducer(cameraInfo.roi);
     cameraInfo.frameSave->AddProducer(cameraInfo.stdDev);
-    cameraInfo.voxelSave->AddProducer(cameraInfo.frameSave);
 
-    if (syncedRawImageDir_ != "") {
-      cameraInfo.frameSave->setFilename(syncedRawImageDir_ + "/camera" + std::to_string(cameraID) + "/hologramImage");
+    if (rawImageDir != "") {
+      cameraInfo.frameSave->setFilename(rawImageDir + "/camera" + std::to_string(cameraID) + "/hologramImage");
     }
     cameraInfo.camera->resize(30);
   }
 
+  // One voxel's results from every camera are written together
+  cameraJoin_ = new MultiCameraJoin(cameraIDs, cameraJoinTimeout_ms);
+  for (int cameraID : cameraIDs) {
+    cameraJoin_->AddProducer(cameraInfoMap_[cameraID].frameSave);
+  }
+  cameraJoin_->resize(30 * numCameras);  // Holds every camera's frames in flight
+  voxelSave_ = new VoxelSave(this);
+  voxelSave_->AddProducer(cameraJoin_);
+
   trigger_ = trigger;
 
   return true;
 }
 
 void CameraManager::writeVoxelData(const voxelData& newVoxelData) {
-  std::lock_guard<std::mutex> lock(voxelDataMutex_);
-  voxelData& v = cameraInfoMap_[newVoxelData.cameraID].voxelData;
-
-  v.cameraID = newVoxelData.cameraID;
-  v.imageName = newVoxelData.imageName; // Based on fr->seq
-  v.roiFFTEnergy = newVoxelData.roiFFTEnergy;
-  v.rouFFTEnergy = newVoxelData.rouFFTEnergy;
-  v.imageMean = newVoxelData.imageMean;
-  v.POSIXTime = newVoxelData.POSIXTime;
-  v.speckleContrast = newVoxelData.speckleContrast;
-
-  v >> (*imageInfoLocal_);
-  v >> (*imageInfoSynced_);
+  writeVoxelData(std::vector<voxelData>(1, newVoxelData));
+}
+
+void CameraManager::writeVoxelData(const std::vector<voxelData>& newVoxelData) {
+  std::vector<voxelData> rows;
+  for (const voxelData& vd : newVoxelData) {
+    // Start from the camera's fixed fields; the map is not modified while scanning
+    auto info = cameraInfoMap_.find(vd.cameraID);
+    voxelData v = info != cameraInfoMap_.end() ? info->second.voxelData : voxelData();
+
+    v.cameraID = vd.cameraID;
+    v.imageName = vd.imageName; // Based on fr->seq
+    v.roiFFTEnergy = vd.roiFFTEnergy;
+    v.rouFFTEnergy = vd.rouFFTEnergy;
+    v.imageMean = vd.imageMean;
+    v.POSIXTime = vd.POSIXTime;
+    v.speckleContrast = vd.speckleContrast;
+    rows.push_back(v);
+  }
+
+  voxelSink_->Append(rows);
+}
+
+std::string CameraManager::syncedPath(const std::string& localPath) const {
+  return syncedRawImageDir_ + localPath.substr(localRawImageDir_.size());
 }
 
 void CameraManager::setImageInfoStream(std::ofstream* stream, bool local) {
@@ -129,6 +214,7 @@ void CameraManager::setImageInfoStream(std::ofstream* stream, bool local) {
   } else {
     imageInfoSynced_ = stream;
   }
+  if (voxelSink_) voxelSink_->SetStreams(imageInfoLocal_, imageInfoSynced_);
 }
 
 void CameraManager::setRepeatedVoxelLogStream(std::ofstream* stream) {
@@ -144,33 +230,68 @@ void CameraManager::startAllCameras() {
   Component::SleepMs(1000);  // Magic sleep to ensure 2 FSIN pulses before frame valid
 }
 
-Rcam* CameraManager::resetCameraMidscan(Rcam* camera) {
-  camera->Reset();
+bool CameraManager::resetCameraMidscan(Rcam* camera) {
+  if (int err = camera->Reset()) {
+    std::cout << "ERROR: Camera failed to reset (err = " << err << ")" << std::endl;
+    return false;
+  }
   camera->SetExposure(exposureTime_s_);
   camera->Start();
   Component::SleepMs(50);
-  return camera;
+  return true;
 }
 
-void CameraManager::resetAllCamerasMidscan(int frameCount) {
+void CameraManager::setFrameCount(int frameCount) {
+  for (auto& info : cameraInfoMap_) {
+    info.second.camera->SetFrameCount(frameCount);
+  }
+}
+
+bool CameraManager::resetAllCamerasMidscan(int frameCount) {
+  // Each camera is its own device, and a reset is mostly waiting for it to come
+  // back: reset them together rather than one after another
+  std::vector<std::pair<Rcam*, std::future<bool>>> resets;
   for (json::iterator id = cameraIDNumbers_.begin(); id != cameraIDNumbers_.end(); id++) {
     int cameraID = std::stoi(id.key());
     Rcam* camera = cameraInfoMap_[cameraID].camera;
-    resetCameraMidscan(camera);
-    camera->SetFrameCount(frameCount);
+    resets.emplace_back(camera, std::async(std::launch::async, [this, camera] { return resetCameraMidscan(camera); }));
+  }
+  bool ok = true;
+  for (auto& reset : resets) {
+    if (reset.second.get()) {
+      reset.first->SetFrameCount(frameCount);
+    } else {
+      ok = false;
+    }
   }
+  return ok;
 }
 
 int CameraManager::captureAndWriteImagesAsync(int numFociPerSlice, int sliceIdx, int numFociPerRow, int axialRowIdx, double frameGatePeriod_ms) {
+  for (auto& info : cameraInfoMap_) info.second.frameSave->setVoxelGrid(numFociPerRow, numFociPerSlice);
+
   // Axial Row Acquisition Trigger
+  time_t start = Component::SteadyClockTimeMs();
   trigger_->triggerAcquisition();  // Trigger image acquisition cascade
-  Component::SleepMs(frameGatePeriod_ms + 3.0*frameGatePeriod_ms/numFociPerRow);  // Ensure last frame is triggered, exposure completes, and transfers over usb
+  // Carry on as soon as every camera has the column's last frame.  The deadline allows for the last
+  // frame to be triggered, exposure to complete, and the frame to transfer over usb
+  int expectedFrames = sliceIdx * numFociPerSlice + axialRowIdx * numFociPerRow;
+  double budget_ms = frameGatePeriod_ms + 3.0*frameGatePeriod_ms/numFociPerRow;
+  if (waitForFrameCount(expectedFrames, budget_ms - (Component::SteadyClockTimeMs() - start))) {
+    // Give any extra frame one frame period to turn up, so it is caught against this column
+    //   rather than the next
+    std::this_thread::sleep_for(std::chrono::microseconds((long)(1000.0 * frameGatePeriod_ms / numFociPerRow)));
+  }
+  double waited_ms = (double)(Component::SteadyClockTimeMs() - start);
+  ++columns_;
+  columnWait_ms_ += waited_ms;
+  columnBudget_ms_ += budget_ms;
 
   for (json::iterator id = cameraIDNumbers_.begin(); id != cameraIDNumbers_.end(); id++) {
     int cameraID = std::stoi(id.key());
     Rcam* camera = cameraInfoMap_[cameraID].camera;
-    if (camera->GetFrameCount() != sliceIdx * numFociPerSlice + axialRowIdx * numFociPerRow) {
-      std::cout << "WARNING: Expected Frames: " << sliceIdx * numFociPerSlice + axialRowIdx * numFociPerRow << std::endl;
+    if (camera->GetFrameCount() != expectedFrames) {
+      std::cout << "WARNING: Expected Frames: " << expectedFrames << std::endl;
       std::cout << "WARNING: Frames: " << camera->GetFrameCount() << std::endl;
       std::cout << "WARNING: Dropped Frames: " << camera->DroppedFrames() << std::endl;
       *repeatedVoxelLog_ << sliceIdx * numFociPerSlice + (axialRowIdx - 1) * numFociPerRow << std::endl;
@@ -181,18 +302,84 @@ int CameraManager::captureAndWriteImagesAsync(int numFociPerSlice, int sliceIdx,
   return 1;
 }
 
+bool CameraManager::waitForFrameCount(int count, double timeout_ms) {
+  time_t deadline = Component::SteadyClockTimeMs() + (time_t)ceil(timeout_ms);
+  bool all = true;
+  for (auto& info : cameraInfoMap_) {
+    double left_ms = (double)(deadline - Component::SteadyClockTimeMs());
+    if (!info.second.camera->WaitFrameCount(count, std::max(0.0, left_ms))) all = false;
+  }
+  return all;
+}
+
 bool CameraManager::endExecNodes() {
+  if (columns_) {
+    std::cout << "INFO: Axial columns: " << columns_ << ", waited " << columnWait_ms_ / columns_ << " ms per column for frames, saving "
+              << (columnBudget_ms_ - columnWait_ms_) / columns_ << " ms per column over the fixed frame gate wait" << std::endl;
+  }
   for (json::iterator id = cameraIDNumbers_.begin(); id != cameraIDNumbers_.end(); id++) {
     int cameraID = std::stoi(id.key());
     Rcam* camera = cameraInfoMap_[cameraID].camera;
     std::cout << "INFO: Camera " << cameraID << " Frames: " << camera->GetFrameCount() << std::endl;
     std::cout << "INFO: Camera " << cameraID << " Dropped Frames: " << camera->DroppedFrames() << std::endl;
+    FFTBatch::Stats fftBatch = cameraInfoMap_[cameraID].fftt->GetBatchStats();
+    if (fftBatch.batches) {
+      std::cout << "INFO: Camera " << cameraID << " FFT batches: " << fftBatch.batches << " (" << fftBatch.frames
+                << " frames, largest " << fftBatch.largest << ")" << std::endl;
+    }
 
-    while (!cameraInfoMap_[cameraID].camera->IsExecDone()) {
-      // Note: do not call IsExecDone from voxelSave, it will return done when it is not actually done
+    // Note: do not wait on voxelSave, it will report done when it is not actually done
+    std::future<void> done = camera->Drain();
+    while (done.wait_for(std::chrono::seconds(1)) != std::future_status::ready) {
       std::cout << "INFO: waiting For Exec Nodes to finish" << std::endl;
-      Component::SleepMs(1000);
     }
   }
-  return true;
+
+  if (cameraJoin_) {
+    MultiCameraJoin::Stats stats = cameraJoin_->GetStats();
+    std::cout << "INFO: Voxels from all cameras: " << stats.complete << std::endl;
+    if (stats.partial) {
+      std::cout << "WARNING: Voxels missing a camera's frame: " << stats.partial << std::endl;
+    }
+  }
+
+  bool ok = true;
+  if (voxelSink_) {
+    ok = voxelSink_->Flush();
+    std::cout << "INFO: Voxel results written: " << voxelSink_->GetStats().records << std::endl;
+    if (!ok) {
+      std::cout << "ERROR: unable to write imageInfo" << std::endl;
+    }
+  }
+
+  if (frameStore_) {
+    int errors = frameStore_->Flush();
+    FrameStore::Stats stats = frameStore_->GetStats();
+    std::cout << "INFO: Frames written: " << stats.frames_written << " (" << stats.mb_per_s << " MB/s, max queue depth "
+              << stats.max_queue_depth << ")" << std::endl;
+    static const char* codecNames[Frame::N_COMPRESS] = { "none", "deflate", "lzw" };
+    for (int i = Frame::COMPRESS_DEFLATE; i < Frame::N_COMPRESS; ++i) {
+      const FrameStore::CodecStats& codec = stats.codec[i];
+      if (codec.frames == 0) continue;
+      std::cout << "INFO: " << codecNames[i] << ": " << codec.frames << " frames, ratio " << codec.ratio << ", "
+                << codec.mb_per_s << " MB/s per thread" << std::endl;
+    }
+    if (stats.frames_fallback) {
+      std::cout << "WARNING: " << stats.frames_fallback << " frames written uncompressed to keep up" << std::endl;
+    }
+    if (errors) {
+      std::cout << "ERROR: " << errors << " frames failed to write" << std::endl;
+      ok = false;
+    }
+  }
+
+  // Containers are finished and mirrored even after errors, for the frames that were written
+  for (auto& info : cameraInfoMap_) {
+    info.second.frameSave->close();
+    std::string container = info.second.frameSave->getFilename() + ".owf";
+    if (fileMirror_ && rawImageContainer_ && std::ifstream(container).good()) {
+      fileMirror_->Copy(container, syncedPath(container));
+    }
+  }
+  return ok;
 }
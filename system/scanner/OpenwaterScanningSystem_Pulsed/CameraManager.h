@@ -1,6 +1,7 @@
 #pragma once
 
 #include <mutex>
+#include <vector>
 
 #include "system/third_party/json-develop/single_include/nlohmann/json.hpp"
 
@@ -8,11 +9,15 @@
 #include "VoxelData.h"
 
 class FFTT;
+class FileMirror;
+class MultiCameraJoin;
 class Rcam;
 class ROI;
 class StdDev;
 class FrameSave;
+class FrameStore;
 class VoxelSave;
+class VoxelSink;
 
 // Encapsulate all the expertise on [multi]camera handling for scanning.
 class CameraManager {
@@ -32,29 +37,64 @@ class CameraManager {
   // ustx become out of sync
   virtual int captureAndWriteImagesAsync(int numFociPerSlice, int sliceIdx, int numFociPerRow, int axialRowIdx, double frameGatePeriod_s);
 
+  // Wait for every camera to have received count frames since its frame count was last set
+  // @param timeout_ms how long to wait for all of them
+  // @returns true if they all did
+  bool waitForFrameCount(int count, double timeout_ms);
+
+  // Queue a voxel result to be written to the imageInfo streams.  Does not block
   void writeVoxelData(const voxelData& newVoxelData);
 
+  // Queue one voxel's results from several cameras, written together
+  void writeVoxelData(const std::vector<voxelData>& newVoxelData);
+
+  // Set where voxel results are written.  The local stream is written in
+  // batches as results arrive; the synced stream is updated periodically
   void setImageInfoStream(std::ofstream* stream, bool local = true);
 
   void setRepeatedVoxelLogStream(std::ofstream* stream);
 
   void startAllCameras();
 
-  void resetAllCamerasMidscan(int frameCount);
+  // Set every camera's frame count, which numbers the frames that follow
+  void setFrameCount(int frameCount);
+
+  // Reset every camera, and restart them at frameCount
+  // @returns false if any camera failed to reset
+  bool resetAllCamerasMidscan(int frameCount);
 
-  Rcam* resetCameraMidscan(Rcam* camera);
+  bool resetCameraMidscan(Rcam* camera);
 
+  // Wait for all exec nodes to finish, then for queued frames and voxel
+  // results to reach disk
   bool endExecNodes();
 
+  // Background copier from local storage to the synced directories, or NULL
+  // when raw images are written straight to syncedRawImageDir
+  FileMirror* fileMirror() { return fileMirror_; }
+
  private:
+  // Where a file written under localRawImageDir is mirrored to
+  std::string syncedPath(const std::string& localPath) const;
+
   Trigger* trigger_;  // Not owned
   double exposureTime_s_;
   std::string syncedRawImageDir_;
+  std::string localRawImageDir_;
+  bool rawImageContainer_ = false;
   json cameraIDNumbers_;
-  std::ofstream* imageInfoLocal_;
-  std::ofstream* imageInfoSynced_;
+  std::ofstream* imageInfoLocal_ = NULL;
+  std::ofstream* imageInfoSynced_ = NULL;
   std::ofstream* repeatedVoxelLog_;
-  std::mutex voxelDataMutex_;
+  FrameStore* frameStore_ = NULL;  // Write-behind storage shared by all cameras' FrameSave nodes
+  VoxelSink* voxelSink_ = NULL;    // Batched writer for imageInfo
+  FileMirror* fileMirror_ = NULL;  // Copies local raw images to syncedRawImageDir
+  // Axial columns acquired, and time spent waiting for their frames against the worst case allowed
+  int columns_ = 0;
+  double columnWait_ms_ = 0;
+  double columnBudget_ms_ = 0;
+  MultiCameraJoin* cameraJoin_ = NULL;  // Groups every camera's frame of a voxel
+  VoxelSave* voxelSave_ = NULL;         // Writes each voxel's group of results
 
   // Container mapping each cameraID attached [key: (int) cameraID#, value: struct]
   struct cameraInfo {
@@ -66,7 +106,6 @@ class CameraManager {
     ROI* roi;
     StdDev* stdDev;
     FrameSave* frameSave;
-    VoxelSave* voxelSave;
   };
   std::map<int, cameraInfo> cameraInfoMap_;
 };
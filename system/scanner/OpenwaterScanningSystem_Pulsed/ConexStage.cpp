@@ -5,6 +5,7 @@
 
 #include "ConexStage.h"
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <stdio.h>
@@ -12,22 +13,98 @@
 #include <string>
 #include <thread>
 
+#include "system/component/inc/time.h"
 #include "system/third_party/rs232/rs232.h"
 
 ConexStage::ConexStage() {
 }
 
 ConexStage::~ConexStage() {
+  delete pipeline_;
+  pipeline_ = NULL;
 }
 
 bool ConexStage::init(int port) {
   if (!rs232_) {  // in case it's mocked
     rs232_ = new RS232();
   }
-  return rs232_->Open(port - 1, 921600, "8N1") == 0;
+  if (rs232_->Open(port - 1, 921600, "8N1") != 0) return false;
+  if (!pipeline_) pipeline_ = new SerialPipeline(rs232_);
+
+  // Predict moves from the controller's own velocity profile
+  double velocity_mm_s = atof(query("1VA?\r\n", "1VA").c_str());
+  double acceleration_mm_s2 = atof(query("1AC?\r\n", "1AC").c_str());
+  if (velocity_mm_s > 0 && acceleration_mm_s2 > 0) setVelocityProfile(velocity_mm_s, acceleration_mm_s2);
+  return true;
 }
 
-int ConexStage::stageMoving() {
+int ConexStage::send(const std::string& command) {
+  if (pipeline_) return pipeline_->Send(command) ? (int)command.size() : 0;
+  return rs232_->SendString(command);
+}
+
+std::string ConexStage::query(const std::string& command, const std::string& prefix, int timeout_ms) {
+  std::string reply = pipeline_->Request(command, prefix, timeout_ms).get();
+  return reply.empty() ? "" : reply.substr(prefix.size());
+}
+
+void ConexStage::setVelocityProfile(double velocity_mm_s, double acceleration_mm_s2) {
+  velocity_mm_s_ = velocity_mm_s;
+  acceleration_mm_s2_ = acceleration_mm_s2;
+}
+
+double ConexStage::predictMove(double distance_mm) const {
+  // Trapezoidal profile, or triangular if the stage never reaches full speed
+  double d = fabs(distance_mm);
+  double ramp_mm = velocity_mm_s_ * velocity_mm_s_ / acceleration_mm_s2_;
+  if (d <= ramp_mm) return 1000 * 2 * sqrt(d / acceleration_mm_s2_);
+  return 1000 * (d / velocity_mm_s_ + velocity_mm_s_ / acceleration_mm_s2_);
+}
+
+ConexStage::Stats ConexStage::getStats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+int ConexStage::waitReady(double predicted_ms) {
+  if (!pipeline_) return stageMoving();
+
+  time_t start = Component::SteadyClockTimeMs();
+  double scale = getStats().moveTimeScale;
+  // Asking before the move can have finished only adds serial traffic
+  time_t first_ms = (time_t)(0.9 * scale * predicted_ms);
+  Component::SleepMs(first_ms);
+
+  int state = 1;
+  int queries = 0, missed = 0;
+  while (state == 1) {
+    std::string reply = query("1TS\r\n", "1TS");
+    queries++;
+    if (reply.size() < 6) {
+      if (++missed > 5) state = -1;
+      continue;
+    }
+    std::string status = "1TS" + reply;
+    state = parseStatus((const unsigned char*)status.c_str());
+    if (state == 1) {
+      // Back off if the move runs far past its prediction
+      Component::SleepMs(Component::SteadyClockTimeMs() - start > 2 * first_ms + 1000 ? 50 : 10);
+    }
+  }
+
+  double actual_ms = double(Component::SteadyClockTimeMs() - start);
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.statusQueries += queries;
+  if (predicted_ms > 0 && state == 0) {
+    stats_.moves++;
+    // Ready at the first query says only that the move took no longer than predicted
+    double ratio = queries == 1 ? 0.8 * scale : actual_ms / predicted_ms;
+    stats_.moveTimeScale = std::min(10.0, std::max(0.1, 0.5 * stats_.moveTimeScale + 0.5 * ratio));
+  }
+  return state == 0 ? 0 : -1;
+}
+
+int ConexStage::parseStatus(const unsigned char* stagePollBuf) {
   const unsigned char readyFromHoming = '2';
   const unsigned char readyFromMoving = '3';
   const unsigned char nrFromReset = 'A';
@@ -37,45 +114,57 @@ int ConexStage::stageMoving() {
   const unsigned char nrFromReady = 'E';
   const unsigned char nr = '0';
 
+  // Warn on detected errors (per ref PDF, above). The last two, the "end of run" errors,
+  // are likely fatal. TODO(cregan/jfs): Kill the scan on these errors?
+  unsigned int // B = std::stoul(std::to_string(stagePollBuf[4]), NULL, 16),
+               // C = std::stoul(std::to_string(stagePollBuf[5]), NULL, 16),
+               D = std::stoul(std::to_string(stagePollBuf[6]), NULL, 16);
+  int port = this->getCOMPortNum() + 1;
+  std::string prefix = "WARNING: Stage error (COM" + std::to_string(port) + "): ";
+  #if 0  // These occur often and are not worth logging.
+  if (B & 2) { std::cerr << prefix << "80 W output power exceeded.\n" << std::flush; }
+  if (B & 1) { std::cerr << prefix << "DC voltage too low.\n" << std::flush; }
+  if (C & 8) { std::cerr << prefix << "Wrong ESP stage.\n" << std::flush; }
+  if (C & 4) { std::cerr << prefix << "Homing time out.\n" << std::flush; }
+  if (C & 2) { std::cerr << prefix << "Following error.\n" << std::flush; }
+  if (C & 1) { std::cerr << prefix << "Short circuit detection.\n" << std::flush; }
+  if (D & 8) { std::cerr << prefix << "RMS current limit.\n" << std::flush; }
+  if (D & 4) { std::cerr << prefix << "Peak current limit.\n" << std::flush; }
+  #endif
+  if (D & 2) { std::cerr << prefix << "Positive end of run.\n" << std::flush; }
+  if (D & 1) { std::cerr << prefix << "Negative end of run.\n" << std::flush; }
+
+  if (stagePollBuf[8] == readyFromHoming ||
+      stagePollBuf[8] == readyFromMoving ||
+      stagePollBuf[8] == nrFromReset) {
+    return 0;
+  } else if (stagePollBuf[8] == disFromReady ||
+    stagePollBuf[8] == disFromMoving ||
+    stagePollBuf[8] == nrFromMoving ||
+    stagePollBuf[8] == nr) {
+    return -1;
+  } else if (stagePollBuf[7] == nr &&
+    stagePollBuf[8] == nrFromReady) {
+    return -1;
+  }
+  return 1;
+}
+
+int ConexStage::stageMoving() {
+  if (pipeline_) return waitReady(0);
+
   for (bool moving = true; moving; ) {
-    rs232_->SendString("1TS\r\n");
+    send("1TS\r\n");
     std::this_thread::sleep_for(std::chrono::milliseconds(20));
 
     unsigned char stagePollBuf[10] = {};
     int poll = rs232_->Poll(stagePollBuf, sizeof stagePollBuf);
     if (poll == 10) {
-      // Warn on detected errors (per ref PDF, above). The last two, the "end of run" errors,
-      // are likely fatal. TODO(cregan/jfs): Kill the scan on these errors?
-      unsigned int // B = std::stoul(std::to_string(stagePollBuf[4]), NULL, 16),
-                   // C = std::stoul(std::to_string(stagePollBuf[5]), NULL, 16),
-                   D = std::stoul(std::to_string(stagePollBuf[6]), NULL, 16);
-      int port = this->getCOMPortNum() + 1;
-      std::string prefix = "WARNING: Stage error (COM" + std::to_string(port) + "): ";
-      #if 0  // These occur often and are not worth logging.
-      if (B & 2) { std::cerr << prefix << "80 W output power exceeded.\n" << std::flush; }
-      if (B & 1) { std::cerr << prefix << "DC voltage too low.\n" << std::flush; }
-      if (C & 8) { std::cerr << prefix << "Wrong ESP stage.\n" << std::flush; }
-      if (C & 4) { std::cerr << prefix << "Homing time out.\n" << std::flush; }
-      if (C & 2) { std::cerr << prefix << "Following error.\n" << std::flush; }
-      if (C & 1) { std::cerr << prefix << "Short circuit detection.\n" << std::flush; }
-      if (D & 8) { std::cerr << prefix << "RMS current limit.\n" << std::flush; }
-      if (D & 4) { std::cerr << prefix << "Peak current limit.\n" << std::flush; }
-      #endif
-      if (D & 2) { std::cerr << prefix << "Positive end of run.\n" << std::flush; }
-      if (D & 1) { std::cerr << prefix << "Negative end of run.\n" << std::flush; }
-
       stagePollBuf[9] = 0;  // Null terminate strings
-      if (stagePollBuf[8] == readyFromHoming ||
-          stagePollBuf[8] == readyFromMoving ||
-          stagePollBuf[8] == nrFromReset) {
+      int state = parseStatus(stagePollBuf);
+      if (state == 0) {
         moving = false;
-      } else if (stagePollBuf[8] == disFromReady ||
-        stagePollBuf[8] == disFromMoving ||
-        stagePollBuf[8] == nrFromMoving ||
-        stagePollBuf[8] == nr) {
-        return -1;
-      } else if (stagePollBuf[7] == nr &&
-        stagePollBuf[8] == nrFromReady) {
+      } else if (state == -1) {
         return -1;
       }
     }
@@ -91,10 +180,12 @@ int ConexStage::stageMoving() {
 double ConexStage::getStageLocation(void) {
   // Note: still not working great, not used in actual scan code until more
   // carefully debugged
+  if (pipeline_) return atof(query("1TP\r\n", "1TP").c_str());
+
   unsigned char stagePollBuf[10] = {};
   double location_mm;
 
-  rs232_->SendString("1TP\r\n");
+  send("1TP\r\n");
   // Magic pause; 10ms recommended in documentation, but appears insufficient
   std::this_thread::sleep_for(std::chrono::milliseconds(20));
 
@@ -112,21 +203,23 @@ double ConexStage::getStageLocation(void) {
 }
 
 int ConexStage::resetController() {
-  rs232_->SendString("1RS\r\n");
+  send("1RS\r\n");
   std::this_thread::sleep_for(std::chrono::milliseconds(10));
   while (stageMoving()) {}
   return 1;
 }
 
 int ConexStage::moveHome() {
-  rs232_->SendString("1OR\r\n");
+  send("1OR\r\n");
+  location_mm_ = 0;
+  located_ = true;
   std::this_thread::sleep_for(std::chrono::milliseconds(10));
   while (stageMoving()) {}
   return 1;
 }
 
 int ConexStage::disableController() {
-  rs232_->SendString("1MM0\r\n");
+  send("1MM0\r\n");
   std::this_thread::sleep_for(std::chrono::milliseconds(10));
   return 1;
 }
@@ -134,18 +227,32 @@ int ConexStage::disableController() {
 int ConexStage::moveRelative(double distance_mm) {
   char stageWrite[15];
   snprintf(stageWrite, sizeof(stageWrite), "1PR%g\r\n", distance_mm);
-  rs232_->SendString(stageWrite);
+  send(stageWrite);
+  location_mm_ += distance_mm;
+  if (pipeline_) {
+    while (waitReady(predictMove(distance_mm))) {}
+    return 1;
+  }
   std::this_thread::sleep_for(std::chrono::milliseconds(10));
   while (stageMoving()) {}
   return 1;
 }
 
+std::future<int> ConexStage::moveAbsoluteAsync(double location_mm) {
+  char stageWrite[15];
+  snprintf(stageWrite, sizeof(stageWrite), "1PA%g\r\n", location_mm);
+  send(stageWrite);
+  double predicted_ms = located_ ? predictMove(location_mm - location_mm_) : 0;
+  location_mm_ = location_mm;
+  located_ = true;
+  if (!pipeline_) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  return std::async(std::launch::async, [this, predicted_ms] { return waitReady(predicted_ms) == 0 ? 1 : -1; });
+}
+
 int ConexStage::moveAbsolute(double location_mm) {
   char stageWrite[15];
   snprintf(stageWrite, sizeof(stageWrite), "1PA%g\r\n", location_mm);
-  rs232_->SendString(stageWrite);
-  std::this_thread::sleep_for(std::chrono::milliseconds(10));
-  int isMoving = stageMoving();
+  int isMoving = moveAbsoluteAsync(location_mm).get() == 1 ? 0 : -1;
   while (isMoving) {
     if (isMoving == -1) {
       // Reset from error
@@ -153,7 +260,7 @@ int ConexStage::moveAbsolute(double location_mm) {
       std::this_thread::sleep_for(std::chrono::milliseconds(500));  // Required after reset
       std::cout << "ERROR: Resetting stage on COM " << this->getCOMPortNum() + 1 << " after error.\n" << std::flush;
       moveHome();
-      rs232_->SendString(stageWrite);  // If stage errors, after reset move back to desired location
+      send(stageWrite);  // If stage errors, after reset move back to desired location
       std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
     isMoving = stageMoving();
@@ -1,7 +1,19 @@
 #pragma once
 
+#include <future>
+#include <mutex>
+#include <string>
+
+#include "SerialPipeline.h"
 #include "stages.h"
 
+// Newport CONEX-CC stage controller
+// Once init() opens the port, a SerialPipeline matches the controller's
+//   replies to queries as they arrive.  Moves then ask for status ("1TS") only once the move
+//   should be nearly done, predicted from the distance and the controller's
+//   velocity and acceleration, and every 10 ms after that.  The prediction is
+//   scaled by how long recent moves actually took.
+// A stage that was not init()ed (e.g. with a mocked port) polls as before.
 class ConexStage: public Stage {
  public:
   ConexStage();
@@ -11,12 +23,58 @@ class ConexStage: public Stage {
 
   int resetController() override;
   int moveHome() override;
-  int disableController() override;
+  int disableController() override;
 
   int moveRelative(double distance_mm) override;
   int moveAbsolute(double location_mm) override;
 
+  // Start a move, without the error recovery of moveAbsolute()
+  // @returns future holding 1 on reaching the location, -1 on a controller error
+  std::future<int> moveAbsoluteAsync(double location_mm);
+
   int stageMoving(void) override;
 
   double getStageLocation(void) override;
+
+  // Velocity profile used to predict move times.  Read from the controller by init()
+  void setVelocityProfile(double velocity_mm_s, double acceleration_mm_s2);
+
+  // Predicted duration of a move, before scaling by recent moves
+  // @returns ms
+  double predictMove(double distance_mm) const;
+
+  struct Stats {
+    int moves = 0;
+    int statusQueries = 0;    // "1TS" sent while waiting for moves
+    double moveTimeScale = 1; // actual / predicted move time, recently
+  };
+  Stats getStats();
+
+ protected:
+  // Write a command that gets no reply
+  // @returns bytes written
+  int send(const std::string& command);
+
+  // Send a command and wait for its reply
+  // @param prefix reply prefix, e.g. "1TS"
+  // @returns reply after the prefix, or "" on timeout
+  std::string query(const std::string& command, const std::string& prefix, int timeout_ms = 200);
+
+  // Wait for the controller to leave its moving or homing state
+  // @param predicted_ms how long the move should take, 0 if unknown
+  // @returns 0 when ready, -1 on an error state
+  int waitReady(double predicted_ms);
+
+  // State of a status reply, "1TS" then 4 error and 2 state hex digits
+  // @returns 0 if ready, 1 if moving or homing, -1 if disabled or not referenced
+  int parseStatus(const unsigned char* reply);
+
+  SerialPipeline* pipeline_ = NULL;
+  std::mutex mutex_;  // guards stats_
+
+  double velocity_mm_s_ = 0.4;      // CONEX-CC defaults
+  double acceleration_mm_s2_ = 1.6;
+  double location_mm_ = 0;          // last commanded
+  bool located_ = false;
+  Stats stats_;
 };
@@ -1,8 +1,17 @@
+#include <iostream>
 #include <string>
 
 #include "FrameSave.h"
 
 #include "system/component/inc/frame.h"
+#include "system/component/inc/framefile.h"
+#include "system/component/inc/framestore.h"
+#include "system/component/inc/roi.h"
+#include "system/component/inc/stddev.h"
+
+FrameSave::~FrameSave() {
+  close();
+}
 
 void* FrameSave::Exec(void* data) {
   Frame* fr = (Frame*)data;
@@ -11,7 +20,7 @@ void* FrameSave::Exec(void* data) {
   if (n_frames_ < 0) {
     std::string fname = filename_ + std::to_string(fr->seq) + ".tiff";
     mutex_.unlock();
-    fr->Write(fname.c_str());
+    write(fr, fname);
     return data;
   }
 
@@ -30,7 +39,7 @@ void* FrameSave::Exec(void* data) {
   ++frame_count_;
   --n_frames_;
   mutex_.unlock();
-  fr->Write(fname.c_str());
+  write(fr, fname);
   return data;
 }
 
@@ -39,6 +48,7 @@ std::string FrameSave::getFilename() {
 }
 
 std::string FrameSave::setFilename(std::string filename, int n_frames) {
+  close();  // A new filename starts a new container
   std::lock_guard<std::mutex> lock(mutex_);
   filename_ = filename;
   frame_count_ = 0;
@@ -49,3 +59,102 @@ std::string FrameSave::setFilename(std::string filename, int n_frames) {
   }
   return filename_;
 }
+
+void FrameSave::setFrameStore(FrameStore* store) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  store_ = store;
+}
+
+void FrameSave::setContainer(bool container, bool packed) {
+  close();
+  std::lock_guard<std::mutex> lock(mutex_);
+  container_ = container;
+  packed_ = packed;
+}
+
+void FrameSave::setVoxelGrid(int foci_per_column, int foci_per_slice) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  foci_per_column_ = foci_per_column;
+  foci_per_slice_ = foci_per_slice;
+}
+
+void FrameSave::close() {
+  {
+    std::lock_guard<std::mutex> lock(file_mutex_);
+    if (!file_) return;
+  }
+  if (store_) store_->Flush(false);  // Queued frames still append to file_
+  std::lock_guard<std::mutex> lock(file_mutex_);
+  if (file_) {
+    file_->Close();
+    delete file_;
+    file_ = NULL;
+    // The store only syncs files it wrote itself, not containers
+    FrameStore::SyncFiles({ file_name_ });
+  }
+}
+
+FrameFileWriter* FrameSave::openContainer(const Frame& fr) {
+  std::string fname;
+  bool packed;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fname = filename_ + ".owf";
+    packed = packed_;
+  }
+  std::lock_guard<std::mutex> lock(file_mutex_);
+  if (!file_) {
+    file_ = new FrameFileWriter();
+    // Record::values, in the order filled in by makeRecord()
+    std::vector<std::string> names = { "ROI", "ROU", "Mean", "Standard Deviation" };
+    if (file_->Open(fname.c_str(), fr.width, fr.height, fr.bits, packed, 64, names) != 0) {
+      std::cout << "ERROR: Unable to create " << fname << std::endl;
+      delete file_;
+      file_ = NULL;
+    } else {
+      file_name_ = fname;
+    }
+  }
+  return file_;
+}
+
+FrameFile::Record FrameSave::makeRecord(const Frame& fr) {
+  FrameFile::Record record = FrameFile::MakeRecord(fr);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (foci_per_column_ > 0 && foci_per_slice_ > 0 && fr.seq >= 0) {
+      record.voxel[0] = fr.seq % foci_per_column_;                     // axial
+      record.voxel[1] = fr.seq % foci_per_slice_ / foci_per_column_;   // azimuth
+      record.voxel[2] = fr.seq / foci_per_slice_;                      // slice
+    }
+  }
+
+  // Tag values are zero if the tag is missing, as for the rest of the record
+  if (ROI::Tag* roi = fr.GetTag<ROI::Tag>()) {
+    record.values[0] = roi->roi;
+    record.values[1] = roi->rou;
+  }
+  if (StdDev::Tag* stddev = fr.GetTag<StdDev::Tag>()) {
+    record.values[2] = stddev->mean;
+    record.values[3] = stddev->stddev;
+  }
+  return record;
+}
+
+void FrameSave::write(Frame* fr, const std::string& fname) {
+  FrameStore::Writer writer;
+  if (container_) {
+    FrameFileWriter* file = openContainer(*fr);
+    if (!file) return;
+    FrameFile::Record record = makeRecord(*fr);
+    writer = [file, record](Frame& f, const std::string&) { return file->Append(f, record); };
+  }
+
+  if (store_) {
+    store_->Save(*fr, fname, writer);
+  } else if (writer) {
+    writer(*fr, fname);
+  } else {
+    fr->Write(fname.c_str());
+  }
+}
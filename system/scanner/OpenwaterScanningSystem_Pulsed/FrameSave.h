@@ -4,11 +4,15 @@
 #include <mutex>
 
 #include "system/component/inc/execnode.h"
+#include "system/component/inc/framefile.h"
+
+class Frame;
+class FrameStore;
 
 class FrameSave : public ExecNode {
  public:
   FrameSave() {}
-  ~FrameSave() {};
+  ~FrameSave();
 
   std::string getFilename();
 
@@ -17,11 +21,49 @@ class FrameSave : public ExecNode {
   // @param n_frames how many frames to save.  Omit or use a negative number to save all frames
   std::string setFilename(std::string filename, int n_frames = -1);
 
+  // Hand frames to a write-behind store instead of writing them on the exec thread
+  // @param store storage service to queue frames on (not owned).  NULL writes synchronously
+  void setFrameStore(FrameStore* store);
+
+  // Save all frames into one FrameFile container, <filename>.owf, instead of one TIFF per frame
+  // @param container true to save to a container
+  // @param packed store pixels packed to the camera bit depth
+  void setContainer(bool container, bool packed = true);
+
+  // Set how frame numbers map to voxels, for the container's records
+  // Frame seq is numbered raster slice by slice, one axial column at a time
+  // @param foci_per_column frames in each axial column
+  // @param foci_per_slice frames in each slice.  Zero or less leaves voxels unknown
+  void setVoxelGrid(int foci_per_column, int foci_per_slice);
+
+  // Finish the current container, writing its final index
+  // Waits for any frames still queued on the frame store
+  void close();
+
  private:
   void* Exec(void* data) override;
 
+  // Write a frame directly, or queue it on the frame store if one is set
+  void write(Frame* fr, const std::string& fname);
+
+  // A container record for a frame, with its voxel indices and tag values
+  FrameFile::Record makeRecord(const Frame& fr);
+
+  // Open the container on the first frame, once the frame geometry is known
+  // @returns NULL if the container could not be created
+  FrameFileWriter* openContainer(const Frame& fr);
+
   int frame_count_ = 0;
   int n_frames_ = 0;
   std::mutex mutex_;
   std::string filename_ = "";
+  FrameStore* store_ = NULL;
+
+  bool container_ = false;
+  bool packed_ = true;
+  int foci_per_column_ = 0;
+  int foci_per_slice_ = 0;
+  std::mutex file_mutex_;
+  FrameFileWriter* file_ = NULL;
+  std::string file_name_;  // of the open container
 };
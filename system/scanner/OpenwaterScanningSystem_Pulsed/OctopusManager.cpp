@@ -1,15 +1,21 @@
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 
 #include "OctopusManager.h"
 
 using json = nlohmann::json;
 
+// USB transfers for ConfigureTimer() and EnableTimer() with no register shadow:
+//   two read backs of the timer control register, 19 register writes
+static const int UNSHADOWED_TRIGGER_TRANSFERS = 2 * 2 + 19;
+
 OctopusManager::~OctopusManager() {
   delete octopus_;
 }
 
 bool OctopusManager::init(const json& systemParameters, int numAxialFoci, Trigger* trigger) {
-  octopus_ = new Octopus();
+  if (!octopus_) octopus_ = new Octopus();
   int octopusOpened = octopus_->Open();
   if (octopusOpened == 0) {
     std::cout << "INFO: Connected to Octopus: " << octopus_->SerialNumber() << std::endl;
@@ -23,8 +29,25 @@ bool OctopusManager::init(const json& systemParameters, int numAxialFoci, Trigge
 
 
 int OctopusManager::TriggerVoxel() {
-  octopus_->ConfigureTimer(timer_SWtrigger_);
-  octopus_->EnableTimer(pin_SWtrigger_, true);
+  auto start = std::chrono::steady_clock::now();
+  int transfers = octopus_->GetStats().transfers;
+  if (octopus_->TimerLoaded(image_SWtrigger_)) {
+    octopus_->RearmTimer(pin_SWtrigger_);
+    ++triggerStats_.rearms;
+  } else {
+    // First trigger, or the timer was reconfigured, e.g. by DisableOutput()
+    octopus_->ConfigureTimer(image_SWtrigger_);
+    octopus_->EnableTimer(pin_SWtrigger_, true);
+  }
+  double latency_us =
+    std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+  transfers = octopus_->GetStats().transfers - transfers;
+  ++triggerStats_.triggers;
+  triggerStats_.transfers += transfers;
+  triggerStats_.transfersSaved += UNSHADOWED_TRIGGER_TRANSFERS - transfers;
+  triggerStats_.totalLatency_us += latency_us;
+  triggerStats_.maxLatency_us = std::max(triggerStats_.maxLatency_us, latency_us);
   return 1;
 }
 
@@ -112,6 +135,7 @@ bool OctopusManager::InitializeOctopus(const json& systemParameters, int numAxia
   timer_SWtrigger_.state[2].period = 1e-6;
   timer_SWtrigger_.state_transition_count = 3;
   timer_SWtrigger_.out_select = pin_SWtrigger_;
+  image_SWtrigger_ = Octopus::CompileTimer(timer_SWtrigger_);
   tempSystemTimer_.timer = timer_SWtrigger_;
   tempSystemTimer_.pin = pin_SWtrigger_;
   systemTimers_.push_back(tempSystemTimer_);
@@ -10,14 +10,28 @@
 class OctopusManager {
  public:
   OctopusManager() {}
+  // Use an Octopus that is not the board, e.g. on a simulated FX3.  Takes ownership.
+  explicit OctopusManager(Octopus* octopus) : octopus_(octopus) {}
   virtual ~OctopusManager();
 
   using json = nlohmann::json;
 
   virtual bool init(const json& systemParameters, int numAxialFoci, Trigger* trigger);
 
+  // Start the SW trigger pulse.  When the trigger timer's registers are already
+  //   on the board, only the timer is restarted.
   int TriggerVoxel();
 
+  struct TriggerStats {
+    int triggers = 0;
+    int rearms = 0;          // triggers that only restarted the timer
+    int transfers = 0;       // USB transfers for all triggers
+    int transfersSaved = 0;  // against configuring and enabling the timer without a shadow
+    double totalLatency_us = 0;
+    double maxLatency_us = 0;
+  };
+  TriggerStats GetTriggerStats() const { return triggerStats_; }
+
   bool InitializeOctopus(const json& systemParameters, int numAxialFoci);
 
   bool EnableSystemChannels(bool channelON);
@@ -27,7 +41,7 @@ class OctopusManager {
   bool DisableOutput(Octopus::Timer timer, Octopus::Pin pin);
 
  private:
-  Octopus* octopus_;
+  Octopus* octopus_ = NULL;
   Trigger* trigger_;
   struct systemTimer {
     Octopus::Timer timer;
@@ -38,6 +52,8 @@ class OctopusManager {
 
   // Timers/pins that are for internally triggering and gating other stuff
   Octopus::Timer timer_SWtrigger_;  // SW trigger to initiate synchronous voxel collection
+  Octopus::TimerImage image_SWtrigger_ = {};  // its registers, compiled once
+  TriggerStats triggerStats_;
   Octopus::Pin pin_SWtrigger_ = Octopus::Pin::OUT8_TOP;
   Octopus::Pin pin_AOMgate_ = Octopus::Pin::OUT6_TOP;
   Octopus::Pin pin_AOMpulseChopGate_ = Octopus::Pin::OUT5_TOP;
@@ -0,0 +1,74 @@
+// OctopusTiming.cpp
+// Simulate the Octopus timers a scan would set up, and dump their pulses
+// to check timing without the rig.  Open a .vcd in a waveform viewer, e.g.
+// GTKWave, or load a .csv anywhere.
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "system/component/inc/octopus.h"
+#include "system/component/inc/octopus_timing_sim.h"
+#include "system/third_party/json-develop/single_include/nlohmann/json.hpp"
+
+#include "OctopusManager.h"
+
+using json = nlohmann::json;
+
+int main(int argc, char* argv[]) {
+  if (argc < 3) {
+    std::cerr << "Usage: " << argv[0] << " <scan_metadata.json> <output.vcd|output.csv> [voxels] [numAxialFoci]\n";
+    return -1;
+  }
+  std::string output(argv[2]);
+  int voxels = argc > 3 ? std::stoi(argv[3]) : 2;
+  int numAxialFoci = argc > 4 ? std::stoi(argv[4]) : 1;
+
+  std::ifstream scanMetadata(argv[1]);
+  if (scanMetadata.fail()) {
+    std::cerr << "Can't open " << argv[1] << std::endl;
+    return -1;
+  }
+  json systemParameters = json::parse(scanMetadata);
+
+  OctopusTimingSim sim;
+  OctopusManager octopusManager(new Octopus(&sim));
+  if (!octopusManager.init(systemParameters, numAxialFoci, NULL)) return -1;
+
+  // Each voxel gets its gate, and one more laser period to settle, as a scan would
+  double laserClockPeriod_s = systemParameters["laserParameters"]["laserClockPeriod_ms"].get<double>() * 0.001;
+  double voxel_s = (numAxialFoci + 1) * laserClockPeriod_s;
+  if (systemParameters["laserParameters"]["pulsed"].get<int>()) {
+    double TTLPulseWidth_s = systemParameters["delayParameters"]["TTLPulseWidth_s"].get<double>();
+    sim.ClockInput(Octopus::Pin::IN1_BOTTOM, laserClockPeriod_s, TTLPulseWidth_s, (numAxialFoci + 1) * voxels + 1,
+                   laserClockPeriod_s / 2);
+  }
+
+  octopusManager.EnableSystemChannels(true);
+  for (int i = 0; i < voxels; ++i) {
+    octopusManager.TriggerVoxel();
+    sim.Run(voxel_s);
+  }
+  octopusManager.EnableSystemChannels(false);
+  sim.Run(laserClockPeriod_s);
+
+  std::ofstream out(output);
+  if (output.size() > 4 && output.compare(output.size() - 4, 4, ".csv") == 0) {
+    sim.WriteCSV(out);
+  } else {
+    sim.WriteVCD(out);
+  }
+  if (!out) {
+    std::cerr << "Can't write " << output << std::endl;
+    return -1;
+  }
+
+  for (int pin = Octopus::Pin::IN1_BOTTOM; pin <= Octopus::Pin::OUT8_TOP; ++pin) {
+    std::vector<OctopusTimingSim::Pulse> pulses = OctopusTimingSim::Pulses(sim.Timeline((Octopus::Pin)pin));
+    if (pulses.empty()) continue;
+    std::cout << OctopusTimingSim::PinName((Octopus::Pin)pin) << ": " << pulses.size() << " pulses, first at "
+              << pulses[0].start * 1e6 << " us, " << pulses[0].width * 1e6 << " us wide" << std::endl;
+  }
+  std::cout << "Wrote " << output << std::endl;
+  return 0;
+}
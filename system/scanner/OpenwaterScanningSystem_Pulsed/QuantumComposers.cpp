@@ -9,6 +9,8 @@
 #include "rs232_wrapper.h"
 
 QuantumComposers::~QuantumComposers() {
+  delete pipeline_;
+  pipeline_ = NULL;
   delete rs232_;
   rs232_ = NULL;
 }
@@ -17,15 +19,35 @@ bool QuantumComposers::init(int port) {
   if (!rs232_) {  // in case it's mocked
     rs232_ = new RS232();
   }
-  return rs232_->Open(port - 1, 38400, "8N1") == 0;
+  if (rs232_->Open(port - 1, 38400, "8N1") != 0) return false;
+  if (!pipeline_) pipeline_ = new SerialPipeline(rs232_);
+  return true;
 }
 
 bool QuantumComposers::sendString(const std::string& str) {
+  if (pipeline_) {
+    // The unit replies "ok", or "?n" on an error, to every command
+    replies_.push_back(pipeline_->Request(str, "", 500));
+    return true;
+  }
   int sendBufOK = rs232_->SendString(str);
   std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  if (sendBufOK <= 0) ++errors_;
   return sendBufOK > 0;
 }
 
+int QuantumComposers::errors() {
+  for (std::future<std::string>& reply : replies_) {
+    std::string r = reply.get();
+    if (r.empty() || r[0] == '?') {
+      std::cerr << "ERROR: Quantum Composers command failed (" << (r.empty() ? "no reply" : r) << ")\n";
+      ++errors_;
+    }
+  }
+  replies_.clear();
+  return errors_;
+}
+
 bool QuantumComposers::setUnitChannelGateMode(bool gatingON, double gateVoltage_V) {
   return sendString(gatingON ? ":PULS0:GAT:MOD CHAN\r\n" : ":PULS0:GAT:MOD DIS\r\n")
     && sendString(":PULS0:GAT:LEV " + std::to_string(gateVoltage_V) + "\r\n");
@@ -84,7 +106,7 @@ bool QuantumComposers::initializeLaser(const json& systemParameters) {
     //setPulseDelay(8, chHDelay_s);
     enableChannel(8, channelON);
 
-    return sendString(":DISP:UPD ?\r\n");
+    return sendString(":DISP:UPD ?\r\n") && errors() == 0;
   }
   std::cerr << "ERROR: Unknown laser type (" << laser << ")\n";
   return false;
@@ -2,10 +2,16 @@
 
 #include "laser.h"
 
+#include <future>
 #include <string>
+#include <vector>
 
 #include "rs232_wrapper.h"
+#include "SerialPipeline.h"
 
+// Quantum Composers pulse generator timing the Amplitude laser
+// Once init() opens the port, commands are pipelined as for the BNC box; see
+//   BerkeleyNucleonics.
 class QuantumComposers : public Laser {
  public:
   QuantumComposers() {}
@@ -29,9 +35,15 @@ class QuantumComposers : public Laser {
 
   bool initializeLaser(const json& systemParameters);
 
+  // Error count so far.  Waits for the replies to any pipelined commands.
+  int errors();
+
  protected:
   // Send a string out through the interface.
   bool sendString(const std::string& str);
 
-  RS232* rs232_;
+  RS232* rs232_ = NULL;
+  SerialPipeline* pipeline_ = NULL;
+  std::vector<std::future<std::string>> replies_;  // to commands not yet checked
+  int errors_ = 0;
 };
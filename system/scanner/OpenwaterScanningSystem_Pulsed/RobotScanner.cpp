@@ -80,96 +80,110 @@ bool RobotScanner::scan() {
     return false;
   }
 
-  bool cancel = CheckForCancel();
+  ScanPlan plan = planScan({ { "alpha", &alphaSteps }, { "beta", &betaSteps }, { "gamma", &gammaSteps },
+                             { "z", &zSteps }, { "y", &ySteps }, { "x", &xSteps } });
+
+  // Robot pose for a slice
+  auto slicePose = [&](int sliceIdx) {
+    const std::vector<double>& location = plan.poses()[sliceIdx].location;
+    double alpha = location[0], beta = location[1], gamma = location[2];
+    double z = location[3], y = location[4], x = location[5];
+
+    // Reshuffle x,y,z for "scanner classic" directions; could rotate the TRF, but then
+    // movement commands would have to be transformed. (MovePose args are relative to WRF)
+    // Z closest is at trfX (opposite other systems, TODO change this?)
+    // trfY adjusts right/left
+    // trfZ adjusts up/down
+    // trfBeta rotates around "up/down" axis +/-25 degrees (note: traditionally this was gamma, but due to
+    // limits on the angular range, TRF coordinate frame is rotated to prevent motion errors)
+    return std::vector<double>({ initialPosition[0] + z, initialPosition[1] + x, initialPosition[2] + y,
+                                 initialPosition[3] + alpha, initialPosition[4] + beta, initialPosition[5] + gamma });
+  };
+  auto queueMove = [&](int sliceIdx) {
+    std::vector<double> pose = slicePose(sliceIdx);
+    return robot_->movePoseAsync(pose[0], pose[1], pose[2], pose[3], pose[4], pose[5]);
+  };
 
-  int sliceIdx = 0;  // Numbering index for hologram images
+  bool cancel = CheckForCancel();
 
   ////////// STAGE SCAN //////////
 
-  for (int alphai = 0; alphai < alphaSteps.values.size() && !cancel; alphai++) {
-    double alpha = alphaSteps[alphai];
-
-    for (int betai = 0; betai < betaSteps.values.size() && !cancel; betai++) {
-      double beta = betaSteps[betai];
-
-      for (int gammai = 0; gammai < gammaSteps.values.size() && !cancel; gammai++) {
-        double gamma = gammaSteps[gammai];
-
-        for (int zi = 0; zi < zSteps.values.size() && !cancel; zi++) {
-          double z = zSteps[zi];
-
-          for (int yi = 0; yi < ySteps.values.size() && !cancel; yi++) {
-            double y = ySteps[yi];
-
-            for (int xi = 0; xi < xSteps.values.size() && !cancel; xi++) {
-              double x = xSteps[xi];
-
-              // Reshuffle x,y,z for "scanner classic" directions; could rotate the TRF, but then
-              // movement commands would have to be transformed. (MovePose args are relative to WRF)
-              // Z closest is at trfX (opposite other systems, TODO change this?)
-              // trfY adjusts right/left
-              // trfZ adjusts up/down
-              // trfBeta rotates around "up/down" axis +/-25 degrees (note: traditionally this was gamma, but due to
-              // limits on the angular range, TRF coordinate frame is rotated to prevent motion errors)
-              if (robot_ && !robot_->movePose(initialPosition[0] + z, initialPosition[1] + x, initialPosition[2] + y, 
-                initialPosition[3] + alpha, initialPosition[4] + beta, initialPosition[5] + gamma)) {
-                cancel = true;
-                break;
-              }
-
-              std::this_thread::sleep_for(std::chrono::milliseconds((long)additionalPauseTime_ms));
-              
-              if (ustx_) ustx_->SetFocus(0, true);  // Use incrementing
-
-              for (int azi = 0; azi < azimuthSteps.values.size() && !cancel; azi++) {
-
-                if (ustx_ && !cancel) {
-                  int focusIdx = ustx_->GetFocus();
-                  if (focusIdx != azi * numAxialSteps) {
-                    LOG(WARNING) << "Unexpected ustx focus index: " << focusIdx;
-                  }
-                }
-
-                int maxErrors = 4;
-                int numErrors = 0;
-                while (cameras_ && !cancel) {
-                  if (cameras_->captureAndWriteImagesAsync(numFociPerSlice_, sliceIdx, numAxialSteps, azi + 1, frameGatePeriod_ms) == 1) break;
-                  LOG(WARNING) << "Repeating axial column capture.";
-                  if (ustx_) ustx_->SetFocus(azi * numAxialSteps, true);  // Use incrementing
-                  cancel = CheckForCancel();
-                  numErrors++;
-                  if (numErrors > maxErrors) {
-                    cameras_->resetAllCamerasMidscan(sliceIdx * numFociPerSlice_ + azi * numAxialSteps);
-                    LOG(WARNING) << "Resetting all cameras due to excessive errors";
-                  }
-                }
-
-                // Check for thermal shutdown after each axial column
-                if (ustx_ && ustx_->ThermalShutdown()) {
-                  ustx_->Reset();
-                  LOG(WARNING) << "USTX reset after thermal shutdown";
-                }
-              }
-
-              // Check that full axial/azimuth slice completed and focus list reindexed to zero
-              if (ustx_) {
-                int focusIdx = ustx_->GetFocus();
-                if (focusIdx != 0) {
-                  LOG(WARNING) << "Unexpected ustx focus index after slice: " << focusIdx;
-                }
-              }
-
-              sliceIdx++;
-
-              // Periodically check for cancel.
-              cancel = CheckForCancel();
-            }
+  // Each slice's move is queued as soon as the last slice's final exposure is
+  //   done, rather than after its checks
+  std::future<bool> move;
+  if (robot_ && !cancel && plan.size() > 0) move = queueMove(0);
+
+  for (int sliceIdx = 0; sliceIdx < plan.size() && !cancel; sliceIdx++) {
+    if (robot_ && !(move.valid() && move.get())) {
+      // Retry with movePose(), which checks the robot's status and resets it as needed
+      std::vector<double> pose = slicePose(sliceIdx);
+      if (!robot_->movePose(pose[0], pose[1], pose[2], pose[3], pose[4], pose[5])) {
+        cancel = true;
+        break;
+      }
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds((long)additionalPauseTime_ms));
+    
+    // Frames, and so images, are numbered by raster index rather than scan
+    //   order, so they map to the same voxels whatever order the plan takes
+    int raster = plan.poses()[sliceIdx].raster;
+    if (cameras_) cameras_->setFrameCount(raster * numFociPerSlice_);
+
+    if (ustx_) ustx_->SetFocus(0, true);  // Use incrementing
+
+    for (int azi = 0; azi < azimuthSteps.values.size() && !cancel; azi++) {
+
+      if (ustx_ && !cancel) {
+        int focusIdx = ustx_->GetFocus();
+        if (focusIdx != azi * numAxialSteps) {
+          LOG(WARNING) << "Unexpected ustx focus index: " << focusIdx;
+        }
+      }
+
+      int maxErrors = 4;
+      int numErrors = 0;
+      while (cameras_ && !cancel) {
+        if (cameras_->captureAndWriteImagesAsync(numFociPerSlice_, raster, numAxialSteps, azi + 1, frameGatePeriod_ms) == 1) break;
+        LOG(WARNING) << "Repeating axial column capture.";
+        if (ustx_) ustx_->SetFocus(azi * numAxialSteps, true);  // Use incrementing
+        cancel = CheckForCancel();
+        numErrors++;
+        if (numErrors > maxErrors) {
+          LOG(WARNING) << "Resetting all cameras due to excessive errors";
+          if (!cameras_->resetAllCamerasMidscan(raster * numFociPerSlice_ + azi * numAxialSteps)) {
+            LOG(ERROR) << "Camera reset failed, cancelling scan";
+            cancel = true;
           }
         }
       }
+
+      // The last exposure is done, so the robot can head for the next slice
+      if (robot_ && azi == azimuthSteps.values.size() - 1 && !cancel && sliceIdx + 1 < plan.size()) {
+        move = queueMove(sliceIdx + 1);
+      }
+
+      // Check for thermal shutdown after each axial column
+      if (ustx_ && ustx_->ThermalShutdown()) {
+        ustx_->Reset();
+        LOG(WARNING) << "USTX reset after thermal shutdown";
+      }
     }
+
+    // Check that full axial/azimuth slice completed and focus list reindexed to zero
+    if (ustx_) {
+      int focusIdx = ustx_->GetFocus();
+      if (focusIdx != 0) {
+        LOG(WARNING) << "Unexpected ustx focus index after slice: " << focusIdx;
+      }
+    }
+
+    // Periodically check for cancel.
+    cancel = CheckForCancel();
   }
 
+  if (move.valid()) move.wait();  // Cancelled with the next slice's move queued
+
   // Move back to centered/closest
   if (robot_ && !robot_->movePose(initialPosition[0], initialPosition[1], initialPosition[2],
     initialPosition[3], initialPosition[4], initialPosition[5])) {
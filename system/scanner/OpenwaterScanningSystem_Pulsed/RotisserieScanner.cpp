@@ -72,75 +72,71 @@ bool RotisserieScanner::scan() {
     return false;
   }
 
+  ScanPlan plan = planScan({ { "z", &zSteps }, { "y", &ySteps }, { "x", &xSteps }, { "gamma", &gammaSteps } });
+  Stage* stages[4] = { zStage_, yStage_, xStage_, rStage_ };
+
   bool cancel = CheckForCancel();
-  int sliceIdx = 0;
-
-  for (int zi = 0; zi < zSteps.values.size() && !cancel; zi++) {
-    double z = zSteps[zi];
-    if (zStage_) zStage_->moveAbsolute(z);
-
-    for (int yi = 0; yi < ySteps.values.size() && !cancel; yi++) {
-      double y = ySteps[yi];
-      if (yStage_) yStage_->moveAbsolute(y);
-
-      for (int xi = 0; xi < xSteps.values.size() && !cancel; xi++) {
-        double x = xSteps[xi];
-        if (xStage_) xStage_->moveAbsolute(x);
-
-        for (int gammai = 0; gammai < gammaSteps.values.size() && !cancel; gammai++) {
-          double gamma = gammaSteps[gammai];
-
-          if (rStage_) rStage_->moveAbsolute(gamma);
-
-          std::this_thread::sleep_for(std::chrono::milliseconds((long)additionalPauseTime_ms));
-
-          if (ustx_) ustx_->SetFocus(0, true);  // Use incrementing
-
-          for (int azi = 0; azi < azimuthSteps.values.size() && !cancel; azi++) {
-
-            if (ustx_ && !cancel) {
-              int focusIdx = ustx_->GetFocus();
-              if (focusIdx != azi * numAxialSteps) {
-                LOG(WARNING) << "Unexpected ustx focus index: " << focusIdx;
-              }
-            }
-
-            int maxErrors = 4;
-            int numErrors = 0;
-            while (cameras_ && !cancel) {
-              if (cameras_->captureAndWriteImagesAsync(numFociPerSlice_, sliceIdx, numAxialSteps, azi + 1, frameGatePeriod_ms) == 1) break;
-              LOG(WARNING) << "Repeating axial column capture.";
-              if (ustx_) ustx_->SetFocus(azi * numAxialSteps, true);  // Use incrementing
-              cancel = CheckForCancel();
-              numErrors++;
-              if (numErrors > maxErrors) {
-                cameras_->resetAllCamerasMidscan(sliceIdx * numFociPerSlice_ + azi * numAxialSteps);
-                LOG(WARNING) << "Resetting all cameras due to excessive errors";
-              }
-            }
-
-            // Check for thermal shutdown after each axial column
-            if (ustx_ && ustx_->ThermalShutdown()) {
-              ustx_->Reset();
-              LOG(WARNING) << "USTX reset after thermal shutdown";
-            }
-          }
+  for (int sliceIdx = 0; sliceIdx < plan.size() && !cancel; sliceIdx++) {
+    // Only the axes that change between slices move
+    const ScanPlan::Pose& pose = plan.poses()[sliceIdx];
+    for (int a = 0; a < 4; a++) {
+      if (stages[a] && (sliceIdx == 0 || plan.poses()[sliceIdx - 1].index[a] != pose.index[a])) {
+        stages[a]->moveAbsolute(pose.location[a]);
+      }
+    }
 
-          // Check that full axial/azimuth slice completed and focus list reindexed to zero
-          if (ustx_) {
-            int focusIdx = ustx_->GetFocus();
-            if (focusIdx != 0) {
-              LOG(WARNING) << "Unexpected ustx focus index after slice: " << focusIdx;
-            }
-          }
+    std::this_thread::sleep_for(std::chrono::milliseconds((long)additionalPauseTime_ms));
 
-          sliceIdx++;
+    // Frames, and so images, are numbered by raster index rather than scan
+    //   order, so they map to the same voxels whatever order the plan takes
+    int raster = plan.poses()[sliceIdx].raster;
+    if (cameras_) cameras_->setFrameCount(raster * numFociPerSlice_);
 
-          // Periodically check for cancel.
-          cancel = CheckForCancel();
+    if (ustx_) ustx_->SetFocus(0, true);  // Use incrementing
+
+    for (int azi = 0; azi < azimuthSteps.values.size() && !cancel; azi++) {
+
+      if (ustx_ && !cancel) {
+        int focusIdx = ustx_->GetFocus();
+        if (focusIdx != azi * numAxialSteps) {
+          LOG(WARNING) << "Unexpected ustx focus index: " << focusIdx;
         }
       }
+
+      int maxErrors = 4;
+      int numErrors = 0;
+      while (cameras_ && !cancel) {
+        if (cameras_->captureAndWriteImagesAsync(numFociPerSlice_, raster, numAxialSteps, azi + 1, frameGatePeriod_ms) == 1) break;
+        LOG(WARNING) << "Repeating axial column capture.";
+        if (ustx_) ustx_->SetFocus(azi * numAxialSteps, true);  // Use incrementing
+        cancel = CheckForCancel();
+        numErrors++;
+        if (numErrors > maxErrors) {
+          LOG(WARNING) << "Resetting all cameras due to excessive errors";
+          if (!cameras_->resetAllCamerasMidscan(raster * numFociPerSlice_ + azi * numAxialSteps)) {
+            LOG(ERROR) << "Camera reset failed, cancelling scan";
+            cancel = true;
+          }
+        }
+      }
+
+      // Check for thermal shutdown after each axial column
+      if (ustx_ && ustx_->ThermalShutdown()) {
+        ustx_->Reset();
+        LOG(WARNING) << "USTX reset after thermal shutdown";
+      }
     }
+
+    // Check that full axial/azimuth slice completed and focus list reindexed to zero
+    if (ustx_) {
+      int focusIdx = ustx_->GetFocus();
+      if (focusIdx != 0) {
+        LOG(WARNING) << "Unexpected ustx focus index after slice: " << focusIdx;
+      }
+    }
+
+    // Periodically check for cancel.
+    cancel = CheckForCancel();
   }
 
   // Move Stages back to centered and closest
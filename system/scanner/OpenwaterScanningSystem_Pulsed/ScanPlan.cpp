@@ -0,0 +1,133 @@
+#include "ScanPlan.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+#include "system/third_party/json-develop/single_include/nlohmann/json.hpp"
+
+using json = nlohmann::json;
+
+// Time for one step of an axis, used to find the slowest
+static double StepTime(const ScanPlan::Axis& axis) {
+  double step = axis.values.size() > 1 ? fabs(axis.values[1] - axis.values[0]) : 0;
+  return (axis.velocity > 0 ? 1000 * step / axis.velocity : 0) + axis.settle_ms;
+}
+
+ScanPlan::ScanPlan(const std::vector<Axis>& axes, bool serpentine, bool slowestOutermost)
+    : axes_(axes), serpentine_(serpentine), slowestOutermost_(slowestOutermost) {
+  Generate();
+}
+
+void ScanPlan::Generate() {
+  int n = (int)axes_.size();
+  std::vector<int> order(n);  // loop order, outermost first
+  for (int a = 0; a < n; a++) order[a] = a;
+  if (slowestOutermost_) {
+    std::stable_sort(order.begin(), order.end(),
+                     [this](int a, int b) { return StepTime(axes_[a]) > StepTime(axes_[b]); });
+  }
+
+  // Raster strides follow the axes as given, whatever order they are walked in
+  int total = 1;
+  std::vector<int> stride(n);
+  for (int a = n - 1; a >= 0; a--) {
+    stride[a] = total;
+    total *= (int)axes_[a].values.size();
+  }
+
+  poses_.clear();
+  poses_.reserve(total);
+  for (int p = 0; p < total; p++) {
+    Pose pose;
+    pose.location.resize(n);
+    pose.index.resize(n);
+    pose.raster = 0;
+
+    // Digits of p, outermost first.  An axis runs backwards when the line it
+    //   is on (the outer digits as one number) is odd
+    int below = total;
+    int line = 0;
+    for (int d = 0; d < n; d++) {
+      int a = order[d];
+      int size = (int)axes_[a].values.size();
+      below /= size;
+      int digit = (p / below) % size;
+      int i = serpentine_ && (line & 1) ? size - 1 - digit : digit;
+      line = line * size + digit;
+      pose.index[a] = i;
+      pose.location[a] = axes_[a].values[i];
+      pose.raster += i * stride[a];
+    }
+    poses_.push_back(pose);
+  }
+}
+
+double ScanPlan::EstimateMove(const Pose& from, const Pose& to) const {
+  double ms = 0;
+  for (int a = 0; a < (int)axes_.size(); a++) {
+    if (from.index[a] == to.index[a]) continue;
+    double move_ms = axes_[a].settle_ms;
+    if (axes_[a].velocity > 0) move_ms += 1000 * fabs(to.location[a] - from.location[a]) / axes_[a].velocity;
+    ms = std::max(ms, move_ms);
+  }
+  return ms;
+}
+
+double ScanPlan::EstimateTravel() const {
+  double ms = 0;
+  for (int p = 1; p < (int)poses_.size(); p++) ms += EstimateMove(poses_[p - 1], poses_[p]);
+  return ms;
+}
+
+bool ScanPlan::Save(const std::string& fname) const {
+  json j;
+  j["serpentine"] = serpentine_;
+  j["slowestOutermost"] = slowestOutermost_;
+  j["axes"] = json::array();
+  for (const Axis& axis : axes_) {
+    j["axes"].push_back({ { "name", axis.name }, { "values", axis.values },
+                          { "velocity", axis.velocity }, { "settle_ms", axis.settle_ms } });
+  }
+  j["poses"] = json::array();  // [raster, index...] in scan order
+  for (const Pose& pose : poses_) {
+    std::vector<int> entry(1, pose.raster);
+    entry.insert(entry.end(), pose.index.begin(), pose.index.end());
+    j["poses"].push_back(entry);
+  }
+
+  std::ofstream out(fname);
+  out << j.dump() << std::endl;
+  return out.good();
+}
+
+bool ScanPlan::Load(const std::string& fname) {
+  std::ifstream in(fname);
+  json j = json::parse(in, nullptr, false);
+  if (j.is_discarded() || !j.contains("axes") || !j.contains("poses")) return false;
+
+  std::vector<Axis> axes;
+  for (const json& axis : j["axes"]) {
+    axes.push_back(Axis(axis["name"].get<std::string>(), axis["values"].get<std::vector<double>>(),
+                        axis["velocity"].get<double>(), axis["settle_ms"].get<double>()));
+  }
+  std::vector<Pose> poses;
+  for (const json& entry : j["poses"]) {
+    std::vector<int> raw = entry.get<std::vector<int>>();
+    if (raw.size() != axes.size() + 1) return false;
+    Pose pose;
+    pose.raster = raw[0];
+    pose.index.assign(raw.begin() + 1, raw.end());
+    for (int a = 0; a < (int)axes.size(); a++) {
+      if (pose.index[a] < 0 || pose.index[a] >= (int)axes[a].values.size()) return false;
+      pose.location.push_back(axes[a].values[pose.index[a]]);
+    }
+    poses.push_back(pose);
+  }
+
+  axes_ = axes;
+  serpentine_ = j["serpentine"].get<bool>();
+  slowestOutermost_ = j["slowestOutermost"].get<bool>();
+  poses_ = poses;
+  return true;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Ordered list of poses for a scan over a grid of stage or robot axes
+// Axes are given outermost first, as the scanners' nested loops have them.
+// - Serpentine (boustrophedon) ordering reverses every other line of each
+//   axis, so no axis flies back to its starting edge.  Every pose then
+//   differs from the last in exactly one axis, by one step.
+// - Optionally the slowest axis (by velocity and settle time) is moved
+//   outermost, so it moves the fewest times.
+// Each pose keeps its per-axis indices and its raster index (its slice index
+//   in the plain nested loops), so results map back to voxel coordinates.
+// Example:
+//   ScanPlan plan({ { "z", zSteps.values }, { "y", ySteps.values }, { "x", xSteps.values } });
+//   for (const ScanPlan::Pose& pose : plan.poses()) MoveTo(pose.location);
+class ScanPlan {
+ public:
+  struct Axis {
+    std::string name;
+    std::vector<double> values;
+    double velocity = 0;   // units per s, or 0 to count settle time only
+    double settle_ms = 0;  // after every move
+
+    Axis() {}
+    Axis(const std::string& name, const std::vector<double>& values, double velocity = 0, double settle_ms = 0)
+        : name(name), values(values), velocity(velocity), settle_ms(settle_ms) {}
+  };
+
+  struct Pose {
+    std::vector<double> location;  // per axis, in the order given
+    std::vector<int> index;        // into each axis' values
+    int raster;                    // slice index in plain nested loops
+  };
+
+  // @param axes outermost first
+  // @param serpentine reverse every other line rather than flying back
+  // @param slowestOutermost reorder so the axis slowest to step moves least
+  ScanPlan(const std::vector<Axis>& axes = std::vector<Axis>(), bool serpentine = true,
+           bool slowestOutermost = false);
+
+  const std::vector<Axis>& axes() const { return axes_; }
+  const std::vector<Pose>& poses() const { return poses_; }
+  int size() const { return (int)poses_.size(); }
+  bool serpentine() const { return serpentine_; }
+
+  // Time to move between two poses, with every axis that changes moving at
+  //   once and then settling
+  // @returns ms
+  double EstimateMove(const Pose& from, const Pose& to) const;
+
+  // Time spent moving between the poses of the plan, after the first
+  // @returns ms
+  double EstimateTravel() const;
+
+  // Write the axes, options and poses as JSON
+  // @returns false if the file could not be written
+  bool Save(const std::string& fname) const;
+
+  // Read a plan written by Save(), e.g. to resume a scan part way through
+  // @returns false if the file could not be read or parsed
+  bool Load(const std::string& fname);
+
+ private:
+  // Fill poses_ from axes_ and the options
+  void Generate();
+
+  std::vector<Axis> axes_;
+  bool serpentine_;
+  bool slowestOutermost_;
+  std::vector<Pose> poses_;
+};
@@ -0,0 +1,98 @@
+#include "SerialPipeline.h"
+
+#include "system/component/inc/time.h"
+
+SerialPipeline::SerialPipeline(RS232* port, const std::string& terminator, int maxInFlight)
+    : port_(port), terminator_(terminator), maxInFlight_(maxInFlight) {
+  reader_ = std::thread(&SerialPipeline::Read, this);
+}
+
+SerialPipeline::~SerialPipeline() {
+  stop_ = true;
+  reader_.join();
+  for (Pending& pending : pending_) pending.reply.set_value("");
+}
+
+bool SerialPipeline::Send(const std::string& command) {
+  std::lock_guard<std::mutex> lock(sendMutex_);
+  return port_->SendString(command) > 0;
+}
+
+std::future<std::string> SerialPipeline::Request(const std::string& command, const std::string& prefix,
+                                                 int timeout_ms) {
+  // Queue the request before writing, so however soon the reply comes it has
+  //   somewhere to go, and in the order the commands are written
+  std::lock_guard<std::mutex> sendLock(sendMutex_);
+  std::unique_lock<std::mutex> lock(mutex_);
+  changed_.wait(lock, [this] { return (int)pending_.size() < maxInFlight_; });
+  pending_.push_back(Pending());
+  Pending& pending = pending_.back();
+  uint64_t id = pending.id = nextId_++;
+  pending.prefix = prefix;
+  pending.deadline_ms = Component::SteadyClockTimeMs() + timeout_ms;
+  std::future<std::string> reply = pending.reply.get_future();
+  stats_.requests++;
+  lock.unlock();
+
+  if (port_->SendString(command) <= 0) {
+    // Expire it now rather than after the timeout
+    lock.lock();
+    for (Pending& p : pending_) {
+      if (p.id == id) p.deadline_ms = 0;
+    }
+  }
+  return reply;
+}
+
+void SerialPipeline::Drain() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  changed_.wait(lock, [this] { return pending_.empty(); });
+}
+
+SerialPipeline::Stats SerialPipeline::GetStats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void SerialPipeline::Match(const std::string& reply) {
+  for (auto p = pending_.begin(); p != pending_.end(); ++p) {
+    if (reply.compare(0, p->prefix.size(), p->prefix) == 0) {
+      p->reply.set_value(reply);
+      pending_.erase(p);
+      stats_.replies++;
+      return;
+    }
+  }
+  stats_.unmatched++;
+}
+
+void SerialPipeline::Read() {
+  std::string received;
+  unsigned char buf[256];
+  while (!stop_) {
+    int len = port_->Poll(buf, sizeof buf);
+    if (len > 0) received.append((const char*)buf, len);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      size_t before = pending_.size();
+      for (size_t end = received.find(terminator_); end != std::string::npos; end = received.find(terminator_)) {
+        Match(received.substr(0, end));
+        received.erase(0, end + terminator_.size());
+      }
+      time_t now = Component::SteadyClockTimeMs();
+      for (auto p = pending_.begin(); p != pending_.end(); ) {
+        if (p->deadline_ms > now) {
+          ++p;
+          continue;
+        }
+        p->reply.set_value("");
+        p = pending_.erase(p);
+        stats_.timeouts++;
+      }
+      if (pending_.size() != before) changed_.notify_all();
+    }
+
+    if (len <= 0) Component::SleepMs(1);  // Polling the port does not block
+  }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "rs232_wrapper.h"
+
+// Command/reply transactions on a serial port, shared by the RS232 drivers
+// A reader thread splits what the device sends into replies at the
+//   terminator, and hands each reply to the oldest outstanding request that
+//   expects it.  Commands are written back to back without waiting for
+//   earlier replies, up to maxInFlight outstanding, so a long setup sequence
+//   costs the device's own processing time rather than a fixed sleep each.
+// A request that times out gets "".  If its reply comes later it goes to the
+//   next request expecting the same prefix, so devices whose replies all look
+//   alike should be given generous timeouts.
+// Example:
+//   SerialPipeline pipeline(rs232);
+//   std::future<std::string> width = pipeline.Request(":PULS1:WIDT 0.001\r\n");
+//   std::string position = pipeline.Request("1TP\r\n", "1TP").get();
+class SerialPipeline {
+ public:
+  // @param port opened port, not owned; nothing else may poll it
+  // @param terminator ends every reply, e.g. "\r\n"
+  // @param maxInFlight most requests awaiting replies at once; more block
+  SerialPipeline(RS232* port, const std::string& terminator = "\r\n", int maxInFlight = 8);
+  ~SerialPipeline();
+
+  // Write a command that gets no reply
+  // @returns false if the write failed
+  bool Send(const std::string& command);
+
+  // Write a command whose reply is wanted, without waiting for it
+  // @param prefix the reply starts with this, or "" for the next reply
+  // @param timeout_ms from when the command is written
+  // @returns future holding the reply without its terminator, or "" on a
+  //   timeout or failed write
+  std::future<std::string> Request(const std::string& command, const std::string& prefix = "",
+                                   int timeout_ms = 200);
+
+  // Wait until no request is outstanding
+  void Drain();
+
+  struct Stats {
+    int requests = 0;
+    int replies = 0;    // handed to a request
+    int timeouts = 0;
+    int unmatched = 0;  // replies no request expected, dropped
+  };
+  Stats GetStats();
+
+ private:
+  struct Pending {
+    uint64_t id;
+    std::string prefix;
+    time_t deadline_ms;
+    std::promise<std::string> reply;
+  };
+
+  // Reader thread body: split replies, match them, expire requests
+  void Read();
+
+  // Hand a reply to the oldest request expecting it
+  // @note caller holds mutex_
+  void Match(const std::string& reply);
+
+  RS232* port_;
+  std::string terminator_;
+  int maxInFlight_;
+  std::thread reader_;
+  std::atomic<bool> stop_{ false };
+
+  std::mutex sendMutex_;  // keeps each command's bytes together
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  std::list<Pending> pending_;  // oldest first
+  uint64_t nextId_ = 0;
+  Stats stats_;
+};
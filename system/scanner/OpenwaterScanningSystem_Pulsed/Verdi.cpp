@@ -12,6 +12,8 @@
 #include "Verdi.h"
 
 Verdi::~Verdi() {
+  delete pipeline_;
+  pipeline_ = NULL;
   delete rs232_;
   rs232_ = NULL;
 }
@@ -20,10 +22,21 @@ bool Verdi::init(int port) {
   if (!rs232_) {
     rs232_ = new RS232();
   }
-  return rs232_->Open(port - 1, 19200, "8N1") == 0;
+  if (rs232_->Open(port - 1, 19200, "8N1") != 0) return false;
+  if (!pipeline_) pipeline_ = new SerialPipeline(rs232_);
+  return true;
 }
 
 bool Verdi::sendString(const std::string& str) {
+  if (pipeline_) {
+    // Wait for the laser to answer, for no longer than the old fixed pause
+    std::string reply = pipeline_->Request(str, "", 1000).get();
+    if (reply.empty()) {
+      LOG(WARNING) << "Verdi: no reply to " << str.substr(0, str.find('\r'));
+      return false;
+    }
+    return true;
+  }
   int sendBufOK = rs232_->SendString(str);
   Component::SleepMs(1000);
   return sendBufOK;
@@ -5,6 +5,7 @@
 #include <string>
 
 #include "rs232_wrapper.h"
+#include "SerialPipeline.h"
 
 class Verdi : public Laser {
  public:
@@ -30,4 +31,5 @@ class Verdi : public Laser {
   bool sendString(const std::string& str);
 
   RS232* rs232_ = nullptr;
+  SerialPipeline* pipeline_ = nullptr;
 };
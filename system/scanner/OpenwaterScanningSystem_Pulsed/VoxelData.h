@@ -19,7 +19,8 @@ struct voxelData {
   double roiFFTEnergy = 0, rouFFTEnergy = 0, imageMean = 0, speckleContrast = 0;
   time_t POSIXTime = 0;
 
-  void operator>>(std::ofstream& stream) {
+  // Append one CSV line.  Flushing is up to the caller (see VoxelSink)
+  void operator>>(std::ostream& stream) const {
     stream << imageName << "," << cameraID << "," << POSIXTime << ","
         << i << "," << j << "," << k << ","
         << alphaIndex << "," << betaIndex << "," << gammaIndex << ","
@@ -28,6 +29,6 @@ struct voxelData {
         << alpha << "," << beta << "," << gamma << ","
         << azimuth << "," << axial << ","
         << roiFFTEnergy << "," << rouFFTEnergy << "," 
-        << imageMean << "," << speckleContrast << std::endl;
+        << imageMean << "," << speckleContrast << '\n';
   }
 };
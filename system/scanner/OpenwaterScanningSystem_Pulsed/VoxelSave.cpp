@@ -2,27 +2,37 @@
 
 #include "system/component/inc/fftt.h"
 #include "system/component/inc/frame.h"
+#include "system/component/inc/multicamerajoin.h"
 #include "system/component/inc/roi.h"
 #include "system/component/inc/stddev.h"
 
 #include <iostream>
 
 void* VoxelSave::Exec(void* data) {
-  Frame* fr = (Frame*)data;
-  voxelData vd;
+  MultiCameraJoin::Bundle* bundle = (MultiCameraJoin::Bundle*)data;
+  if (bundle->missing) {
+    std::cout << "WARNING: frame " << bundle->seq << " missing from " << bundle->missing << " camera(s)" << std::endl;
+  }
 
-  roi_tag* roiInfo = ROI::GetTag(fr);
-  fft_tag* fftInfo = FFTT::GetTag(fr);
+  std::vector<voxelData> vds;
+  for (Frame* fr : bundle->frames) {
+    if (!fr) continue;
+    voxelData vd;
 
-  vd.cameraID = fr->serialNumber;
-  vd.imageName = "hologramImage" + std::to_string(fr->seq); // TODO(CR/carsten): if this becomes device frames test what happens after reset
-  vd.roiFFTEnergy = roiInfo->roi;
-  vd.rouFFTEnergy = roiInfo->rou;
-  vd.imageMean = fftInfo->fft_zero;
-  vd.POSIXTime = fr->timestamp_ms_;
-  vd.speckleContrast = StdDev::GetTag(fr)->stddev / StdDev::GetTag(fr)->mean;
+    roi_tag* roiInfo = ROI::GetTag(fr);
+    fft_tag* fftInfo = FFTT::GetTag(fr);
 
-  cameras_->writeVoxelData(vd);
+    vd.cameraID = fr->serialNumber;
+    vd.imageName = "hologramImage" + std::to_string(fr->seq); // TODO(CR/carsten): if this becomes device frames test what happens after reset
+    vd.roiFFTEnergy = roiInfo->roi;
+    vd.rouFFTEnergy = roiInfo->rou;
+    vd.imageMean = fftInfo->fft_zero;
+    vd.POSIXTime = fr->timestamp_ms_;
+    vd.speckleContrast = StdDev::GetTag(fr)->stddev / StdDev::GetTag(fr)->mean;
+    vds.push_back(vd);
+  }
+
+  cameras_->writeVoxelData(vds);
 
   return data;
 }
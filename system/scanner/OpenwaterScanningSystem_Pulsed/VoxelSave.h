@@ -1,11 +1,14 @@
 #pragma once
 
 #include <cstdint>
+#include <vector>
 
 #include "CameraManager.h"
 
 #include "system/component/inc/execnode.h"
 
+// Write the results of each voxel, from every camera at once
+// Consumes MultiCameraJoin::Bundles
 class VoxelSave : public ExecNode {
  public:
   VoxelSave(CameraManager* cameras) : cameras_(cameras) {}
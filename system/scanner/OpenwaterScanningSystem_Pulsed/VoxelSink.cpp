@@ -0,0 +1,103 @@
+#include "VoxelSink.h"
+
+#include <sstream>
+#include <vector>
+
+#include "system/component/inc/time.h"
+
+VoxelSink::VoxelSink(int batch_ms, int mirror_ms) : batch_ms_(batch_ms), mirror_ms_(mirror_ms) {
+  last_mirror_ms_ = Component::SteadyClockTimeMs();
+  writer_ = std::thread(&VoxelSink::Run, this);
+}
+
+
+VoxelSink::~VoxelSink() {
+  Flush();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  writer_.join();
+}
+
+
+void VoxelSink::SetStreams(std::ostream* local, std::ostream* synced) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  local_ = local;
+  synced_ = synced;
+}
+
+
+void VoxelSink::Append(const voxelData& vd) {
+  queue_.Push(vd);
+}
+
+
+void VoxelSink::Append(const std::vector<voxelData>& vds) {
+  for (const voxelData& vd : vds) queue_.Push(vd);
+}
+
+
+bool VoxelSink::Flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  uint64_t ticket = ++flush_requested_;
+  wake_.notify_all();
+  flushed_.wait(lock, [this, ticket] { return flush_done_ >= ticket; });
+  return ok_;
+}
+
+
+VoxelSink::Stats VoxelSink::GetStats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+
+void VoxelSink::WriteBatch(bool force_mirror) {
+  std::vector<voxelData> batch;
+  if (queue_.PopAll(&batch) > 0) {
+    std::ostringstream lines;
+    for (const voxelData& vd : batch) vd >> lines;
+    std::string text = lines.str();
+    if (local_) {
+      local_->write(text.data(), text.size());
+      local_->flush();  // Once per batch, not once per line
+      if (!*local_) ok_ = false;
+    }
+    if (synced_) pending_ += text;
+    stats_.records += batch.size();
+    ++stats_.batches;
+  }
+
+  time_t now = Component::SteadyClockTimeMs();
+  if (force_mirror || now - last_mirror_ms_ >= mirror_ms_) {
+    if (synced_ && !pending_.empty()) {
+      synced_->write(pending_.data(), pending_.size());
+      synced_->flush();
+      if (!*synced_) ok_ = false;
+      ++stats_.mirrors;
+    }
+    pending_.clear();
+    last_mirror_ms_ = now;
+  }
+}
+
+
+void VoxelSink::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    wake_.wait_for(lock, std::chrono::milliseconds(batch_ms_),
+                   [this] { return stop_ || flush_requested_ > flush_done_; });
+    // Records appended before a Flush() call are already in the queue, so
+    // one pass covers every ticket issued so far
+    uint64_t ticket = flush_requested_;
+    bool flush = ticket > flush_done_;
+    WriteBatch(flush || stop_);
+    if (flush) {
+      flush_done_ = ticket;
+      flushed_.notify_all();
+    }
+    if (stop_ && queue_.empty()) break;
+  }
+}
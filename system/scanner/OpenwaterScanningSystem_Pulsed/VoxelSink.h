@@ -0,0 +1,80 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "VoxelData.h"
+
+#include "system/component/inc/mpsc_queue.h"
+
+// Batched, asynchronous writer for voxel results
+// Append() queues a record without taking a lock, so pipeline threads never
+//   wait on the disk.  A writer thread formats everything queued into one
+//   buffer every batch period and writes it to the local stream with a single
+//   flush.  The synced (network) stream gets the same lines, less often.
+// Example:
+//   VoxelSink sink;
+//   sink.SetStreams(&local, &synced);
+//   sink.Append(vd);  // from any thread
+//   sink.Flush();     // end of scan: everything is on both streams
+class VoxelSink {
+ public:
+  // @param batch_ms how often queued records are written to the local stream
+  // @param mirror_ms how often written records are copied to the synced stream
+  VoxelSink(int batch_ms = 100, int mirror_ms = 2000);
+
+  // Flushes, then stops the writer thread
+  ~VoxelSink();
+
+  // Set the output streams.  Either may be NULL.  Not owned
+  void SetStreams(std::ostream* local, std::ostream* synced);
+
+  // Queue a record
+  void Append(const voxelData& vd);
+
+  // Queue several records, e.g. one voxel's from every camera
+  void Append(const std::vector<voxelData>& vds);
+
+  // Block until everything appended before this call is written and flushed
+  //   to both streams
+  // @returns false if a stream is in a failed state
+  bool Flush();
+
+  struct Stats {
+    uint64_t records = 0;
+    uint64_t batches = 0;   // writes to the local stream
+    uint64_t mirrors = 0;   // writes to the synced stream
+  };
+  Stats GetStats();
+
+ private:
+  // Writer thread body
+  void Run();
+
+  // Write queued records, and mirror if it is time to (or force)
+  // @note caller holds mutex_
+  void WriteBatch(bool force_mirror);
+
+  MpscQueue<voxelData> queue_;
+  int batch_ms_;
+  int mirror_ms_;
+
+  std::mutex mutex_;               // streams, pending_, stats_, flush handshake
+  std::condition_variable wake_;   // flush requested, or stopping
+  std::condition_variable flushed_;
+  std::ostream* local_ = NULL;
+  std::ostream* synced_ = NULL;
+  std::string pending_;            // written locally, not yet mirrored
+  time_t last_mirror_ms_ = 0;
+  uint64_t flush_requested_ = 0;
+  uint64_t flush_done_ = 0;
+  bool ok_ = true;
+  bool stop_ = false;
+  Stats stats_;
+  std::thread writer_;
+};
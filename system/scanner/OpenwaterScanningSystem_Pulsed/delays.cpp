@@ -15,6 +15,8 @@ BerkeleyNucleonics::BerkeleyNucleonics() {
 }
 
 BerkeleyNucleonics::~BerkeleyNucleonics() {
+  delete pipeline_;
+  pipeline_ = NULL;
   delete rs232_;
   rs232_ = NULL;
 }
@@ -26,10 +28,16 @@ bool BerkeleyNucleonics::init(int port) {
     LOG(ERROR) << "BNC: error initializing";
     return false;
   }
+  if (!pipeline_) pipeline_ = new SerialPipeline(rs232_);
   return setModelNumber();
 }
 
 bool BerkeleyNucleonics::sendString(const std::string& str) {
+  if (pipeline_) {
+    // The unit replies "ok", or "?n" on an error, to every command
+    replies_.push_back(pipeline_->Request(str, "", 500));
+    return true;
+  }
   int stat = rs232_->SendString(str);
   Component::SleepMs(10);
   if (stat <= 0) {
@@ -40,6 +48,18 @@ bool BerkeleyNucleonics::sendString(const std::string& str) {
   return true;
 }
 
+int BerkeleyNucleonics::errors() {
+  for (std::future<std::string>& reply : replies_) {
+    std::string r = reply.get();
+    if (r.empty() || r[0] == '?') {
+      LOG(ERROR) << "BNC: command failed (" << (r.empty() ? "no reply" : r) << ")";
+      ++errors_;
+    }
+  }
+  replies_.clear();
+  return errors_;
+}
+
 bool BerkeleyNucleonics::setUnitPulseMode(PulseMode pulseMode) {
   std::string boxWrite;
   switch (pulseMode) {
@@ -114,6 +134,17 @@ int BerkeleyNucleonics::getModelNumber() {
 }
 
 bool BerkeleyNucleonics::setModelNumber() {
+  if (pipeline_) {
+    std::string id = pipeline_->Request("*IDN?\r\n", "", 500).get();  // e.g. "BNC,577,..."
+    if (id.size() < 7) {
+      LOG(ERROR) << "BNC identifies as '" << id << "'";
+      ++errors_;
+      return false;
+    }
+    modelNumber_ = atoi(id.c_str() + 4);
+    return true;
+  }
+
   sendString("*IDN?\r\n");
 
   unsigned char bncPollBuf[7] = {0};
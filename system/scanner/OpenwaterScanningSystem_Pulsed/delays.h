@@ -1,8 +1,11 @@
 #pragma once
 
+#include <future>
 #include <string>
+#include <vector>
 
 #include "rs232_wrapper.h"
+#include "SerialPipeline.h"
 
 enum PulseMode {
   CONTINUOUS,
@@ -11,6 +14,10 @@ enum PulseMode {
   DUTY_CYCLE
 };
 
+// BNC 525/577 delay generator
+// Once init() opens the port, commands are pipelined: each is written without
+//   waiting for the unit's "ok", and errors() checks the replies.  A unit that
+//   was not init()ed (e.g. with a mocked port) pauses after each command.
 class BerkeleyNucleonics {
  public:
   BerkeleyNucleonics();
@@ -56,7 +63,8 @@ class BerkeleyNucleonics {
   bool setNumberBurstPulses(int numPulses);
 
   // Return error count (for error checking after a long sequence of setup calls).
-  int errors() { return errors_; }
+  // Waits for the replies to any pipelined commands.
+  int errors();
 
  protected:
   // Send a string out through the interface.
@@ -65,5 +73,7 @@ class BerkeleyNucleonics {
   int modelNumber_ = 0;  // BNC 577 vs 525
   int errors_ = 0;
 
-  RS232 *rs232_;
+  RS232 *rs232_ = NULL;
+  SerialPipeline* pipeline_ = NULL;
+  std::vector<std::future<std::string>> replies_;  // to commands not yet checked
 };
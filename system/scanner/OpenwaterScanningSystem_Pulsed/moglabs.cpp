@@ -9,6 +9,8 @@
 #include "rs232_wrapper.h"
 
 MoglabsLaserDriver::~MoglabsLaserDriver() {
+  delete pipeline_;
+  pipeline_ = NULL;
   delete rs232_;
   rs232_ = NULL;
 }
@@ -19,10 +21,16 @@ bool MoglabsLaserDriver::init(int port) {
   if (!rs232_) {  // in case it's mocked
     rs232_ = new RS232();
   }
-  return rs232_->Open(port - 1, 38400, "8N1") == 0;
+  if (rs232_->Open(port - 1, 38400, "8N1") != 0) return false;
+  if (!pipeline_) pipeline_ = new SerialPipeline(rs232_);
+  return true;
 }
 
 int MoglabsLaserDriver::sendString(const std::string& str) {
+  if (pipeline_) {
+    // The driver answers every command; wait for it rather than a fixed pause
+    return !pipeline_->Request(str, "", 100).get().empty();
+  }
   int sendBufOK = rs232_->SendString(str);
   std::this_thread::sleep_for(std::chrono::milliseconds(10));
   return sendBufOK > 0;
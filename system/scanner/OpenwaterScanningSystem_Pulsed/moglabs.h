@@ -5,6 +5,7 @@
 #include <string>
 
 #include "rs232_wrapper.h"
+#include "SerialPipeline.h"
 
 class MoglabsLaserDriver : public Laser {
  public:
@@ -22,5 +23,6 @@ class MoglabsLaserDriver : public Laser {
   // Send a string out through the interface.
   int sendString(const std::string& str);
 
-  RS232* rs232_;
+  RS232* rs232_ = NULL;
+  SerialPipeline* pipeline_ = NULL;
 };
@@ -2,6 +2,7 @@
 
 #include "robot.h"
 
+#include <cstring>
 #include <iostream>
 
 #include "system/component/inc/time.h"
@@ -12,7 +13,115 @@ Robot::Robot(): socket_(NULL) {
 }
 
 Robot::~Robot() {
+  disconnect();
+}
+
+void Robot::setAddress(const std::string& address, int port) {
+  address_ = address;
+  port_ = port;
+}
+
+void Robot::disconnect() {
+  if (socket_) {
+    try {
+      socket_->shutdown();
+    } catch (const SocketException&) {
+    }
+  }
+  if (reader_.joinable()) reader_.join();
   delete socket_;
+  socket_ = NULL;
+}
+
+void Robot::readMessages(TCPSocket* socket) {
+  std::string pending;
+  char buffer[256];
+  for (;;) {
+    int recvd = 0;
+    try {
+      recvd = socket->recv(buffer, sizeof(buffer));
+    } catch (const SocketException& e) {
+      std::cout << "Socket recv exception: " << e.what() << std::endl;
+    }
+    if (recvd <= 0) break;  // Closed, or shut down by disconnect()
+
+    // Messages are null terminated
+    pending.append(buffer, recvd);
+    for (size_t end = pending.find('\0'); end != std::string::npos; end = pending.find('\0')) {
+      Message message;
+      message.raw = pending.substr(0, end);
+      pending.erase(0, end + 1);
+      sscanf(message.raw.c_str(), "[%d]", &message.code);
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (message.code == 3030) {  // Checkpoint reached: "[3030][n]"
+        int checkpoint = 0;
+        sscanf(message.raw.c_str(), "[3030][%d]", &checkpoint);
+        auto move = moves_.find(checkpoint);
+        if (move != moves_.end()) {
+          move->second.set_value(true);
+          moves_.erase(move);
+        }
+      } else {
+        std::cout << "Robot says: " << message.raw << std::endl;
+        if (message.code >= 1000 && message.code < 2000) failMoves();  // Command error; the robot drops its queued motion
+        recent_.push_back({ ++messages_, message });
+        if (recent_.size() > 32) recent_.pop_front();
+      }
+      changed_.notify_all();
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  connected_ = false;
+  failMoves();
+  changed_.notify_all();
+}
+
+bool Robot::waitMessage(uint64_t after, int code, int timeout_ms, Message* message) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return changed_.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&] {
+    for (const auto& recent : recent_) {
+      if (recent.first > after && (code == 0 || recent.second.code == code)) {
+        *message = recent.second;
+        return true;
+      }
+    }
+    return false;
+  });
+}
+
+void Robot::failMoves() {
+  for (auto& move : moves_) move.second.set_value(false);
+  moves_.clear();
+}
+
+std::future<bool> Robot::queueMotion(const std::string& command) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  // A few moves queued lets the robot blend them; more would only delay a cancel
+  changed_.wait(lock, [this] { return (int)moves_.size() < maxInFlight_ || !connected_; });
+  int checkpoint = nextCheckpoint_;
+  nextCheckpoint_ = nextCheckpoint_ % 8000 + 1;  // The robot takes 1 to 8000
+  std::future<bool> done = moves_[checkpoint].get_future();
+  if (!connected_) {
+    failMoves();
+    return done;
+  }
+  lock.unlock();
+
+  char buf[32];
+  snprintf(buf, sizeof(buf), "SetCheckpoint(%d)", checkpoint);
+  try {
+    std::lock_guard<std::mutex> sendLock(sendMutex_);
+    std::cout << "We say: " << command << std::endl;
+    socket_->send(command.c_str(), int(command.length() + 1));  // Send the null.
+    socket_->send(buf, int(strlen(buf) + 1));
+  } catch (const SocketException& e) {
+    std::cout << "Socket send exception: " << e.what() << std::endl;
+    lock.lock();
+    failMoves();
+  }
+  return done;
 }
 
 bool Robot::reset() {
@@ -25,55 +134,61 @@ bool Robot::reset() {
   return true;
 }
 
-bool Robot::write(const std::string& s, int delay) {
+bool Robot::write(const std::string& s, int timeout_ms) {
   const int retries = 5;
   for (int i = 0; i < retries; ++i) {
     const char* op = nullptr;
     try {
       std::cout << "We say: " << s << std::endl;
+      uint64_t sent;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sent = messages_;
+      }
       op = "send";
-      socket_->send(s.c_str(), int(s.length() + 1));  // Send the null.
-
-      if (delay) {
-        Component::SleepMs(delay);
-        op = "recv";
-        char buffer[256];
-        if (int recvd = socket_->recv(buffer, sizeof(buffer))) {
-          std::cout << "Robot says: " << std::string(buffer, buffer + recvd) << std::endl;
-          std::cout << "Error count: " << errors_ << std::endl;
-
-          // If it's a status command, check the return.
-          if (s.compare("GetStatusRobot") == 0) {
-            int as = -1, hs = -1, sm = -1, es = -1, pm = -1, eob = -1, eom = -1;
-            sscanf(buffer, "[2007][%d, %d, %d, %d, %d, %d, %d]", &as, &hs, &sm, &es, &pm, &eob, &eom);
-            if (es == 1) {
-              std::cout << "Robot error condition detected; attempting reset." << std::endl;
-              if (!write("ResetError", 200)) return false;
-            }
-            if (pm == 1) {
-              std::cout << "Robot pause motion condition detected; attempting to resume." << std::endl;
-              if (!write("ClearMotion", 1000)) return false;
-              if (!write("ResumeMotion", 1000)) return false;
-            }
-          } else if (s.compare("GetPose") == 0) {
-            double x = 0, y = 0, z = 0, alpha = 0, beta = 0, gamma = 0;
-            sscanf(buffer, "[2027][%lf, %lf, %lf, %lf, %lf, %lf]", &x, &y, &z, &alpha, &beta, &gamma);
-            currentPose_[0] = x;
-            currentPose_[1] = y;
-            currentPose_[2] = z;
-            currentPose_[3] = alpha;
-            currentPose_[4] = beta;
-            currentPose_[5] = gamma;
-          } else if (s.compare("GetJoints") == 0) {
-            double j1 = 0, j2 = 0, j3 = 0, j4 = 0, j5 = 0, j6 = 0;
-            sscanf(buffer, "[2026][%lf, %lf, %lf, %lf, %lf, %lf]", &j1, &j2, &j3, &j4, &j5, &j6);
-            joints_[0] = j1;
-            joints_[1] = j2;
-            joints_[2] = j3;
-            joints_[3] = j4;
-            joints_[4] = j5;
-            joints_[5] = j6;
+      {
+        std::lock_guard<std::mutex> lock(sendMutex_);
+        socket_->send(s.c_str(), int(s.length() + 1));  // Send the null.
+      }
+
+      // Queries' replies are known by their code; anything else takes the next message
+      int code = s == "GetStatusRobot" ? 2007 : s == "GetPose" ? 2027 : s == "GetJoints" ? 2026 : 0;
+      Message reply;
+      if (timeout_ms && waitMessage(sent, code, timeout_ms, &reply)) {
+        const char* buffer = reply.raw.c_str();
+        std::cout << "Error count: " << errors_ << std::endl;
+
+        // If it's a status command, check the return.
+        if (s.compare("GetStatusRobot") == 0) {
+          int as = -1, hs = -1, sm = -1, es = -1, pm = -1, eob = -1, eom = -1;
+          sscanf(buffer, "[2007][%d, %d, %d, %d, %d, %d, %d]", &as, &hs, &sm, &es, &pm, &eob, &eom);
+          if (es == 1) {
+            std::cout << "Robot error condition detected; attempting reset." << std::endl;
+            if (!write("ResetError", 200)) return false;
           }
+          if (pm == 1) {
+            std::cout << "Robot pause motion condition detected; attempting to resume." << std::endl;
+            if (!write("ClearMotion", 1000)) return false;
+            if (!write("ResumeMotion", 1000)) return false;
+          }
+        } else if (s.compare("GetPose") == 0) {
+          double x = 0, y = 0, z = 0, alpha = 0, beta = 0, gamma = 0;
+          sscanf(buffer, "[2027][%lf, %lf, %lf, %lf, %lf, %lf]", &x, &y, &z, &alpha, &beta, &gamma);
+          currentPose_[0] = x;
+          currentPose_[1] = y;
+          currentPose_[2] = z;
+          currentPose_[3] = alpha;
+          currentPose_[4] = beta;
+          currentPose_[5] = gamma;
+        } else if (s.compare("GetJoints") == 0) {
+          double j1 = 0, j2 = 0, j3 = 0, j4 = 0, j5 = 0, j6 = 0;
+          sscanf(buffer, "[2026][%lf, %lf, %lf, %lf, %lf, %lf]", &j1, &j2, &j3, &j4, &j5, &j6);
+          joints_[0] = j1;
+          joints_[1] = j2;
+          joints_[2] = j3;
+          joints_[3] = j4;
+          joints_[4] = j5;
+          joints_[5] = j6;
         }
       }
 
@@ -91,25 +206,27 @@ bool Robot::write(const std::string& s, int delay) {
 }
 
 bool Robot::init() {
+  disconnect();  // When resetting
   try {
-    const char* const RobotAddress = "192.168.0.100";
-    const int RobotSocket = 10000;
-    socket_ = new TCPSocket(RobotAddress, RobotSocket);
-    std::cout << "Found robot at " << RobotAddress << ":" << RobotSocket << "." << std::endl;
+    socket_ = new TCPSocket(address_, port_);
+    std::cout << "Found robot at " << address_ << ":" << port_ << "." << std::endl;
   } catch(const SocketException& e) {
     std::cout << "Socket init exception: " << e.what() << std::endl;
     return false;
   }
-  Component::SleepMs(100);
+
+  uint64_t connected;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    connected_ = true;
+    connected = messages_;
+  }
+  reader_ = std::thread(&Robot::readMessages, this, socket_);
 
   // Expecting "[3000][Connected to Meca500 3_7.0.6]" here.
-  try {
-    char buffer[256];
-    if (int recvd = socket_->recv(buffer, sizeof(buffer))) {
-      std::cout << "Robot says: " << std::string(buffer, buffer + recvd) << std::endl;
-    }
-  } catch (const SocketException & e) {
-    std::cout << "Socket recv exception: " << e.what() << std::endl;
+  Message greeting;
+  if (!waitMessage(connected, 0, 2000, &greeting)) {
+    std::cout << "No greeting from robot." << std::endl;
     return false;
   }
   return true;
@@ -139,22 +256,32 @@ bool Robot::setTRF(double x, double y, double z, double alpha, double beta, doub
 bool Robot::moveJoints(double t1, double t2, double t3, double t4, double t5, double t6) {
   char buf[256];
   snprintf(buf, 256, "MoveJoints(%g,%g,%g,%g,%g,%g)", t1, t2, t3, t4, t5, t6);
-  return write(std::string(buf), 250);
+  return queueMotion(buf).get();
 }
 
 bool Robot::movePose(double x, double y, double z, double alpha, double beta, double gamma) {
   // Check for robot error status.
-  if (!write("GetStatusRobot", 10)) return false;
+  if (!write("GetStatusRobot", 100)) return false;
+
+  for (int i = 0; i < 2; ++i) {
+    if (movePoseAsync(x, y, z, alpha, beta, gamma).get()) return true;
+    ++errors_;
+    std::cout << "Robot move failed; attempting reset." << std::endl;
+    if (!reset()) return false;
+  }
+  return false;
+}
 
+std::future<bool> Robot::movePoseAsync(double x, double y, double z, double alpha, double beta, double gamma) {
   char buf[256];
   snprintf(buf, 256, "MovePose(%g,%g,%g,%g,%g,%g)", x, y, z, alpha, beta, gamma);
-  return write(std::string(buf), 500);
+  return queueMotion(buf);
 }
 
 bool Robot::moveLinRelTRF(double x, double y, double z, double alpha, double beta, double gamma) {
   char buf[256];
   snprintf(buf, 256, "MoveLinRelTRF(%g,%g,%g,%g,%g,%g)", x, y, z, alpha, beta, gamma);
-  return write(std::string(buf), 250);
+  return queueMotion(buf).get();
 }
 
 bool Robot::setInitJoints(double j1, double j2, double j3, double j4, double j5, double j6) {
@@ -1,13 +1,29 @@
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <map>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 class TCPSocket;
 
+// Meca500 robot client
+// A reader thread parses the robot's messages as they arrive, so commands wait
+//   for their reply rather than sleeping for a worst-case time.  Motion
+//   commands are queued on the robot ahead of time, up to a limit, so it can
+//   blend them; each is followed by a checkpoint whose message completes the
+//   command's future.
 class Robot {
  public:
   Robot();
   virtual ~Robot();
 
+  // Connect somewhere other than the robot's default 192.168.0.100:10000
+  void setAddress(const std::string& address, int port);
+
   // Initialize. Delayed from _ct for testability.
   virtual bool init();
 
@@ -24,6 +40,14 @@ class Robot {
   // Move the tool to these coords in the TRF.
   bool movePose(double x, double y, double z, double alpha, double beta, double gamma);
 
+  // Queue a movePose() without waiting for it, or for the robot's status
+  // @returns future holding true once the move is complete, false on a robot
+  //   error or lost connection
+  std::future<bool> movePoseAsync(double x, double y, double z, double alpha, double beta, double gamma);
+
+  // Most motion commands queued on the robot at once.  Queueing more blocks
+  void setMaxInFlight(int maxInFlight) { maxInFlight_ = maxInFlight; }
+
   // Move the tool a relative amount, in current TRF coords.
   bool moveLinRelTRF(double x, double y, double z, double alpha, double beta, double gamma);
 
@@ -40,13 +64,50 @@ class Robot {
   std::vector<double> getJoints();
 
  protected:
+  struct Message {
+    int code = 0;
+    std::string raw;  // e.g. "[2007][1, 1, 0, 0, 0, 1, 1]"
+  };
+
   // Write a single command to the port, and handle any errors that occur.
-  bool write(const std::string&, int delay_ms);
+  // @param timeout_ms how long to wait for a reply, 0 for none
+  bool write(const std::string&, int timeout_ms);
+
+  // Send a motion command followed by a checkpoint
+  // @returns future completed by the checkpoint
+  std::future<bool> queueMotion(const std::string& command);
+
+  // Reader thread body: split messages, complete checkpoints, file replies
+  void readMessages(TCPSocket* socket);
+
+  // Wait for a message received after `after` messages
+  // @param code message code wanted, or 0 for any
+  // @returns false on timeout
+  bool waitMessage(uint64_t after, int code, int timeout_ms, Message* message);
+
+  // Complete every queued move's future with false
+  // @note caller holds mutex_
+  void failMoves();
+
+  // Shut down the connection and the reader thread
+  void disconnect();
 
   // Reset the robot state after a network failure.
   bool reset();
 
+  std::string address_ = "192.168.0.100";
+  int port_ = 10000;
   TCPSocket* socket_;
+  std::thread reader_;
+  std::mutex sendMutex_;  // keeps a move and its checkpoint together
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  std::deque<std::pair<uint64_t, Message>> recent_;  // and each one's number
+  uint64_t messages_ = 0;  // received, other than checkpoints
+  std::map<int, std::promise<bool>> moves_;  // queued, by checkpoint
+  int nextCheckpoint_ = 1;
+  int maxInFlight_ = 4;
+  bool connected_ = false;
   int errors_ = 0;
   double trf_[6];
   double joints_[6];
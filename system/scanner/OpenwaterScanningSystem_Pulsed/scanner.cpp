@@ -11,6 +11,7 @@ namespace fs = std::experimental::filesystem;
 
 #include <glog/logging.h>
 
+#include "system/component/inc/filemirror.h"
 #include "system/component/inc/time.h"
 
 #include "OctopusManager.h"
@@ -143,6 +144,18 @@ bool Scanner::initializeUSTx() {
     }
   }
 
+  // Fine grids take a while to compute, so keep focus lists to reuse on restart
+  std::string ustxCacheDir = systemParameters_["fileParameters"].value("ustxCacheDir", std::string("ustxFocusCache"));
+  if (ustxCacheDir != "") {
+    std::error_code err;
+    fs::create_directories(ustxCacheDir, err);
+    if (err) {
+      LOG(WARNING) << "Can't create USTx focus list cache " << ustxCacheDir << ": " << err.message();
+    } else {
+      ustx_->SetCacheDir(ustxCacheDir);
+    }
+  }
+
   if (!ustx_->ComputeFoci(focusList)) {
     return false;
   }
@@ -222,9 +235,38 @@ bool Scanner::initializeDelayGenerator() {
 
   delayGenerator_->enableUnit(unitON);
   delayGenerator_->displayUpdate();
+  int errors = delayGenerator_->errors();
+  if (errors) LOG(WARNING) << "BNC: " << errors << " errors during setup";
   return true;
 }
 
+ScanPlan Scanner::planScan(const std::vector<std::pair<std::string, const Range*>>& ranges) {
+  const auto& scanParameters = systemParameters_["scanParameters"];
+  bool serpentine = scanParameters.value("serpentineScan", false);
+  bool slowestOutermost = scanParameters.value("slowestAxisOutermost", false);
+  json velocity = scanParameters.value("axisVelocity", json::object());
+  json settle = scanParameters.value("axisSettle_ms", json::object());
+
+  std::vector<ScanPlan::Axis> axes;
+  for (const auto& range : ranges) {
+    axes.push_back(ScanPlan::Axis(range.first, range.second->values, velocity.value(range.first, 0.0),
+                                  settle.value(range.first, 0.0)));
+  }
+  ScanPlan plan(axes, serpentine, slowestOutermost);
+  LOG(INFO) << "Scan plan: " << plan.size() << " slices, estimated travel " << plan.EstimateTravel() / 1000
+            << " s (" << ScanPlan(axes, false).EstimateTravel() / 1000 << " s in raster order)";
+
+  // Saved with the scan's data, when there is any: tests and dry runs have no data directory
+  std::string localScanDataDir = systemParameters_["fileParameters"]["localScanDataDir"].get<std::string>();
+  if (cameras_ && fs::is_directory(localScanDataDir)) {
+    std::string planFilename = localScanDataDir + "/scanPlan.json";
+    if (!plan.Save(planFilename)) {
+      LOG(WARNING) << "Could not save scan plan to " << planFilename;
+    }
+  }
+  return plan;
+}
+
 // Implement Trigger: Trigger the signal capture sequence for a voxel.
 void Scanner::triggerAcquisition() {
   int octopusSystem = systemParameters_["hardwareParameters"]["octopus"].get<int>();
@@ -258,16 +300,24 @@ bool Scanner::startScan() {
     fileParams["syncedScanDataDir"].get<std::string>() + imageInfoFilename;
   std::string syncedScanDataDir_repeatedVoxelLog =
     fileParams["syncedScanDataDir"].get<std::string>() + repeatedVoxelLogFilename;
+  // When raw images are mirrored, the repeated voxel log is too.  imageInfo is
+  // already written locally, and copied to the synced file periodically.
+  repeatedVoxelLogName_ = syncedScanDataDir_repeatedVoxelLog;
+  if (cameras_ && cameras_->fileMirror()) {
+    repeatedVoxelLogName_ = fileParams["localScanDataDir"].get<std::string>() + repeatedVoxelLogFilename;
+    repeatedVoxelLogMirror_ = syncedScanDataDir_repeatedVoxelLog;
+  }
   imageInfoSynced_.open(syncedScanDataDir_imageInfo, std::ofstream::out | std::ofstream::app);
   imageInfoLocal_.open(localScanDataDir_imageInfo, std::ofstream::out | std::ofstream::app);
-  repeatedVoxelLog_.open(syncedScanDataDir_repeatedVoxelLog, std::ofstream::out | std::ofstream::app);
+  repeatedVoxelLog_.open(repeatedVoxelLogName_, std::ofstream::out | std::ofstream::app);
+  // Header first: once the streams are handed over, voxels are written from another thread
+  imageInfoLocal_ << CSVHeader;
+  imageInfoSynced_ << CSVHeader;
   if (cameras_) {
     cameras_->setImageInfoStream(&imageInfoLocal_, true);
     cameras_->setImageInfoStream(&imageInfoSynced_, false);
     cameras_->setRepeatedVoxelLogStream(&repeatedVoxelLog_);
   }
-  imageInfoLocal_ << CSVHeader;
-  imageInfoSynced_ << CSVHeader;
 
   return true;
 }
@@ -277,7 +327,15 @@ bool Scanner::endScan() {
 
   if (delayGenerator_) delayGenerator_->enableUnit(false);
 
-  if (octopusManager_) octopusManager_->EnableSystemChannels(false);
+  if (octopusManager_) {
+    octopusManager_->EnableSystemChannels(false);
+    OctopusManager::TriggerStats stats = octopusManager_->GetTriggerStats();
+    if (stats.triggers) {
+      LOG(INFO) << "Octopus: " << stats.triggers << " voxel triggers, " << stats.rearms << " re-armed only, "
+                << stats.transfers << " USB transfers (" << stats.transfersSaved << " saved), latency "
+                << stats.totalLatency_us / stats.triggers << " us mean, " << stats.maxLatency_us << " us max";
+    }
+  }
 
   std::string laserModel = systemParameters_["laserParameters"]["laser"].get<std::string>();
   if (laser_) {
@@ -295,6 +353,15 @@ bool Scanner::endScan() {
   imageInfoSynced_.close();
   repeatedVoxelLog_.close();
 
+  FileMirror* mirror = cameras_ ? cameras_->fileMirror() : NULL;
+  if (mirror) {
+    if (repeatedVoxelLogMirror_ != "") mirror->Copy(repeatedVoxelLogName_, repeatedVoxelLogMirror_);
+    FileMirror::Backlog backlog = mirror->GetBacklog();
+    LOG(INFO) << "Mirror backlog: " << backlog.files_pending << " files, " << backlog.bytes_pending / 1000000
+              << " MB (" << backlog.files_copied << " copied at " << backlog.mb_per_s << " MB/s, "
+              << backlog.failures << " failed)";
+  }
+
   return true;
 }
 
@@ -11,6 +11,7 @@
 #include "CameraManager.h"
 #include "delays.h"
 #include "laser.h"
+#include "ScanPlan.h"
 #include "trigger.h"
 
 class OctopusManager;
@@ -44,6 +45,12 @@ class Scanner : public Trigger {
     double operator[](int i) { return values[i]; }
   };
 
+  // Order the scan's slices over the given axes, outermost first.  Options
+  //   from scanParameters, all optional: serpentineScan, slowestAxisOutermost,
+  //   and per-axis axisVelocity (units/s) and axisSettle_ms, keyed by name.
+  //   The plan is saved to localScanDataDir/scanPlan.json, mapping slices to voxels
+  ScanPlan planScan(const std::vector<std::pair<std::string, const Range*>>& ranges);
+
   // Initialize components.
   bool initializeDelayGenerator();
   bool initializeUSTx();
@@ -68,4 +75,6 @@ class Scanner : public Trigger {
   std::ofstream imageInfoLocal_;
   std::ofstream imageInfoSynced_;
   std::ofstream repeatedVoxelLog_;
+  std::string repeatedVoxelLogName_;
+  std::string repeatedVoxelLogMirror_;  // synced copy, when output is mirrored
 };
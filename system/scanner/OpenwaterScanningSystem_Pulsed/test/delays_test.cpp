@@ -1,7 +1,9 @@
 #include "googletest/googletest/include/gtest/gtest.h"
 #include "googletest/googlemock/include/gmock/gmock.h"
 
+#include "system/component/inc/time.h"
 #include "system/scanner/OpenwaterScanningSystem_Pulsed/delays.h"
+#include "system/scanner/OpenwaterScanningSystem_Pulsed/test/serial_emulator.h"
 
 using testing::Return;
 using testing::_;
@@ -15,10 +17,10 @@ class MockRS232 : public RS232 {
   MOCK_METHOD2(Poll, int(unsigned char* buffer, int max_size));
 };
 
-// Test subclass using MockRS2332
+// Test subclass using MockRS2332 or SerialEmulator
 class BerkeleyNucleonicsTest : public BerkeleyNucleonics {
  public:
-  BerkeleyNucleonicsTest(MockRS232 *mock) { rs232_ = mock; }
+  BerkeleyNucleonicsTest(RS232 *mock) { rs232_ = mock; }
   ~BerkeleyNucleonicsTest() { rs232_ = NULL; } // keep parent class from deleting stack object
 
   void TestSetModelNumber(int modelNum) { modelNumber_ = modelNum; }
@@ -210,3 +212,61 @@ TEST(Delays, setModelNumber) {
   ON_CALL(mockRS232, Poll).WillByDefault(FakePollForSetModelNumberFails);
   ASSERT_FALSE(test.setModelNumber());
 }
+
+// Replies as a BNC 577 does
+static std::string BncReply(const std::string& command) {
+  if (command == "*IDN?") return "BNC,577,18432,2.4.1";
+  if (command == ":PULS9:STAT ON") return "?3";  // No such channel
+  return "ok";
+}
+
+// The scanner's setup for the fake laser
+static void Configure(BerkeleyNucleonics* bnc) {
+  bnc->resetUnit();
+  bnc->setUnitPulseMode(CONTINUOUS);
+  bnc->setUnitExternalTriggerMode(false);
+  bnc->setUnitPulseRate(10);
+  bnc->setPulseDelay(1, "0.001");
+  bnc->setPulseWidth(1, "0.0001");
+  bnc->setPulseDelay(6, "0.002");
+  bnc->setPulseWidth(6, "0.0001");
+  for (int channel = 1; channel <= 6; channel++) bnc->enableChannel(channel, channel == 1 || channel == 6);
+  bnc->enableUnit(true);
+  bnc->displayUpdate();
+}
+
+TEST(Delays, pipelinedSetupIsFaster) {
+  SerialEmulator legacyPort(BncReply);
+  BerkeleyNucleonicsTest legacy(&legacyPort);  // Not init()ed, so pauses after each command
+  legacy.TestSetModelNumber(577);
+  time_t start = Component::SteadyClockTimeMs();
+  Configure(&legacy);
+  time_t legacy_ms = Component::SteadyClockTimeMs() - start;
+
+  SerialEmulator port(BncReply);
+  BerkeleyNucleonicsTest pipelined(&port);
+  ASSERT_TRUE(pipelined.init(1));
+  ASSERT_EQ(577, pipelined.getModelNumber());
+  start = Component::SteadyClockTimeMs();
+  Configure(&pipelined);
+  ASSERT_EQ(0, pipelined.errors());
+  time_t pipelined_ms = Component::SteadyClockTimeMs() - start;
+
+  RecordProperty("legacy_ms", (int)legacy_ms);
+  RecordProperty("pipelined_ms", (int)pipelined_ms);
+  std::vector<std::string> commands = port.commands();
+  ASSERT_EQ("*IDN?", commands[0]);
+  commands.erase(commands.begin());
+  ASSERT_EQ(legacyPort.commands(), commands);
+  ASSERT_LT(3 * pipelined_ms, legacy_ms);
+}
+
+TEST(Delays, pipelinedErrorsCounted) {
+  SerialEmulator port(BncReply);
+  BerkeleyNucleonicsTest test(&port);
+  ASSERT_TRUE(test.init(1));
+  test.enableChannel(2, true);
+  test.enableChannel(9, true);
+  ASSERT_EQ(1, test.errors());
+  ASSERT_EQ(1, test.errors());  // Each reply counted once
+}
@@ -3,6 +3,7 @@
 
 #include "system/scanner/OpenwaterScanningSystem_Pulsed/QuantumComposers.h"
 #include "system/scanner/OpenwaterScanningSystem_Pulsed/Verdi.h"
+#include "system/scanner/OpenwaterScanningSystem_Pulsed/test/serial_emulator.h"
 
 using testing::Return;
 using testing::_;
@@ -13,6 +14,7 @@ class MockRS232 : public RS232 {
   MOCK_METHOD3(Open, int(int port, int baud_rate, const char* mode));
   MOCK_CONST_METHOD0(Port, int());
   MOCK_METHOD1(SendString, int(const std::string&));
+  MOCK_METHOD2(Poll, int(unsigned char* buffer, int max_size));
 };
 
 // Test subclass using MockRS2332
@@ -25,7 +27,7 @@ class QuantumComposersTest : public QuantumComposers {
 // Test subclass using MockRS2332
 class VerdiTest : public Verdi {
  public:
-  VerdiTest(MockRS232* mock) { rs232_ = mock; }
+  VerdiTest(RS232* mock) { rs232_ = mock; }
   ~VerdiTest() { rs232_ = NULL; } // keep parent class from deleting stack object
 };
 
@@ -123,3 +125,14 @@ TEST(LaserTest, enableUnit) {
   ASSERT_TRUE(test.enableUnit(true));
   ASSERT_TRUE(test.enableUnit(false));
 }
+
+TEST(LaserTest, replyEndsWait_Verdi) {
+  SerialEmulator port([](const std::string& command) { return command; }, 5);  // Echoes
+  VerdiTest test(&port);
+  ASSERT_TRUE(test.init(4));
+  time_t start = Component::SteadyClockTimeMs();
+  ASSERT_TRUE(test.setLaserPower(1.5));
+  ASSERT_TRUE(test.setLaserRun(true));
+  ASSERT_LT(Component::SteadyClockTimeMs() - start, 500);  // Rather than 1 s each
+  ASSERT_EQ(std::vector<std::string>({ "P:1.500000", "L:1" }), port.commands());
+}
@@ -0,0 +1,158 @@
+#include <cstring>
+#include <vector>
+
+#include "googletest/googletest/include/gtest/gtest.h"
+#include "system/component/inc/octopus.h"
+#include "system/component/inc/octopus_sim.h"
+#include "system/component/inc/octopus_timing_sim.h"
+#include "system/component/test/octopus_timing_assert.h"
+#include "system/scanner/OpenwaterScanningSystem_Pulsed/OctopusManager.h"
+#include "system/third_party/json-develop/single_include/nlohmann/json.hpp"
+
+using json = nlohmann::json;
+
+static const int TIMER_CONTROL = 0x1F;
+static const Octopus::Pin SW_TRIGGER = Octopus::Pin::OUT8_TOP;
+
+// Just what InitializeOctopus reads, for a pulsed system
+const char* const TestJSON = R"foo({
+  "ultrasoundParameters": {
+    "ultrasoundAmp": "USTx",
+    "ultrasoundVoltage_V": 45.0,
+    "ultrasoundFreq_MHz": 5.0
+  },
+  "AOMParameters": {
+    "AOM1Freq_MHz": 100,
+    "AOM2Freq_MHz": 95.0,
+    "AOM1Volt_V": 7,
+    "AOM2Volt_V": 7
+  },
+  "laserParameters": {
+    "pseudoPulsed": 0,
+    "laserClockPeriod_ms": 10.0,
+    "pulsed": 1
+  },
+  "cameraParameters": {
+    "frameLength_ms": 10.0
+  },
+  "delayParameters": {
+    "TTLPulseWidth_s": 0.0001,
+    "chADelay_s": "0.00081",
+    "chBDelay_s": "0.00058789",
+    "chCDelay_s": "0.00058789",
+    "chCWidth_s": "0.001",
+    "chDDelay_s": "0.00071",
+    "chDWidth_s": "0.001",
+    "chEDelay_s": "0.0",
+    "chEWidth_s": "0.0001"
+  }
+})foo";
+
+// The SW trigger timer, as InitializeOctopus sets it up
+static Octopus::Timer SWTrigger() {
+  Octopus::Timer ot;
+  memset(&ot, 0, sizeof(ot));
+  ot.trigger.select = Octopus::Pin::HIGH;
+  ot.trigger.sense = Octopus::Timer::Trigger::HIGH;
+  ot.gate.select = Octopus::Pin::HIGH;
+  ot.gate.sense = Octopus::Timer::Gate::HIGH;
+  ot.state[1].output_value = true;
+  ot.state[1].next_state = 2;
+  ot.state[1].period = 100e-6;
+  ot.state[2].next_state = 0;
+  ot.state[2].period = 1e-6;
+  ot.state_transition_count = 3;
+  ot.out_select = SW_TRIGGER;
+  return ot;
+}
+
+static std::vector<uint16_t> TimerControlWrites(const OctopusSim& sim) {
+  std::vector<uint16_t> writes;
+  for (const OctopusSim::Write& w : sim.Writes()) {
+    if (w.device == TIMER_CONTROL && w.reg == 0) writes.push_back(w.data);
+  }
+  return writes;
+}
+
+TEST(TestOctopusManager, TriggerPulseTrainUnchanged) {
+  // The board as the scan leaves it, triggered the way TriggerVoxel always has
+  OctopusSim reference_sim;
+  Octopus reference(&reference_sim);
+  OctopusSim sim;
+  OctopusManager manager(new Octopus(&sim));
+  json systemParameters = json::parse(TestJSON);
+  ASSERT_TRUE(manager.init(systemParameters, 10, NULL));
+  ASSERT_EQ(0, reference.Open());
+  ASSERT_TRUE(manager.EnableSystemChannels(true));
+  reference.EnableTimer(SW_TRIGGER, true);
+
+  // Same timer control writes: disable, then enable, every voxel
+  uint16_t others = sim.Reg(TIMER_CONTROL, 0) & ~(1 << (SW_TRIGGER - 8));
+  sim.ClearLog();
+  for (int i = 0; i < 5; ++i) {
+    manager.TriggerVoxel();
+    reference.InvalidateShadow();
+    reference.ConfigureTimer(SWTrigger());
+    reference.EnableTimer(SW_TRIGGER, true);
+  }
+  std::vector<uint16_t> writes = TimerControlWrites(sim);
+  ASSERT_EQ(10u, writes.size());
+  for (size_t i = 0; i < writes.size(); ++i) {
+    ASSERT_EQ(others | (i % 2) << (SW_TRIGGER - 8), writes[i]) << i;
+  }
+  ASSERT_EQ(TimerControlWrites(reference_sim).size(), writes.size() + 1);  // and the enable above
+
+  for (int reg = 0; reg < 17; ++reg) {
+    ASSERT_EQ(reference_sim.Reg(SW_TRIGGER - 8, reg), sim.Reg(SW_TRIGGER - 8, reg)) << reg;
+  }
+}
+
+TEST(TestOctopusManager, TriggerOnlyRearms) {
+  OctopusSim sim;
+  OctopusManager manager(new Octopus(&sim));
+  json systemParameters = json::parse(TestJSON);
+  ASSERT_TRUE(manager.init(systemParameters, 10, NULL));
+
+  sim.ClearLog();
+  manager.TriggerVoxel();
+  ASSERT_EQ(1 + 17 + 1, sim.Transfers());  // Timer registers written once
+  for (int i = 0; i < 99; ++i) manager.TriggerVoxel();
+  ASSERT_EQ(1 + 17 + 1 + 99 * 2, sim.Transfers());
+
+  OctopusManager::TriggerStats stats = manager.GetTriggerStats();
+  ASSERT_EQ(100, stats.triggers);
+  ASSERT_EQ(99, stats.rearms);
+  ASSERT_EQ(sim.Transfers(), stats.transfers);
+  ASSERT_EQ(100 * 23 - sim.Transfers(), stats.transfersSaved);
+  ASSERT_GE(stats.maxLatency_us * 100, stats.totalLatency_us);
+
+  // Turning the outputs off reconfigures the timer, so the next trigger loads it again
+  manager.EnableSystemChannels(false);
+  sim.ClearLog();
+  manager.TriggerVoxel();
+  ASSERT_GT(sim.Transfers(), 2);
+  ASSERT_EQ(99, manager.GetTriggerStats().rearms);
+}
+
+TEST(TestOctopusManager, PulsedVoxelTiming) {
+  OctopusTimingSim sim;
+  OctopusManager manager(new Octopus(&sim));
+  json systemParameters = json::parse(TestJSON);
+  ASSERT_TRUE(manager.init(systemParameters, 10, NULL));
+  sim.ClockInput(Octopus::Pin::IN1_BOTTOM, 10e-3, 100e-6, 12, 5e-3);  // the laser
+
+  manager.EnableSystemChannels(true);
+  manager.TriggerVoxel();
+  sim.Run(0.12);
+
+  // The SW trigger opens the voxel gate for the voxel's 10 laser pulses
+  EXPECT_TRUE(PulsesAre(sim.Timeline(SW_TRIGGER), { { -1, 100e-6 } }));
+  EXPECT_TRUE(PulsesAre(sim.Timeline(Octopus::Pin::OUT8_BOTTOM), { { -1, 0.1 } }));
+  std::vector<OctopusTimingSim::Pulse> ustx = OctopusTimingSim::Pulses(sim.Timeline(Octopus::Pin::OUT2_BOTTOM));
+  ASSERT_EQ(10u, ustx.size());
+  EXPECT_NEAR(100e-6, ustx[0].width, 2 * ONE_CYCLE);
+  // USTx at chBDelay_s from each laser pulse in the gate
+  EXPECT_NEAR(5e-3 + 0.00058789, ustx[0].start, 2 * ONE_CYCLE);
+  EXPECT_NEAR(95e-3 + 0.00058789, ustx[9].start, 2 * ONE_CYCLE);
+  EXPECT_EQ(10u, OctopusTimingSim::Pulses(sim.AOMTimeline(1)).size());
+}
@@ -0,0 +1,202 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "googletest/googletest/include/gtest/gtest.h"
+#include "system/component/inc/time.h"
+#include "system/scanner/OpenwaterScanningSystem_Pulsed/robot.h"
+#include "system/third_party/practical-socket/PracticalSocket.h"
+
+// Emulates a Meca500 on a local TCP port.  Motion commands queue up and each
+// takes move_ms; checkpoints are reported when the motion before them is done.
+class RobotEmulator {
+ public:
+  RobotEmulator(int move_ms) : server_("127.0.0.1", 0), move_ms_(move_ms) {
+    thread_ = std::thread([this] { Serve(); });
+  }
+
+  ~RobotEmulator() {
+    stop_ = true;
+    thread_.join();
+    if (sender_.joinable()) sender_.join();
+    delete client_;
+  }
+
+  int port() { return server_.getLocalPort(); }
+
+  // Reject motion from now on, as a robot in error does
+  void FailMoves() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fail_ = true;
+  }
+
+  // Most moves queued on the emulator at once
+  int maxQueued() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return maxQueued_;
+  }
+
+ private:
+  void Serve() {
+    client_ = server_.accept();
+    Say(Component::SteadyClockTimeMs(), "[3000][Connected to Meca500 emulator]");
+    sender_ = std::thread([this] { Send(); });
+
+    std::string pending;
+    char buffer[256];
+    for (int recvd; (recvd = client_->recv(buffer, sizeof(buffer))) > 0; ) {
+      pending.append(buffer, recvd);
+      for (size_t end = pending.find('\0'); end != std::string::npos; end = pending.find('\0')) {
+        Handle(pending.substr(0, end));
+        pending.erase(0, end + 1);
+      }
+    }
+  }
+
+  void Handle(const std::string& command) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    time_t now = Component::SteadyClockTimeMs();
+    moveEnds_.erase(std::remove_if(moveEnds_.begin(), moveEnds_.end(), [now](time_t end) { return end <= now; }),
+                    moveEnds_.end());
+    int checkpoint;
+    if (command == "ActivateRobot") {
+      SayLocked(now, "[2000][Motors activated.]");
+    } else if (command == "Home") {
+      SayLocked(now, "[2002][Homing done.]");
+    } else if (command == "ResetError") {
+      SayLocked(now, "[2005][The error was reset.]");
+    } else if (command == "GetStatusRobot") {
+      SayLocked(now, "[2007][1, 1, 0, 0, 0, 1, 1]");
+    } else if (command == "GetPose") {
+      char reply[256];
+      snprintf(reply, sizeof(reply), "[2027][%g, %g, %g, %g, %g, %g]", pose_[0], pose_[1], pose_[2], pose_[3],
+               pose_[4], pose_[5]);
+      SayLocked(now, reply);
+    } else if (command.compare(0, 4, "Move") == 0) {
+      if (fail_) {
+        SayLocked(now, "[1011][The robot is in error.]");
+        return;
+      }
+      sscanf(command.c_str(), "MovePose(%lf,%lf,%lf,%lf,%lf,%lf)", &pose_[0], &pose_[1], &pose_[2], &pose_[3],
+             &pose_[4], &pose_[5]);
+      motionEnd_ = std::max(now, motionEnd_) + move_ms_;
+      moveEnds_.push_back(motionEnd_);
+      maxQueued_ = std::max(maxQueued_, (int)moveEnds_.size());
+    } else if (sscanf(command.c_str(), "SetCheckpoint(%d)", &checkpoint) == 1) {
+      if (!fail_) SayLocked(std::max(now, motionEnd_), "[3030][" + std::to_string(checkpoint) + "]");
+    }
+  }
+
+  void Say(time_t when, const std::string& message) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    SayLocked(when, message);
+  }
+
+  void SayLocked(time_t when, const std::string& message) {
+    outbox_.push_back({ when, message });
+    std::stable_sort(outbox_.begin(), outbox_.end(),
+                     [](const Message& a, const Message& b) { return a.first < b.first; });
+  }
+
+  // Sender thread body: send messages when they are due
+  void Send() {
+    while (!stop_) {
+      std::vector<std::string> due;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        while (!outbox_.empty() && outbox_.front().first <= Component::SteadyClockTimeMs()) {
+          due.push_back(outbox_.front().second);
+          outbox_.pop_front();
+        }
+      }
+      try {
+        for (const std::string& message : due) client_->send(message.c_str(), (int)message.size() + 1);
+      } catch (const SocketException&) {
+        return;  // Robot disconnected
+      }
+      Component::SleepMs(1);
+    }
+  }
+
+  using Message = std::pair<time_t, std::string>;
+
+  TCPServerSocket server_;
+  TCPSocket* client_ = NULL;
+  int move_ms_;
+  std::thread thread_;
+  std::thread sender_;
+  std::atomic<bool> stop_{ false };
+
+  std::mutex mutex_;
+  std::deque<Message> outbox_;  // by when each is due
+  time_t motionEnd_ = 0;
+  std::vector<time_t> moveEnds_;  // of queued moves
+  int maxQueued_ = 0;
+  double pose_[6] = {};
+  bool fail_ = false;
+};
+
+TEST(RobotTest, movePoseWaitsForMotion) {
+  RobotEmulator emulator(100);
+  Robot robot;
+  robot.setAddress("127.0.0.1", emulator.port());
+  ASSERT_TRUE(robot.init());
+  ASSERT_TRUE(robot.activate(true));
+
+  time_t start = Component::SteadyClockTimeMs();
+  ASSERT_TRUE(robot.movePose(1, 2, 3, 4, 5, 6));
+  time_t elapsed = Component::SteadyClockTimeMs() - start;
+  ASSERT_GE(elapsed, 100);
+  ASSERT_LT(elapsed, 200);
+  ASSERT_EQ(std::vector<double>({ 1, 2, 3, 4, 5, 6 }), robot.getPose());
+}
+
+TEST(RobotTest, queuedMovesCompleteInOrder) {
+  RobotEmulator emulator(100);
+  Robot robot;
+  robot.setAddress("127.0.0.1", emulator.port());
+  ASSERT_TRUE(robot.init());
+
+  time_t start = Component::SteadyClockTimeMs();
+  std::vector<std::future<bool>> moves;
+  for (int i = 0; i < 3; i++) moves.push_back(robot.movePoseAsync(i, 0, 0, 0, 0, 0));
+  ASSERT_LT(Component::SteadyClockTimeMs() - start, 50);  // Queued without waiting
+
+  ASSERT_TRUE(moves[0].get());
+  ASSERT_EQ(std::future_status::timeout, moves[2].wait_for(std::chrono::milliseconds(0)));
+  ASSERT_TRUE(moves[1].get());
+  ASSERT_TRUE(moves[2].get());
+  ASSERT_GE(Component::SteadyClockTimeMs() - start, 300);
+  ASSERT_EQ(3, emulator.maxQueued());
+}
+
+TEST(RobotTest, maxInFlightLimitsQueue) {
+  RobotEmulator emulator(100);
+  Robot robot;
+  robot.setAddress("127.0.0.1", emulator.port());
+  ASSERT_TRUE(robot.init());
+  robot.setMaxInFlight(1);
+
+  std::future<bool> first = robot.movePoseAsync(1, 0, 0, 0, 0, 0);
+  time_t start = Component::SteadyClockTimeMs();
+  std::future<bool> second = robot.movePoseAsync(2, 0, 0, 0, 0, 0);
+  ASSERT_GE(Component::SteadyClockTimeMs() - start, 80);  // Waited for the first
+  ASSERT_TRUE(first.get());
+  ASSERT_TRUE(second.get());
+  ASSERT_EQ(1, emulator.maxQueued());
+}
+
+TEST(RobotTest, robotErrorFailsMove) {
+  RobotEmulator emulator(100);
+  Robot robot;
+  robot.setAddress("127.0.0.1", emulator.port());
+  ASSERT_TRUE(robot.init());
+  emulator.FailMoves();
+  ASSERT_FALSE(robot.movePoseAsync(1, 0, 0, 0, 0, 0).get());
+}
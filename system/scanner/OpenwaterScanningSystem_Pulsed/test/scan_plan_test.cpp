@@ -0,0 +1,78 @@
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "googletest/googletest/include/gtest/gtest.h"
+#include "system/scanner/OpenwaterScanningSystem_Pulsed/ScanPlan.h"
+
+static std::string TempName(const std::string& name) {
+  const char* dir = getenv("TEST_TMPDIR");  // Set by bazel
+  return std::string(dir ? dir : ".") + "/" + name;
+}
+
+static std::vector<ScanPlan::Axis> Grid() {
+  return { ScanPlan::Axis("z", { 0, 1 }, 1, 100),
+           ScanPlan::Axis("y", { 0, 1, 2 }, 10),
+           ScanPlan::Axis("x", { 0, 1, 2, 3 }, 10) };
+}
+
+TEST(TestScanPlan, RasterMatchesNestedLoops) {
+  ScanPlan plan(Grid(), false);
+  ASSERT_EQ(24, plan.size());
+  int p = 0;
+  for (int zi = 0; zi < 2; zi++) {
+    for (int yi = 0; yi < 3; yi++) {
+      for (int xi = 0; xi < 4; xi++, p++) {
+        const ScanPlan::Pose& pose = plan.poses()[p];
+        ASSERT_EQ(p, pose.raster);
+        ASSERT_EQ(std::vector<int>({ zi, yi, xi }), pose.index);
+        ASSERT_EQ(std::vector<double>({ (double)zi, (double)yi, (double)xi }), pose.location);
+      }
+    }
+  }
+}
+
+TEST(TestScanPlan, SerpentineStepsOneAxisAtATime) {
+  ScanPlan plan(Grid());
+  std::set<int> rasters;
+  for (int p = 0; p < plan.size(); p++) {
+    const ScanPlan::Pose& pose = plan.poses()[p];
+    rasters.insert(pose.raster);
+    ASSERT_EQ(pose.raster, pose.index[0] * 12 + pose.index[1] * 4 + pose.index[2]);  // Maps back to the voxel
+    if (p == 0) continue;
+    int moved = 0;
+    for (int a = 0; a < 3; a++) moved += abs(pose.index[a] - plan.poses()[p - 1].index[a]);
+    ASSERT_EQ(1, moved) << p;
+  }
+  ASSERT_EQ(24, rasters.size());
+  ASSERT_LT(plan.EstimateTravel(), ScanPlan(Grid(), false).EstimateTravel());
+}
+
+TEST(TestScanPlan, SlowestAxisOutermost) {
+  std::vector<ScanPlan::Axis> axes = { ScanPlan::Axis("fast", { 0, 1, 2 }, 100),
+                                       ScanPlan::Axis("slow", { 0, 1, 2 }, 1) };
+  ScanPlan plan(axes, true, true);
+  int slowMoves = 0;
+  for (int p = 1; p < plan.size(); p++) slowMoves += plan.poses()[p].index[1] != plan.poses()[p - 1].index[1];
+  ASSERT_EQ(2, slowMoves);
+  ASSERT_EQ(3, plan.poses()[1].raster);  // Index order is still as given
+}
+
+TEST(TestScanPlan, SaveAndLoad) {
+  std::string fname = TempName("scan_plan.json");
+  ScanPlan plan(Grid(), true, true);
+  ASSERT_TRUE(plan.Save(fname));
+
+  ScanPlan loaded;
+  ASSERT_TRUE(loaded.Load(fname));
+  ASSERT_EQ(plan.size(), loaded.size());
+  for (int p = 0; p < plan.size(); p++) {
+    ASSERT_EQ(plan.poses()[p].raster, loaded.poses()[p].raster);
+    ASSERT_EQ(plan.poses()[p].location, loaded.poses()[p].location);
+  }
+  ASSERT_DOUBLE_EQ(plan.EstimateTravel(), loaded.EstimateTravel());
+  remove(fname.c_str());
+  ASSERT_FALSE(loaded.Load(fname));
+}
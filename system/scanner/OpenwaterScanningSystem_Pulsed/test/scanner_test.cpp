@@ -159,7 +159,8 @@ void CameraManager::writeVoxelData(const voxelData& newVoxelData) {}
 void CameraManager::setImageInfoStream(std::ofstream* stream, bool local) {}
 void CameraManager::setRepeatedVoxelLogStream(std::ofstream* stream) {}
 void CameraManager::startAllCameras() {}
-void CameraManager::resetAllCamerasMidscan(int frameCoutn) {}
+void CameraManager::setFrameCount(int frameCount) {}
+bool CameraManager::resetAllCamerasMidscan(int frameCoutn) { return true; }
 bool CameraManager::endExecNodes() { return true; }
 
 // Mock for ConexStage
@@ -168,6 +169,8 @@ class MockConexStage: public ConexStage {
   MOCK_METHOD1(init, bool(int comPort));
   MOCK_METHOD0(resetController, int());
   MOCK_METHOD0(moveHome, int());
+  MOCK_METHOD1(moveAbsolute, int(double location_mm));
+  MOCK_METHOD0(disableController, int());
 };
 
 class MockCameraManager: public CameraManager {
@@ -202,7 +205,7 @@ class TestScanner : public AsyncScanner {
       USTx* ustx, CameraManager* cameras, OctopusManager* octopusManager)
       : AsyncScanner(systemParams, laser, delays, xStage, yStage, zStage,
             ustx, cameras, octopusManager) {}
-  ~TestScanner() { laser_ = NULL; xStage_ = NULL; cameras_ = NULL; octopusManager_ = NULL; }  // keep parent class from deleting stack objects
+  ~TestScanner() { laser_ = NULL; xStage_ = NULL; yStage_ = NULL; cameras_ = NULL; octopusManager_ = NULL; }  // keep parent class from deleting stack objects
 };
 
 class ScannerTest : public ::testing::Test {
@@ -249,6 +252,41 @@ TEST(ScannerTest, scanCallsCameraManagerCaptureAndWriteImages_and_setVoxelEnergy
   ASSERT_TRUE(test.scan());
 }
 
+TEST(ScannerTest, serpentineScanNumbersImagesByRaster) {
+  std::stringstream scanMetadata(TestJSON);
+  json systemParameters = json::parse(scanMetadata);
+  systemParameters["scanParameters"]["xLength_mm"] = 2.0;
+  systemParameters["scanParameters"]["yLength_mm"] = 1.0;
+  systemParameters["scanParameters"]["serpentineScan"] = true;
+  testing::NiceMock<MockCameraManager> cmgr;
+  TestScanner test(systemParameters, NULL, NULL, NULL, NULL, NULL, NULL, &cmgr, NULL);
+  std::vector<int> slices;
+  EXPECT_CALL(cmgr, init(_, _)).WillOnce(Return(true));
+  EXPECT_CALL(cmgr, captureAndWriteImagesAsync(_, _, _, _, _))
+      .WillRepeatedly(testing::Invoke([&slices](int, int sliceIdx, int, int, double) {
+        if (slices.empty() || slices.back() != sliceIdx) slices.push_back(sliceIdx);
+        return 1;
+      }));
+  ASSERT_TRUE(test.init());
+  ASSERT_TRUE(test.scan());
+  // The second x line runs backwards, but keeps its raster numbers
+  ASSERT_EQ(std::vector<int>({ 0, 1, 2, 5, 4, 3 }), slices);
+}
+
+TEST(ScannerTest, scanMovesOnlyStagesThatChange) {
+  std::stringstream scanMetadata(TestJSON);
+  json systemParameters = json::parse(scanMetadata);
+  testing::NiceMock<MockConexStage> xStage, yStage;
+  TestScanner test(systemParameters, NULL, NULL, &xStage, &yStage, NULL, NULL, NULL, NULL);
+  EXPECT_CALL(xStage, init(_)).WillOnce(Return(true));
+  EXPECT_CALL(yStage, init(_)).WillOnce(Return(true));
+  EXPECT_CALL(xStage, moveAbsolute(_)).Times(49 + 1).WillRepeatedly(Return(1));
+  EXPECT_CALL(yStage, moveAbsolute(_)).Times(2).WillRepeatedly(Return(1));  // Into the first slice, and back to center
+  ASSERT_TRUE(test.init());
+  ASSERT_TRUE(test.scan());
+  ASSERT_EQ(49, test.timeline().size());
+}
+
 TEST(ScannerTest, initCallsOctopusManagerInit) {
   std::stringstream scanMetadata(TestJSON);
   json systemParameters = json::parse(scanMetadata);
@@ -276,6 +314,11 @@ bool Robot::movePose(double, double, double, double, double, double) { return fa
 bool Robot::moveLinRelTRF(double, double, double, double, double, double) { return false; }
 bool Robot::setInitJoints(double, double, double, double, double, double) { return false; }
 std::vector<double> Robot::getPose() { return std::vector<double>(6, 0.0); }
+std::future<bool> Robot::movePoseAsync(double, double, double, double, double, double) {
+  std::promise<bool> done;
+  done.set_value(false);
+  return done.get_future();
+}
 
 class MockRobot: public Robot {
  public:
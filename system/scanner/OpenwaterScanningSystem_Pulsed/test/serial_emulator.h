@@ -0,0 +1,76 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "system/component/inc/time.h"
+#include "system/scanner/OpenwaterScanningSystem_Pulsed/rs232_wrapper.h"
+
+// Emulates a serial device that handles one command at a time, as instrument
+// controllers do: each command's reply is sent process_ms after the device
+// gets to it, and the next command waits its turn.
+class SerialEmulator : public RS232 {
+ public:
+  // @param respond reply to a command (without its terminator), "" for none
+  // @param process_ms time the device takes over each command
+  // @param terminator appended to each reply
+  SerialEmulator(std::function<std::string(const std::string&)> respond, int process_ms = 1,
+                 const std::string& terminator = "\r\n")
+      : respond_(respond), process_ms_(process_ms), terminator_(terminator) {}
+
+  int Open(int port, int baud_rate, const char* mode) override { return 0; }
+  int Port() const override { return 0; }
+  void FlushRXTX() override {}
+
+  int SendString(const std::string& str) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string command = str.substr(0, str.find_first_of("\r\n"));
+    commands_.push_back(command);
+    busyUntil_ms_ = std::max(busyUntil_ms_, Component::SteadyClockTimeMs()) + process_ms_;
+    std::string reply = respond_(command);
+    if (!reply.empty()) replies_.push_back({ busyUntil_ms_, reply + terminator_ });
+    return (int)str.size();
+  }
+
+  // Hands over at most chunk bytes at a time, as a slow port would
+  int Poll(unsigned char* buffer, int max_size) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int len = 0;
+    max_size = std::min(max_size, chunk_);
+    while (len < max_size && !replies_.empty() && replies_.front().first <= Component::SteadyClockTimeMs()) {
+      std::string& reply = replies_.front().second;
+      int n = std::min(max_size - len, (int)reply.size());
+      memcpy(buffer + len, reply.data(), n);
+      len += n;
+      reply.erase(0, n);
+      if (reply.empty()) replies_.pop_front();
+    }
+    return len;
+  }
+
+  void setChunk(int chunk) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    chunk_ = chunk;
+  }
+
+  // Commands received so far, without terminators
+  std::vector<std::string> commands() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return commands_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::function<std::string(const std::string&)> respond_;
+  int process_ms_;
+  std::string terminator_;
+  int chunk_ = 1 << 20;
+  time_t busyUntil_ms_ = 0;
+  std::vector<std::string> commands_;
+  std::deque<std::pair<time_t, std::string>> replies_;  // and when each arrives
+};
@@ -0,0 +1,64 @@
+#include <future>
+#include <string>
+#include <vector>
+
+#include "googletest/googletest/include/gtest/gtest.h"
+#include "system/component/inc/time.h"
+#include "system/scanner/OpenwaterScanningSystem_Pulsed/SerialPipeline.h"
+#include "system/scanner/OpenwaterScanningSystem_Pulsed/test/serial_emulator.h"
+
+// Replies to "x?" with "x=<x>", and to "quiet" not at all
+static std::string Echo(const std::string& command) {
+  if (command == "quiet") return "";
+  return command.substr(0, command.size() - 1) + "=" + command;
+}
+
+TEST(TestSerialPipeline, RepliesMatchRequestsInOrder) {
+  SerialEmulator device(Echo, 5);
+  device.setChunk(3);  // Replies split across polls
+  SerialPipeline pipeline(&device);
+
+  time_t start = Component::SteadyClockTimeMs();
+  std::vector<std::future<std::string>> replies;
+  for (int i = 0; i < 6; i++) replies.push_back(pipeline.Request("a" + std::to_string(i) + "?\r\n"));
+  ASSERT_LT(Component::SteadyClockTimeMs() - start, 5);  // Written without waiting
+
+  for (int i = 0; i < 6; i++) ASSERT_EQ("a" + std::to_string(i) + "=a" + std::to_string(i) + "?", replies[i].get());
+  ASSERT_LT(Component::SteadyClockTimeMs() - start, 6 * 5 + 20);
+  ASSERT_EQ(6, pipeline.GetStats().replies);
+}
+
+TEST(TestSerialPipeline, PrefixPicksReply) {
+  SerialEmulator device(Echo);
+  SerialPipeline pipeline(&device);
+  std::future<std::string> b = pipeline.Request("b?\r\n", "b=");
+  ASSERT_TRUE(pipeline.Send("c?\r\n"));  // Its reply is not wanted
+  ASSERT_EQ("b=b?", b.get());
+  pipeline.Drain();
+  ASSERT_EQ("d=d?", pipeline.Request("d?\r\n", "d=").get());
+  ASSERT_EQ(1, pipeline.GetStats().unmatched);
+}
+
+TEST(TestSerialPipeline, TimeoutGivesEmptyReply) {
+  SerialEmulator device(Echo);
+  SerialPipeline pipeline(&device);
+  time_t start = Component::SteadyClockTimeMs();
+  ASSERT_EQ("", pipeline.Request("quiet\r\n", "", 50).get());
+  ASSERT_GE(Component::SteadyClockTimeMs() - start, 50);
+  ASSERT_EQ("e=e?", pipeline.Request("e?\r\n").get());
+  ASSERT_EQ(1, pipeline.GetStats().timeouts);
+}
+
+TEST(TestSerialPipeline, MaxInFlightBlocks) {
+  SerialEmulator device(Echo, 20);
+  SerialPipeline pipeline(&device, "\r\n", 2);
+  time_t start = Component::SteadyClockTimeMs();
+  std::future<std::string> f = pipeline.Request("f?\r\n");
+  std::future<std::string> g = pipeline.Request("g?\r\n");
+  ASSERT_LT(Component::SteadyClockTimeMs() - start, 10);
+  std::future<std::string> h = pipeline.Request("h?\r\n");  // Waits for f's reply
+  ASSERT_GE(Component::SteadyClockTimeMs() - start, 20);
+  ASSERT_EQ(std::future_status::ready, f.wait_for(std::chrono::milliseconds(0)));
+  ASSERT_EQ("h=h?", h.get());
+  ASSERT_EQ("g=g?", g.get());
+}
@@ -1,7 +1,12 @@
+#include <deque>
+#include <future>
+#include <mutex>
+#include <string>
 
 #include "googletest/googletest/include/gtest/gtest.h"
 #include "googletest/googlemock/include/gmock/gmock.h"
 
+#include "system/component/inc/time.h"
 #include "system/scanner/OpenwaterScanningSystem_Pulsed/ConexStage.h"
 
 using testing::Return;
@@ -16,10 +21,102 @@ class MockRS232 : public RS232 {
   MOCK_METHOD2(Poll, int(unsigned char* buffer, int max_size));
 };
 
-// Test subclass using MockRS2332
+// Emulates a CONEX-CC controller on the far end of the port.  Commands change
+// its state as they do the real controller's, moves take distance / velocity,
+// and replies arrive a couple of ms after the command.
+class ConexEmulator : public RS232 {
+ public:
+  // @param velocity_mm_s how fast moves go
+  // @param reported_mm_s velocity reported to "1VA?", if different
+  ConexEmulator(double velocity_mm_s, double reported_mm_s = 0)
+      : velocity_mm_s_(velocity_mm_s), reported_mm_s_(reported_mm_s > 0 ? reported_mm_s : velocity_mm_s) {}
+
+  int Open(int port, int baud_rate, const char* mode) override { return 0; }
+  int Port() const override { return 0; }
+  void FlushRXTX() override {}
+
+  int SendString(const std::string& str) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string command = str.substr(0, str.find('\r'));
+    Update();
+    if (command == "1TS") {
+      statusQueries_++;
+      Reply("1TS0000" + state_);
+    } else if (command == "1TP") {
+      Reply("1TP" + std::to_string(location_mm_));
+    } else if (command == "1VA?") {
+      Reply("1VA" + std::to_string(reported_mm_s_));
+    } else if (command == "1AC?") {
+      Reply("1AC1000");
+    } else if (command.compare(0, 3, "1PA") == 0) {
+      Move(atof(command.c_str() + 3), "28");
+    } else if (command == "1OR") {
+      Move(0, "1E");
+    } else if (command == "1RS") {
+      state_ = "0A";
+    } else if (command == "1MM0") {
+      state_ = "3C";
+    }
+    return (int)str.size();
+  }
+
+  int Poll(unsigned char* buffer, int max_size) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int len = 0;
+    while (len < max_size && !replies_.empty() && replies_.front().first <= Component::SteadyClockTimeMs()) {
+      std::string& reply = replies_.front().second;
+      int n = std::min(max_size - len, (int)reply.size());
+      memcpy(buffer + len, reply.data(), n);
+      len += n;
+      reply.erase(0, n);
+      if (reply.empty()) replies_.pop_front();
+    }
+    return len;
+  }
+
+  // Disable mid-move from now on, as on a following error
+  void FailMoves() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fail_ = true;
+  }
+
+  int statusQueries() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return statusQueries_;
+  }
+
+ private:
+  void Reply(const std::string& reply) {
+    replies_.push_back({ Component::SteadyClockTimeMs() + 2, reply + "\r\n" });
+  }
+
+  void Move(double location_mm, const std::string& state) {
+    moveEnd_ms_ = Component::SteadyClockTimeMs() + (time_t)(1000 * fabs(location_mm - location_mm_) / velocity_mm_s_);
+    location_mm_ = location_mm;
+    state_ = fail_ ? "3D" : state;
+  }
+
+  // Ready once the move's time is up
+  void Update() {
+    if (Component::SteadyClockTimeMs() < moveEnd_ms_) return;
+    if (state_ == "28") state_ = "33";
+    if (state_ == "1E") state_ = "32";
+  }
+
+  std::mutex mutex_;
+  double velocity_mm_s_, reported_mm_s_;
+  double location_mm_ = 0;
+  time_t moveEnd_ms_ = 0;
+  std::string state_ = "0A";  // NOT REFERENCED from reset
+  bool fail_ = false;
+  int statusQueries_ = 0;
+  std::deque<std::pair<time_t, std::string>> replies_;  // and when each arrives
+};
+
+// Test subclass using MockRS232 or ConexEmulator
 class ConexStageTest : public ConexStage {
  public:
-  ConexStageTest(MockRS232 *mock) { rs232_ = mock; }
+  ConexStageTest(RS232 *mock) { rs232_ = mock; }
   ~ConexStageTest() { rs232_ = NULL; } // keep parent class from deleting stack object
 };
 
@@ -156,3 +253,51 @@ TEST(StagesTest, moveAbsolute) {
   ON_CALL(mockRS232, Poll).WillByDefault(FakePoll);
   ASSERT_TRUE(test.moveAbsolute(2.9));
 }
+
+TEST(StagesTest, emulatedMoveFinishesSoonAfterStageStops) {
+  ConexEmulator emulator(10);
+  ConexStageTest test(&emulator);
+  ASSERT_TRUE(test.init(6));
+  ASSERT_TRUE(test.moveHome());
+
+  int queries = emulator.statusQueries();
+  time_t start = Component::SteadyClockTimeMs();
+  ASSERT_TRUE(test.moveAbsolute(2.0));  // 200 ms
+  time_t elapsed = Component::SteadyClockTimeMs() - start;
+  ASSERT_GE(elapsed, 200);
+  ASSERT_LT(elapsed, 260);
+  ASSERT_LE(emulator.statusQueries() - queries, 4);  // Not asked until nearly there
+  ASSERT_NEAR(2.0, test.getStageLocation(), 1e-6);
+}
+
+TEST(StagesTest, emulatedMoveFutureResolvesOnReady) {
+  ConexEmulator emulator(10);
+  ConexStageTest test(&emulator);
+  ASSERT_TRUE(test.init(6));
+  test.moveHome();
+
+  std::future<int> move = test.moveAbsoluteAsync(1.0);  // 100 ms
+  ASSERT_EQ(std::future_status::timeout, move.wait_for(std::chrono::milliseconds(50)));
+  ASSERT_EQ(std::future_status::ready, move.wait_for(std::chrono::milliseconds(150)));
+  ASSERT_EQ(1, move.get());
+
+  emulator.FailMoves();
+  ASSERT_EQ(-1, test.moveAbsoluteAsync(2.0).get());
+}
+
+TEST(StagesTest, emulatedMovesAdaptToSlowerStage) {
+  ConexEmulator emulator(5, 10);  // Twice as slow as it says
+  ConexStageTest test(&emulator);
+  ASSERT_TRUE(test.init(6));
+  test.moveHome();
+
+  int queries[4];
+  for (int i = 0; i < 4; i++) {
+    int before = emulator.statusQueries();
+    ASSERT_TRUE(test.moveAbsolute(i % 2 ? 0.0 : 1.0));
+    queries[i] = emulator.statusQueries() - before;
+  }
+  ASSERT_LT(queries[3], queries[0]);
+  ASSERT_GT(test.getStats().moveTimeScale, 1.5);
+  ASSERT_EQ(4, test.getStats().moves);
+}
@@ -0,0 +1,68 @@
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "googletest/googletest/include/gtest/gtest.h"
+#include "system/component/inc/time.h"
+#include "system/scanner/OpenwaterScanningSystem_Pulsed/VoxelSink.h"
+
+static int CountLines(const std::string& s) {
+  int n = 0;
+  for (char c : s) n += c == '\n';
+  return n;
+}
+
+TEST(TestVoxelSink, FlushWritesEverythingToBothStreams) {
+  std::ostringstream local, synced;
+  VoxelSink sink(1000, 60000);  // Periods far longer than the test: only Flush() writes
+  sink.SetStreams(&local, &synced);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.push_back(std::thread([&sink, t] {
+      voxelData vd;
+      vd.cameraID = t;
+      for (int i = 0; i < 1000; ++i) {
+        vd.imageName = "hologramImage" + std::to_string(i);
+        sink.Append(vd);
+      }
+    }));
+  }
+  for (std::thread& t : threads) t.join();
+  ASSERT_TRUE(sink.Flush());
+
+  ASSERT_EQ(4000, CountLines(local.str()));
+  ASSERT_EQ(local.str(), synced.str());
+  ASSERT_EQ(4000, sink.GetStats().records);
+  ASSERT_EQ(1, sink.GetStats().mirrors);
+}
+
+TEST(TestVoxelSink, WritesLocalBeforeMirroring) {
+  std::ostringstream local, synced;
+  VoxelSink sink(10, 60000);
+  sink.SetStreams(&local, &synced);
+  voxelData vd;
+  vd.imageName = "hologramImage0";
+  sink.Append(vd);
+  for (int i = 0; i < 100 && sink.GetStats().batches == 0; ++i) Component::SleepMs(10);
+  ASSERT_EQ(1, CountLines(local.str()));
+  ASSERT_TRUE(synced.str().empty());  // Not time to mirror yet
+  sink.Flush();
+  ASSERT_EQ(local.str(), synced.str());
+}
+
+TEST(TestVoxelSink, LineFormat) {
+  std::ostringstream local;
+  VoxelSink sink;
+  sink.SetStreams(&local, NULL);
+  voxelData vd;
+  vd.imageName = "hologramImage7";
+  vd.cameraID = 3;
+  vd.POSIXTime = 1234;
+  vd.roiFFTEnergy = 0.5;
+  vd.speckleContrast = 0.25;
+  sink.Append(vd);
+  sink.Flush();
+  ASSERT_EQ("hologramImage7,3,1234,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0.5,0,0,0.25\n", local.str());
+}
@@ -221,6 +221,14 @@ int CommunicatingSocket::recv(void *buffer, int bufferLen) {
   return rtn;
 }
 
+void CommunicatingSocket::shutdown() {
+  #ifdef _MSC_VER // WIN32
+    ::shutdown(sockDesc, 2);  // SD_BOTH
+  #else
+    ::shutdown(sockDesc, SHUT_RDWR);
+  #endif
+}
+
 string CommunicatingSocket::getForeignAddress() {
   sockaddr_in addr;
   unsigned int addr_len = sizeof(addr);
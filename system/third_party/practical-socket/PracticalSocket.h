@@ -170,6 +170,12 @@ public:
    */
   int recv(void *buffer, int bufferLen);
 
+  /**
+   *   Shut down both directions of the connection, so a recv() blocked in
+   *   another thread returns
+   */
+  void shutdown();
+
   /**
    *   Get the foreign address.  Call connect() before calling recv()
    *   @return foreign address
@@ -11,6 +11,7 @@
 #include "system/component/inc/cli.h"
 #include "system/component/inc/fftt.h"
 #include "system/component/inc/frame_draw.h"
+#include "system/component/inc/framehist.h"
 #include "system/component/inc/fx3.h"
 #include "system/component/inc/rcam.h"
 #include "system/component/inc/roi.h"
@@ -660,6 +661,7 @@ int main(int argc, char* argv[]) {
   dsw.Resize(camera.GetConfig());
   ROI roi(camera.GetConfig());
   ROIDraw droi(camera.GetConfig());
+  FrameHist hist;
   StdDev stddev;
   FrameStats stats;
   stats.Init(camera.GetConfig());
@@ -670,7 +672,8 @@ int main(int argc, char* argv[]) {
   save.AddProducer(&camera);
   fftt.AddProducer(&dec);
   roi.AddProducer(&fftt);
-  stddev.AddProducer(&roi);
+  hist.AddProducer(&roi);
+  stddev.AddProducer(&hist);
   stats.AddProducer(&stddev);
   df.AddProducer(&camera);
   dfftt.AddProducer(&stats);
@@ -1,6 +1,7 @@
 #include "framestats.h"
 
 #include "system/component/inc/fftt.h"
+#include "system/component/inc/framehist.h"
 #include "system/component/inc/roi.h"
 #include "system/component/inc/stddev.h"
 
@@ -47,20 +48,28 @@ void* FrameStats::Exec(void* data) {
   millis_ = GetTickCount();
 
   Frame* fr = (Frame*)data;
-  int64_t sum = 0;
-  int saturated = 0;
-  double fr_width = fr->width;
-  double fr_height = fr->height;
-
-  int satval = (1 << fr->bits) - 1;
-  for (int i = 0; i < fr->width * fr->height; ++i) {
-    sum += fr->data[i];
-    if (fr->data[i] == satval) ++saturated;
+  double mean;
+  double pct_saturated;
+  const FrameHist::Tag* hist = fr->GetTag<FrameHist::Tag>();
+  if (hist) {
+    mean = hist->Mean();
+    pct_saturated = hist->SaturatedFraction() * 100.0;
+  } else {
+    int64_t sum = 0;
+    int saturated = 0;
+    double fr_width = fr->width;
+    double fr_height = fr->height;
+
+    int satval = (1 << fr->bits) - 1;
+    for (int i = 0; i < fr->width * fr->height; ++i) {
+      sum += fr->data[i];
+      if (fr->data[i] == satval) ++saturated;
+    }
+    mean = static_cast<double>(sum) / (fr_width * fr_height);
+    pct_saturated = (double)saturated \
+      / (fr_width * fr_height) \
+      * 100.0;
   }
-  double mean = static_cast<double>(sum) / (fr_width * fr_height);
-  double pct_saturated = (double)saturated \
-    / (fr_width * fr_height) \
-    * 100.0;
 
   double roi_rou = ROI::GetTag(fr)->roi / ROI::GetTag(fr)->rou;
   double fft_max = 0;
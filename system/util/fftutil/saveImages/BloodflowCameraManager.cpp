@@ -21,6 +21,9 @@ BloodflowCameraManager::~BloodflowCameraManager() {
     while (!cameraInfoMap_[cameraID].bloodflowVoxelSave->IsExecDone()) {
       Component::SleepMs(1000);  // Wait for processing to complete before deleting any exec nodes
     }
+    if (cameraInfoMap_[cameraID].bloodflowVoxelSave->flush() != 0) {
+      std::cout << "ERROR: Camera " << cameraID << " images failed to write" << std::endl;
+    }
     this->enableSave(false);
     delete cameraInfoMap_[cameraID].camera; // Clean up camera objects
     delete cameraInfoMap_[cameraID].filterdev;
@@ -7,14 +7,22 @@
 
 #include "system/component/inc/filterdev.h"
 #include "system/component/inc/frame.h"
+#include "system/component/inc/framestore.h"
 #include "system/component/inc/stdDev.h"
 
+BloodflowVoxelSave::BloodflowVoxelSave(BloodflowCameraManager* bloodflowCameras)
+    : bloodflowCameras_(bloodflowCameras), frameStore_(new FrameStore(1, 16)) {}
+
+BloodflowVoxelSave::~BloodflowVoxelSave() {
+  delete frameStore_;  // Writes out anything still queued
+}
+
 void* BloodflowVoxelSave::Exec(void* data) {
   Frame* fr = (Frame*)data;
   std::lock_guard<std::mutex> lock(bvsMutex_);
   if (filename_ != "") {
     std::string fname = filename_ + std::to_string(fr->seq) + ".tiff";
-    fr->Write(fname.c_str());
+    frameStore_->Save(*fr, fname);
   }
 
   bloodflowVoxelData voxelData;
@@ -57,3 +65,7 @@ std::string BloodflowVoxelSave::setPulseWidth(const std::string& pulseWidth_s) {
 void BloodflowVoxelSave::enableSave(bool saveON) {
   enableSave_ = saveON;
 }
+
+int BloodflowVoxelSave::flush() {
+  return frameStore_->Flush();
+}
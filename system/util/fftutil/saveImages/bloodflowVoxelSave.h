@@ -6,11 +6,12 @@
 #include "system/component/inc/execnode.h"
 
 class BloodflowCameraManager;
+class FrameStore;
 
 class BloodflowVoxelSave : public ExecNode {
  public:
-  BloodflowVoxelSave(BloodflowCameraManager* bloodflowCameras) : bloodflowCameras_(bloodflowCameras) {}
-  ~BloodflowVoxelSave() {};
+  BloodflowVoxelSave(BloodflowCameraManager* bloodflowCameras);
+  ~BloodflowVoxelSave();
 
   std::string getFilename();
 
@@ -21,9 +22,14 @@ class BloodflowVoxelSave : public ExecNode {
   // Enable saving [work around for extra frame at beginning of continuous acquisition sequence]
   void enableSave(bool saveON);
 
+  // Wait for all queued images to be written to disk
+  // @returns number of images that failed to write
+  int flush();
+
  private:
   void* Exec(void* data) override;
   BloodflowCameraManager* bloodflowCameras_;
+  FrameStore* frameStore_;  // Writes images off the exec threads
 
   std::string filename_ = "";
   std::string pulseWidth_s_ = "";
@@ -0,0 +1,111 @@
+#undef _CRT_SECURE_NO_WARNINGS
+#define _CRT_SECURE_NO_WARNINGS
+
+// Convert between FrameFile containers and TIFF images
+//   framefile info <file.owf>
+//     Print the header and the per-frame index as CSV
+//   framefile totiff <file.owf> <prefix>
+//     Write each frame to <prefix><seq>.tiff
+//   framefile fromtiff [-p] [-n chunk_frames] <file.owf> <image.tiff> ...
+//     Pack TIFF images into a new container.  -p packs pixels to the image bit depth
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "system/component/inc/frame.h"
+#include "system/component/inc/framefile.h"
+
+static int Usage() {
+  printf("Usage: framefile info <file.owf>\n");
+  printf("       framefile totiff <file.owf> <prefix>\n");
+  printf("       framefile fromtiff [-p] [-n chunk_frames] <file.owf> <image.tiff> ...\n");
+  return -1;
+}
+
+static int Info(const char* fname) {
+  FrameFileReader reader;
+  if (reader.Open(fname) != 0) {
+    printf("Unable to open %s\n", fname);
+    return -1;
+  }
+  const FrameFile::Header& h = reader.GetHeader();
+  printf("# %d x %d, %d bits%s, %d frames, %d frames per chunk\n",
+         h.width, h.height, h.bits, h.packed ? " packed" : "", reader.Count(), h.chunk_frames);
+  printf("index,seq,camera,timestamp_ms,temperature,voxel_x,voxel_y,voxel_z,err");
+  for (uint32_t v = 0; v < h.n_values; ++v) printf(",%s", h.value_names[v]);
+  printf("\n");
+  for (int i = 0; i < reader.Count(); ++i) {
+    const FrameFile::Record& r = reader.GetRecord(i);
+    printf("%d,%d,%d,%lld,%g,%d,%d,%d,%d", i, r.seq, r.camera, (long long)r.timestamp_ms, r.temperature,
+           r.voxel[0], r.voxel[1], r.voxel[2], r.err);
+    for (uint32_t v = 0; v < h.n_values; ++v) printf(",%.9g", r.values[v]);
+    printf("\n");
+  }
+  return 0;
+}
+
+static int ToTiff(const char* fname, const char* prefix) {
+  FrameFileReader reader;
+  if (reader.Open(fname) != 0) {
+    printf("Unable to open %s\n", fname);
+    return -1;
+  }
+  Frame fr;
+  for (int i = 0; i < reader.Count(); ++i) {
+    reader.Read(i, &fr);
+    std::string out = prefix + std::to_string(fr.seq) + ".tiff";
+    if (fr.Write(out.c_str()) != 0) {
+      printf("Unable to write %s\n", out.c_str());
+      return -1;
+    }
+  }
+  printf("Wrote %d frames\n", reader.Count());
+  return 0;
+}
+
+static int FromTiff(int argc, char** argv) {
+  bool packed = false;
+  int chunk_frames = 64;
+  int arg = 0;
+  for (; arg < argc && argv[arg][0] == '-'; ++arg) {
+    if (strcmp(argv[arg], "-p") == 0) {
+      packed = true;
+    } else if (strcmp(argv[arg], "-n") == 0 && arg + 1 < argc) {
+      chunk_frames = atoi(argv[++arg]);
+    } else {
+      return Usage();
+    }
+  }
+  if (argc - arg < 2) return Usage();
+  const char* fname = argv[arg++];
+
+  FrameFileWriter writer;
+  for (int seq = 0; arg < argc; ++arg, ++seq) {
+    Frame fr;
+    if (fr.Read(argv[arg]) != 0) {
+      printf("Unable to read %s\n", argv[arg]);
+      return -1;
+    }
+    fr.seq = seq;
+    if (seq == 0 && writer.Open(fname, fr.width, fr.height, fr.bits, packed, chunk_frames) != 0) {
+      printf("Unable to create %s\n", fname);
+      return -1;
+    }
+    if (writer.Append(fr) != 0) {
+      printf("%s does not match the size or bit depth of the first image\n", argv[arg]);
+      return -1;
+    }
+  }
+  printf("Wrote %d frames\n", writer.Count());
+  return writer.Close();
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) return Usage();
+  if (strcmp(argv[1], "info") == 0) return Info(argv[2]);
+  if (strcmp(argv[1], "totiff") == 0 && argc == 4) return ToTiff(argv[2], argv[3]);
+  if (strcmp(argv[1], "fromtiff") == 0) return FromTiff(argc - 2, argv + 2);
+  return Usage();
+}
@@ -0,0 +1,34 @@
+#undef _CRT_SECURE_NO_WARNINGS
+#define _CRT_SECURE_NO_WARNINGS
+
+// Convert a binary tag log (see TagLog) to CSV
+//   taglog <file.owtag> [out.csv]
+//     Writes to stdout when no output file is given
+
+#include <cstdio>
+#include <string>
+
+#include "system/component/inc/taglog.h"
+
+int main(int argc, char** argv) {
+  if (argc < 2 || argc > 3) {
+    printf("Usage: taglog <file.owtag> [out.csv]\n");
+    return -1;
+  }
+  TagLogReader reader;
+  if (reader.Open(argv[1]) != 0) {
+    printf("Unable to read %s\n", argv[1]);
+    return -1;
+  }
+  FILE* out = stdout;
+  if (argc == 3 && !(out = fopen(argv[2], "w"))) {
+    printf("Unable to create %s\n", argv[2]);
+    return -1;
+  }
+  fprintf(out, "%s\n", reader.CsvHeader().c_str());
+  for (size_t i = 0; i < reader.Count(); ++i) {
+    fprintf(out, "%s\n", reader.Csv(reader.Record(i)).c_str());
+  }
+  if (out != stdout) fclose(out);
+  return 0;
+}
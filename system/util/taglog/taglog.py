@@ -0,0 +1,90 @@
+#!/usr/bin/python
+
+# Read binary tag logs written by TagLog (system/component/inc/taglog.h)
+#   python taglog.py <file.owtag> [out.csv]
+
+import numpy as np
+import sys
+
+_HEADER = np.dtype([('magic', 'S8'), ('version', '<u4'), ('header_bytes', '<u4'), ('record_bytes', '<u4'),
+                    ('n_groups', '<u4'), ('n_columns', '<u4'), ('reserved', '<u4')])
+_GROUP = np.dtype([('name', 'S32'), ('first_column', '<u4'), ('n_columns', '<u4')])
+_COLUMN = np.dtype([('name', 'S32'), ('type', '<u4'), ('offset', '<u4')])
+_TYPES = ['<i4', '<i8', '<f8', '<f4']
+
+# Read a tag log
+# @param fname file to read
+# @returns (records, groups)
+#   records: numpy structured array, one field per column plus 'present',
+#     a bitmask of the groups on each frame.  Columns of absent groups are zero
+#   groups: list of (group name, [column names])
+def Read(fname):
+  raw = np.fromfile(fname, dtype=np.uint8)
+  header = raw[:_HEADER.itemsize].view(_HEADER)[0]
+  if header['magic'] != b'OWTAGLOG' or header['version'] != 2:
+    raise ValueError('%s is not a tag log' % fname)
+  p = _HEADER.itemsize
+  groups = raw[p:p + header['n_groups'] * _GROUP.itemsize].view(_GROUP)
+  p += groups.nbytes
+  columns = raw[p:p + header['n_columns'] * _COLUMN.itemsize].view(_COLUMN)
+
+  names = [c['name'].decode() for c in columns]
+  group_columns = [columns[g['first_column']:g['first_column'] + g['n_columns']] for g in groups]
+  group_bytes = [max([int(c['offset']) + np.dtype(_TYPES[c['type']]).itemsize for c in gc] + [0])
+                 for gc in group_columns]
+
+  # Records only hold the groups present on their frame, so find where each one starts
+  data = raw[header['header_bytes']:]
+  sizes = {}
+  starts, masks = [], []
+  p = 0
+  while p + 4 <= len(data):
+    present = int(data[p:p + 4].view('<u4')[0])
+    if present not in sizes:
+      sizes[present] = 4 + sum(b for g, b in enumerate(group_bytes) if present & (1 << g))
+    if p + sizes[present] > len(data):
+      break  # Partial last record
+    starts.append(p)
+    masks.append(present)
+    p += sizes[present]
+  starts = np.array(starts, dtype=np.int64)
+  masks = np.array(masks, dtype='<u4')
+
+  dtype = np.dtype({'names': ['present'] + names, 'formats': ['<u4'] + [_TYPES[c['type']] for c in columns]})
+  records = np.zeros(len(starts), dtype)
+  records['present'] = masks
+  # Every record with the same groups present has the same layout
+  for present in sizes:
+    rows = np.nonzero(masks == present)[0]
+    pos = 4
+    for g, gc in enumerate(group_columns):
+      if not present & (1 << g):
+        continue
+      for c in gc:
+        t = np.dtype(_TYPES[c['type']])
+        idx = starts[rows, None] + pos + int(c['offset']) + np.arange(t.itemsize)
+        records[c['name'].decode()][rows] = np.ascontiguousarray(data[idx]).view(t)[:, 0]
+      pos += group_bytes[g]
+
+  group_list = [(g['name'].decode(), names[g['first_column']:g['first_column'] + g['n_columns']]) for g in groups]
+  return records, group_list
+
+# Write a tag log as CSV.  Columns of groups missing from a frame are left empty
+# @param fname tag log to read
+# @param out file object to write
+def ToCsv(fname, out):
+  records, groups = Read(fname)
+  out.write(', '.join(name for _, columns in groups for name in columns) + '\n')
+  for rec in records:
+    fields = []
+    for g, (_, columns) in enumerate(groups):
+      present = rec['present'] & (1 << g)
+      fields += [str(rec[name]) if present else '' for name in columns]
+    out.write(', '.join(fields) + '\n')
+
+if __name__ == '__main__':
+  if len(sys.argv) == 3:
+    with open(sys.argv[2], 'w') as out:
+      ToCsv(sys.argv[1], out)
+  else:
+    ToCsv(sys.argv[1], sys.stdout)